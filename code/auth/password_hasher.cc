@@ -0,0 +1,158 @@
+#include "password_hasher.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/crypto.h>
+
+namespace {
+
+const char* SCRYPT_PREFIX = "$scrypt$";
+
+std::string ToHex(const std::string& data) {
+    static const char* digits = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(data.size() * 2);
+    for (unsigned char ch : data) {
+        hex += digits[ch >> 4];
+        hex += digits[ch & 0xf];
+    }
+    return hex;
+}
+
+bool FromHex(const std::string& hex, std::string* data) {
+    if (hex.size() % 2)
+        return false;
+    data->clear();
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        char byte[3] = {hex[i], hex[i + 1], '\0'};
+        char* end = nullptr;
+        long v = strtol(byte, &end, 16);
+        if (end != byte + 2)
+            return false;
+        *data += static_cast<char>(v);
+    }
+    return true;
+}
+
+// 按 '$' 切分存储格式
+std::vector<std::string> Split(const std::string& s) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (true) {
+        size_t pos = s.find('$', start);
+        parts.push_back(s.substr(start, pos - start));
+        if (pos == std::string::npos)
+            break;
+        start = pos + 1;
+    }
+    return parts;
+}
+
+// 长度相同时用常量时间比较，避免泄露匹配的前缀长度
+bool SafeEqual(const std::string& a, const std::string& b) {
+    return a.size() == b.size() && CRYPTO_memcmp(a.data(), b.data(), a.size()) == 0;
+}
+
+} // namespace
+
+PasswordHasher::PasswordHasher()
+    : cost_(DEFAULT_COST), max_pending_(0), pending_(0) {
+}
+
+PasswordHasher* PasswordHasher::instance() {
+    static PasswordHasher hasher;
+    return &hasher;
+}
+
+// 只在启动时调用
+void PasswordHasher::Init(int thread_count, int max_pending, uint64_t cost) {
+    assert(thread_count > 0 && max_pending > 0);
+    assert(cost >= 2 && (cost & (cost - 1)) == 0);
+    cost_ = cost;
+    max_pending_ = max_pending;
+    pool_.reset(new ThreadPool(thread_count));
+}
+
+bool PasswordHasher::Acquire() {
+    if (++pending_ > max_pending_) {
+        --pending_;
+        LOG_WARN("PasswordHasher busy, %d pending!", max_pending_);
+        return false;
+    }
+    return true;
+}
+
+void PasswordHasher::Hash(const std::string& pwd, HashCallback callback) {
+    if (!pool_) { // 未初始化线程池时在调用线程上计算
+        std::string hash = HashNow(pwd);
+        callback(!hash.empty(), hash);
+        return;
+    }
+    if (!Acquire()) {
+        callback(false, "");
+        return;
+    }
+    pool_->AddTask([this, pwd, callback]() {
+        std::string hash = HashNow(pwd);
+        --pending_;
+        callback(!hash.empty(), hash);
+    });
+}
+
+void PasswordHasher::Verify(const std::string& pwd, const std::string& stored, VerifyCallback callback) {
+    if (!pool_) {
+        callback(true, VerifyNow(pwd, stored));
+        return;
+    }
+    if (!Acquire()) {
+        callback(false, false);
+        return;
+    }
+    pool_->AddTask([this, pwd, stored, callback]() {
+        bool match = VerifyNow(pwd, stored);
+        --pending_;
+        callback(true, match);
+    });
+}
+
+std::string PasswordHasher::HashNow(const std::string& pwd) const {
+    unsigned char salt[SALT_LEN];
+    if (RAND_bytes(salt, sizeof(salt)) != 1)
+        return "";
+    std::string salt_str(reinterpret_cast<char*>(salt), sizeof(salt));
+    std::string hash;
+    if (!Scrypt(pwd, salt_str, cost_, BLOCK_SIZE, PARALLEL, &hash))
+        return "";
+    return SCRYPT_PREFIX + std::to_string(cost_) + "$" + std::to_string(BLOCK_SIZE) + "$" +
+           std::to_string(PARALLEL) + "$" + ToHex(salt_str) + "$" + ToHex(hash);
+}
+
+bool PasswordHasher::VerifyNow(const std::string& pwd, const std::string& stored) {
+    if (stored.compare(0, strlen(SCRYPT_PREFIX), SCRYPT_PREFIX) != 0)
+        return SafeEqual(pwd, stored); // 旧的明文记录
+
+    // "", "scrypt", N, r, p, salt, hash
+    std::vector<std::string> parts = Split(stored);
+    std::string salt, expect, actual;
+    if (parts.size() != 7 || !FromHex(parts[5], &salt) || !FromHex(parts[6], &expect))
+        return false;
+    uint64_t n = strtoull(parts[2].c_str(), nullptr, 10);
+    uint64_t r = strtoull(parts[3].c_str(), nullptr, 10);
+    uint64_t p = strtoull(parts[4].c_str(), nullptr, 10);
+    if (expect.empty() || !Scrypt(pwd, salt, n, r, p, &actual))
+        return false;
+    return SafeEqual(actual, expect);
+}
+
+bool PasswordHasher::Scrypt(const std::string& pwd, const std::string& salt,
+                            uint64_t n, uint64_t r, uint64_t p, std::string* out) {
+    out->assign(HASH_LEN, '\0');
+    uint64_t max_mem = 128 * n * r * (p + 1) + (1 << 20); // scrypt 需要约 128*N*r 字节
+    return EVP_PBE_scrypt(pwd.data(), pwd.size(),
+                          reinterpret_cast<const unsigned char*>(salt.data()), salt.size(),
+                          n, r, p, max_mem,
+                          reinterpret_cast<unsigned char*>(&(*out)[0]), out->size()) == 1;
+}
@@ -0,0 +1,56 @@
+#ifndef PASSWORD_HASHER_H
+#define PASSWORD_HASHER_H
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <functional>
+
+#include "../pool/threadpool.h"
+#include "../log/log.h"
+
+// 密码哈希（scrypt）及其专用线程池
+// 哈希是 CPU 密集型操作，放在独立且大小受限的线程池里执行，不占用处理静态文件的 I/O 工作线程；
+// 排队的任务超过上限时直接失败，登录风暴不会无限堆积
+// 存储格式：$scrypt$N$r$p$盐(hex)$哈希(hex)；不带前缀的旧记录按明文比较
+class PasswordHasher {
+public:
+    using HashCallback = std::function<void(bool ok, const std::string& hash)>;
+    using VerifyCallback = std::function<void(bool ok, bool match)>;
+
+    static PasswordHasher* instance();
+
+    // thread_count 个哈希线程，最多 max_pending 个任务排队；cost 为 scrypt 的 N（2 的幂）
+    void Init(int thread_count = 2, int max_pending = 1024, uint64_t cost = DEFAULT_COST);
+
+    // 回调在哈希线程上执行，ok 为 false 表示队列已满或哈希出错
+    void Hash(const std::string& pwd, HashCallback callback);
+    void Verify(const std::string& pwd, const std::string& stored, VerifyCallback callback);
+
+    // 同步接口，调用线程上直接计算
+    std::string HashNow(const std::string& pwd) const;
+    static bool VerifyNow(const std::string& pwd, const std::string& stored);
+
+    int Pending() const { return pending_; }
+
+private:
+    PasswordHasher();
+    ~PasswordHasher() = default;
+
+    bool Acquire(); // 占用一个排队名额
+    static bool Scrypt(const std::string& pwd, const std::string& salt,
+                       uint64_t n, uint64_t r, uint64_t p, std::string* out);
+
+    static const uint64_t DEFAULT_COST = 16384;
+    static const uint64_t BLOCK_SIZE = 8;   // scrypt r
+    static const uint64_t PARALLEL = 1;     // scrypt p
+    static const size_t SALT_LEN = 16;
+    static const size_t HASH_LEN = 32;
+
+    uint64_t cost_;
+    int max_pending_;
+    std::atomic<int> pending_; //排队和执行中的任务数
+    std::unique_ptr<ThreadPool> pool_;
+};
+
+#endif // PASSWORD_HASHER_H
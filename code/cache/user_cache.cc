@@ -0,0 +1,103 @@
+#include "user_cache.h"
+
+UserCache::UserCache()
+    : shard_capacity_(DEFAULT_CAPACITY / SHARD_COUNT),
+      ttl_ms_(DEFAULT_TTL_MS), negative_ttl_ms_(DEFAULT_NEGATIVE_TTL_MS) {
+}
+
+UserCache* UserCache::instance() {
+    static UserCache cache;
+    return &cache;
+}
+
+// 只在启动时调用
+void UserCache::Init(size_t capacity, int ttl_ms, int negative_ttl_ms) {
+    Clear();
+    shard_capacity_ = capacity == 0 ? 0 : (capacity + SHARD_COUNT - 1) / SHARD_COUNT;
+    ttl_ms_ = ttl_ms;
+    negative_ttl_ms_ = negative_ttl_ms;
+}
+
+UserCache::Shard& UserCache::GetShard(const std::string& name) {
+    return shards_[std::hash<std::string>()(name) % SHARD_COUNT];
+}
+
+UserCache::LOOKUP UserCache::Get(const std::string& name, std::string* password) {
+    if (shard_capacity_ == 0)
+        return MISS;
+    Shard& shard = GetShard(name);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    auto it = shard.entries.find(name);
+    if (it == shard.entries.end())
+        return MISS;
+    Entry& entry = it->second;
+    if (entry.expires <= Clock::now()) { // 过期，顺便删掉
+        shard.lru.erase(entry.lru);
+        shard.entries.erase(it);
+        return MISS;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, entry.lru); // 移到表头
+    if (!entry.exists)
+        return NOT_FOUND;
+    if (password)
+        *password = entry.password;
+    return FOUND;
+}
+
+void UserCache::Put(const std::string& name, const std::string& password) {
+    Insert(name, true, password, ttl_ms_);
+}
+
+void UserCache::PutMissing(const std::string& name) {
+    Insert(name, false, "", negative_ttl_ms_);
+}
+
+void UserCache::Insert(const std::string& name, bool exists, const std::string& password, int ttl_ms) {
+    if (shard_capacity_ == 0 || ttl_ms <= 0)
+        return;
+    Shard& shard = GetShard(name);
+    Clock::time_point expires = Clock::now() + std::chrono::milliseconds(ttl_ms);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    auto it = shard.entries.find(name);
+    if (it != shard.entries.end()) { // 更新已有条目
+        Entry& entry = it->second;
+        entry.exists = exists;
+        entry.password = password;
+        entry.expires = expires;
+        shard.lru.splice(shard.lru.begin(), shard.lru, entry.lru);
+        return;
+    }
+    if (shard.entries.size() >= shard_capacity_) { // 分片已满，淘汰最久未使用的
+        shard.entries.erase(shard.lru.back());
+        shard.lru.pop_back();
+    }
+    shard.lru.push_front(name);
+    shard.entries[name] = Entry{exists, password, expires, shard.lru.begin()};
+}
+
+void UserCache::Invalidate(const std::string& name) {
+    Shard& shard = GetShard(name);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    auto it = shard.entries.find(name);
+    if (it == shard.entries.end())
+        return;
+    shard.lru.erase(it->second.lru);
+    shard.entries.erase(it);
+}
+
+void UserCache::Clear() {
+    for (Shard& shard : shards_) {
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        shard.lru.clear();
+        shard.entries.clear();
+    }
+}
+
+size_t UserCache::Size() {
+    size_t size = 0;
+    for (Shard& shard : shards_) {
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        size += shard.entries.size();
+    }
+    return size;
+}
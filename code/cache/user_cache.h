@@ -0,0 +1,68 @@
+#ifndef USER_CACHE_H
+#define USER_CACHE_H
+
+#include <string>
+#include <list>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+
+// 用户名 -> 密码 的进程内缓存，放在 MySQL 前面
+// 按用户名哈希分片，每个分片一把锁、独立 LRU；条目带过期时间，
+// 也缓存“用户不存在”（负缓存），避免重复查询不存在的用户
+class UserCache {
+public:
+    enum LOOKUP {
+        MISS,      // 未缓存或已过期，需要查询数据库
+        FOUND,     // 用户存在，password 已填充
+        NOT_FOUND  // 用户确定不存在
+    };
+
+    static UserCache* instance();
+
+    // capacity 为总条目上限，ttl_ms/negative_ttl_ms 为正/负缓存的有效期；capacity 为 0 时关闭缓存
+    void Init(size_t capacity, int ttl_ms, int negative_ttl_ms);
+
+    LOOKUP Get(const std::string& name, std::string* password);
+    void Put(const std::string& name, const std::string& password); // 查询命中或注册成功
+    void PutMissing(const std::string& name); // 查询确认用户不存在
+    void Invalidate(const std::string& name); // 数据库中的用户被修改/删除时调用
+    void Clear();
+
+    size_t Size();
+
+private:
+    UserCache();
+    ~UserCache() = default;
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct Entry {
+        bool exists;
+        std::string password;
+        Clock::time_point expires;
+        std::list<std::string>::iterator lru; // 在分片 LRU 链表中的位置
+    };
+
+    struct Shard {
+        std::mutex mtx;
+        std::list<std::string> lru; // 表头为最近使用
+        std::unordered_map<std::string, Entry> entries;
+    };
+
+    Shard& GetShard(const std::string& name);
+    void Insert(const std::string& name, bool exists, const std::string& password, int ttl_ms);
+
+    static const int SHARD_COUNT = 16;
+    static const size_t DEFAULT_CAPACITY = 65536;
+    static const int DEFAULT_TTL_MS = 60000;
+    static const int DEFAULT_NEGATIVE_TTL_MS = 5000;
+
+    Shard shards_[SHARD_COUNT];
+    size_t shard_capacity_; //每个分片的条目上限
+    int ttl_ms_;
+    int negative_ttl_ms_;
+};
+
+#endif // USER_CACHE_H
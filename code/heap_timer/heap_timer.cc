@@ -37,8 +37,8 @@ void HeapTimer::Tick() {
         TimerNode node = heap_.front();
         if (std::chrono::duration_cast<MS>(node.expires - Clock::now()).count() > 0)
             break;
+        Pop(); // 先移除，回调中可以为同一个 id 重新添加定时器
         node.cb();
-        Pop();
     }
 }
 
@@ -74,12 +74,11 @@ void HeapTimer::SwapNode(size_t i, size_t j) {
 // 向上调整算法
 void HeapTimer::SiftUp(size_t child) {
     assert(child < heap_.size());
-    size_t parent = (child - 1) / 2;
-    while (parent > 0) {
+    while (child > 0) {
+        size_t parent = (child - 1) / 2;
         if (heap_[parent] > heap_[child]) {
             SwapNode(child, parent);
             child = parent;
-            parent = (child - 1) / 2;
         } else {
             break;
         }
@@ -110,7 +109,7 @@ bool HeapTimer::SiftDown(size_t parent, size_t n) {
 void HeapTimer::Delete(size_t i) {
     assert(!heap_.empty() && i < heap_.size());
     size_t n = heap_.size() - 1;
-    if (i < n - 1) { // 跳过n
+    if (i < n) { // 与最后一个节点交换，i 本身就是最后一个时跳过
         SwapNode(i, n);
         if (!SiftDown(i, n))
             SiftUp(i);
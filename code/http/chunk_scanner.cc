@@ -0,0 +1,91 @@
+#include "chunk_scanner.h"
+
+#include <cassert>
+
+const size_t ChunkScanner::MAX_SIZE_DIGITS;
+const size_t ChunkScanner::MAX_LINE;
+
+void ChunkScanner::Init() {
+    state_ = SIZE;
+    data_left_ = 0;
+    digits_ = 0;
+    line_ = 0;
+}
+
+void ChunkScanner::Skip(size_t len) {
+    assert(state_ == DATA && len <= data_left_);
+    data_left_ -= len;
+    if (data_left_ == 0)
+        state_ = DATA_CR;
+}
+
+// 1a;name=value\r\n <1a 字节内容>\r\n ... 0\r\n <尾部字段>\r\n
+long ChunkScanner::Scan(const char* data, size_t len) {
+    size_t i = 0;
+    for (; i < len && state_ != DATA && state_ != DONE && state_ != ERROR; ++i) {
+        char ch = data[i];
+        switch (state_) {
+        case SIZE: {
+            int digit = ch >= '0' && ch <= '9' ? ch - '0' :
+                        (ch | 0x20) >= 'a' && (ch | 0x20) <= 'f' ? (ch | 0x20) - 'a' + 10 : -1;
+            if (digit >= 0 && digits_ < MAX_SIZE_DIGITS) {
+                data_left_ = data_left_ * 16 + digit;
+                ++digits_;
+            } else if (digits_ > 0 && (ch == ';' || ch == ' ' || ch == '\t')) {
+                state_ = EXTENSION;
+                line_ = 0;
+            } else if (digits_ > 0 && ch == '\r') {
+                state_ = SIZE_LF;
+            } else {
+                state_ = ERROR;
+            }
+            break;
+        }
+        case EXTENSION:
+            if (ch == '\r')
+                state_ = SIZE_LF;
+            else if (++line_ > MAX_LINE)
+                state_ = ERROR;
+            break;
+        case SIZE_LF:
+            if (ch != '\n') {
+                state_ = ERROR;
+            } else if (data_left_ == 0) {
+                state_ = TRAILER;
+            } else {
+                state_ = DATA;
+                digits_ = 0;
+            }
+            break;
+        case DATA_CR:
+            state_ = ch == '\r' ? DATA_LF : ERROR;
+            break;
+        case DATA_LF:
+            state_ = ch == '\n' ? SIZE : ERROR;
+            break;
+        case TRAILER:
+            if (ch == '\r') {
+                state_ = FINAL_LF;
+            } else {
+                state_ = TRAILER_LINE;
+                line_ = 1;
+            }
+            break;
+        case TRAILER_LINE:
+            if (ch == '\r')
+                state_ = TRAILER_LF;
+            else if (++line_ > MAX_LINE)
+                state_ = ERROR;
+            break;
+        case TRAILER_LF:
+            state_ = ch == '\n' ? TRAILER : ERROR;
+            break;
+        case FINAL_LF:
+            state_ = ch == '\n' ? DONE : ERROR;
+            break;
+        default:
+            break;
+        }
+    }
+    return state_ == ERROR ? -1 : static_cast<long>(i);
+}
@@ -0,0 +1,49 @@
+#ifndef CHUNK_SCANNER_H
+#define CHUNK_SCANNER_H
+
+#include <cstddef>
+#include <cstdint>
+
+// 分块编码（Transfer-Encoding: chunked）报文体的边界跟踪，不做任何 I/O，也不拷贝数据
+// 块大小行、块之后的回车换行和尾部字段称为框架，由 Scan 逐字节解析；块内容只按长度跳过，
+// 调用方可以不看内容直接搬运（如 splice），只有框架需要读到用户态
+class ChunkScanner {
+public:
+    enum STATE {
+        SIZE,        // 块大小的十六进制数字
+        EXTENSION,   // 块扩展，跳过
+        SIZE_LF,     // 块大小行的换行
+        DATA,        // 块内容，DataLeft() 字节
+        DATA_CR,     // 块内容之后的回车换行
+        DATA_LF,
+        TRAILER,     // 最后一块之后的尾部字段，或结尾的空行
+        TRAILER_LINE,
+        TRAILER_LF,
+        FINAL_LF,    // 结尾空行的换行
+        DONE,
+        ERROR
+    };
+
+    ChunkScanner() { Init(); }
+
+    void Init();
+    // data 从框架中的某个位置开始：返回从头开始属于框架的字节数，遇到块内容或报文结束时停下；
+    // 格式错误时返回 -1
+    long Scan(const char* data, size_t len);
+    size_t DataLeft() const { return state_ == DATA ? data_left_ : 0; } // 当前块还未跳过的内容
+    void Skip(size_t len); // 跳过 len 字节块内容，不超过 DataLeft()
+
+    bool IsDone() const { return state_ == DONE; }
+    STATE State() const { return state_; }
+
+private:
+    static const size_t MAX_SIZE_DIGITS = 15;  // 块大小最多 15 个十六进制数字，不会溢出
+    static const size_t MAX_LINE = 4096;       // 块扩展或尾部字段行的最大长度
+
+    STATE state_;
+    uint64_t data_left_;
+    size_t digits_;   // 已读到的块大小数字个数
+    size_t line_;     // 当前块扩展或尾部字段行已读的长度
+};
+
+#endif // CHUNK_SCANNER_H
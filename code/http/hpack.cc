@@ -0,0 +1,387 @@
+#include "hpack.h"
+
+#include <vector>
+
+namespace {
+
+struct StaticEntry {
+    const char* name;
+    const char* value;
+};
+
+// RFC 7541 附录 B 的 Huffman 编码，下标为符号，256 为 EOS
+const uint32_t HUFFMAN_CODES[257] = {
+    0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5, 0xfffffe6, 0xfffffe7,
+    0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9, 0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec,
+    0xfffffed, 0xfffffee, 0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+    0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9, 0xffffffa, 0xffffffb,
+    0x14, 0x3f8, 0x3f9, 0xffa, 0x1ff9, 0x15, 0xf8, 0x7fa,
+    0x3fa, 0x3fb, 0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+    0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+    0x1e, 0x1f, 0x5c, 0xfb, 0x7ffc, 0x20, 0xffb, 0x3fc,
+    0x1ffa, 0x21, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+    0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+    0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72,
+    0xfc, 0x73, 0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+    0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5, 0x25, 0x26,
+    0x27, 0x6, 0x74, 0x75, 0x28, 0x29, 0x2a, 0x7,
+    0x2b, 0x76, 0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+    0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd, 0x1ffd, 0xffffffc,
+    0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8, 0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9,
+    0x3fffd6, 0x7fffda, 0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+    0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1, 0x7fffe2, 0x7fffe3,
+    0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5, 0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef,
+    0x3fffda, 0x1fffdd, 0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+    0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf, 0x7fffeb, 0x7fffec,
+    0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2, 0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef,
+    0xfffea, 0x3fffe2, 0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+    0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2, 0x3fffe8, 0x1ffffec,
+    0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde, 0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed,
+    0x7fff2, 0x1fffe3, 0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+    0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3, 0x7ffffe4, 0x7ffffe5,
+    0xfffec, 0xfffff3, 0xfffed, 0x1fffe6, 0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3,
+    0x3fffea, 0x3fffeb, 0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+    0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8, 0x7ffffe9, 0x7ffffea,
+    0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed, 0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee,
+    0x3fffffff,
+};
+
+const uint8_t HUFFMAN_BITS[257] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+    6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+    5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+    13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+    15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+    6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+    30,
+};
+
+// RFC 7541 附录 A 的静态表，下标从 1 开始
+const StaticEntry STATIC_TABLE[61] = {
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+};
+
+const size_t STATIC_COUNT = 61;
+const size_t ENTRY_OVERHEAD = 32; // RFC 7541 4.1
+
+// Huffman 解码树，node[0] 为根；叶子的 symbol 为符号，中间节点为 -1
+struct HuffmanTree {
+    struct Node {
+        int child[2] = {0, 0};
+        int symbol = -1;
+    };
+    std::vector<Node> nodes;
+
+    HuffmanTree() : nodes(1) {
+        for (int sym = 0; sym < 257; ++sym) {
+            int node = 0;
+            for (int bit = HUFFMAN_BITS[sym] - 1; bit >= 0; --bit) {
+                int b = (HUFFMAN_CODES[sym] >> bit) & 1;
+                if (nodes[node].child[b] == 0) {
+                    nodes[node].child[b] = nodes.size();
+                    nodes.emplace_back();
+                }
+                node = nodes[node].child[b];
+            }
+            nodes[node].symbol = sym;
+        }
+    }
+};
+
+const HuffmanTree& Tree() {
+    static const HuffmanTree tree;
+    return tree;
+}
+
+} // namespace
+
+HpackDecoder::HpackDecoder(size_t max_table_size)
+    : size_(0), max_size_(max_table_size), limit_(max_table_size) {}
+
+bool HpackDecoder::Decode(const uint8_t* data, size_t len, const HeaderCallback& on_header) {
+    const uint8_t* p = data;
+    const uint8_t* end = data + len;
+    bool field_seen = false; // 动态表大小更新只能出现在头部块的开头
+    std::string name, value;
+    while (p < end) {
+        uint8_t first = *p;
+        uint64_t index = 0;
+        if (first & 0x80) { // 1xxxxxxx 索引
+            if (!Hpack::DecodeInteger(&p, end, 7, &index) || !Lookup(index, &name, &value))
+                return false;
+        } else if ((first & 0xe0) == 0x20) { // 001xxxxx 动态表大小更新
+            if (field_seen || !Hpack::DecodeInteger(&p, end, 5, &index) || index > limit_)
+                return false;
+            max_size_ = index;
+            Evict(max_size_);
+            continue;
+        } else {
+            // 01xxxxxx 加入动态表；0000xxxx 不加入；0001xxxx 永不加入
+            bool indexing = (first & 0xc0) == 0x40;
+            if (!Hpack::DecodeInteger(&p, end, indexing ? 6 : 4, &index))
+                return false;
+            if (index == 0) {
+                if (!Hpack::DecodeString(&p, end, &name))
+                    return false;
+            } else if (!Lookup(index, &name, nullptr)) {
+                return false;
+            }
+            if (!Hpack::DecodeString(&p, end, &value))
+                return false;
+            if (indexing)
+                Insert(name, value);
+        }
+        field_seen = true;
+        if (!on_header(name, value))
+            return false;
+    }
+    return true;
+}
+
+bool HpackDecoder::Lookup(uint64_t index, std::string* name, std::string* value) const {
+    if (index == 0)
+        return false;
+    if (index <= STATIC_COUNT) {
+        name->assign(STATIC_TABLE[index - 1].name);
+        if (value)
+            value->assign(STATIC_TABLE[index - 1].value);
+        return true;
+    }
+    index -= STATIC_COUNT + 1;
+    if (index >= table_.size())
+        return false;
+    *name = table_[index].name;
+    if (value)
+        *value = table_[index].value;
+    return true;
+}
+
+// 新项比上限还大时清空动态表，不插入
+void HpackDecoder::Insert(const std::string& name, const std::string& value) {
+    size_t size = name.size() + value.size() + ENTRY_OVERHEAD;
+    if (size > max_size_) {
+        Evict(0);
+        return;
+    }
+    Evict(max_size_ - size);
+    table_.push_front({name, value});
+    size_ += size;
+}
+
+void HpackDecoder::Evict(size_t max_size) {
+    while (size_ > max_size && !table_.empty()) {
+        size_ -= table_.back().name.size() + table_.back().value.size() + ENTRY_OVERHEAD;
+        table_.pop_back();
+    }
+}
+
+void Hpack::EncodeStatus(int code, std::string* out) {
+    int index = 0;
+    switch (code) {
+    case 200: index = 8; break;
+    case 204: index = 9; break;
+    case 206: index = 10; break;
+    case 304: index = 11; break;
+    case 400: index = 12; break;
+    case 404: index = 13; break;
+    case 500: index = 14; break;
+    default: break;
+    }
+    if (index > 0) {
+        EncodeInteger(index, 7, 0x80, out);
+        return;
+    }
+    EncodeHeader(8, std::to_string(code), out);
+}
+
+void Hpack::EncodeHeader(int name_index, std::string_view value, std::string* out) {
+    EncodeInteger(name_index, 4, 0x00, out);
+    EncodeString(value, out);
+}
+
+void Hpack::EncodeHeader(std::string_view name, std::string_view value, std::string* out) {
+    out->push_back(0x00);
+    EncodeString(name, out);
+    EncodeString(value, out);
+}
+
+// 前缀 prefix_bits 位放不下时，剩余部分每 7 位一个字节，最高位表示后面还有
+void Hpack::EncodeInteger(uint64_t value, int prefix_bits, uint8_t first, std::string* out) {
+    uint64_t max_prefix = (1u << prefix_bits) - 1;
+    if (value < max_prefix) {
+        out->push_back(static_cast<char>(first | value));
+        return;
+    }
+    out->push_back(static_cast<char>(first | max_prefix));
+    value -= max_prefix;
+    while (value >= 0x80) {
+        out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out->push_back(static_cast<char>(value));
+}
+
+void Hpack::EncodeString(std::string_view str, std::string* out) {
+    size_t huffman = HuffmanLength(str);
+    if (huffman < str.size()) {
+        EncodeInteger(huffman, 7, 0x80, out);
+        HuffmanEncode(str, out);
+    } else {
+        EncodeInteger(str.size(), 7, 0x00, out);
+        out->append(str.data(), str.size());
+    }
+}
+
+bool Hpack::DecodeInteger(const uint8_t** p, const uint8_t* end, int prefix_bits, uint64_t* value) {
+    if (*p >= end)
+        return false;
+    uint64_t max_prefix = (1u << prefix_bits) - 1;
+    *value = *(*p)++ & max_prefix;
+    if (*value < max_prefix)
+        return true;
+    for (int shift = 0; *p < end; shift += 7) {
+        if (shift > 56) // 超过 64 位
+            return false;
+        uint8_t byte = *(*p)++;
+        *value += static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+bool Hpack::DecodeString(const uint8_t** p, const uint8_t* end, std::string* out) {
+    if (*p >= end)
+        return false;
+    bool huffman = **p & 0x80;
+    uint64_t len = 0;
+    if (!DecodeInteger(p, end, 7, &len) || len > static_cast<uint64_t>(end - *p))
+        return false;
+    const uint8_t* data = *p;
+    *p += len;
+    if (huffman)
+        return HuffmanDecode(data, len, out);
+    out->assign(reinterpret_cast<const char*>(data), len);
+    return true;
+}
+
+size_t Hpack::HuffmanLength(std::string_view str) {
+    size_t bits = 0;
+    for (unsigned char ch : str)
+        bits += HUFFMAN_BITS[ch];
+    return (bits + 7) / 8;
+}
+
+void Hpack::HuffmanEncode(std::string_view str, std::string* out) {
+    uint64_t bits = 0; // 待输出的位，低 count 位有效
+    int count = 0;
+    for (unsigned char ch : str) {
+        bits = (bits << HUFFMAN_BITS[ch]) | HUFFMAN_CODES[ch];
+        count += HUFFMAN_BITS[ch];
+        while (count >= 8) {
+            count -= 8;
+            out->push_back(static_cast<char>(bits >> count));
+        }
+    }
+    if (count > 0) // 用 EOS 的高位（全 1）补齐
+        out->push_back(static_cast<char>((bits << (8 - count)) | (0xff >> count)));
+}
+
+// 末尾不足一个符号的位必须是不超过 7 位的全 1（EOS 的前缀），EOS 本身不能出现
+bool Hpack::HuffmanDecode(const uint8_t* data, size_t len, std::string* out) {
+    const HuffmanTree& tree = Tree();
+    out->clear();
+    int node = 0;
+    int depth = 0;      // 当前符号已读的位数
+    bool ones = true;   // 当前符号已读的位是否全为 1
+    for (size_t i = 0; i < len; ++i) {
+        for (int bit = 7; bit >= 0; --bit) {
+            int b = (data[i] >> bit) & 1;
+            node = tree.nodes[node].child[b];
+            if (node == 0)
+                return false;
+            ++depth;
+            ones = ones && b;
+            int symbol = tree.nodes[node].symbol;
+            if (symbol >= 0) {
+                if (symbol == 256)
+                    return false;
+                out->push_back(static_cast<char>(symbol));
+                node = 0;
+                depth = 0;
+                ones = true;
+            }
+        }
+    }
+    return depth <= 7 && ones;
+}
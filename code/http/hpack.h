@@ -0,0 +1,68 @@
+#ifndef HPACK_H
+#define HPACK_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <deque>
+#include <functional>
+
+// HPACK（RFC 7541）头部压缩
+// 解码器维护对端编码时使用的动态表，整数、字符串和 Huffman 编码都按 RFC 处理；
+// 编码不使用动态表，响应头只用静态表的名称加字面值，不受对端动态表大小设置的影响
+class HpackDecoder {
+public:
+    // 回调返回 false 时中止解码（如头部总长度超限）
+    using HeaderCallback = std::function<bool(const std::string& name, const std::string& value)>;
+
+    // max_table_size 为通过 SETTINGS_HEADER_TABLE_SIZE 告知对端的动态表上限
+    explicit HpackDecoder(size_t max_table_size = 4096);
+
+    // 解码一个完整的头部块；格式错误时返回 false，连接应以 COMPRESSION_ERROR 关闭
+    bool Decode(const uint8_t* data, size_t len, const HeaderCallback& on_header);
+
+    size_t TableSize() const { return size_; }
+    size_t TableEntries() const { return table_.size(); }
+
+private:
+    struct Entry {
+        std::string name;
+        std::string value;
+    };
+
+    bool Lookup(uint64_t index, std::string* name, std::string* value) const;
+    void Insert(const std::string& name, const std::string& value);
+    void Evict(size_t max_size);
+
+    std::deque<Entry> table_; // 最新的在前，对应下标 62
+    size_t size_;             // 每项为名称、值的长度加 32
+    size_t max_size_;         // 对端通过大小更新指令设置的当前上限
+    size_t limit_;            // 当前上限不能超过它
+};
+
+// 编码和基本类型的编解码
+class Hpack {
+public:
+    static const int NAME_CONTENT_LENGTH = 28; // 静态表中的名称下标
+    static const int NAME_CONTENT_TYPE = 31;
+    static const int NAME_DATE = 33;
+    static const int NAME_LOCATION = 46;
+    static const int NAME_SERVER = 54;
+
+    static void EncodeStatus(int code, std::string* out); // ":status"，常见的状态码直接用静态表下标
+    // 不加入动态表的字面值，名称用静态表下标；值较短时用 Huffman 编码
+    static void EncodeHeader(int name_index, std::string_view value, std::string* out);
+    static void EncodeHeader(std::string_view name, std::string_view value, std::string* out); // 名称为小写
+
+    static void EncodeInteger(uint64_t value, int prefix_bits, uint8_t first, std::string* out);
+    static void EncodeString(std::string_view str, std::string* out);
+    static bool DecodeInteger(const uint8_t** p, const uint8_t* end, int prefix_bits, uint64_t* value);
+    static bool DecodeString(const uint8_t** p, const uint8_t* end, std::string* out);
+
+    static size_t HuffmanLength(std::string_view str);
+    static void HuffmanEncode(std::string_view str, std::string* out);
+    static bool HuffmanDecode(const uint8_t* data, size_t len, std::string* out);
+};
+
+#endif // HPACK_H
@@ -0,0 +1,733 @@
+#include "http2_session.h"
+
+#include <sys/mman.h> // munmap
+#include <cstring>
+#include <algorithm>
+
+const size_t Http2Session::PREFACE_LEN;
+const size_t Http2Session::FRAME_HEADER_LEN;
+const uint32_t Http2Session::MAX_CONCURRENT_STREAMS;
+const int32_t Http2Session::LOCAL_WINDOW;
+const size_t Http2Session::MAX_FRAME_SIZE;
+const size_t Http2Session::MAX_HEADER_BLOCK;
+const int Http2Session::MAX_DATA_FRAMES;
+
+namespace {
+
+const char PREFACE[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+const int64_t MAX_WINDOW = 0x7fffffff;
+const int64_t DEFAULT_WINDOW = 65535;
+
+enum SETTING {
+    SETTINGS_HEADER_TABLE_SIZE = 0x1,
+    SETTINGS_ENABLE_PUSH = 0x2,
+    SETTINGS_MAX_CONCURRENT_STREAMS = 0x3,
+    SETTINGS_INITIAL_WINDOW_SIZE = 0x4,
+    SETTINGS_MAX_FRAME_SIZE = 0x5,
+    SETTINGS_MAX_HEADER_LIST_SIZE = 0x6
+};
+
+uint32_t ReadUint32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+
+void AppendUint32(std::string* out, uint32_t value) {
+    out->push_back(static_cast<char>(value >> 24));
+    out->push_back(static_cast<char>(value >> 16));
+    out->push_back(static_cast<char>(value >> 8));
+    out->push_back(static_cast<char>(value));
+}
+
+// HTTP2-Settings 为 base64url 编码，不带填充
+bool DecodeBase64Url(const std::string& in, std::string* out) {
+    uint32_t bits = 0;
+    int count = 0;
+    for (char ch : in) {
+        int value;
+        if (ch >= 'A' && ch <= 'Z') value = ch - 'A';
+        else if (ch >= 'a' && ch <= 'z') value = ch - 'a' + 26;
+        else if (ch >= '0' && ch <= '9') value = ch - '0' + 52;
+        else if (ch == '-' || ch == '+') value = 62;
+        else if (ch == '_' || ch == '/') value = 63;
+        else if (ch == '=') break;
+        else return false;
+        bits = (bits << 6) | value;
+        count += 6;
+        if (count >= 8) {
+            count -= 8;
+            out->push_back(static_cast<char>(bits >> count));
+        }
+    }
+    return true;
+}
+
+// 连接相关的头部在 HTTP/2 中不允许出现
+bool IsConnectionHeader(const std::string& name) {
+    return name == "connection" || name == "keep-alive" || name == "proxy-connection" ||
+           name == "transfer-encoding" || name == "upgrade";
+}
+
+} // namespace
+
+Http2Session::Stream::Stream(uint32_t stream_id)
+    : id(stream_id), remote_closed(false), dispatched(false), responded(false), closed(false), head(false),
+      send_window(0), recv_window(LOCAL_WINDOW), body(nullptr), body_len(0), sent(0), map(nullptr), map_len(0) {}
+
+Http2Session::Stream::~Stream() {
+    if (map)
+        munmap(map, map_len);
+}
+
+Http2Session::Http2Session(const char* src_dir, int max_streams, Buffer* out, QueueBody queue)
+    : src_dir_(src_dir), max_streams_(max_streams), out_(out), queue_(std::move(queue)),
+      pending_(nullptr), active_(0), last_stream_id_(0), opened_(0),
+      preface_(false), settings_sent_(false), draining_(false), goaway_sent_(false), closing_(false),
+      header_stream_(0), header_end_stream_(false),
+      send_window_(DEFAULT_WINDOW), recv_window_(DEFAULT_WINDOW), initial_window_(DEFAULT_WINDOW),
+      peer_max_frame_(MAX_FRAME_SIZE) {}
+
+int Http2Session::MatchPreface(const char* data, size_t len) {
+    size_t n = std::min(len, PREFACE_LEN);
+    if (memcmp(data, PREFACE, n) != 0)
+        return -1;
+    return n == PREFACE_LEN ? 1 : 0;
+}
+
+bool Http2Session::IsUpgrade(const HttpRequest& request) {
+    return request.IsUpgrade("h2c") && !request.GetHeader("HTTP2-Settings").empty();
+}
+
+bool Http2Session::Upgrade(const HttpRequest& request, HttpResponse& response) {
+    std::string settings;
+    if (!DecodeBase64Url(request.GetHeader("HTTP2-Settings"), &settings) ||
+        ApplySettings(reinterpret_cast<const uint8_t*>(settings.data()), settings.size()) != NO_ERROR) {
+        LOG_WARN("Bad HTTP2-Settings");
+        return false;
+    }
+    out_->Append("HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n");
+    WriteSettings();
+    // 升级的请求成为流 1，对端已不会再发送它的请求体
+    Stream* stream = NewStream(1);
+    stream->remote_closed = true;
+    stream->dispatched = true;
+    stream->head = request.Method() == "HEAD";
+    Send(stream, response);
+    LOG_DEBUG("Upgraded to h2c");
+    return true;
+}
+
+void Http2Session::Process(Buffer& in) {
+    done_.clear(); // 上一批已经写完
+    if (IsSuspended())
+        return;
+    if (!preface_ && !closing_) {
+        int ret = MatchPreface(in.ReadBegin(), in.ReadableBytes());
+        if (ret < 0) {
+            LOG_WARN("Bad HTTP/2 preface");
+            ConnectionError(PROTOCOL_ERROR);
+        } else if (ret > 0) {
+            in.Retrieve(PREFACE_LEN);
+            preface_ = true;
+            if (!settings_sent_)
+                WriteSettings();
+        }
+    }
+    while (preface_ && !closing_ && !IsSuspended() && in.ReadableBytes() >= FRAME_HEADER_LEN) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(in.ReadBegin());
+        size_t len = (size_t(p[0]) << 16) | (size_t(p[1]) << 8) | p[2];
+        if (len > MAX_FRAME_SIZE) {
+            LOG_WARN("HTTP/2 frame too large: %zu", len);
+            ConnectionError(FRAME_SIZE_ERROR);
+            break;
+        }
+        if (in.ReadableBytes() < FRAME_HEADER_LEN + len)
+            break;
+        HandleFrame(p[3], p[4], ReadUint32(p + 5) & 0x7fffffff, p + FRAME_HEADER_LEN, len);
+        in.Retrieve(FRAME_HEADER_LEN + len);
+    }
+    if (!closing_)
+        WriteData();
+    Sweep();
+}
+
+void Http2Session::Verify(HttpRequest::VerifyCallback done) {
+    assert(pending_);
+    pending_->request.Verify(std::move(done));
+}
+
+void Http2Session::Resume(HttpRequest::VERIFY_RESULT result) {
+    assert(pending_);
+    done_.clear();
+    Stream* stream = pending_;
+    pending_ = nullptr;
+    stream->request.SetVerifyResult(result);
+    int code = result == HttpRequest::VERIFY_UNAVAILABLE ? 503 : 200;
+    response_.Init(HttpRequest::VerifyPage(result), src_dir_, code);
+    Send(stream, response_);
+    if (!closing_)
+        WriteData();
+    Sweep();
+}
+
+void Http2Session::HandleFrame(uint8_t type, uint8_t flags, uint32_t id, const uint8_t* payload, size_t len) {
+    // 头部块必须连续，中间不能插入其他帧
+    if (header_stream_ != 0 && type != CONTINUATION) {
+        ConnectionError(PROTOCOL_ERROR);
+        return;
+    }
+    switch (type) {
+    case DATA: OnData(flags, id, payload, len); break;
+    case HEADERS: OnHeaders(flags, id, payload, len); break;
+    case PRIORITY: // 不按优先级调度，只检查格式
+        if (id == 0) {
+            ConnectionError(PROTOCOL_ERROR);
+        } else if (len != 5) {
+            StreamError(id, FRAME_SIZE_ERROR);
+        }
+        break;
+    case RST_STREAM: OnRstStream(id, payload, len); break;
+    case SETTINGS: OnSettings(flags, id, payload, len); break;
+    case PUSH_PROMISE: ConnectionError(PROTOCOL_ERROR); break; // 客户端不能推送
+    case PING: OnPing(flags, id, payload, len); break;
+    case GOAWAY: OnGoAway(id, payload, len); break;
+    case WINDOW_UPDATE: OnWindowUpdate(id, payload, len); break;
+    case CONTINUATION: OnContinuation(flags, id, payload, len); break;
+    default: break; // 未知的帧类型忽略
+    }
+}
+
+bool Http2Session::StripPadding(uint8_t flags, const uint8_t** payload, size_t* len) {
+    if (!(flags & PADDED))
+        return true;
+    if (*len < 1 || (*payload)[0] >= *len) {
+        ConnectionError(PROTOCOL_ERROR);
+        return false;
+    }
+    *len -= 1 + (*payload)[0];
+    *payload += 1;
+    return true;
+}
+
+void Http2Session::OnData(uint8_t flags, uint32_t id, const uint8_t* payload, size_t len) {
+    if (id == 0 || id > last_stream_id_) {
+        ConnectionError(PROTOCOL_ERROR);
+        return;
+    }
+    // 整个帧（含填充）都计入流量控制，包括已关闭的流上的
+    recv_window_ -= len;
+    if (recv_window_ < 0) {
+        ConnectionError(FLOW_CONTROL_ERROR);
+        return;
+    }
+    if (recv_window_ <= LOCAL_WINDOW / 2) {
+        WriteWindowUpdate(0, LOCAL_WINDOW - recv_window_);
+        recv_window_ = LOCAL_WINDOW;
+    }
+    Stream* stream = Find(id);
+    if (!stream) // 已经关闭或重置的流，对端发出时还不知道
+        return;
+    if (stream->remote_closed) {
+        StreamError(id, STREAM_CLOSED);
+        return;
+    }
+    stream->recv_window -= len;
+    if (stream->recv_window < 0) {
+        StreamError(id, FLOW_CONTROL_ERROR);
+        return;
+    }
+    if (!StripPadding(flags, &payload, &len))
+        return;
+    if (stream->dispatched) {
+        // 响应已确定（如请求体过大），剩余的请求体丢弃
+    } else if (stream->upload) {
+        stream->upload->Feed(reinterpret_cast<const char*>(payload), len);
+    } else if (stream->request.AppendBody(reinterpret_cast<const char*>(payload), len) ==
+               HttpRequest::PARSE_TOO_LARGE) {
+        SendError(stream, 413);
+    }
+    if (flags & END_STREAM) {
+        EndOfBody(stream);
+    } else if (stream->recv_window <= LOCAL_WINDOW / 2) {
+        WriteWindowUpdate(id, LOCAL_WINDOW - stream->recv_window);
+        stream->recv_window = LOCAL_WINDOW;
+    }
+}
+
+void Http2Session::OnHeaders(uint8_t flags, uint32_t id, const uint8_t* payload, size_t len) {
+    if (id == 0) {
+        ConnectionError(PROTOCOL_ERROR);
+        return;
+    }
+    if (!StripPadding(flags, &payload, &len))
+        return;
+    if (flags & PRIORITY_FLAG) {
+        if (len < 5) {
+            ConnectionError(FRAME_SIZE_ERROR);
+            return;
+        }
+        payload += 5;
+        len -= 5;
+    }
+    if (flags & END_HEADERS) {
+        OnHeaderBlock(id, flags & END_STREAM, payload, len);
+        return;
+    }
+    header_stream_ = id;
+    header_end_stream_ = flags & END_STREAM;
+    header_block_.assign(reinterpret_cast<const char*>(payload), len);
+}
+
+void Http2Session::OnContinuation(uint8_t flags, uint32_t id, const uint8_t* payload, size_t len) {
+    if (header_stream_ == 0 || id != header_stream_) {
+        ConnectionError(PROTOCOL_ERROR);
+        return;
+    }
+    if (header_block_.size() + len > MAX_HEADER_BLOCK) {
+        LOG_WARN("HTTP/2 header block too large");
+        ConnectionError(ENHANCE_YOUR_CALM);
+        return;
+    }
+    header_block_.append(reinterpret_cast<const char*>(payload), len);
+    if (!(flags & END_HEADERS))
+        return;
+    header_stream_ = 0;
+    OnHeaderBlock(id, header_end_stream_, reinterpret_cast<const uint8_t*>(header_block_.data()),
+                  header_block_.size());
+    header_block_.clear();
+}
+
+// 一个完整的头部块：新的请求，或者已有请求的尾部字段
+// 不处理的头部块也要解码，否则动态表与对端不一致
+void Http2Session::OnHeaderBlock(uint32_t id, bool end_stream, const uint8_t* block, size_t len) {
+    auto ignore = [](const std::string&, const std::string&) { return true; };
+    Stream* stream = Find(id);
+    if (stream) { // 尾部字段忽略，必须结束请求
+        if (!decoder_.Decode(block, len, ignore)) {
+            ConnectionError(COMPRESSION_ERROR);
+        } else if (stream->remote_closed) {
+            StreamError(id, STREAM_CLOSED);
+        } else if (!end_stream) {
+            StreamError(id, PROTOCOL_ERROR);
+        } else {
+            EndOfBody(stream);
+        }
+        return;
+    }
+    if (id % 2 == 0 || id <= last_stream_id_) {
+        ConnectionError(PROTOCOL_ERROR);
+        return;
+    }
+    last_stream_id_ = id;
+    if (draining_ || active_ >= MAX_CONCURRENT_STREAMS) {
+        if (!decoder_.Decode(block, len, ignore)) {
+            ConnectionError(COMPRESSION_ERROR);
+        } else if (!draining_) { // 已经发出 GOAWAY 时，之后的流对端知道不会被处理
+            WriteRst(id, REFUSED_STREAM);
+        }
+        return;
+    }
+    stream = NewStream(id);
+    bool malformed = false;
+    if (!DecodeRequest(stream, block, len, &malformed)) {
+        ConnectionError(COMPRESSION_ERROR);
+        return;
+    }
+    if (malformed) {
+        StreamError(id, PROTOCOL_ERROR);
+        return;
+    }
+    if (max_streams_ > 0 && ++opened_ >= max_streams_) { // 处理完这个流后关闭连接
+        draining_ = true;
+        WriteGoAway(NO_ERROR);
+    }
+    HttpRequest::PARSE_RESULT ret = stream->request.EndHeaders();
+    if (ret != HttpRequest::PARSE_OK) {
+        SendError(stream, HttpRequest::ErrorCode(ret));
+    } else if (stream->request.IsUpload()) {
+        stream->upload.reset(new HttpUpload());
+        if (!stream->upload->Start(stream->request.GetHeader("Content-Type"), stream->request.BodyLength())) {
+            stream->upload.reset();
+            SendError(stream, 400);
+        }
+    }
+    if (end_stream)
+        EndOfBody(stream);
+}
+
+// 伪头部给出请求行，:authority 作为 Host；格式不符合要求时设置 malformed，仍然解码完整个块
+bool Http2Session::DecodeRequest(Stream* stream, const uint8_t* block, size_t len, bool* malformed) {
+    std::string method, path;
+    bool regular = false;
+    HttpRequest& request = stream->request;
+    bool ok = decoder_.Decode(block, len, [&](const std::string& name, const std::string& value) {
+        if (*malformed)
+            return true;
+        if (!name.empty() && name[0] == ':') {
+            if (regular) {
+                *malformed = true;
+            } else if (name == ":method" && method.empty()) {
+                method = value;
+            } else if (name == ":path" && path.empty()) {
+                path = value;
+            } else if (name == ":authority") {
+                *malformed = !request.AddHeader("host", value);
+            } else if (name != ":scheme") {
+                *malformed = true;
+            }
+            return true;
+        }
+        regular = true;
+        if (name.empty() || std::any_of(name.begin(), name.end(), [](unsigned char ch) { return isupper(ch); }) ||
+            IsConnectionHeader(name) ||
+            (name == "te" && value != "trailers") || !request.AddHeader(name, value))
+            *malformed = true;
+        return true;
+    });
+    if (!ok)
+        return false;
+    if (method.empty() || path.empty() || path[0] != '/') // CONNECT 和 "*" 不支持
+        *malformed = true;
+    if (!*malformed) {
+        request.SetRequestLine(method, path, "2.0");
+        stream->head = method == "HEAD";
+        LOG_DEBUG("[%u] [%s] [%s]", stream->id, method.c_str(), path.c_str());
+    }
+    return true;
+}
+
+// 请求体收完（END_STREAM），没有确定响应时按路由处理
+void Http2Session::EndOfBody(Stream* stream) {
+    stream->remote_closed = true;
+    if (stream->dispatched) {
+        if (stream->responded && stream->sent == stream->body_len)
+            CloseStream(stream); // 响应在请求体收完之前就已发完
+        return;
+    }
+    int code = 200;
+    if (stream->upload) {
+        if (!stream->upload->IsFinished()) { // 请求体比 Content-Length 短
+            stream->upload->Abort();
+            SendError(stream, 400);
+            return;
+        }
+        code = stream->upload->Finish();
+    } else {
+        stream->request.FinishBody();
+    }
+    Dispatch(stream, code);
+}
+
+void Http2Session::Dispatch(Stream* stream, int code) {
+    stream->dispatched = true;
+    response_.Init(stream->request.Path(), src_dir_, code);
+    const Router::Route* route = stream->request.GetRoute();
+    if (route)
+        route->handler(stream->request, response_);
+    if (stream->request.IsVerifyPending()) { // 等待数据库验证，由 Resume 继续
+        pending_ = stream;
+        return;
+    }
+    Send(stream, response_);
+}
+
+void Http2Session::SendError(Stream* stream, int code) {
+    stream->dispatched = true;
+    response_.Init(stream->request.Path(), src_dir_, code);
+    Send(stream, response_);
+}
+
+void Http2Session::Send(Stream* stream, HttpResponse& response) {
+    response.Load();
+    if (response.HasContent()) {
+        stream->content = response.TakeContent();
+        stream->body = stream->content.data();
+        stream->body_len = stream->content.size();
+    } else {
+        stream->map_len = response.FileLen();
+        stream->map = response.DetachFile();
+        stream->body = stream->map;
+        stream->body_len = stream->map_len;
+    }
+    std::string block;
+    Hpack::EncodeStatus(response.Code(), &block);
+    Hpack::EncodeHeader(Hpack::NAME_CONTENT_TYPE, ResponseHeader::MimeType(response.Mime()), &block);
+    Hpack::EncodeHeader(Hpack::NAME_CONTENT_LENGTH, std::to_string(stream->body_len), &block);
+    const std::string& date = ResponseHeader::Date(); // "Date: ...\r\n"
+    Hpack::EncodeHeader(Hpack::NAME_DATE, std::string_view(date).substr(6, date.size() - 8), &block);
+    if (stream->head)
+        stream->body_len = 0;
+    WriteFrameHeader(block.size(), HEADERS, END_HEADERS | (stream->body_len == 0 ? END_STREAM : 0), stream->id);
+    out_->Append(block);
+    stream->responded = true;
+    LOG_DEBUG("[%u] %d, %zu bytes", stream->id, response.Code(), stream->body_len);
+    if (stream->body_len == 0 && stream->remote_closed)
+        CloseStream(stream);
+}
+
+// 各流轮流发送，每轮每个流最多一帧，直到窗口用完、没有数据或达到一批的上限
+void Http2Session::WriteData() {
+    int frames = 0;
+    bool progress = true;
+    while (progress && frames < MAX_DATA_FRAMES && send_window_ > 0) {
+        progress = false;
+        for (auto& item : streams_) {
+            Stream* stream = item.second.get();
+            if (stream->closed || !stream->responded || stream->sent == stream->body_len ||
+                stream->send_window <= 0)
+                continue;
+            size_t len = std::min({stream->body_len - stream->sent, peer_max_frame_,
+                                   static_cast<size_t>(std::min(stream->send_window, send_window_))});
+            bool end = stream->sent + len == stream->body_len;
+            WriteFrameHeader(len, DATA, end ? END_STREAM : 0, stream->id);
+            queue_(stream->body + stream->sent, len);
+            stream->sent += len;
+            stream->send_window -= len;
+            send_window_ -= len;
+            progress = true;
+            if (end && stream->remote_closed)
+                CloseStream(stream);
+            if (++frames >= MAX_DATA_FRAMES || send_window_ <= 0)
+                break;
+        }
+    }
+}
+
+// 响应在请求体收完之前发完时（如 413），剩余的请求体照常接收后丢弃，收完再关闭，
+// 和 HTTP/1.1 一样保证客户端能读到错误页面
+void Http2Session::CloseStream(Stream* stream) {
+    if (stream->closed)
+        return;
+    stream->closed = true;
+    --active_;
+}
+
+// 关闭的流移到 done_，其中的文件映射等本批次写完后释放；没有未完成的流时结束连接
+void Http2Session::Sweep() {
+    for (auto it = streams_.begin(); it != streams_.end();) {
+        if (it->second->closed) {
+            done_.push_back(std::move(it->second));
+            it = streams_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (draining_ && active_ == 0 && !closing_) {
+        if (!goaway_sent_)
+            WriteGoAway(NO_ERROR);
+        closing_ = true;
+    }
+}
+
+Http2Session::Stream* Http2Session::Find(uint32_t id) {
+    auto it = streams_.find(id);
+    return it == streams_.end() || it->second->closed ? nullptr : it->second.get();
+}
+
+Http2Session::Stream* Http2Session::NewStream(uint32_t id) {
+    std::unique_ptr<Stream>& stream = streams_[id];
+    stream.reset(new Stream(id));
+    stream->send_window = initial_window_;
+    last_stream_id_ = std::max(last_stream_id_, id);
+    ++active_;
+    return stream.get();
+}
+
+void Http2Session::OnRstStream(uint32_t id, const uint8_t* payload, size_t len) {
+    if (id == 0 || id > last_stream_id_) {
+        ConnectionError(PROTOCOL_ERROR);
+        return;
+    }
+    if (len != 4) {
+        ConnectionError(FRAME_SIZE_ERROR);
+        return;
+    }
+    Stream* stream = Find(id);
+    if (stream) {
+        LOG_DEBUG("[%u] reset by peer: %u", id, ReadUint32(payload));
+        CloseStream(stream);
+    }
+}
+
+void Http2Session::OnSettings(uint8_t flags, uint32_t id, const uint8_t* payload, size_t len) {
+    if (id != 0) {
+        ConnectionError(PROTOCOL_ERROR);
+        return;
+    }
+    if (flags & ACK) {
+        if (len != 0)
+            ConnectionError(FRAME_SIZE_ERROR);
+        return;
+    }
+    if (len % 6 != 0) {
+        ConnectionError(FRAME_SIZE_ERROR);
+        return;
+    }
+    uint32_t code = ApplySettings(payload, len);
+    if (code != NO_ERROR) {
+        ConnectionError(code);
+        return;
+    }
+    WriteFrameHeader(0, SETTINGS, ACK, 0);
+}
+
+uint32_t Http2Session::ApplySettings(const uint8_t* payload, size_t len) {
+    if (len % 6 != 0)
+        return FRAME_SIZE_ERROR;
+    for (size_t i = 0; i < len; i += 6) {
+        uint16_t key = (payload[i] << 8) | payload[i + 1];
+        uint32_t value = ReadUint32(payload + i + 2);
+        switch (key) {
+        case SETTINGS_ENABLE_PUSH: // 不推送，只检查取值
+            if (value > 1)
+                return PROTOCOL_ERROR;
+            break;
+        case SETTINGS_INITIAL_WINDOW_SIZE: {
+            if (value > MAX_WINDOW)
+                return FLOW_CONTROL_ERROR;
+            // 已有的流按差值调整，窗口可能变为负数
+            int64_t delta = int64_t(value) - initial_window_;
+            for (auto& item : streams_) {
+                item.second->send_window += delta;
+                if (item.second->send_window > MAX_WINDOW)
+                    return FLOW_CONTROL_ERROR;
+            }
+            initial_window_ = value;
+            break;
+        }
+        case SETTINGS_MAX_FRAME_SIZE:
+            if (value < 16384 || value > 16777215)
+                return PROTOCOL_ERROR;
+            peer_max_frame_ = value;
+            break;
+        default: // 响应头不使用动态表，HEADER_TABLE_SIZE 等不影响发送
+            break;
+        }
+    }
+    return NO_ERROR;
+}
+
+void Http2Session::OnPing(uint8_t flags, uint32_t id, const uint8_t* payload, size_t len) {
+    if (id != 0) {
+        ConnectionError(PROTOCOL_ERROR);
+        return;
+    }
+    if (len != 8) {
+        ConnectionError(FRAME_SIZE_ERROR);
+        return;
+    }
+    if (flags & ACK)
+        return;
+    WriteFrameHeader(8, PING, ACK, 0);
+    out_->Append(payload, 8);
+}
+
+// 对端要关闭连接：不再接受新的流，已有的处理完后关闭
+void Http2Session::OnGoAway(uint32_t id, const uint8_t* payload, size_t len) {
+    if (id != 0) {
+        ConnectionError(PROTOCOL_ERROR);
+        return;
+    }
+    if (len < 8) {
+        ConnectionError(FRAME_SIZE_ERROR);
+        return;
+    }
+    LOG_DEBUG("GOAWAY from peer: last stream %u, error %u", ReadUint32(payload) & 0x7fffffff,
+              ReadUint32(payload + 4));
+    draining_ = true;
+}
+
+void Http2Session::OnWindowUpdate(uint32_t id, const uint8_t* payload, size_t len) {
+    if (len != 4) {
+        ConnectionError(FRAME_SIZE_ERROR);
+        return;
+    }
+    uint32_t increment = ReadUint32(payload) & 0x7fffffff;
+    if (id == 0) {
+        if (increment == 0 || send_window_ + increment > MAX_WINDOW) {
+            ConnectionError(increment == 0 ? PROTOCOL_ERROR : FLOW_CONTROL_ERROR);
+            return;
+        }
+        send_window_ += increment;
+        return;
+    }
+    if (id > last_stream_id_) {
+        ConnectionError(PROTOCOL_ERROR);
+        return;
+    }
+    Stream* stream = Find(id);
+    if (!stream)
+        return;
+    if (increment == 0 || stream->send_window + increment > MAX_WINDOW) {
+        StreamError(id, increment == 0 ? PROTOCOL_ERROR : FLOW_CONTROL_ERROR);
+        return;
+    }
+    stream->send_window += increment;
+}
+
+void Http2Session::WriteFrameHeader(size_t len, uint8_t type, uint8_t flags, uint32_t id) {
+    char header[FRAME_HEADER_LEN] = {
+        static_cast<char>(len >> 16), static_cast<char>(len >> 8), static_cast<char>(len),
+        static_cast<char>(type), static_cast<char>(flags),
+        static_cast<char>(id >> 24), static_cast<char>(id >> 16), static_cast<char>(id >> 8), static_cast<char>(id)
+    };
+    out_->Append(header, sizeof(header));
+}
+
+// 服务端前言：并发流上限和较大的接收窗口，连接级的窗口只能用 WINDOW_UPDATE 扩大
+void Http2Session::WriteSettings() {
+    std::string payload;
+    const uint32_t settings[][2] = {
+        {SETTINGS_MAX_CONCURRENT_STREAMS, MAX_CONCURRENT_STREAMS},
+        {SETTINGS_INITIAL_WINDOW_SIZE, static_cast<uint32_t>(LOCAL_WINDOW)},
+        {SETTINGS_MAX_HEADER_LIST_SIZE, static_cast<uint32_t>(MAX_HEADER_BLOCK)},
+    };
+    for (const auto& setting : settings) {
+        payload.push_back(static_cast<char>(setting[0] >> 8));
+        payload.push_back(static_cast<char>(setting[0]));
+        AppendUint32(&payload, setting[1]);
+    }
+    WriteFrameHeader(payload.size(), SETTINGS, 0, 0);
+    out_->Append(payload);
+    WriteWindowUpdate(0, LOCAL_WINDOW - DEFAULT_WINDOW);
+    recv_window_ = LOCAL_WINDOW;
+    settings_sent_ = true;
+}
+
+void Http2Session::WriteWindowUpdate(uint32_t id, uint32_t increment) {
+    std::string payload;
+    AppendUint32(&payload, increment);
+    WriteFrameHeader(payload.size(), WINDOW_UPDATE, 0, id);
+    out_->Append(payload);
+}
+
+void Http2Session::WriteRst(uint32_t id, uint32_t code) {
+    std::string payload;
+    AppendUint32(&payload, code);
+    WriteFrameHeader(payload.size(), RST_STREAM, 0, id);
+    out_->Append(payload);
+}
+
+void Http2Session::WriteGoAway(uint32_t code) {
+    std::string payload;
+    AppendUint32(&payload, last_stream_id_);
+    AppendUint32(&payload, code);
+    WriteFrameHeader(payload.size(), GOAWAY, 0, 0);
+    out_->Append(payload);
+    goaway_sent_ = true;
+}
+
+void Http2Session::StreamError(uint32_t id, uint32_t code) {
+    LOG_DEBUG("[%u] stream error: %u", id, code);
+    WriteRst(id, code);
+    Stream* stream = Find(id);
+    if (stream) {
+        CloseStream(stream);
+    }
+}
+
+// 连接错误：发送 GOAWAY，不再处理任何帧，写完后关闭
+void Http2Session::ConnectionError(uint32_t code) {
+    LOG_WARN("HTTP/2 connection error: %u", code);
+    WriteGoAway(code);
+    closing_ = true;
+}
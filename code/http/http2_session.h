@@ -0,0 +1,178 @@
+#ifndef HTTP2_SESSION_H
+#define HTTP2_SESSION_H
+
+#include <cstdint>
+#include <string>
+#include <map>
+#include <memory>
+#include <vector>
+#include <functional>
+
+#include "../buffer/buffer.h"
+#include "../log/log.h"
+#include "hpack.h"
+#include "http_request.h"
+#include "http_response.h"
+#include "http_upload.h"
+
+// HTTP/2（RFC 9113）连接的协议状态
+// 明文 h2c：连接开头就是客户端前言（prior knowledge），或者由 HTTP/1.1 的 Upgrade: h2c 请求升级
+// 一个连接上的多个流交错收发：每个流有自己的 HttpRequest，头部由 HPACK 解码，请求体来自 DATA 帧；
+// 请求收完后和 HTTP/1.1 一样按路由生成响应、映射静态文件，响应头用 HPACK 编码，
+// 内容按流和连接两级的流量控制窗口切成 DATA 帧，各流轮流发送
+// 帧追加到 HttpConnect 的写缓冲，DATA 帧的内容直接指向流持有的文件映射，和 HTTP/1.1 一样由一次 writev 写出
+class Http2Session {
+public:
+    // 把 data 开始的 len 字节排在写缓冲中已追加的数据之后写出，不拷贝；本批次写完之前内容保持有效
+    using QueueBody = std::function<void(const char* data, size_t len)>;
+
+    static const size_t PREFACE_LEN = 24;
+    static const size_t FRAME_HEADER_LEN = 9;
+    static const uint32_t MAX_CONCURRENT_STREAMS = 100;
+    static const int32_t LOCAL_WINDOW = 1 << 20;  // 每个流和整个连接的接收窗口
+    static const size_t MAX_FRAME_SIZE = 16384;   // 接收的帧长度上限，即协议的默认值
+    static const size_t MAX_HEADER_BLOCK = 65536; // 一个头部块（含 CONTINUATION）的最大长度
+    static const int MAX_DATA_FRAMES = 128;       // 一批最多写出的 DATA 帧数，每帧占两个 iovec
+
+    // max_streams 为连接上最多处理的流数，达到后发送 GOAWAY，处理完已有的流再关闭，0 不限制
+    Http2Session(const char* src_dir, int max_streams, Buffer* out, QueueBody queue);
+    ~Http2Session() = default;
+
+    // 数据是否为客户端前言：1 是，0 还不能确定（只收到了一部分），-1 不是
+    static int MatchPreface(const char* data, size_t len);
+    // 是否为 HTTP/1.1 升级到 h2c 的请求
+    static bool IsUpgrade(const HttpRequest& request);
+
+    // 升级：request 已按 HTTP/1.1 处理完，response 为它的响应；写出 101 和服务端的 SETTINGS，
+    // 响应作为流 1 发送。HTTP2-Settings 格式错误时返回 false，什么也不写，由调用方按 HTTP/1.1 回复
+    bool Upgrade(const HttpRequest& request, HttpResponse& response);
+
+    // 处理 in 中所有完整的帧，再按窗口写出各流待发送的数据；只在上一批写完后调用
+    void Process(Buffer& in);
+
+    // 某个流的登录/注册请求等待数据库时，整个连接挂起，和 HTTP/1.1 相同
+    bool IsSuspended() const { return pending_ != nullptr; }
+    void Verify(HttpRequest::VerifyCallback done);
+    void Resume(HttpRequest::VERIFY_RESULT result);
+
+    bool IsClosing() const { return closing_; } // 已发送 GOAWAY，写完后关闭连接
+
+private:
+    enum FRAME_TYPE {
+        DATA = 0x0,
+        HEADERS = 0x1,
+        PRIORITY = 0x2,
+        RST_STREAM = 0x3,
+        SETTINGS = 0x4,
+        PUSH_PROMISE = 0x5,
+        PING = 0x6,
+        GOAWAY = 0x7,
+        WINDOW_UPDATE = 0x8,
+        CONTINUATION = 0x9
+    };
+    enum FRAME_FLAG {
+        END_STREAM = 0x1,
+        ACK = 0x1,
+        END_HEADERS = 0x4,
+        PADDED = 0x8,
+        PRIORITY_FLAG = 0x20
+    };
+    enum ERROR_CODE {
+        NO_ERROR = 0x0,
+        PROTOCOL_ERROR = 0x1,
+        INTERNAL_ERROR = 0x2,
+        FLOW_CONTROL_ERROR = 0x3,
+        STREAM_CLOSED = 0x5,
+        FRAME_SIZE_ERROR = 0x6,
+        REFUSED_STREAM = 0x7,
+        COMPRESSION_ERROR = 0x9,
+        ENHANCE_YOUR_CALM = 0xb
+    };
+
+    struct Stream {
+        uint32_t id;
+        bool remote_closed; // 对端已发送 END_STREAM
+        bool dispatched;    // 响应已确定，之后的请求体丢弃
+        bool responded;     // 响应头已写出
+        bool closed;        // 不再收发，等本批次写完后释放
+        bool head;          // HEAD 请求，响应没有内容
+        int64_t send_window;
+        int64_t recv_window;
+        HttpRequest request;
+        std::unique_ptr<HttpUpload> upload;
+        const char* body;   // 指向 map 或 content
+        size_t body_len;
+        size_t sent;
+        char* map;          // 文件映射，流释放时解除
+        size_t map_len;
+        std::string content;
+
+        explicit Stream(uint32_t stream_id);
+        ~Stream();
+    };
+
+    void HandleFrame(uint8_t type, uint8_t flags, uint32_t id, const uint8_t* payload, size_t len);
+    void OnData(uint8_t flags, uint32_t id, const uint8_t* payload, size_t len);
+    void OnHeaders(uint8_t flags, uint32_t id, const uint8_t* payload, size_t len);
+    void OnContinuation(uint8_t flags, uint32_t id, const uint8_t* payload, size_t len);
+    void OnHeaderBlock(uint32_t id, bool end_stream, const uint8_t* block, size_t len);
+    void OnRstStream(uint32_t id, const uint8_t* payload, size_t len);
+    void OnSettings(uint8_t flags, uint32_t id, const uint8_t* payload, size_t len);
+    void OnPing(uint8_t flags, uint32_t id, const uint8_t* payload, size_t len);
+    void OnGoAway(uint32_t id, const uint8_t* payload, size_t len);
+    void OnWindowUpdate(uint32_t id, const uint8_t* payload, size_t len);
+    uint32_t ApplySettings(const uint8_t* payload, size_t len); // 返回错误码
+    bool StripPadding(uint8_t flags, const uint8_t** payload, size_t* len);
+
+    bool DecodeRequest(Stream* stream, const uint8_t* block, size_t len, bool* malformed);
+    void EndOfBody(Stream* stream);
+    void Dispatch(Stream* stream, int code); // 按路由生成响应，可能进入等待验证
+    void SendError(Stream* stream, int code);
+    void Send(Stream* stream, HttpResponse& response); // 写出响应头，内容由 WriteData 发送
+    void WriteData();
+    void CloseStream(Stream* stream);
+    void Sweep();
+
+    Stream* Find(uint32_t id); // 未关闭的流
+    Stream* NewStream(uint32_t id);
+
+    void WriteFrameHeader(size_t len, uint8_t type, uint8_t flags, uint32_t id);
+    void WriteSettings();
+    void WriteWindowUpdate(uint32_t id, uint32_t increment);
+    void WriteRst(uint32_t id, uint32_t code);
+    void WriteGoAway(uint32_t code);
+    void StreamError(uint32_t id, uint32_t code);
+    void ConnectionError(uint32_t code);
+
+    const char* src_dir_;
+    int max_streams_;
+    Buffer* out_;
+    QueueBody queue_;
+
+    HpackDecoder decoder_;
+    HttpResponse response_;
+
+    std::map<uint32_t, std::unique_ptr<Stream>> streams_; // 按 id 排列，轮流发送
+    std::vector<std::unique_ptr<Stream>> done_; // 已关闭的流，内容可能还在本批次中
+    Stream* pending_;      // 等待验证的流
+    uint32_t active_;      // 未关闭的流数
+    uint32_t last_stream_id_;
+    int opened_;           // 已接受的流数
+
+    bool preface_;         // 已收到客户端前言
+    bool settings_sent_;
+    bool draining_;        // 不再接受新的流，已有的处理完后关闭
+    bool goaway_sent_;
+    bool closing_;
+
+    uint32_t header_stream_; // 正在接收 CONTINUATION 的流，0 为没有
+    bool header_end_stream_;
+    std::string header_block_;
+
+    int64_t send_window_;  // 连接级的发送窗口
+    int64_t recv_window_;  // 连接级的接收窗口
+    int64_t initial_window_; // 对端的 SETTINGS_INITIAL_WINDOW_SIZE
+    size_t peer_max_frame_;  // 对端的 SETTINGS_MAX_FRAME_SIZE
+};
+
+#endif // HTTP2_SESSION_H
@@ -1,11 +1,120 @@
 #include "http_connect.h"
+#include "http2_session.h"
 
 bool HttpConnect::is_ET;
 const char* HttpConnect::src_dir;
 std::atomic<int> HttpConnect::use_count;
+int HttpConnect::max_requests = 1000;
+int HttpConnect::keep_alive_timeout_ms = 60000;
+const int HttpConnect::MAX_PIPELINE;
+const size_t HttpConnect::MAX_READ_BYTES;
+const size_t HttpConnect::MAX_WS_FRAMES;
+std::function<void(HttpConnect*, uint32_t)> HttpConnect::on_wake;
+
+// 每个响应最多占用两个 iovec，一批响应可以一次 writev 写出
+static_assert(HttpConnect::MAX_PIPELINE * 2 <= IOV_MAX, "too many iovecs per batch");
+static_assert(Http2Session::MAX_DATA_FRAMES * 2 + 2 <= IOV_MAX, "too many iovecs per batch");
+static_assert(HttpConnect::MAX_WS_FRAMES + 1 <= IOV_MAX, "too many iovecs per batch");
+
+namespace {
+
+Router::Handler Page(std::string page) {
+    return [page](HttpRequest&, HttpResponse& response) { response.SetPath(page); };
+}
+
+// 表单提交时验证，能用缓存确定结果时直接跳转，否则挂起连接等待数据库；不是表单时返回页面本身
+Router::Handler UserForm(std::string page, bool is_login) {
+    return [page, is_login](HttpRequest& request, HttpResponse& response) {
+        if (!request.IsForm()) {
+            response.SetPath(page);
+            return;
+        }
+        HttpRequest::VERIFY_RESULT result;
+        if (request.BeginVerify(is_login, &result))
+            response.SetPath(HttpRequest::VerifyPage(result));
+    };
+}
+
+std::string JsonEscape(const std::string& text) {
+    std::string out;
+    out.reserve(text.size() + 8);
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+std::string OnlineMessage(size_t count) {
+    return "{\"type\":\"online\",\"count\":" + std::to_string(count) + "}";
+}
+
+// 欢迎页的实时更新：在线人数的变化和访客发送的短消息广播给所有打开页面的连接
+std::shared_ptr<const WebSocketHandler> LiveUpdates() {
+    static const size_t MAX_TEXT = 512;
+    static WebSocketChannel channel;
+    auto handler = std::make_shared<WebSocketHandler>();
+    handler->on_open = [](const std::shared_ptr<WebSocket>& ws) {
+        channel.Join(ws);
+        channel.Broadcast(OnlineMessage(channel.Size()));
+    };
+    handler->on_message = [](const std::shared_ptr<WebSocket>&, std::string& message, bool binary) {
+        if (binary || message.empty() || message.size() > MAX_TEXT)
+            return;
+        channel.Broadcast("{\"type\":\"message\",\"text\":\"" + JsonEscape(message) + "\"}");
+    };
+    handler->on_close = [](const std::shared_ptr<WebSocket>& ws, uint16_t) {
+        channel.Leave(ws);
+        channel.Broadcast(OnlineMessage(channel.Size()));
+    };
+    return handler;
+}
+
+} // namespace
+
+Router::Handler HttpConnect::WebSocketRoute(std::shared_ptr<const WebSocketHandler> handler) {
+    return [handler](HttpRequest& request, HttpResponse& response) {
+        if (!request.AcceptWebSocket(handler))
+            response.Init(request.Path(), src_dir, 400);
+    };
+}
+
+Router::Handler HttpConnect::ProxyRoute(int upstream) {
+    return [upstream](HttpRequest& request, HttpResponse& response) {
+        if (!request.ForwardTo(upstream))
+            response.Init(request.Path(), src_dir, 502);
+    };
+}
+
+// 上传收完后回到图片页，失败时按状态码返回错误页面
+Router::Handler HttpConnect::UploadRoute() {
+    return Page("/picture.html");
+}
+
+void HttpConnect::AddDefaultRoutes(Router* router) {
+    static const char* PAGES[] = {"/index", "/register", "/login", "/welcome", "/video", "/picture"};
+    router->Add("*", "/", Page("/index.html"));
+    for (const char* page : PAGES)
+        router->Add("*", page, Page(std::string(page) + ".html"));
+    router->Add("POST", "/login", UserForm("/login.html", true));
+    router->Add("POST", "/login.html", UserForm("/login.html", true));
+    router->Add("POST", "/register", UserForm("/register.html", false));
+    router->Add("POST", "/register.html", UserForm("/register.html", false));
+    router->Add("GET", "/ws", WebSocketRoute(LiveUpdates()));
+    // 其余路径都是静态文件，响应已按请求路径初始化
+    router->Add("*", "/*path", [](HttpRequest&, HttpResponse&) {});
+}
 
 HttpConnect::HttpConnect()
-    : fd_(-1), is_close_(true) {
+    : fd_(-1), is_close_(true), serial_(0), queued_head_(0), iov_idx_(0), to_write_(0), keep_alive_(false), requests_(0) {
     memset(&addr_, 0, sizeof(addr_));
 }
 
@@ -18,88 +127,394 @@ HttpConnect::~HttpConnect() {
 void HttpConnect::Init(int socket_fd, const sockaddr_in& addr){
     assert(socket_fd > 0);
     ++use_count;
+    ++serial_;
+    is_close_ = false;
     fd_ = socket_fd;
     addr_ = addr;
     read_buff_.RetrieveAll();
-    write_buff_.RetrieveAll();
+    ClearResponses();
+    request_.Init();
+    h2_.reset();
+    if (TlsContext::instance()->IsEnabled())
+        tls_.Init(fd_);
+    keep_alive_ = false;
+    requests_ = 0;
     LOG_INFO("Client[%d][%s:%d] in, user count: %d", fd_, GetIP(), GetPort(), (int)use_count);
 }
 
 void HttpConnect::Close(){
+    proxy_.Close(); // 租用的上游连接状态未知，由连接池关闭
     response_.UnmapFile();
+    ClearResponses();
+    upload_.Abort();
+    h2_.reset(); // 流持有的文件映射在 ClearResponses 之后才能释放
+    // 应用和频道可能还持有 WebSocket，关闭后它不再接受消息，on_close 通知应用
+    std::shared_ptr<WebSocket> ws = std::atomic_exchange(&ws_, std::shared_ptr<WebSocket>());
+    if (ws)
+        ws->Shutdown();
     if(!is_close_){
         is_close_ = true;
         --use_count;
+        tls_.Close();
         close(fd_);
         LOG_INFO("Client[%d][%s:%d] quit, user count: %d", fd_, GetIP(), GetPort(), (int)use_count);
     }
 }
 
 ssize_t HttpConnect::Read(int* save_errno) {
+    if (tls_.IsActive())
+        return ReadTls(save_errno);
+    if (upload_.IsActive() && !upload_.IsFinished()) // 上传的请求体不经过读缓冲
+        return upload_.ReadFrom(fd_, save_errno, is_ET);
     ssize_t len = -1;
     do {
         len = read_buff_.ReadFD(fd_, save_errno);
         if (len <= 0)
             break;
-    } while (is_ET); // EF: 边沿触发，循环读取数据将数据处理完
+    } while (is_ET && read_buff_.ReadableBytes() < MAX_READ_BYTES); // EF: 边沿触发，循环读取数据将数据处理完
+    // 读缓冲中积压较多时先处理，EPOLLONESHOT 重新注册时仍有数据会再次触发，读缓冲的大小因此有上限
     return len;
 }
 
-
-ssize_t HttpConnect::Write(int* save_errno) {
+// 上传的请求体也要先解密，同样经过读缓冲
+ssize_t HttpConnect::ReadTls(int* save_errno) {
+    if (!tls_.IsEstablished()) {
+        int ret = tls_.Handshake();
+        if (ret <= 0) {
+            *save_errno = ret < 0 ? EPROTO : EAGAIN;
+            return -1;
+        }
+    }
     ssize_t len = -1;
     do {
-        len = writev(fd_, iov_, iov_cnt_);
-        if (len <= 0) {
-            *save_errno = errno;
+        len = tls_.Read(read_buff_, save_errno);
+        if (len <= 0)
             break;
-        }
+    } while (is_ET && read_buff_.ReadableBytes() < MAX_READ_BYTES);
+    return len;
+}
 
-        if (iov_[0].iov_len + iov_[1].iov_len == 0) { // 读完
+ssize_t HttpConnect::Write(int* save_errno) {
+    ssize_t len = -1;
+    if (tls_.IsActive() && !tls_.IsEstablished()) { // 握手等待可写时由写事件继续
+        if (tls_.Handshake() < 0)
+            keep_alive_ = false;
+        return 0;
+    }
+    // 写到全部写完或发送缓冲区满为止
+    while (to_write_ > 0) {
+        if (tls_.IsActive()) {
+            len = tls_.Writev(&iov_[iov_idx_], iov_.size() - iov_idx_, save_errno);
+        } else {
+            len = writev(fd_, &iov_[iov_idx_], iov_.size() - iov_idx_);
+            if (len < 0)
+                *save_errno = errno;
+        }
+        if (len <= 0)
             break;
-        } else if (static_cast<size_t>(len) > iov_[0].iov_len) { // iov[0]读完
-            // 更新指针和长度
-            size_t read_len = len - iov_[0].iov_len;
-            iov_[1].iov_base = (uint8_t*)iov_[1].iov_base + read_len;
-            iov_[1].iov_len -= read_len;
-            if (iov_[0].iov_len) {
-                write_buff_.RetrieveAll();
-                iov_[0].iov_len = 0;
-            }
-        } else { // iov[0]未读完
-            iov_[0].iov_base = (uint8_t*)iov_[0].iov_base + len;
-            iov_[0].iov_len -= len;
-            write_buff_.Retrieve(len);
+        to_write_ -= len;
+        // 跳过已写完的块，更新写了一部分的块
+        size_t written = len;
+        while (iov_idx_ < iov_.size() && written >= iov_[iov_idx_].iov_len) {
+            written -= iov_[iov_idx_].iov_len;
+            ++iov_idx_;
         }
-    } while (is_ET || ToWriteBytes() > 10240);
-    // 边沿触发模式下数据被全部写入
-    // 在非边沿触发模式下，或需要写入的数据量较大时，也能分多次写入
+        if (written > 0) {
+            iov_[iov_idx_].iov_base = (uint8_t*)iov_[iov_idx_].iov_base + written;
+            iov_[iov_idx_].iov_len -= written;
+        }
+    }
+    if (to_write_ == 0) {
+        ClearResponses();
+    }
     return len;
 }
 
 
 bool HttpConnect::Process() {
-    request_.Init();
-    if (read_buff_.ReadableBytes() <= 0)
+    assert(to_write_ == 0);
+    if (tls_.IsActive() && !tls_.IsEstablished()) {
+        keep_alive_ = true;
+        return tls_.WantWrite();
+    }
+    int count = 0;
+    // 等待验证或转发的请求之前的响应先写出，写完后再次调用时挂起或开始转发
+    while (!h2_ && !ws_ && count < MAX_PIPELINE && !request_.IsVerifyPending() && request_.Upstream() < 0) {
+        if (!upload_.IsActive()) {
+            if (requests_ == 0 && request_.IsIdle()) { // 连接开头可能是 HTTP/2 的前言
+                int preface = Http2Session::MatchPreface(read_buff_.ReadBegin(), read_buff_.ReadableBytes());
+                if (preface == 0)
+                    break;
+                if (preface > 0) {
+                    StartHttp2();
+                    break;
+                }
+            }
+            HttpRequest::PARSE_RESULT ret = request_.Parse(read_buff_);
+            if (ret == HttpRequest::PARSE_AGAIN)
+                break;
+            if (ret != HttpRequest::PARSE_OK) {
+                MakeErrorResponse(HttpRequest::ErrorCode(ret));
+                ++count;
+                break;
+            }
+            if (request_.IsUpload() &&
+                !upload_.Start(request_.GetHeader("Content-Type"), request_.BodyLength())) {
+                MakeErrorResponse(400);
+                ++count;
+                break;
+            }
+        }
+        int code = 200;
+        if (upload_.IsActive()) {
+            upload_.Feed(read_buff_);
+            if (!upload_.IsFinished()) // 剩余的请求体由 Read 直接从 socket 读取
+                break;
+            code = upload_.Finish();
+        }
+        Dispatch(code);
+        if (request_.IsVerifyPending() || request_.Upstream() >= 0) // 等待数据库验证，或者转发给上游
+            break;
+        if (code == 200 && (UpgradeHttp2() || UpgradeWebSocket()))
+            break;
+        keep_alive_ = NextKeepAlive();
+        MakeResponse();
+        ++count;
+        request_.Init();
+        if (!keep_alive_) // 写完后关闭连接，后面的请求不再处理
+            break;
+    }
+    if (h2_) {
+        h2_->Process(read_buff_);
+        keep_alive_ = !h2_->IsClosing();
+    }
+    if (ws_)
+        ProcessWebSocket();
+    if (write_buff_.ReadableBytes() == 0 && pieces_.empty()) {
+        if (request_.Upstream() >= 0)
+            StartForward();
         return false;
-    if (request_.Parse(read_buff_)) {
-        LOG_DEBUG("path: %s", request_.Path().c_str());
-        response_.Init(request_.Path(), src_dir, 200, request_.IsKeepAlive());
+    }
+    if (write_buff_.ReadableBytes() > queued_head_)
+        QueuePiece(nullptr, 0, false);
+    BuildIov();
+    return true;
+}
+
+bool HttpConnect::IsSuspended() const {
+    return h2_ ? h2_->IsSuspended() : request_.IsVerifyPending();
+}
+
+void HttpConnect::Verify(HttpRequest::VerifyCallback done) {
+    if (h2_) {
+        h2_->Verify(std::move(done));
     } else {
-        response_.Init(request_.Path(), src_dir, 400, false);
+        request_.Verify(std::move(done));
     }
+}
 
-    response_.MakeResponse(write_buff_);
-    iov_[0].iov_base = const_cast<char*>(write_buff_.ReadBegin());
-    iov_[0].iov_len = write_buff_.ReadableBytes();
-    iov_cnt_ = 1;
+void HttpConnect::StartHttp2() {
+    h2_.reset(new Http2Session(src_dir, max_requests, &write_buff_, [this](const char* data, size_t len) {
+        QueuePiece(data, len, false);
+    }));
+    keep_alive_ = true;
+    LOG_DEBUG("Client[%d] HTTP/2", fd_);
+}
 
-    // 报文主体文件
-    if (response_.File()) {
-        iov_[1].iov_base = response_.File();
-        iov_[1].iov_len = response_.FileLen();
-        iov_cnt_ = 2;
+bool HttpConnect::UpgradeHttp2() {
+    // h2c 只用于明文连接，TLS 上的 HTTP/2 由 ALPN 协商
+    if (tls_.IsActive() || request_.IsUpload() || !Http2Session::IsUpgrade(request_))
+        return false;
+    StartHttp2();
+    if (!h2_->Upgrade(request_, response_)) {
+        h2_.reset();
+        return false;
     }
-    LOG_DEBUG("filesize: %d, %d to %d", response_.FileLen(), iov_cnt_, ToWriteBytes());
+    ++requests_;
+    request_.Init();
     return true;
 }
+
+bool HttpConnect::UpgradeWebSocket() {
+    std::shared_ptr<const WebSocketHandler> handler = request_.GetWebSocket();
+    if (!handler)
+        return false;
+    write_buff_.Append("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                       "Sec-WebSocket-Accept: ");
+    write_buff_.Append(WebSocket::AcceptKey(request_.GetHeader("Sec-WebSocket-Key")));
+    write_buff_.Append("\r\n\r\n", 4);
+    response_.UnmapFile();
+    uint32_t serial = serial_;
+    std::atomic_store(&ws_, std::make_shared<WebSocket>(handler, [this, serial]() { on_wake(this, serial); }));
+    ++requests_;
+    request_.Init();
+    keep_alive_ = true;
+    LOG_DEBUG("Client[%d] WebSocket", fd_);
+    ws_->Open();
+    return true;
+}
+
+// 101 响应头留在 write_buff_ 中，成为第一个帧的头部；帧是共享的，本批次写完前由 frames_ 持有
+void HttpConnect::ProcessWebSocket() {
+    ws_->Process(read_buff_);
+    bool more = ws_->TakeFrames(&frames_, MAX_WS_FRAMES);
+    for (const WebSocket::Frame& frame : frames_)
+        QueuePiece(frame->data(), frame->size(), false);
+    keep_alive_ = more || !ws_->IsDone(); // 关闭帧写出后关闭连接
+}
+
+bool HttpConnect::IsWebSocket() const {
+    return std::atomic_load(&ws_) != nullptr;
+}
+
+bool HttpConnect::IsDone() const {
+    return ws_ && ws_->IsDone();
+}
+
+bool HttpConnect::Park(bool idle, const std::function<void()>& arm) {
+    if (proxy_.IsActive())
+        return proxy_.Park(arm);
+    if (!ws_) {
+        arm();
+        return true;
+    }
+    return ws_->Park(idle, arm);
+}
+
+bool HttpConnect::Unpark(bool hangup, bool writable) {
+    if (proxy_.IsActive())
+        return proxy_.Unpark();
+    std::shared_ptr<WebSocket> ws = std::atomic_load(&ws_);
+    return !ws || ws->Unpark(hangup, writable);
+}
+
+bool HttpConnect::Ping() {
+    std::shared_ptr<WebSocket> ws = std::atomic_load(&ws_);
+    return !ws || ws->Ping();
+}
+
+bool HttpConnect::Resume(HttpRequest::VERIFY_RESULT result) {
+    assert(to_write_ == 0);
+    if (h2_) {
+        h2_->Resume(result);
+        keep_alive_ = !h2_->IsClosing();
+        if (write_buff_.ReadableBytes() > queued_head_)
+            QueuePiece(nullptr, 0, false);
+        BuildIov();
+        return true;
+    }
+    request_.SetVerifyResult(result);
+    int code = result == HttpRequest::VERIFY_UNAVAILABLE ? 503 : 200; // 数据库繁忙时快速失败
+    response_.Init(HttpRequest::VerifyPage(result), src_dir, code);
+    keep_alive_ = NextKeepAlive();
+    MakeResponse();
+    request_.Init();
+    BuildIov();
+    return true;
+}
+
+// 响应由 HttpProxy 直接写给客户端，不经过本批次
+void HttpConnect::StartForward() {
+    keep_alive_ = NextKeepAlive();
+    proxy_.Start(request_, fd_, tls_.IsActive() ? &tls_ : nullptr, addr_, read_buff_, keep_alive_,
+                 keep_alive_timeout_ms / 1000, max_requests > 0 ? max_requests - requests_ : 0);
+}
+
+HttpProxy::STEP HttpConnect::Forward() {
+    assert(to_write_ == 0);
+    HttpProxy::STEP step = proxy_.Step(read_buff_);
+    if (step == HttpProxy::FAILED) {
+        keep_alive_ = proxy_.IsKeepAlive();
+        response_.Init(request_.Path(), src_dir, 502);
+        response_.SetKeepAlive(keep_alive_, keep_alive_timeout_ms / 1000,
+                               max_requests > 0 ? max_requests - requests_ : 0);
+        MakeResponse();
+        request_.Init();
+        BuildIov();
+    } else if (step == HttpProxy::FINISHED) {
+        keep_alive_ = proxy_.IsKeepAlive();
+        request_.Init();
+    }
+    return step;
+}
+
+// 响应先按请求路径初始化为静态文件，再交给匹配的路由处理
+void HttpConnect::Dispatch(int code) {
+    response_.Init(request_.Path(), src_dir, code);
+    const Router::Route* route = request_.GetRoute();
+    LOG_DEBUG("path: %s, route: %s", request_.Path().c_str(), route ? route->pattern.c_str() : "-");
+    if (route)
+        route->handler(request_, response_);
+}
+
+// 客户端要求保持连接且没有达到请求数上限时保持，并在响应头中告知剩余的请求数
+bool HttpConnect::NextKeepAlive() {
+    ++requests_;
+    // 留在 socket 中的请求体只有转发时才会读走，否则无法找到下一个请求
+    bool keep_alive = request_.IsKeepAlive() && (max_requests <= 0 || requests_ < max_requests) &&
+                      (!request_.HasStreamedBody() || request_.Upstream() >= 0);
+    response_.SetKeepAlive(keep_alive, keep_alive_timeout_ms / 1000,
+                           max_requests > 0 ? max_requests - requests_ : 0);
+    return keep_alive;
+}
+
+// 无法确定下一个请求从哪里开始，回复错误后关闭连接
+void HttpConnect::MakeErrorResponse(int code) {
+    keep_alive_ = false;
+    response_.Init(request_.Path(), src_dir, code, false);
+    MakeResponse();
+    read_buff_.RetrieveAll();
+}
+
+void HttpConnect::MakeResponse() {
+    response_.MakeResponse(write_buff_);
+    size_t len = response_.File() ? response_.FileLen() : 0;
+    QueuePiece(response_.DetachFile(), len, true); // 文件在本批次写完后才解除映射
+}
+
+void HttpConnect::QueuePiece(const char* data, size_t len, bool mapped) {
+    Piece piece;
+    piece.head_len = write_buff_.ReadableBytes() - queued_head_;
+    piece.data = data;
+    piece.len = len;
+    piece.mapped = mapped;
+    queued_head_ += piece.head_len;
+    pieces_.push_back(piece);
+}
+
+void HttpConnect::BuildIov() {
+    // write_buff_ 在生成响应时可能扩容，所有响应头追加完之后才能取地址
+    char* head = const_cast<char*>(write_buff_.ReadBegin());
+    bool merge = false; // 上一段没有内容，头部可以和它的连在一起
+    for (const Piece& piece : pieces_) {
+        if (merge && !iov_.empty()) {
+            iov_.back().iov_len += piece.head_len;
+        } else if (piece.head_len > 0) {
+            iov_.push_back({head, piece.head_len});
+        }
+        head += piece.head_len;
+        to_write_ += piece.head_len;
+        merge = piece.len == 0;
+        // 报文主体文件或流的内容
+        if (piece.len > 0) {
+            iov_.push_back({const_cast<char*>(piece.data), piece.len});
+            to_write_ += piece.len;
+        }
+    }
+    LOG_DEBUG("responses: %zu, %zu iovecs, %zu bytes", pieces_.size(), iov_.size(), to_write_);
+}
+
+void HttpConnect::ClearResponses() {
+    for (const Piece& piece : pieces_) {
+        if (piece.mapped && piece.data) {
+            munmap(const_cast<char*>(piece.data), piece.len);
+        }
+    }
+    pieces_.clear();
+    frames_.clear();
+    queued_head_ = 0;
+    iov_.clear();
+    iov_idx_ = 0;
+    to_write_ = 0;
+    write_buff_.RetrieveAll();
+}
@@ -5,50 +5,139 @@
 #include <sys/uio.h>   // readv/writev
 #include <cassert>
 #include <atomic>
+#include <functional>
+#include <vector>
+#include <climits>     // IOV_MAX
+#include <memory>
 
 #include "../buffer/buffer.h"
 #include "../log/log.h"
 #include "http_request.h"
 #include "http_response.h"
+#include "http_upload.h"
+#include "http_proxy.h"
+#include "websocket.h"
+#include "../tls/tls_connect.h"
+
+class Http2Session;
 
 class HttpConnect {
 public:
     static bool is_ET;
     static const char* src_dir;
     static std::atomic<int> use_count;
+    static int max_requests;          // 一个连接上最多处理的请求数，达到后关闭连接，0 不限制
+    static int keep_alive_timeout_ms; // 保持的连接空闲多久后关闭，写入 Keep-Alive 头部
+    static const int MAX_PIPELINE = 64; // 一次最多处理的流水线请求数，它们的响应合并成一次 writev
+    static const size_t MAX_READ_BYTES = 65536; // 读缓冲中未处理的数据达到该长度时停止读取，先处理
+    static const size_t MAX_WS_FRAMES = 256; // WebSocket 连接一次最多写出的帧数
+    // WebSocket 连接停放时其他线程发来消息，由它把连接（serial 用于识别 fd 被复用）交给线程池；由 WebServer 设置
+    static std::function<void(HttpConnect* client, uint32_t serial)> on_wake;
 
     HttpConnect();
     ~HttpConnect();
 
+    // 注册内置的路由：页面、登录、注册、欢迎页的实时更新，以及其余路径的静态文件；在服务启动前调用
+    static void AddDefaultRoutes(Router* router);
+    // 上传的路由处理函数，注册时带 Router::STREAM_BODY；上传没有身份验证，不在内置路由中
+    static Router::Handler UploadRoute();
+    // 把请求升级为 WebSocket 的路由处理函数，握手不合法时返回 400
+    static Router::Handler WebSocketRoute(std::shared_ptr<const WebSocketHandler> handler);
+    // 把请求转发给编号为 upstream 的上游服务器组的路由处理函数，注册时带 Router::FORWARD；HTTP/2 的请求返回 502
+    static Router::Handler ProxyRoute(int upstream);
+
     void Init(int socket_fd, const sockaddr_in& addr);
     void Close();
 
+    // 开启 TLS 时先完成握手，读写都经过 TlsConnect；握手期间 Process 按握手需要的方向等待事件
     ssize_t Read(int* save_errno);
     ssize_t Write(int* save_errno);
+    // 解析读缓冲中所有完整的请求，按顺序生成响应；返回 true 表示响应已就绪
+    // 只在上一批响应写完后调用，不完整的请求留在读缓冲中等待后续数据
+    // 连接以 HTTP/2 前言开始或请求升级到 h2c 后，读缓冲中的数据交给 Http2Session 按帧处理；
+    // 升级到 WebSocket 后交给 WebSocket 解析，响应为待发队列中的帧
     bool Process();
 
+    // 登录/注册请求在等待数据库时挂起，不占用工作线程
+    bool IsSuspended() const;
+    void Verify(HttpRequest::VerifyCallback done);
+    bool Resume(HttpRequest::VERIFY_RESULT result); // 拿到验证结果后生成响应
+
+    // WebSocket 连接由工作线程和其他线程的消息共同驱动，重新注册事件都经过 Park，见 WebSocket
+    bool IsWebSocket() const; // 主线程也会调用
+    bool IsDone() const;      // WebSocket 关闭握手已完成，没有要写的数据时关闭连接
+    bool Park(bool idle, const std::function<void()>& arm); // 其他连接直接调用 arm，返回 true
+    bool Unpark(bool hangup, bool writable); // 主线程收到事件时调用，返回 false 时丢弃事件
+    bool Ping();   // 主线程的定时器到期，返回 false 时关闭连接
+
+    // 反向代理：Process 返回 false 且 IsForwarding 时，由 WebServer 租用上游连接后交给 Attach，
+    // 之后每次事件调用 Forward 推进，按返回值注册客户端或上游的事件；等待期间的事件同样经过 Park/Unpark
+    bool IsForwarding() const { return proxy_.IsActive(); } // 主线程也会调用
+    int ForwardUpstream() const { return proxy_.Upstream(); }
+    const UpstreamConnect* UpstreamConn() const { return proxy_.Connect(); }
+    void Attach(UpstreamConnect* conn) { proxy_.Attach(conn); }
+    // FAILED 时已生成 502 响应，等待写出；FINISHED 时响应已写完，按 IsKeepAlive 继续
+    HttpProxy::STEP Forward();
+
     // 写的总长度
-    int ToWriteBytes() const { return iov_[0].iov_len + iov_[1].iov_len; }
-    bool IsKeepAlive() const { return request_.IsKeepAlive(); }
+    size_t ToWriteBytes() const { return to_write_; }
+    bool IsKeepAlive() const { return keep_alive_; } // 最后一个已排队的响应是否保持连接
 
     int GetFd() const { return fd_; }
+    bool IsClose() const { return is_close_; }
+    uint32_t Serial() const { return serial_; } // 每次 Init 递增，用于识别 fd 被复用
     int GetPort() const { return addr_.sin_port; }
     const char* GetIP() const { return inet_ntoa(addr_.sin_addr); }
     sockaddr_in GetAddr() const { return addr_; }
 
 private:
     int fd_;     //客户端连接的套接字文件描述符，用于进行网络数据的读写操作
-    bool is_close_;
+    std::atomic<bool> is_close_; //工作线程和主线程都会读取
+    std::atomic<uint32_t> serial_;
     struct sockaddr_in addr_;   //客户端的地址信息，包括 IP 地址和端口号
 
-    int iov_cnt_;    //iovec 数组的有效元素数量，用于 writev 函数进行分散写操作。
-    struct iovec iov_[2];   //iovec 结构体数组，用于存储待写入的数据块信息。
+    // 一段待写的数据：head_len 字节在 write_buff_ 中，之后是不经拷贝的内容，
+    // HTTP/1.1 为响应头和映射的文件，HTTP/2 为若干帧和流持有的内容，WebSocket 为共享的帧
+    struct Piece {
+        size_t head_len;
+        const char* data;
+        size_t len;
+        bool mapped; // data 为本连接映射的文件，本批次写完后解除映射
+    };
+
+    std::vector<Piece> pieces_; //本批次的响应，按请求顺序排列
+    size_t queued_head_; //write_buff_ 中已经归入 pieces_ 的字节数
+    std::vector<struct iovec> iov_; //本批次所有响应头和文件，用于 writev 函数进行分散写操作
+    size_t iov_idx_;  //第一个未写完的 iovec
+    size_t to_write_; //剩余未写的字节数
+    bool keep_alive_;
+    int requests_;    //这个连接上已经生成的响应数
+
+    ssize_t ReadTls(int* save_errno);
+    void MakeResponse(); // 生成一个响应并加入本批次
+    void QueuePiece(const char* data, size_t len, bool mapped); // write_buff_ 中新追加的数据和 data 作为一段
+    void StartHttp2();
+    bool UpgradeHttp2(); // 当前请求要求升级到 h2c 时，以 101 回复并把它的响应作为流 1
+    bool UpgradeWebSocket(); // 路由处理函数接受了 WebSocket 升级时，以 101 回复
+    void ProcessWebSocket(); // 处理读缓冲中的帧，取出待发的帧加入本批次
+    void MakeErrorResponse(int code);
+    void Dispatch(int code); // 按路由生成当前请求的响应内容
+    bool NextKeepAlive(); // 当前请求的响应之后是否保持连接
+    void StartForward();  // 之前的响应都已写完，开始转发当前请求
+    void BuildIov();     // 本批次的响应生成完毕后，按顺序填写 iov_
+    void ClearResponses(); // 写完或关闭时解除文件映射，清空本批次
 
     Buffer read_buff_;
-    Buffer write_buff_;    
+    Buffer write_buff_; //本批次所有响应的响应头
     
     HttpRequest request_;
     HttpResponse response_;
+    HttpUpload upload_; //正在接收的上传请求体
+    std::unique_ptr<Http2Session> h2_; //升级到 HTTP/2 后的协议状态
+    std::shared_ptr<WebSocket> ws_; //升级到 WebSocket 后的连接，主线程也会读取，用 std::atomic_load/store 访问
+    std::vector<WebSocket::Frame> frames_; //本批次写出的帧，写完后释放
+    TlsConnect tls_;
+    HttpProxy proxy_; //正在转发的请求
 };
 
 #endif // HTTP_CONNECT_H
@@ -0,0 +1,633 @@
+#include "http_proxy.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <strings.h> // strncasecmp
+
+const size_t HttpProxy::MAX_HEAD;
+const size_t HttpProxy::PIPE_CHUNK;
+const size_t HttpProxy::FRAME_PEEK;
+
+namespace {
+
+bool EqualsIgnoreCase(const char* begin, const char* end, const char* name) {
+    size_t len = strlen(name);
+    return static_cast<size_t>(end - begin) == len && strncasecmp(begin, name, len) == 0;
+}
+
+// 逐跳的头部只对一段连接有效，不转发；请求体和响应体的长度由代理重新确定
+bool IsHopByHop(const std::string& name) {
+    static const char* HOP_BY_HOP[] = {"connection", "keep-alive", "proxy-connection", "te", "trailer",
+                                       "upgrade", "transfer-encoding", "content-length", "expect"};
+    for (const char* hop : HOP_BY_HOP) {
+        if (name == hop)
+            return true;
+    }
+    return false;
+}
+
+} // namespace
+
+HttpProxy::HttpProxy()
+    : active_(false), parked_(false), upstream_(-1), conn_(nullptr), client_fd_(-1), tls_(nullptr),
+      splice_in_(false), splice_out_(false), piped_(0), phase_(SEND_HEAD), sent_(0), has_host_(false),
+      body_left_(0), body_read_(false), got_response_(false), reply_sent_(0), started_(false),
+      framing_(NONE), resp_left_(0), dechunk_(false), eof_(false), upstream_keep_alive_(false),
+      head_request_(false), client_http10_(false), keep_alive_(false), timeout_s_(0), max_requests_(0) {
+    pipe_fd_[0] = pipe_fd_[1] = -1;
+}
+
+HttpProxy::~HttpProxy() {
+    Close();
+    ClosePipe();
+}
+
+// GET /api/user HTTP/1.1 -> 上游；连接总是按 HTTP/1.1 保持，与客户端是否保持无关
+void HttpProxy::Start(const HttpRequest& request, int client_fd, TlsConnect* tls, const sockaddr_in& addr,
+                      Buffer& client_in, bool keep_alive, int timeout_s, int max_requests) {
+    assert(!active_ && request.Upstream() >= 0);
+    upstream_ = request.Upstream();
+    conn_ = nullptr;
+    client_fd_ = client_fd;
+    tls_ = tls;
+    splice_in_ = tls == nullptr;
+    splice_out_ = tls == nullptr || tls->IsKtlsSend(); // kTLS 由内核加密，明文可以直接 splice
+    piped_ = 0;
+    head_request_ = request.Method() == "HEAD";
+    client_http10_ = request.Version() == "1.0";
+    keep_alive_ = keep_alive;
+    timeout_s_ = timeout_s;
+    max_requests_ = max_requests;
+
+    std::string connection = request.GetHeader("Connection");
+    std::string forwarded_for;
+    has_host_ = false;
+    send_.clear();
+    send_ += request.Method();
+    send_ += ' ';
+    send_ += request.Path();
+    send_ += " HTTP/1.1\r\n";
+    for (size_t i = 0; i < request.HeaderCount(); ++i) {
+        const std::pair<std::string, std::string>& header = request.HeaderAt(i);
+        if (IsHopByHop(header.first) || header.first == "x-forwarded-proto" ||
+            HttpRequest::HasToken(connection, header.first.c_str()))
+            continue;
+        if (header.first == "x-forwarded-for") { // 多个时合并，客户端的地址加在最后
+            forwarded_for += header.second;
+            forwarded_for += ", ";
+            continue;
+        }
+        has_host_ = has_host_ || header.first == "host";
+        send_ += header.first;
+        send_ += ": ";
+        send_ += header.second;
+        send_ += "\r\n";
+    }
+    char ip[INET_ADDRSTRLEN] = {0};
+    inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+    send_ += "x-forwarded-for: " + forwarded_for + ip + "\r\n";
+    send_ += tls ? "x-forwarded-proto: https\r\n" : "x-forwarded-proto: http\r\n";
+
+    // 请求体：已读入内存的直接附在请求头后面，留在 socket 中的先取走读缓冲中已有的部分
+    size_t length = request.HasStreamedBody() ? request.BodyLength() : request.Body().size();
+    if (length > 0 || !request.GetHeader("Content-Length").empty() ||
+        !request.GetHeader("Transfer-Encoding").empty())
+        send_ += "content-length: " + std::to_string(length) + "\r\n";
+    send_ += "\r\n";
+    body_left_ = 0;
+    if (request.HasStreamedBody()) {
+        size_t buffered = std::min(client_in.ReadableBytes(), length);
+        send_.append(client_in.ReadBegin(), buffered);
+        client_in.Retrieve(buffered);
+        body_left_ = length - buffered;
+    } else {
+        send_ += request.Body();
+    }
+    sent_ = 0;
+    body_read_ = false;
+    got_response_ = false;
+
+    recv_.RetrieveAll();
+    reply_.clear();
+    reply_sent_ = 0;
+    // 客户端等待 100 Continue 才发送请求体时由代理回复，上游看到的是普通的请求
+    if (body_left_ > 0 && !client_http10_ && HttpRequest::HasToken(request.GetHeader("Expect"), "100-continue"))
+        reply_ = "HTTP/1.1 100 Continue\r\n\r\n";
+    started_ = false;
+    framing_ = NONE;
+    resp_left_ = 0;
+    scanner_.Init();
+    dechunk_ = false;
+    eof_ = false;
+    upstream_keep_alive_ = false;
+    phase_ = SEND_HEAD;
+    parked_ = false;
+    active_ = true;
+    LOG_DEBUG("Forward %s %s to upstream %d, body %zu", request.Method().c_str(), request.Path().c_str(),
+              upstream_, length);
+}
+
+void HttpProxy::Attach(UpstreamConnect* conn) {
+    conn_ = conn;
+    if (!conn || has_host_)
+        return;
+    // HTTP/1.0 的请求可以没有 Host，按上游服务器补上，重试时沿用
+    const std::string& name = UpstreamPool::instance()->ServerName(conn);
+    send_.insert(send_.find("\r\n") + 2, "host: " + name + "\r\n");
+    has_host_ = true;
+}
+
+bool HttpProxy::Park(const std::function<void()>& arm) {
+    parked_ = true; // 先停放再注册，事件可能在 arm 返回之前就到达
+    arm();
+    return true;
+}
+
+bool HttpProxy::Unpark() {
+    return parked_.exchange(false);
+}
+
+HttpProxy::STEP HttpProxy::Step(Buffer& client_in) {
+    assert(active_);
+    if (!conn_)
+        return Fail();
+    STEP step = FINISHED;
+    bool next = true;
+    while (next) {
+        switch (phase_) {
+        case SEND_HEAD:
+            next = SendHead(&step);
+            break;
+        case SEND_BODY:
+            next = SendBody(client_in, &step);
+            break;
+        case RECV_HEAD:
+            next = RecvHead(&step);
+            break;
+        case RELAY:
+            next = Relay(&step);
+            break;
+        }
+    }
+    return step;
+}
+
+bool HttpProxy::SendHead(STEP* step) {
+    while (sent_ < send_.size()) {
+        ssize_t len = send(conn_->fd, send_.data() + sent_, send_.size() - sent_, MSG_NOSIGNAL);
+        if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            *step = WAIT_UPSTREAM_WRITE;
+            return false;
+        }
+        if (len <= 0) {
+            *step = Fail();
+            return false;
+        }
+        sent_ += len;
+    }
+    phase_ = body_left_ > 0 ? SEND_BODY : RECV_HEAD;
+    return true;
+}
+
+// 客户端 socket -> 管道 -> 上游 socket；TLS 或没有管道时经过读缓冲
+bool HttpProxy::SendBody(Buffer& client_in, STEP* step) {
+    if (!FlushReply(step)) // 100 Continue
+        return false;
+    while (body_left_ > 0 || piped_ > 0) {
+        if (piped_ > 0) {
+            ssize_t len = splice(pipe_fd_[0], nullptr, conn_->fd, nullptr, piped_, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (len < 0 && errno == EAGAIN) {
+                *step = WAIT_UPSTREAM_WRITE;
+                return false;
+            }
+            if (len <= 0) {
+                *step = Fail();
+                return false;
+            }
+            piped_ -= len;
+            continue;
+        }
+        if (client_in.ReadableBytes() > 0) {
+            size_t len = std::min(client_in.ReadableBytes(), body_left_);
+            ssize_t sent = send(conn_->fd, client_in.ReadBegin(), len, MSG_NOSIGNAL);
+            if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                *step = WAIT_UPSTREAM_WRITE;
+                return false;
+            }
+            if (sent <= 0) {
+                *step = Fail();
+                return false;
+            }
+            client_in.Retrieve(sent);
+            body_left_ -= sent;
+            continue;
+        }
+        ssize_t len = -1;
+        int read_errno = 0;
+        if (splice_in_ && OpenPipe()) {
+            len = splice(client_fd_, nullptr, pipe_fd_[1], nullptr, std::min(body_left_, PIPE_CHUNK),
+                         SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            read_errno = errno;
+            if (len > 0) {
+                piped_ += len;
+                body_left_ -= len;
+            }
+        } else {
+            len = tls_ ? tls_->Read(client_in, &read_errno) : client_in.ReadFD(client_fd_, &read_errno);
+        }
+        if (len > 0) {
+            body_read_ = true;
+            continue;
+        }
+        if (len < 0 && (read_errno == EAGAIN || read_errno == EWOULDBLOCK)) {
+            *step = WAIT_CLIENT_READ;
+            return false;
+        }
+        *step = ClientGone();
+        return false;
+    }
+    phase_ = RECV_HEAD;
+    return true;
+}
+
+bool HttpProxy::RecvHead(STEP* step) {
+    static const char CRLF2[] = "\r\n\r\n";
+    while (true) {
+        const char* begin = recv_.ReadBegin();
+        const char* end = recv_.WriteBeginConst();
+        const char* head_end = std::search(begin, end, CRLF2, CRLF2 + 4);
+        if (head_end != end) {
+            int ret = ParseHead(begin, head_end + 4);
+            recv_.RetrieveUntil(head_end + 4);
+            if (ret < 0) {
+                *step = Fail();
+                return false;
+            }
+            if (ret == 0) // 100 Continue 等中间响应，等待最终响应
+                continue;
+            phase_ = RELAY;
+            return true;
+        }
+        if (recv_.ReadableBytes() > MAX_HEAD) {
+            LOG_WARN("Upstream response head too large");
+            *step = Fail();
+            return false;
+        }
+        int read_errno = 0;
+        ssize_t len = recv_.ReadFD(conn_->fd, &read_errno);
+        if (len > 0) {
+            got_response_ = true;
+            continue;
+        }
+        if (len < 0 && (read_errno == EAGAIN || read_errno == EWOULDBLOCK)) {
+            *step = WAIT_UPSTREAM_READ;
+            return false;
+        }
+        *step = Fail();
+        return false;
+    }
+}
+
+// HTTP/1.1 200 OK
+int HttpProxy::ParseHead(const char* begin, const char* end) {
+    const char* line_end = std::search(begin, end, "\r\n", "\r\n" + 2);
+    if (line_end - begin < 12 || memcmp(begin, "HTTP/1.", 7) != 0 || begin[8] != ' ' ||
+        !isdigit(begin[9]) || !isdigit(begin[10]) || !isdigit(begin[11]) ||
+        (line_end - begin > 12 && begin[12] != ' ')) {
+        LOG_WARN("Upstream status line error");
+        return -1;
+    }
+    int code = (begin[9] - '0') * 100 + (begin[10] - '0') * 10 + (begin[11] - '0');
+    bool http11 = begin[7] != '0';
+    if (code < 200) // 转发时去掉了 Upgrade，不会收到 101
+        return code == 101 ? -1 : 0;
+
+    // 先找出 Connection 中列出的头部，再逐个决定是否转发
+    struct Field {
+        const char* name;
+        const char* name_end;
+        const char* value;
+        const char* value_end;
+    };
+    std::vector<Field> fields;
+    std::string connection;
+    bool chunked = false;
+    bool has_length = false;
+    size_t length = 0;
+    for (const char* line = line_end + 2; line < end - 2;) {
+        const char* next = std::search(line, end, "\r\n", "\r\n" + 2);
+        const char* colon = std::find(line, next, ':');
+        if (colon == next || colon == line) {
+            LOG_WARN("Upstream header error");
+            return -1;
+        }
+        Field field = {line, colon, colon + 1, next};
+        while (field.value < next && (*field.value == ' ' || *field.value == '\t'))
+            ++field.value;
+        while (field.value_end > field.value && (field.value_end[-1] == ' ' || field.value_end[-1] == '\t'))
+            --field.value_end;
+        std::string value(field.value, field.value_end);
+        if (EqualsIgnoreCase(line, colon, "connection")) {
+            connection += value + ",";
+        } else if (EqualsIgnoreCase(line, colon, "transfer-encoding")) {
+            // 只支持以 chunked 结尾的编码，其余的编码原样转发给客户端
+            if (!HttpRequest::HasToken(value, "chunked") || chunked) {
+                LOG_WARN("Upstream Transfer-Encoding unsupported: %s", value.c_str());
+                return -1;
+            }
+            chunked = true;
+        } else if (EqualsIgnoreCase(line, colon, "content-length")) {
+            if (value.empty() || value.size() > 18 || value.find_first_not_of("0123456789") != std::string::npos ||
+                (has_length && std::stoull(value) != length)) {
+                LOG_WARN("Upstream Content-Length error: %s", value.c_str());
+                return -1;
+            }
+            has_length = true;
+            length = std::stoull(value);
+        }
+        fields.push_back(field);
+        line = next + 2;
+    }
+    if (chunked && has_length) { // 与请求一样，两者同时出现时拒绝
+        LOG_WARN("Upstream response has both Content-Length and Transfer-Encoding");
+        return -1;
+    }
+
+    if (head_request_ || code == 204 || code == 304) {
+        framing_ = NONE;
+    } else if (chunked) {
+        framing_ = CHUNKED;
+    } else if (has_length) {
+        framing_ = length > 0 ? LENGTH : NONE;
+        resp_left_ = length;
+    } else {
+        framing_ = UNTIL_CLOSE;
+    }
+    upstream_keep_alive_ = framing_ != UNTIL_CLOSE && (http11 ? !HttpRequest::HasToken(connection, "close")
+                                                              : HttpRequest::HasToken(connection, "keep-alive"));
+    dechunk_ = framing_ == CHUNKED && client_http10_;
+    if (framing_ == UNTIL_CLOSE || dechunk_) // 响应体以关闭连接结束
+        keep_alive_ = false;
+
+    reply_ = "HTTP/1.1 ";
+    reply_.append(begin + 9, line_end);
+    reply_ += "\r\n";
+    for (const Field& field : fields) {
+        std::string name(field.name, field.name_end);
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        if ((IsHopByHop(name) && name != "content-length" && name != "trailer") ||
+            (name == "trailer" && dechunk_) || HttpRequest::HasToken(connection, name.c_str()))
+            continue;
+        reply_.append(field.name, field.value_end);
+        reply_ += "\r\n";
+    }
+    if (chunked && !dechunk_)
+        reply_ += "Transfer-Encoding: chunked\r\n";
+    if (keep_alive_) {
+        reply_ += "Connection: keep-alive\r\n";
+        if (timeout_s_ > 0 || max_requests_ > 0) {
+            reply_ += "Keep-Alive: ";
+            if (timeout_s_ > 0)
+                reply_ += "timeout=" + std::to_string(timeout_s_);
+            if (max_requests_ > 0)
+                reply_ += std::string(timeout_s_ > 0 ? ", " : "") + "max=" + std::to_string(max_requests_);
+            reply_ += "\r\n";
+        }
+    } else {
+        reply_ += "Connection: close\r\n";
+    }
+    reply_ += "\r\n";
+    reply_sent_ = 0;
+    started_ = true;
+    LOG_DEBUG("Upstream %d response %d, framing %d", upstream_, code, framing_);
+    return 1;
+}
+
+// 每次只在 reply_ 和管道都写空之后才搬运下一段，保证写给客户端的顺序
+bool HttpProxy::Relay(STEP* step) {
+    while (true) {
+        if (!FlushReply(step))
+            return false;
+        if (piped_ > 0) {
+            ssize_t len = splice(pipe_fd_[0], nullptr, client_fd_, nullptr, piped_, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (len < 0 && errno == EAGAIN) {
+                *step = WAIT_CLIENT_WRITE;
+                return false;
+            }
+            if (len <= 0) {
+                *step = ClientGone();
+                return false;
+            }
+            piped_ -= len;
+            continue;
+        }
+        if (IsBodyDone()) {
+            *step = Finish();
+            return false;
+        }
+        if (recv_.ReadableBytes() > 0) {
+            if (!ConsumeBuffered()) {
+                *step = Fail();
+                return false;
+            }
+            continue;
+        }
+        // 分块编码的框架：预读一段交给 ChunkScanner，只取走属于框架的字节，块内容留在 socket 中
+        if (splice_out_ && framing_ == CHUNKED && scanner_.DataLeft() == 0 && OpenPipe()) {
+            char frame[FRAME_PEEK];
+            ssize_t len = recv(conn_->fd, frame, sizeof(frame), MSG_PEEK);
+            if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                *step = WAIT_UPSTREAM_READ;
+                return false;
+            }
+            long framed = len > 0 ? scanner_.Scan(frame, len) : -1;
+            if (framed < 0 || recv(conn_->fd, frame, framed, 0) != framed) {
+                LOG_WARN("Upstream chunked body error");
+                *step = Fail();
+                return false;
+            }
+            if (!dechunk_)
+                reply_.append(frame, framed);
+            continue;
+        }
+        ssize_t len = -1;
+        int read_errno = 0;
+        if (splice_out_ && OpenPipe()) {
+            size_t want = PIPE_CHUNK;
+            if (framing_ == LENGTH)
+                want = std::min(resp_left_, PIPE_CHUNK);
+            else if (framing_ == CHUNKED)
+                want = std::min(scanner_.DataLeft(), PIPE_CHUNK);
+            len = splice(conn_->fd, nullptr, pipe_fd_[1], nullptr, want, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            read_errno = errno;
+            if (len > 0) {
+                piped_ += len;
+                if (framing_ == LENGTH)
+                    resp_left_ -= len;
+                else if (framing_ == CHUNKED)
+                    scanner_.Skip(len);
+            }
+        } else {
+            len = recv_.ReadFD(conn_->fd, &read_errno);
+        }
+        if (len > 0)
+            continue;
+        if (len < 0 && (read_errno == EAGAIN || read_errno == EWOULDBLOCK)) {
+            *step = WAIT_UPSTREAM_READ;
+            return false;
+        }
+        if (len == 0 && framing_ == UNTIL_CLOSE) {
+            eof_ = true;
+            continue;
+        }
+        LOG_WARN("Upstream closed before the response is complete");
+        *step = Fail();
+        return false;
+    }
+}
+
+// 随响应头读到的，以及拷贝路径上读到的响应体
+bool HttpProxy::ConsumeBuffered() {
+    const char* data = recv_.ReadBegin();
+    size_t len = recv_.ReadableBytes();
+    if (framing_ == LENGTH) {
+        len = std::min(len, resp_left_);
+        resp_left_ -= len;
+        reply_.append(data, len);
+    } else if (framing_ == CHUNKED && scanner_.DataLeft() > 0) {
+        len = std::min(len, scanner_.DataLeft());
+        scanner_.Skip(len);
+        reply_.append(data, len);
+    } else if (framing_ == CHUNKED) {
+        long framed = scanner_.Scan(data, len);
+        if (framed < 0) {
+            LOG_WARN("Upstream chunked body error");
+            return false;
+        }
+        len = framed;
+        if (!dechunk_)
+            reply_.append(data, len);
+    } else {
+        reply_.append(data, len);
+    }
+    recv_.Retrieve(len);
+    return true;
+}
+
+bool HttpProxy::IsBodyDone() const {
+    switch (framing_) {
+    case LENGTH:
+        return resp_left_ == 0;
+    case CHUNKED:
+        return scanner_.IsDone();
+    case UNTIL_CLOSE:
+        return eof_;
+    default:
+        return true;
+    }
+}
+
+bool HttpProxy::FlushReply(STEP* step) {
+    while (reply_sent_ < reply_.size()) {
+        ssize_t len = -1;
+        int write_errno = 0;
+        if (tls_) {
+            struct iovec iov = {const_cast<char*>(reply_.data()) + reply_sent_, reply_.size() - reply_sent_};
+            len = tls_->Writev(&iov, 1, &write_errno);
+        } else {
+            len = send(client_fd_, reply_.data() + reply_sent_, reply_.size() - reply_sent_, MSG_NOSIGNAL);
+            write_errno = errno;
+        }
+        if (len < 0 && (write_errno == EAGAIN || write_errno == EWOULDBLOCK)) {
+            *step = WAIT_CLIENT_WRITE;
+            return false;
+        }
+        if (len <= 0) {
+            *step = ClientGone();
+            return false;
+        }
+        reply_sent_ += len;
+    }
+    reply_.clear();
+    reply_sent_ = 0;
+    return true;
+}
+
+bool HttpProxy::OpenPipe() {
+    if (pipe_fd_[0] >= 0)
+        return true;
+    if (pipe2(pipe_fd_, O_CLOEXEC | O_NONBLOCK) < 0) {
+        // 没有管道时退回经过缓冲的拷贝
+        LOG_WARN("Proxy pipe error: %s", strerror(errno));
+        pipe_fd_[0] = pipe_fd_[1] = -1;
+        splice_in_ = splice_out_ = false;
+        return false;
+    }
+    return true;
+}
+
+void HttpProxy::ClosePipe() {
+    if (pipe_fd_[0] >= 0) {
+        close(pipe_fd_[0]);
+        close(pipe_fd_[1]);
+        pipe_fd_[0] = pipe_fd_[1] = -1;
+    }
+    piped_ = 0;
+}
+
+// 复用的连接可能在放回后被上游关闭，在读到响应之前出错、请求体也还没有从客户端读走时换个连接重试；
+// 还没有生成响应头时由调用方回复 502，之后只能关闭客户端连接
+HttpProxy::STEP HttpProxy::Fail() {
+    if (conn_ && conn_->requests > 0 && !got_response_ && !body_read_) {
+        LOG_DEBUG("Upstream connection[%d] reused %d times is broken, retry", conn_->fd, conn_->requests);
+        Release(UpstreamPool::CLOSE);
+        sent_ = 0;
+        recv_.RetrieveAll();
+        phase_ = SEND_HEAD;
+        return RETRY;
+    }
+    if (conn_)
+        Release(UpstreamPool::FAIL);
+    active_ = false;
+    if (piped_ > 0) // 管道中剩下的请求体或响应体随管道丢弃
+        ClosePipe();
+    if (started_) {
+        keep_alive_ = false;
+        return FINISHED;
+    }
+    keep_alive_ = keep_alive_ && body_left_ == 0; // 请求体没有读完时无法找到下一个请求
+    return FAILED;
+}
+
+HttpProxy::STEP HttpProxy::ClientGone() {
+    LOG_DEBUG("Client[%d] gone while forwarding", client_fd_);
+    Release(UpstreamPool::CLOSE);
+    if (piped_ > 0)
+        ClosePipe();
+    keep_alive_ = false;
+    active_ = false;
+    return FINISHED;
+}
+
+// 上游还保持连接、也没有多余的数据时放回连接池
+HttpProxy::STEP HttpProxy::Finish() {
+    Release(upstream_keep_alive_ && recv_.ReadableBytes() == 0 ? UpstreamPool::REUSE : UpstreamPool::CLOSE);
+    recv_.RetrieveAll();
+    active_ = false;
+    return FINISHED;
+}
+
+void HttpProxy::Release(UpstreamPool::RELEASE how) {
+    if (!conn_)
+        return;
+    UpstreamPool::instance()->Release(conn_, how);
+    conn_ = nullptr;
+}
+
+void HttpProxy::Close() {
+    Release(UpstreamPool::CLOSE);
+    ClosePipe();
+    active_ = false;
+    parked_ = false;
+}
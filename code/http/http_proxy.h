@@ -0,0 +1,129 @@
+#ifndef HTTP_PROXY_H
+#define HTTP_PROXY_H
+
+#include <fcntl.h>     // splice
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include <string>
+#include <atomic>
+#include <functional>
+
+#include "../buffer/buffer.h"
+#include "../log/log.h"
+#include "../pool/upstream_pool.h"
+#include "../tls/tls_connect.h"
+#include "http_request.h"
+#include "chunk_scanner.h"
+
+// 反向代理：把一个 HTTP/1.x 请求转发给上游服务器，并把响应原样交给客户端
+// 请求头去掉逐跳的头部，加上 X-Forwarded-For/X-Forwarded-Proto 后写给上游；留在 socket 中的请求体
+// 和响应体经管道用 splice 在两个 socket 之间搬运，不经过用户态；分块编码的响应只有框架读到用户态，
+// 块内容同样 splice。TLS 连接读写都要经过 OpenSSL，改为经缓冲拷贝，开启 kTLS 发送时响应仍用 splice
+// 上游连接从 UpstreamPool 租用，响应完整时放回；复用的连接在收到响应之前就断开时换一个连接重试
+// 由工作线程调用 Step 推进，需要等待时返回等待哪个 socket，由 WebServer 注册事件后停放（Park）
+class HttpProxy {
+public:
+    enum STEP {
+        WAIT_CLIENT_READ,    // 等待客户端可读（请求体）
+        WAIT_CLIENT_WRITE,   // 等待客户端可写
+        WAIT_UPSTREAM_READ,  // 等待上游可读
+        WAIT_UPSTREAM_WRITE, // 等待上游可写
+        RETRY,     // 复用的连接已失效，重新租用连接后再次 Step
+        FAILED,    // 没能从上游得到响应，还没有向客户端写出响应，由调用方回复 502
+        FINISHED   // 响应已写完，或者中途出错（此时不再保持连接）
+    };
+
+    HttpProxy();
+    ~HttpProxy();
+
+    // 请求头解析完（留在 socket 中的请求体还没读）、路由决定转发后调用；
+    // client_in 中属于请求体的数据被取走，tls 为 nullptr 时是明文连接
+    // keep_alive 为客户端连接是否保持，timeout_s、max_requests 写入 Keep-Alive 头部，0 时不写出该项
+    void Start(const HttpRequest& request, int client_fd, TlsConnect* tls, const sockaddr_in& addr,
+               Buffer& client_in, bool keep_alive, int timeout_s, int max_requests);
+    void Attach(UpstreamConnect* conn); // 租到的连接，没有可用的服务器时为 nullptr
+    STEP Step(Buffer& client_in);
+    void Close(); // 客户端连接关闭，放弃转发
+
+    bool IsActive() const { return active_; } // 主线程也会读取
+    bool IsKeepAlive() const { return keep_alive_; } // 结束后客户端连接是否保持
+    int Upstream() const { return upstream_; }
+    const UpstreamConnect* Connect() const { return conn_; }
+
+    // 等待期间客户端和上游的事件都可能到达，只有停放后的第一个事件交给工作线程，见 WebSocket::Park
+    bool Park(const std::function<void()>& arm);
+    bool Unpark(); // 返回 false 时丢弃事件
+
+private:
+    enum PHASE {
+        SEND_HEAD, // 请求头和已读到的请求体
+        SEND_BODY, // 留在客户端 socket 中的请求体
+        RECV_HEAD, // 响应头
+        RELAY      // 响应体
+    };
+    enum FRAMING {
+        NONE,        // 没有响应体：HEAD、204、304
+        LENGTH,      // Content-Length
+        CHUNKED,     // 分块编码
+        UNTIL_CLOSE  // 上游关闭连接时结束
+    };
+
+    static const size_t MAX_HEAD = 65536;   // 响应头的最大长度
+    static const size_t PIPE_CHUNK = 65536; // 每次 splice 的最大长度，与管道的默认容量相同
+    static const size_t FRAME_PEEK = 4096;  // 分块编码每次预读框架的长度
+
+    bool SendHead(STEP* step);
+    bool SendBody(Buffer& client_in, STEP* step);
+    bool RecvHead(STEP* step);
+    bool Relay(STEP* step);
+    bool FlushReply(STEP* step); // 把 reply_ 写给客户端
+    int ParseHead(const char* begin, const char* end); // 1 为最终响应，0 为跳过的 1xx，-1 为格式错误
+    bool ConsumeBuffered(); // 处理已读到 recv_ 中的响应体，格式错误时返回 false
+    bool IsBodyDone() const;
+    bool OpenPipe();
+    void ClosePipe();
+    STEP Fail();       // 上游出错
+    STEP ClientGone(); // 客户端断开或写出错
+    STEP Finish();
+    void Release(UpstreamPool::RELEASE how);
+
+    std::atomic<bool> active_;
+    std::atomic<bool> parked_;
+    int upstream_;
+    UpstreamConnect* conn_;
+    int client_fd_;
+    TlsConnect* tls_;
+    bool splice_in_;   // 请求体用 splice 从客户端读取
+    bool splice_out_;  // 响应体用 splice 写给客户端
+    int pipe_fd_[2];
+    size_t piped_;     // 管道中还没写出的字节数
+
+    PHASE phase_;
+    std::string send_; // 发给上游的请求头和已读到的请求体，重试时重新发送
+    size_t sent_;
+    bool has_host_;    // 请求带有 Host，否则租到连接后按服务器补上
+    size_t body_left_; // 还留在客户端 socket 中的请求体
+    bool body_read_;   // 已经从客户端读取了请求体，不能再重试
+    bool got_response_; // 已经从上游读到了数据，不能再重试
+
+    Buffer recv_;       // 响应头，以及随响应头读到的响应体
+    std::string reply_; // 写给客户端的响应头、分块框架和拷贝的响应体
+    size_t reply_sent_;
+    bool started_;      // 响应头已经生成，出错时不能再回复 502
+    FRAMING framing_;
+    size_t resp_left_;  // LENGTH：还未转发的响应体
+    ChunkScanner scanner_;
+    bool dechunk_;      // HTTP/1.0 的客户端不认识分块编码，只转发块内容，以关闭连接结束
+    bool eof_;          // UNTIL_CLOSE：上游已关闭
+    bool upstream_keep_alive_;
+
+    bool head_request_;
+    bool client_http10_;
+    bool keep_alive_;
+    int timeout_s_;
+    int max_requests_;
+};
+
+#endif // HTTP_PROXY_H
@@ -1,82 +1,297 @@
 #include "http_request.h"
+#include "websocket.h"
 
-const std::unordered_set<std::string> HttpRequest::DEFAULT_HTML{
-    "/index", "/register", "/login", "/welcome",
-    "/video", "/picture"
-};
-
-const std::unordered_map<std::string, int> HttpRequest::DEFAULT_HTML_TAG {
-    {"/login.html", 1}, {"/register.html", 0}
-};
+size_t HttpRequest::max_body_size = 1024 * 1024;
+size_t HttpRequest::max_upload_size = 64 * 1024 * 1024;
 
 void HttpRequest::Init() {
     state_ = REQUEST_LINE;
-    method_ = "";
-    path_ = "";
-    version_ = "";
-    body_ = "";
-    header_.clear();
-    post_.clear();
-    
+    // clear 不释放内存，同一连接上的下一个请求直接复用
+    method_.clear();
+    path_.clear();
+    version_.clear();
+    if (body_.capacity() > MAX_KEEP_BODY)
+        std::string().swap(body_);
+    else
+        body_.clear();
+    body_left_ = 0;
+    header_count_ = 0;
+    if (!post_.empty())
+        post_.clear();
+    route_ = nullptr;
+    params_.Clear();
+    verify_pending_ = false;
+    is_login_ = false;
+    is_upload_ = false;
+    is_streamed_ = false;
+    upstream_ = -1;
+    websocket_.reset();
 }
 
-bool HttpRequest::ParseRequestLine(const std::string& line){
+bool HttpRequest::ParseRequestLine(const char* begin, const char* end){
     // GET /index.html HTTP/1.1
-    std::regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
-    std::smatch match;
-    if (std::regex_match(line, match, patten)) {
-        method_ = match[1];
-        path_ = match[2];
-        version_ = match[3];
+    const char* method_end = std::find(begin, end, ' ');
+    const char* path_end = method_end == end ? end : std::find(method_end + 1, end, ' ');
+    const char* version = path_end == end ? end : path_end + 1;
+    if (path_end != end && end - version > 5 && memcmp(version, "HTTP/", 5) == 0 &&
+        std::find(version, end, ' ') == end) {
+        method_.assign(begin, method_end);
+        path_.assign(method_end + 1, path_end);
+        version_.assign(version + 5, end);
+        route_ = Router::instance()->Match(method_, path_, &params_); // 上传等路由在请求头结束时就要知道
         state_ = HEADERS;
         return true;
-    } 
+    }
     LOG_ERROR("RequestLine Error"); 
     return false;
 }
 
-void HttpRequest::ParseHeader(const std::string& line){
+bool HttpRequest::ParseHeader(const char* begin, const char* end){
     // Host: localhost:8080
-    std::regex patten("^([^:]*): ?(.*)$");
-    std::smatch match;
-    if (std::regex_match(line, match, patten)) {
-        header_[match[1]] = match[2];
-    } else {
-        state_ = BODY;
+    const char* colon = std::find(begin, end, ':');
+    if (colon == end || colon == begin || header_count_ >= MAX_HEADERS) {
+        LOG_ERROR("Header Error");
+        return false;
     }
+    const char* value = colon + 1;
+    while (value < end && (*value == ' ' || *value == '\t'))
+        ++value;
+    while (end > value && (end[-1] == ' ' || end[-1] == '\t'))
+        --end;
+    if (header_count_ == header_.size())
+        header_.emplace_back();
+    std::pair<std::string, std::string>& header = header_[header_count_++];
+    header.first.assign(begin, colon);
+    std::transform(header.first.begin(), header.first.end(), header.first.begin(), ::tolower);
+    header.second.assign(value, end);
+    return true;
 }
 
-void HttpRequest::ParseBody(const std::string& line) {
-    body_ = line;
-    ParsePost(); 
-    state_ = FINISH;
-    LOG_DEBUG("Body: %s, len: %d", line.c_str(), line.size());
+void HttpRequest::SetRequestLine(std::string_view method, std::string_view path, std::string_view version) {
+    method_.assign(method.data(), method.size());
+    path_.assign(path.data(), path.size());
+    version_.assign(version.data(), version.size());
+    route_ = Router::instance()->Match(method_, path_, &params_);
+    state_ = HEADERS;
 }
 
-void HttpRequest::ParsePost() {
-    if (method_ == "POST" && header_["Content-Type"] == "application/x-www-form-urlencoded") {
-        ParseFromUrlEncoded();
-        if (DEFAULT_HTML_TAG.count(path_)) { // 登录/注册
-            int tag = DEFAULT_HTML_TAG.find(path_)->second;
-            LOG_DEBUG("Tag: %d", tag);
-            if (tag == 0 || tag == 1) {
-                bool is_login = (tag == 1);
-                if (UserVerify(post_["username"], post_["password"], is_login))
-                    path_ = "/welcome.html";
-                else
-                    path_ = "/error.html";
+bool HttpRequest::AddHeader(std::string_view name, std::string_view value) {
+    if (header_count_ >= MAX_HEADERS || name.size() + value.size() > MAX_LINE)
+        return false;
+    if (header_count_ == header_.size())
+        header_.emplace_back();
+    std::pair<std::string, std::string>& header = header_[header_count_++];
+    header.first.assign(name.data(), name.size());
+    header.second.assign(value.data(), value.size());
+    return true;
+}
+
+// 与文本解析共用请求体长度和上传的判断；没有分块编码，请求体的边界由调用方确定
+HttpRequest::PARSE_RESULT HttpRequest::EndHeaders() {
+    PARSE_RESULT ret = ParseHeaderEnd();
+    if (ret == PARSE_OK && state_ == CHUNK_SIZE) {
+        LOG_ERROR("Transfer-Encoding not allowed");
+        return PARSE_ERROR;
+    }
+    return ret;
+}
+
+HttpRequest::PARSE_RESULT HttpRequest::AppendBody(const char* data, size_t len) {
+    assert(state_ == BODY);
+    if (len > max_body_size - body_.size()) {
+        LOG_WARN("Body too large: %zu", body_.size() + len);
+        return PARSE_TOO_LARGE;
+    }
+    body_.append(data, len);
+    return PARSE_OK;
+}
+
+void HttpRequest::FinishBody() {
+    if (state_ == BODY)
+        ParseBody();
+}
+
+const std::string* HttpRequest::FindHeader(const char* key) const {
+    for (size_t i = 0; i < header_count_; ++i) {
+        if (header_[i].first == key)
+            return &header_[i].second;
+    }
+    return nullptr;
+}
+
+// 所有 Content-Length 头部的取值，一个头部中也可以是逗号分隔的列表（RFC 9112 6.3）
+// 取值都相同时按一个处理；不一致时无法确定请求的边界，返回 false
+bool HttpRequest::GetContentLength(std::string* value, bool* found) const {
+    *found = false;
+    for (size_t i = 0; i < header_count_; ++i) {
+        if (header_[i].first != "content-length")
+            continue;
+        const std::string& list = header_[i].second;
+        size_t pos = 0;
+        do {
+            size_t end = std::min(list.find(',', pos), list.size());
+            size_t begin = std::min(list.find_first_not_of(" \t", pos), end);
+            size_t last = end;
+            while (last > begin && (list[last - 1] == ' ' || list[last - 1] == '\t'))
+                --last;
+            std::string item = list.substr(begin, last - begin);
+            if (*found && item != *value)
+                return false;
+            *value = item;
+            *found = true;
+            pos = end + 1;
+        } while (pos <= list.size());
+    }
+    return true;
+}
+
+// 所有 Transfer-Encoding 头部中按顺序出现的编码，转为小写，编码的参数保留在其中
+bool HttpRequest::GetTransferCodings(std::vector<std::string>* codings) const {
+    bool found = false;
+    codings->clear();
+    for (size_t i = 0; i < header_count_; ++i) {
+        if (header_[i].first != "transfer-encoding")
+            continue;
+        found = true;
+        const std::string& list = header_[i].second;
+        size_t pos = 0;
+        while (pos < list.size()) {
+            size_t end = std::min(list.find(',', pos), list.size());
+            size_t begin = std::min(list.find_first_not_of(" \t", pos), end);
+            size_t last = end;
+            while (last > begin && (list[last - 1] == ' ' || list[last - 1] == '\t'))
+                --last;
+            if (last > begin) { // 列表中的空元素忽略
+                codings->emplace_back(list, begin, last - begin);
+                std::transform(codings->back().begin(), codings->back().end(),
+                               codings->back().begin(), ::tolower);
             }
+            pos = end + 1;
+        }
+    }
+    return found;
+}
+
+// 遇到空行时调用：分块编码时逐块读取请求体，否则按 Content-Length 读取，都没有时请求体为空
+HttpRequest::PARSE_RESULT HttpRequest::ParseHeaderEnd() {
+    std::string length;
+    bool has_length = false;
+    if (!GetContentLength(&length, &has_length)) {
+        LOG_ERROR("Content-Length Error: conflicting values");
+        return PARSE_ERROR;
+    }
+    std::vector<std::string> codings;
+    bool has_encoding = GetTransferCodings(&codings);
+    bool upload = route_ && (route_->flags & Router::STREAM_BODY);
+    // HTTP/2 的请求体按帧到达，由 AppendBody 读入，不留在 socket 中
+    bool forward = route_ && (route_->flags & Router::FORWARD) && version_ != "2.0";
+    if (has_encoding) {
+        // 两者同时出现时，前后端可能对请求边界理解不一致（请求走私），直接拒绝；
+        // chunked 不是最后一个编码或出现多次时无法确定请求体的边界（RFC 9112 6.3）
+        // 上传要求 Content-Length，分块编码的上传不支持
+        size_t chunked = std::count(codings.begin(), codings.end(), "chunked");
+        if (has_length || upload || chunked != 1 || codings.back() != "chunked") {
+            LOG_ERROR("Transfer-Encoding Error: %s", FindHeader("transfer-encoding")->c_str());
+            return PARSE_ERROR;
+        }
+        // 只实现了 chunked，gzip 等其他编码无法还原请求体（RFC 9112 6.1）
+        if (codings.size() > 1) {
+            LOG_WARN("Transfer-Encoding not implemented: %s", codings.front().c_str());
+            return PARSE_NOT_IMPLEMENTED;
+        }
+        state_ = CHUNK_SIZE;
+        return PARSE_OK;
+    }
+    if (has_length) {
+        if (length.empty() || length.size() > 18 || length.find_first_not_of("0123456789") != std::string::npos) {
+            LOG_ERROR("Content-Length Error: %s", length.c_str());
+            return PARSE_ERROR;
         }
+        body_left_ = std::stoull(length);
     }
+    if (upload) { // 请求体留给 HttpUpload 直接写入文件
+        if (!has_length) {
+            LOG_ERROR("Upload without Content-Length");
+            return PARSE_ERROR;
+        }
+        if (body_left_ > max_upload_size) {
+            LOG_WARN("Upload too large: %zu", body_left_);
+            return PARSE_TOO_LARGE;
+        }
+        is_upload_ = true;
+        state_ = FINISH;
+        return PARSE_OK;
+    }
+    if (forward && body_left_ > 0) { // 转发的请求体不经过内存，与上传一样单独限制长度
+        if (body_left_ > max_upload_size) {
+            LOG_WARN("Forward body too large: %zu", body_left_);
+            return PARSE_TOO_LARGE;
+        }
+        is_streamed_ = true;
+        state_ = FINISH;
+        return PARSE_OK;
+    }
+    if (body_left_ > max_body_size) { // 不等请求体到达就拒绝
+        LOG_WARN("Body too large: %zu", body_left_);
+        return PARSE_TOO_LARGE;
+    }
+    body_.reserve(body_left_);
+    state_ = BODY;
+    return PARSE_OK;
 }
 
-void HttpRequest::ParsePath() {
-    if (path_ == "/") {
-        path_ = "/index.html";
-    } else {
-        if (DEFAULT_HTML.find(path_) != DEFAULT_HTML.end())
-            path_ += ".html";
+// 1a;name=value
+HttpRequest::PARSE_RESULT HttpRequest::ParseChunkSize(const char* begin, const char* end) {
+    const char* hex_end = std::find(begin, end, ';'); // 忽略块扩展
+    size_t size = 0;
+    for (const char* p = begin; p < hex_end; ++p) {
+        unsigned char ch = *p;
+        int digit = isdigit(ch) ? ch - '0' : (isxdigit(ch) ? tolower(ch) - 'a' + 10 : -1);
+        if (digit < 0 || hex_end - begin > 15) {
+            LOG_ERROR("Chunk Size Error: %s", std::string(begin, end).c_str());
+            return PARSE_ERROR;
+        }
+        size = size * 16 + digit;
+    }
+    if (hex_end == begin) {
+        LOG_ERROR("Chunk Size Error: empty");
+        return PARSE_ERROR;
     }
+    if (size == 0) { // 最后一块
+        state_ = CHUNK_TRAILER;
+        return PARSE_OK;
+    }
+    if (size > max_body_size - body_.size()) {
+        LOG_WARN("Body too large: %zu", body_.size() + size);
+        return PARSE_TOO_LARGE;
+    }
+    body_left_ = size;
+    state_ = CHUNK_DATA;
+    return PARSE_OK;
+}
+
+// 数据直接从读缓冲追加到 body_，读缓冲中只保留还没有解析的数据
+void HttpRequest::ReadBody(Buffer& buff) {
+    size_t len = std::min(buff.ReadableBytes(), body_left_);
+    body_.append(buff.ReadBegin(), len);
+    buff.Retrieve(len);
+    body_left_ -= len;
+}
+
+void HttpRequest::ParseBody() {
+    ParsePost(); 
+    state_ = FINISH;
+    LOG_DEBUG("Body len: %zu", body_.size()); // 表单里有明文密码，不输出内容
+}
+
+void HttpRequest::ParsePost() {
+    if (IsForm())
+        ParseFromUrlEncoded();
+}
+
+bool HttpRequest::IsForm() const {
+    const std::string* type = FindHeader("content-type");
+    return method_ == "POST" && type && *type == "application/x-www-form-urlencoded";
 }
 
 int HttpRequest::ConverHex(char ch) {
@@ -108,7 +323,6 @@ void HttpRequest::ParseFromUrlEncoded(){
             value = body_.substr(j, i - j);
             j = i + 1;
             post_[key] = value;
-            LOG_DEBUG("%s = %s", key.c_str(), value.c_str());
             break;
         case '+': // 替换为空格
             body_[i] = ' ';
@@ -131,115 +345,215 @@ void HttpRequest::ParseFromUrlEncoded(){
     }
 }
 
-bool HttpRequest::UserVerify(const std::string& name, const std::string& pwd, bool is_login) {
+void HttpRequest::Verify(VerifyCallback done) {
+    assert(verify_pending_);
+    UserVerify(post_["username"], post_["password"], is_login_, std::move(done));
+}
+
+bool HttpRequest::BeginVerify(bool is_login, VERIFY_RESULT* result) {
+    is_login_ = is_login;
+    bool verified = false;
+    if (VerifyCached(post_["username"], post_["password"], is_login_, &verified)) {
+        *result = verified ? VERIFY_PASS : VERIFY_FAIL;
+        return true;
+    }
+    verify_pending_ = true; // 查询数据库和密码哈希都是异步的，由 HttpConnect 挂起连接后发起
+    return false;
+}
+
+void HttpRequest::SetVerifyResult(VERIFY_RESULT result) {
+    LOG_DEBUG("Verify result: %d", result);
+    verify_pending_ = false;
+}
+
+const char* HttpRequest::VerifyPage(VERIFY_RESULT result) {
+    if (result == VERIFY_UNAVAILABLE)
+        return "/503.html";
+    return result == VERIFY_PASS ? "/welcome.html" : "/error.html";
+}
+
+// 只用缓存验证，不需要查询存储也不需要计算哈希时返回 true
+bool HttpRequest::VerifyCached(const std::string& name, const std::string& pwd, bool is_login,
+                               bool* verified) {
+    *verified = false;
+    if (name == "" || pwd == "")
+        return true;
+    UserCache::LOOKUP ret = UserCache::instance()->Get(name, nullptr);
+    if (ret == UserCache::FOUND && !is_login) {
+        LOG_INFO("user used!");
+        return true;
+    }
+    if (ret == UserCache::NOT_FOUND && is_login) {
+        LOG_INFO("user not found!");
+        return true;
+    }
+    return false; // 未命中、登录需要校验哈希，或注册新用户仍需写存储
+}
+
+void HttpRequest::UserVerify(const std::string& name, const std::string& pwd, bool is_login,
+                             VerifyCallback done) {
     if(name == "" || pwd == ""){
-        return false;
+        done(VERIFY_FAIL);
+        return;
     }
-    LOG_INFO("Verify user: %s with pwd: %s", name.c_str(), pwd.c_str());
-    MYSQL* sql;
-    SqlConnectRAII(&sql, SqlConnectPool::instance());
-    assert(sql);
-
-    bool flag = false;
-    char order[256] = {0};
-    MYSQL_RES* res = nullptr;      // 查询结果集
-    if (!is_login) // 注册
-        flag = true;
-    snprintf(order, 256, "SELECT username, password FROM User WHERE username='%s' LIMIT 1", name.c_str());
-    LOG_DEBUG("%s", order);
-
-    // 查询用户信息
-    if (mysql_query(sql, order)) {
-        if (res)
-            mysql_free_result(res); // 查询失败，释放结果集
-        return false;
+    LOG_INFO("Verify user: %s", name.c_str());
+    std::string stored;
+    UserCache::LOOKUP cached = UserCache::instance()->Get(name, &stored);
+    if (is_login && cached == UserCache::FOUND) {
+        CheckPassword(pwd, stored, std::move(done)); // 缓存中已有哈希，不必查询存储
+        return;
+    }
+    if (!is_login && cached == UserCache::NOT_FOUND) {
+        InsertUser(name, pwd, std::move(done)); // 已确认用户名未被使用
+        return;
     }
-    res = mysql_store_result(sql);   // 存储查询结果到res中
-
-    // 处理查询结果
-    while (MYSQL_ROW row = mysql_fetch_row(res)) {
-        LOG_DEBUG("MYSQL ROW: %s %s", row[0], row[1]);
-        std::string password = row[1];
-        if (is_login) {
-            if (pwd == password) {
-                flag = true;
+
+    UserStore* store = UserStore::instance();
+    if (store == nullptr) {
+        LOG_ERROR("No user store!");
+        done(VERIFY_UNAVAILABLE);
+        return;
+    }
+
+    // 查询用户信息，异步存储的回调在主线程上执行
+    store->FindUser(name, [name, pwd, is_login, done](bool ok, bool exists, const std::string& password) {
+        if (!ok) { // 存储出错或排队超时
+            done(VERIFY_UNAVAILABLE);
+            return;
+        }
+        if (!exists) {
+            UserCache::instance()->PutMissing(name);
+            if (is_login) {
+                LOG_INFO("user not found!");
+                done(VERIFY_FAIL);
             } else {
-                flag = false;
-                LOG_INFO("pwd error!");
+                InsertUser(name, pwd, done); // 注册（用户名未被使用）
             }
-        } else {
-            flag = false;
-            LOG_INFO("user used!");
+            return;
         }
-    }
-    mysql_free_result(res);
-    // 注册（用户名未被使用）
-    if (!is_login && flag) {
-        LOG_DEBUG("register");
-        bzero(order, 256);
-        snprintf(order, 256, "INSERT INTO User(username, password) VALUES('%s', '%s')", name.c_str(), pwd.c_str());
-        LOG_DEBUG("%s", order);
-        if (mysql_query(sql, order)) {
-            LOG_ERROR("MySQL insert fail: Error: %s", mysql_error(sql));
-            flag = false;
+
+        UserCache::instance()->Put(name, password);
+        if (!is_login) {
+            LOG_INFO("user used!");
+            done(VERIFY_FAIL);
         } else {
-            LOG_DEBUG("UserVerify success!");
-            flag = true;
+            CheckPassword(pwd, password, done);
         }
-    }
-    return flag;
+    });
+}
+
+// 在哈希线程池中校验密码，不占用 I/O 工作线程和主线程
+void HttpRequest::CheckPassword(const std::string& pwd, const std::string& stored,
+                                VerifyCallback done) {
+    PasswordHasher::instance()->Verify(pwd, stored, [done](bool ok, bool match) {
+        if (!ok) { // 哈希线程池积压过多
+            done(VERIFY_UNAVAILABLE);
+            return;
+        }
+        if (!match)
+            LOG_INFO("pwd error!");
+        done(match ? VERIFY_PASS : VERIFY_FAIL);
+    });
+}
+
+void HttpRequest::InsertUser(const std::string& name, const std::string& pwd,
+                             VerifyCallback done) {
+    LOG_DEBUG("register");
+    PasswordHasher::instance()->Hash(pwd, [name, done](bool ok, const std::string& hash) {
+        if (!ok) {
+            done(VERIFY_UNAVAILABLE);
+            return;
+        }
+        UserStore::instance()->AddUser(name, hash, [name, hash, done](bool ok) {
+            if (!ok) {
+                LOG_ERROR("Insert user fail!");
+                UserCache::instance()->Invalidate(name); // 可能已被并发注册，下次重新查询
+            } else {
+                LOG_DEBUG("UserVerify success!");
+                UserCache::instance()->Put(name, hash);
+            }
+            done(ok ? VERIFY_PASS : VERIFY_FAIL);
+        });
+    });
 }
 
 // 解析 HTTP 请求
-bool HttpRequest::Parse(Buffer& buff) {
+// 只有完整的一行才会被取走，不完整的行留在 buff 中；请求体边到达边取走，
+// 下次读到数据后从当前状态继续
+HttpRequest::PARSE_RESULT HttpRequest::Parse(Buffer& buff) {
     const char* END = "\r\n";
-    if (buff.ReadableBytes() == 0)
-        return false;
-    
-    while (buff.ReadableBytes() && state_ != FINISH) {
+    PARSE_RESULT ret = PARSE_OK;
+    while (state_ != FINISH) {
+        if (state_ == BODY || state_ == CHUNK_DATA) {
+            ReadBody(buff);
+            if (body_left_ > 0)
+                return PARSE_AGAIN;
+            if (state_ == BODY) {
+                ParseBody();
+                break;
+            }
+            state_ = CHUNK_DATA_END;
+            continue;
+        }
         // 找到buff中，首次出现"\r\n"的位置
         const char* line_end = std::search(buff.ReadBegin(), buff.WriteBeginConst(), END, END + 2);
-        std::string line(buff.ReadBegin(), line_end);
+        if (line_end == buff.WriteBeginConst()) { // 这一行还没收完
+            if (buff.ReadableBytes() > MAX_LINE) {
+                LOG_ERROR("Line too long");
+                return PARSE_ERROR;
+            }
+            return PARSE_AGAIN;
+        }
+        const char* line = buff.ReadBegin();
+        bool empty = line == line_end;
         switch (state_) {
         case REQUEST_LINE:
-            if (ParseRequestLine(line) == false)
-                return false;
-            ParsePath();
+            if (empty) // 请求之间多余的空行忽略
+                break;
+            if (ParseRequestLine(line, line_end) == false)
+                return PARSE_ERROR;
             break;
         case HEADERS:
-            ParseHeader(line);
-            if (buff.ReadableBytes() <= 2) // get请求，提前结束
-                state_ = FINISH;
+            if (empty) {
+                ret = ParseHeaderEnd();
+            } else if (ParseHeader(line, line_end) == false) {
+                ret = PARSE_ERROR;
+            }
             break;
-        case BODY:
-            ParseBody(line);
+        case CHUNK_SIZE:
+            ret = ParseChunkSize(line, line_end);
             break;
-        default:
+        case CHUNK_DATA_END:
+            if (!empty) {
+                LOG_ERROR("Chunk Data Error");
+                ret = PARSE_ERROR;
+            }
+            state_ = CHUNK_SIZE;
             break;
-        }
-        if (line_end == buff.WriteBegin()) { // 读完了
-            buff.RetrieveAll();
+        case CHUNK_TRAILER: // 尾部字段忽略，空行表示请求结束
+            if (empty)
+                ParseBody();
+            break;
+        default:
             break;
         }
         buff.RetrieveUntil(line_end + 2); // 跳过回车换行
+        if (ret != PARSE_OK)
+            return ret;
     }
     LOG_DEBUG("[%s] [%s] [%s]", method_ .c_str(), path_.c_str(), version_.c_str());
-    return true;
+    return PARSE_OK;
 }
 
-std::string HttpRequest::Method() const {
+const std::string& HttpRequest::Method() const {
     return method_;
 }
 
-std::string HttpRequest::Path() const {
+const std::string& HttpRequest::Path() const {
     return path_;
 }
 
-std::string& HttpRequest::Path() {
-    return path_;
-}
-
-std::string HttpRequest::Version() const {
+const std::string& HttpRequest::Version() const {
     return version_;
 }
 
@@ -257,8 +571,69 @@ std::string HttpRequest::GetPost(const char* key) const {
     return "";
 }
 
-bool HttpRequest::IsKeepAlive() const {
-    if (header_.count("Connect") == 1) 
-        return header_.find("Connect")->second == "keep-alive" && version_ == "1.1";
+std::string HttpRequest::GetHeader(const std::string& key) const {
+    std::string lower = key;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    const std::string* value = FindHeader(lower.c_str());
+    return value ? *value : "";
+}
+
+// Connection: keep-alive, Upgrade
+bool HttpRequest::HasToken(const std::string& value, const char* token) {
+    size_t len = strlen(token);
+    size_t pos = 0;
+    while (pos < value.size()) {
+        size_t end = std::min(value.find(',', pos), value.size());
+        size_t begin = value.find_first_not_of(" \t", pos);
+        size_t last = value.find_last_not_of(" \t", end - 1);
+        if (begin < end && last != std::string::npos && last >= begin &&
+            last - begin + 1 == len && strncasecmp(value.data() + begin, token, len) == 0)
+            return true;
+        pos = end + 1;
+    }
     return false;
 }
+
+int HttpRequest::ErrorCode(PARSE_RESULT ret) {
+    switch (ret) {
+    case PARSE_TOO_LARGE:
+        return 413;
+    case PARSE_NOT_IMPLEMENTED:
+        return 501;
+    default:
+        return 400;
+    }
+}
+
+bool HttpRequest::IsUpgrade(const char* protocol) const {
+    const std::string* connection = FindHeader("connection");
+    const std::string* upgrade = FindHeader("upgrade");
+    return connection && upgrade && HasToken(*connection, "upgrade") && HasToken(*upgrade, protocol);
+}
+
+bool HttpRequest::ForwardTo(int upstream) {
+    if (version_ == "2.0" || upstream < 0)
+        return false;
+    upstream_ = upstream;
+    return true;
+}
+
+// 只接受 HTTP/1.1 的 GET 升级，HTTP/2 的请求没有 Connection/Upgrade 头部，不会通过
+bool HttpRequest::AcceptWebSocket(std::shared_ptr<const WebSocketHandler> handler) {
+    const std::string* version = FindHeader("sec-websocket-version");
+    const std::string* key = FindHeader("sec-websocket-key");
+    if (method_ != "GET" || version_ != "1.1" || !IsUpgrade("websocket") || is_upload_ ||
+        !version || *version != "13" || !key || !WebSocket::IsValidKey(*key))
+        return false;
+    websocket_ = std::move(handler);
+    return true;
+}
+
+bool HttpRequest::IsKeepAlive() const {
+    const std::string* connection = FindHeader("connection");
+    if (connection && HasToken(*connection, "close"))
+        return false;
+    if (version_ == "1.1") // HTTP/1.1 默认保持连接
+        return true;
+    return connection && HasToken(*connection, "keep-alive");
+}
@@ -2,64 +2,161 @@
 #define HTTP_REQUEST_H
 
 #include <cstring>
+#include <strings.h> // strncasecmp
 #include <string>
-#include <unordered_set>
+#include <string_view>
 #include <unordered_map>
 #include <algorithm>
-#include <regex> // 正则表达式
-#include <mysql/mysql.h>
+#include <functional>
+#include <vector>
+#include <memory>
 
 
 
 #include "../buffer/buffer.h"
 #include "../log/log.h"
-#include "../pool/sql_connect_pool.h"
+#include "../store/user_store.h"
+#include "../cache/user_cache.h"
+#include "../auth/password_hasher.h"
+#include "router.h"
+
+struct WebSocketHandler;
 
 class HttpRequest{
 public:
     enum PARSE_STATE {
         REQUEST_LINE,
         HEADERS,
-        BODY,
+        BODY,           // 按 Content-Length 读取请求体
+        CHUNK_SIZE,     // 分块编码：块大小行
+        CHUNK_DATA,     // 块数据
+        CHUNK_DATA_END, // 块数据之后的回车换行
+        CHUNK_TRAILER,  // 最后一块之后的尾部字段
         FINISH
     };
+    enum PARSE_RESULT {
+        PARSE_OK,      // 解析出一个完整的请求
+        PARSE_AGAIN,   // 请求不完整，已解析的部分保留，等待后续数据
+        PARSE_ERROR,   // 请求格式错误
+        PARSE_TOO_LARGE, // 请求体超过 max_body_size
+        PARSE_NOT_IMPLEMENTED // 使用了不支持的传输编码
+    };
+    enum VERIFY_RESULT {
+        VERIFY_FAIL,
+        VERIFY_PASS,
+        VERIFY_UNAVAILABLE // 存储或哈希线程池不可用/繁忙，返回 503
+    };
+    using VerifyCallback = std::function<void(VERIFY_RESULT)>;
+
+    static size_t max_body_size; // 请求体的最大长度，超过时返回 413
+    static size_t max_upload_size; // 上传请求的请求体不在内存中保存，单独限制长度
+
     HttpRequest() { Init(); }
     ~HttpRequest() = default;
 
-    void Init(); // 初始化
-    bool Parse(Buffer& buff); // 解析 HTTP 请求
+    void Init(); // 开始解析下一个请求，保留各字段已分配的内存
+    // 从 buff 中解析一个请求，只取走属于该请求的数据，流水线中后续的请求留在 buff 中
+    PARSE_RESULT Parse(Buffer& buff);
+    bool IsIdle() const { return state_ == REQUEST_LINE; } // 还没有解析到请求行
+
+    // HTTP/2 等不经过文本解析的请求：依次给出请求行、各头部，EndHeaders 之后追加请求体，
+    // 收完后 FinishBody；上传请求在 EndHeaders 时就确定，请求体由调用方交给 HttpUpload
+    void SetRequestLine(std::string_view method, std::string_view path, std::string_view version);
+    bool AddHeader(std::string_view name, std::string_view value); // 名称应为小写；超过个数或长度上限时返回 false
+    PARSE_RESULT EndHeaders();
+    PARSE_RESULT AppendBody(const char* data, size_t len);
+    void FinishBody();
 
-    std::string Method() const;    // HTTP 请求方法
-    std::string Path() const;   // 请求路径
-    std::string& Path();    // 获取可修改的请求路径
-    std::string Version() const;    // HTTP 版本
+    const std::string& Method() const;    // HTTP 请求方法
+    const std::string& Path() const;   // 请求路径
+    const std::string& Version() const;    // HTTP 版本
     std::string GetPost(const std::string& key) const;   // 获取 POST 请求数据
     std::string GetPost(const char* key) const;   // 获取 POST 请求数据
 
-    bool IsKeepAlive() const;    // 是否保持连接
+    std::string GetHeader(const std::string& key) const; // 获取请求头，名称不区分大小写，不存在时返回空串
+    bool IsKeepAlive() const;    // 是否保持连接：HTTP/1.1 默认保持，HTTP/1.0 需要 Connection: keep-alive
+    bool IsForm() const;         // 是否为 application/x-www-form-urlencoded 的 POST，表单数据由 GetPost 获取
+    bool IsUpgrade(const char* protocol) const; // 是否请求升级到 protocol（Connection: Upgrade, Upgrade: protocol）
+    static bool HasToken(const std::string& value, const char* token); // 逗号分隔的列表中是否有 token，不区分大小写
+    static int ErrorCode(PARSE_RESULT ret); // 解析失败时响应的状态码
+
+    // 请求行解析完时按方法和路径匹配的路由，没有匹配时为 nullptr
+    const Router::Route* GetRoute() const { return route_; }
+    std::string_view Param(std::string_view name) const { return params_.Get(name); } // 路径参数
+
+    // 上传请求在请求头解析完时就返回 PARSE_OK，长度为 BodyLength() 的请求体由调用方接收
+    bool IsUpload() const { return is_upload_; }
+    size_t BodyLength() const { return body_left_; }
+
+    // 反向代理：路由处理函数把请求交给编号为 upstream 的上游服务器组，由 HttpConnect 转发；
+    // HTTP/2 的请求不转发，返回 false
+    bool ForwardTo(int upstream);
+    int Upstream() const { return upstream_; } // 没有转发时为 -1
+    // FORWARD 路由的请求体在请求头解析完时还在 socket 中，长度为 BodyLength()，由转发时直接搬运
+    bool HasStreamedBody() const { return is_streamed_; }
+    const std::string& Body() const { return body_; } // 已读入内存的请求体
+    size_t HeaderCount() const { return header_count_; }
+    const std::pair<std::string, std::string>& HeaderAt(size_t i) const { return header_[i]; } // 名称为小写
+
+    // 登录/注册：能用缓存确定结果时返回 true 并给出 result，否则进入等待验证状态，
+    // 由 HttpConnect 挂起连接后调用 Verify
+    bool BeginVerify(bool is_login, VERIFY_RESULT* result);
+    bool IsVerifyPending() const { return verify_pending_; }
+    void Verify(VerifyCallback done);             // 异步验证，done 在数据库查询结束后于主线程调用
+    void SetVerifyResult(VERIFY_RESULT result);   // 拿到验证结果，结束等待
+    static const char* VerifyPage(VERIFY_RESULT result); // 验证结果对应的跳转页面
+
+    // WebSocket：路由处理函数接受升级，握手合法时返回 true，HttpConnect 随后以 101 回复并交给 handler
+    bool AcceptWebSocket(std::shared_ptr<const WebSocketHandler> handler);
+    const std::shared_ptr<const WebSocketHandler>& GetWebSocket() const { return websocket_; }
 
 private:
     static int  ConverHex(char ch); // 十六进制转换为十进制
-    static bool UserVerify(const std::string& name, const std::string& pwd, bool is_login); // 用户验证
+    static bool VerifyCached(const std::string& name, const std::string& pwd, bool is_login,
+                             bool* verified); // 用缓存验证
+    static void UserVerify(const std::string& name, const std::string& pwd, bool is_login,
+                           VerifyCallback done); // 用户验证
+    static void CheckPassword(const std::string& pwd, const std::string& stored,
+                              VerifyCallback done); // 校验密码哈希
+    static void InsertUser(const std::string& name, const std::string& pwd,
+                           VerifyCallback done); // 注册新用户
 
-    bool ParseRequestLine(const std::string& line); // 解析请求行
-    void ParseHeader(const std::string& line); // 解析请求头
-    void ParseBody(const std::string& line); // 解析请求体
+    // 各行直接在读缓冲中解析，[begin, end) 不含回车换行
+    bool ParseRequestLine(const char* begin, const char* end); // 解析请求行
+    bool ParseHeader(const char* begin, const char* end); // 解析请求头
+    PARSE_RESULT ParseHeaderEnd(); // 请求头结束，确定请求体的长度或编码
+    bool GetContentLength(std::string* value, bool* found) const; // 取值不一致时返回 false
+    bool GetTransferCodings(std::vector<std::string>* codings) const; // 没有 Transfer-Encoding 时返回 false
+    PARSE_RESULT ParseChunkSize(const char* begin, const char* end); // 解析块大小行
+    const std::string* FindHeader(const char* key) const; // key 为小写
+    void ReadBody(Buffer& buff);   // 把 buff 中属于当前请求体的数据追加到 body_
+    void ParseBody(); // 请求体读完后解析
 
-    void ParsePath(); // 解析请求路径 
     void ParsePost(); // 解析 POST 请求数据
     void ParseFromUrlEncoded(); // 解析 URL 编码格式的 POST 数据 
 
-    static const std::unordered_set<std::string> DEFAULT_HTML;
-    static const std::unordered_map<std::string, int> DEFAULT_HTML_TAG;
+    static const size_t MAX_LINE = 8192; // 请求行或单个请求头的最大长度
+    static const size_t MAX_HEADERS = 100; // 请求头的最大个数
+    static const size_t MAX_KEEP_BODY = 65536; // body_ 超过该容量时释放，避免空闲连接长期占用
 
     PARSE_STATE state_;  // 当前解析状态,初始为 REQUEST_LINE,HEADERS,BODY,FINISH
     std::string method_;  // HTTP 请求方法
     std::string path_;    // 请求路径
     std::string version_;  // HTTP 版本
     std::string body_;   // 请求体
-    std::unordered_map<std::string, std::string> header_; // HTTP 请求的头部信息
+    size_t body_left_; // 当前请求体（分块编码时为当前块）还未读到的字节数
+    // HTTP 请求的头部信息，名称转为小写；前 header_count_ 个有效，之后的元素留作下次复用
+    std::vector<std::pair<std::string, std::string>> header_;
+    size_t header_count_;
     std::unordered_map<std::string, std::string> post_;   // POST 请求的数据
+    const Router::Route* route_;
+    RouteParams params_;  // 指向 path_ 中的片段
+    bool verify_pending_; // 是否等待数据库验证
+    bool is_login_;       // 等待的是登录还是注册
+    bool is_upload_;      // 请求体由 HttpUpload 接收
+    bool is_streamed_;    // 请求体留在 socket 中，由转发时搬运
+    int upstream_;        // 转发的上游服务器组，-1 为不转发
+    std::shared_ptr<const WebSocketHandler> websocket_; // 已接受的 WebSocket 升级
 };
 
 #endif
\ No newline at end of file
@@ -1,43 +1,8 @@
 #include "http_response.h"
 
 
-const std::unordered_map<int, std::string> HttpResponse::CODE_STATUS = {
-    {200, "OK"},
-    {400, "Bad Requeset"},
-    {403, "Forbidden"},
-    {404, "Not Found"},
-};
-
-const std::unordered_map<int, std::string> HttpResponse::CODE_PATH = {
-    {400, "/400.html"},
-    {403, "/403.html"},
-    {404, "/404.html"},
-};
-
-const std::unordered_map<std::string, std::string> HttpResponse::SUFFIX_TYPE = {
-    {".html",  "text/html"},
-    {".xml",   "text/xml"},
-    {".xhtml", "application/xhtml+xml"},
-    {".txt",   "text/plain"},
-    {".rtf",   "application/rtf"},
-    {".pdf",   "application/pdf"},
-    {".word",  "application/nsword"},
-    {".png",   "image/png"},
-    {".gif",   "image/gif"},
-    {".jpg",   "image/jpeg"},
-    {".jpeg",  "image/jpeg"},
-    {".au",    "audio/basic"},
-    {".mpeg",  "video/mpeg"},
-    {".mpg",   "video/mpeg"},
-    {".avi",   "video/x-msvideo"},
-    {".gz",    "application/x-gzip"},
-    {".tar",   "application/x-tar"},
-    {".css",   "text/css"},
-    {".js",    "text/javascript"},
-};
-
-
-HttpResponse::HttpResponse(): code_(-1), is_keep_alive_(false), path_(""), src_dir_(""), mmfile_(nullptr){
+HttpResponse::HttpResponse(): code_(-1), is_keep_alive_(false), keep_alive_timeout_(0), keep_alive_max_(0), path_(""),
+                              has_content_(false), mime_(-1), src_dir_(""), mmfile_(nullptr){
     memset(&mmfile_stat_, 0, sizeof(mmfile_stat_));
 }
 
@@ -50,12 +15,30 @@ void HttpResponse::Init(const std::string& path, const std::string& src_dir, int
     assert(src_dir != ""); //资源目录不能为空
     code_ = code;
     is_keep_alive_ = is_keep_alive;
+    keep_alive_timeout_ = 0;
+    keep_alive_max_ = 0;
     path_ = path;
+    has_content_ = false;
+    content_.clear();
+    mime_ = -1;
     src_dir_ = src_dir;
     mmfile_ = nullptr;
     memset(&mmfile_stat_, 0, sizeof(mmfile_stat_));
 }
 
+void HttpResponse::SetKeepAlive(bool is_keep_alive, int timeout_s, int max_requests){
+    is_keep_alive_ = is_keep_alive;
+    keep_alive_timeout_ = timeout_s;
+    keep_alive_max_ = max_requests;
+}
+
+void HttpResponse::SetContent(int code, std::string content, std::string_view type){
+    code_ = code;
+    has_content_ = true;
+    content_ = std::move(content);
+    mime_ = ResponseHeader::MimeIndex(type);
+}
+
 // 解除内存映射
 void HttpResponse::UnmapFile(){
     if(mmfile_){
@@ -64,101 +47,89 @@ void HttpResponse::UnmapFile(){
     }
 }
 
+char* HttpResponse::DetachFile(){
+    char* file = mmfile_;
+    mmfile_ = nullptr;
+    return file;
+}
+
 void HttpResponse::ErrorHtml(){
-    if(CODE_PATH.count(code_) == 1){
-        path_ = CODE_PATH.find(code_)->second;
+    std::string_view page = ResponseHeader::ErrorPage(code_);
+    if(!page.empty()){
+        path_.assign(page.data(), page.size());
         stat((src_dir_ + path_).c_str(), &mmfile_stat_);
     }
 }
 
-void HttpResponse::AddStateLine(Buffer& buff){
-    std::string status;
-    if(CODE_STATUS.count(code_) == 1){
-        status = CODE_STATUS.find(code_)->second;
-    } else {
-        code_ = 400;
-        status = CODE_STATUS.find(400)->second;
-    }
-    buff.Append("HTTP/1.1 " + std::to_string(code_) + " " + status + "\r\n");
+// 状态行和头部由预先拼好的模板生成，一次追加到缓冲区
+void HttpResponse::AddHeader(Buffer& buff, size_t content_len){
+    ResponseHeader::instance()->Append(buff, code_, Mime(), is_keep_alive_,
+                                       keep_alive_timeout_, keep_alive_max_, content_len);
 }
 
+std::string HttpResponse::ErrorBody(const std::string& message) const{
+    std::string body;
+    std::string_view status = ResponseHeader::Status(code_);
+    body += "<html><title>Error</title>";
+    body += "<body bgcolor=\"ffffff\">";
+    body += std::to_string(code_) + " : ";
+    body.append(status.empty() ? "Bad Request" : status);
+    body += "\n";
+    body += "<p>" + message + "</p>";
+    body += "<hr><em>WebServer</em></body></html>";
+    return body;
+}
 
-void HttpResponse::AddHeader(Buffer& buff){
-    buff.Append("Connection: ");
-    if(is_keep_alive_){
-        buff.Append("keep-alive\r\n");
-        buff.Append("Keep-Alive: timeout=120\r\n");
-    } else {
-        buff.Append("close\r\n");
-    }
-    buff.Append("Content-type: " + GetFileType() + "\r\n");
+void HttpResponse::ErrorContent(Buffer& buff, const std::string& message){
+    std::string body = ErrorBody(message);
+    AddHeader(buff, body.size());
+    buff.Append(body);
 }
 
-std::string HttpResponse::GetFileType(){
-    std::string::size_type idx = path_.find_last_of('.');
-    if(idx == std::string::npos){
-        return "text/plain";
+void HttpResponse::Load(){
+    if (has_content_)
+        return;
+    if (code_ >= 400) {
+        // 调用方已确定的错误（如 400、413），不再检查请求路径
+    } else if (stat((src_dir_ + path_).c_str(), &mmfile_stat_) < 0) {
+        LOG_WARN("stat fail: error: %s", strerror(errno));
+        code_ = 404;
+    } else if (S_ISDIR(mmfile_stat_.st_mode)) {
+        code_ = 404;
+    } else if (!(mmfile_stat_.st_mode & S_IROTH)) {
+        code_ = 403;
+    } else if (code_ == -1) {
+        code_ = 200;
     }
-    std::string suffix = path_.substr(idx);
-    if(SUFFIX_TYPE.count(suffix) == 1){
-        return SUFFIX_TYPE.find(suffix)->second;
+    ErrorHtml();
+    if(ResponseHeader::Status(code_).empty()){
+        code_ = 400;
     }
-    return "text/plain";
-}
-
-// 将文件映射进内存地址中
-void HttpResponse::AddContent(Buffer& buff){
+    // 将文件映射进内存地址中
     std::string path = src_dir_ + path_;
     int src_fd = open(path.c_str(), O_RDONLY);
     if(src_fd < 0){
-        ErrorContent(buff, "File Not Found!");
+        has_content_ = true;
+        content_ = ErrorBody("File Not Found!");
         return;
     }
     LOG_DEBUG("File path: %s", path.c_str());
-    //获取文件状态
     void* mmret = mmap(0, mmfile_stat_.st_size, PROT_READ, MAP_PRIVATE, src_fd, 0);
+    close(src_fd);
     if(mmret == MAP_FAILED){
-        close(src_fd);
-        ErrorContent(buff, "File Not Found!");
+        has_content_ = true;
+        content_ = ErrorBody("File Not Found!");
         return;
     }
     mmfile_ = static_cast<char*>(mmret);
-    close(src_fd);
-    buff.Append("Content-length: " + std::to_string(mmfile_stat_.st_size) + "\r\n\r\n");
-}
-
-
-void HttpResponse::ErrorContent(Buffer& buff, const std::string& message){
-    std::string body;
-    std::string status;
-    body += "<html><title>Error</title>";
-    body += "<body bgcolor=\"ffffff\">";
-    if(CODE_STATUS.count(code_) == 1){
-        status = CODE_STATUS.find(code_)->second;
-    } else {   
-        status = "Bad Request";
-    }
-    body += std::to_string(code_) + " : " + status + "\n";
-    body += "<p>" + message + "</p>";
-    body += "<hr><em>WebServer</em></body></html>";
-
-    buff.Append("Content-length: " + std::to_string(body.size()) + "\r\n\r\n");
-    buff.Append(body);
 }
 
 void HttpResponse::MakeResponse(Buffer& buff){
-    if (stat((src_dir_ + path_).c_str(), &mmfile_stat_) < 0) {
-        LOG_WARN("stat fail: error: %s", strerror(errno));
-        code_ = 404;
-    } else if (S_ISDIR(mmfile_stat_.st_mode)) {
-        code_ = 404;
-    } else if (!(mmfile_stat_.st_mode & S_IROTH)) {
-        code_ = 403;
-    } else if (code_ == -1) {
-        code_ = 200;
+    Load();
+    if (has_content_) {
+        AddHeader(buff, content_.size());
+        buff.Append(content_);
+        return;
     }
-    ErrorHtml();
-    AddStateLine(buff);
-    AddHeader(buff);
-    AddContent(buff);
-}
\ No newline at end of file
+    AddHeader(buff, mmfile_stat_.st_size);
+}
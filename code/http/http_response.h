@@ -10,10 +10,11 @@
 #include <cstring>    // memset
 #include <cassert>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 
 #include "../buffer/buffer.h"
 #include "../log/log.h"
+#include "response_header.h"
 
 class HttpResponse{
 public:
@@ -21,29 +22,43 @@ public:
     ~HttpResponse();
     void Init(const std::string& path, const std::string& src_dir, int code = -1, bool is_keep_alive = false);
     void UnmapFile();   // 解除内存映射
+    // 在 Init 之后调用；timeout_s、max_requests 为 Keep-Alive 头部的参数，0 表示不写出该项
+    void SetKeepAlive(bool is_keep_alive, int timeout_s, int max_requests);
+    // 路由的处理函数使用：换成另一个文件，或者不读文件、直接给出响应内容
+    void SetPath(std::string_view path) { path_.assign(path.data(), path.size()); }
+    // type 为决定 Content-type 的扩展名，如 ".json"
+    void SetContent(int code, std::string content, std::string_view type = ".html");
 
+    // 确定最终的状态码并准备响应内容：映射文件，或者换成错误页面；文件打不开时给出错误信息
+    // MakeResponse 会先调用它；HTTP/2 只取状态码和内容，响应头另行编码
+    void Load();
     void MakeResponse(Buffer& buff);
     void ErrorContent(Buffer& buff, const std::string& message);
 
     char* File() { return mmfile_; }
+    char* DetachFile(); // 交出映射的文件，由调用方在写完后 munmap
     size_t FileLen() const { return mmfile_stat_.st_size; }
+    bool HasContent() const { return has_content_; } // 内容不是文件，而是 Content()
+    const std::string& Content() const { return content_; }
+    std::string TakeContent() { return std::move(content_); }
     int Code() const { return code_; }
+    int Mime() const { return mime_ >= 0 ? mime_ : ResponseHeader::MimeIndex(path_); }
+    const std::string& Path() const { return path_; }
 private:
-    void AddStateLine(Buffer& buff);
-    void AddHeader(Buffer& buff);
-    void AddContent(Buffer& buff);
+    void AddHeader(Buffer& buff, size_t content_len);
+    std::string ErrorBody(const std::string& message) const;
 
     void ErrorHtml();
-    std::string GetFileType();
-
-    static const std::unordered_map<int, std::string> CODE_STATUS;          // 编码状态集
-    static const std::unordered_map<int, std::string> CODE_PATH;            // 编码路径集
-    static const std::unordered_map<std::string, std::string> SUFFIX_TYPE;  // 后缀状态集
 
     int code_;
     bool is_keep_alive_; //是否保持连接
+    int keep_alive_timeout_; //空闲超时，秒
+    int keep_alive_max_; //连接上剩余的请求数
 
     std::string path_; //请求路径
+    bool has_content_; //响应内容由处理函数给出，不读文件
+    std::string content_;
+    int mime_; //给出内容时的文件类型，-1 表示按 path_ 的扩展名
     std::string src_dir_; //资源目录
 
     char* mmfile_; //内存映射地址
@@ -0,0 +1,170 @@
+#ifndef HTTP_TABLES_H
+#define HTTP_TABLES_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+// 文件类型和状态码的静态表，连同查找用的完美哈希都在编译期生成
+// 查找只做一次哈希、一次取槽位和一次比较，不分配内存；找不到时返回下标 -1
+namespace http_tables {
+
+struct Mime {
+    std::string_view suffix; // 含 '.'，小写
+    std::string_view type;
+};
+
+// 第一项是默认类型
+inline constexpr Mime MIMES[] = {
+    {".txt",   "text/plain"},
+    {".html",  "text/html"},
+    {".htm",   "text/html"},
+    {".css",   "text/css"},
+    {".js",    "text/javascript"},
+    {".mjs",   "text/javascript"},
+    {".json",  "application/json"},
+    {".xml",   "text/xml"},
+    {".xhtml", "application/xhtml+xml"},
+    {".wasm",  "application/wasm"},
+    {".rtf",   "application/rtf"},
+    {".pdf",   "application/pdf"},
+    {".word",  "application/nsword"},
+    {".png",   "image/png"},
+    {".gif",   "image/gif"},
+    {".jpg",   "image/jpeg"},
+    {".jpeg",  "image/jpeg"},
+    {".webp",  "image/webp"},
+    {".avif",  "image/avif"},
+    {".svg",   "image/svg+xml"},
+    {".ico",   "image/x-icon"},
+    {".woff",  "font/woff"},
+    {".woff2", "font/woff2"},
+    {".ttf",   "font/ttf"},
+    {".otf",   "font/otf"},
+    {".eot",   "application/vnd.ms-fontobject"},
+    {".au",    "audio/basic"},
+    {".mp3",   "audio/mpeg"},
+    {".mp4",   "video/mp4"},
+    {".webm",  "video/webm"},
+    {".mpeg",  "video/mpeg"},
+    {".mpg",   "video/mpeg"},
+    {".avi",   "video/x-msvideo"},
+    {".gz",    "application/x-gzip"},
+    {".tar",   "application/x-tar"},
+};
+
+struct Status {
+    int code;
+    std::string_view reason;
+    std::string_view page; // 错误页面，为空时不替换请求的文件
+};
+
+inline constexpr Status STATUSES[] = {
+    {200, "OK",                  ""},
+    {400, "Bad Requeset",        "/400.html"},
+    {403, "Forbidden",           "/403.html"},
+    {404, "Not Found",           "/404.html"},
+    {413, "Payload Too Large",   "/413.html"},
+    {501, "Not Implemented",     "/501.html"},
+    {502, "Bad Gateway",         "/502.html"},
+    {503, "Service Unavailable", "/503.html"},
+    {507, "Insufficient Storage", "/507.html"},
+};
+
+inline constexpr int MIME_COUNT = sizeof(MIMES) / sizeof(MIMES[0]);
+inline constexpr int STATUS_COUNT = sizeof(STATUSES) / sizeof(STATUSES[0]);
+inline constexpr size_t MAX_SUFFIX = 8; // 更长的扩展名直接当作未知
+
+// 扩展名只含字母、数字和 '.'，按位或 0x20 即转成小写且不影响数字和 '.'，匹配不区分大小写
+constexpr uint32_t HashSuffix(std::string_view suffix, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed; // FNV-1a
+    for (char c : suffix)
+        h = (h ^ static_cast<uint8_t>(c | 0x20)) * 16777619u;
+    return h;
+}
+
+constexpr uint32_t HashCode(int code, uint32_t seed) {
+    return (static_cast<uint32_t>(code) ^ seed) * 2654435761u;
+}
+
+// 槽位数为 2^BITS，取哈希的高 BITS 位；slot 中存放表项下标加 1，0 为空
+template <int BITS>
+struct PerfectHash {
+    static constexpr uint32_t SIZE = 1u << BITS;
+    uint32_t seed = 0;
+    uint8_t slot[SIZE] = {};
+
+    static constexpr uint32_t Slot(uint32_t h) { return h >> (32 - BITS); }
+};
+
+template <int BITS>
+constexpr PerfectHash<BITS> BuildMimeHash() {
+    for (uint32_t seed = 1; seed < 100000; ++seed) {
+        PerfectHash<BITS> table;
+        table.seed = seed;
+        bool ok = true;
+        for (int i = 0; i < MIME_COUNT && ok; ++i) {
+            uint8_t& slot = table.slot[table.Slot(HashSuffix(MIMES[i].suffix, seed))];
+            ok = slot == 0;
+            slot = static_cast<uint8_t>(i + 1);
+        }
+        if (ok)
+            return table;
+    }
+    return PerfectHash<BITS>();
+}
+
+template <int BITS>
+constexpr PerfectHash<BITS> BuildStatusHash() {
+    for (uint32_t seed = 1; seed < 100000; ++seed) {
+        PerfectHash<BITS> table;
+        table.seed = seed;
+        bool ok = true;
+        for (int i = 0; i < STATUS_COUNT && ok; ++i) {
+            uint8_t& slot = table.slot[table.Slot(HashCode(STATUSES[i].code, seed))];
+            ok = slot == 0;
+            slot = static_cast<uint8_t>(i + 1);
+        }
+        if (ok)
+            return table;
+    }
+    return PerfectHash<BITS>();
+}
+
+inline constexpr PerfectHash<7> MIME_HASH = BuildMimeHash<7>();
+inline constexpr PerfectHash<4> STATUS_HASH = BuildStatusHash<4>();
+static_assert(MIME_HASH.seed != 0, "no perfect hash for MIMES, add a bit");
+static_assert(STATUS_HASH.seed != 0, "no perfect hash for STATUSES, add a bit");
+
+constexpr bool EqualSuffix(std::string_view key, std::string_view suffix) {
+    if (key.size() != suffix.size())
+        return false;
+    for (size_t i = 0; i < key.size(); ++i) {
+        if (key[i] != (suffix[i] | 0x20))
+            return false;
+    }
+    return true;
+}
+
+// 按路径的扩展名查找，返回 MIMES 的下标
+constexpr int FindMime(std::string_view path) {
+    size_t dot = path.rfind('.');
+    if (dot == std::string_view::npos || path.size() - dot > MAX_SUFFIX)
+        return -1;
+    std::string_view suffix = path.substr(dot);
+    int idx = MIME_HASH.slot[MIME_HASH.Slot(HashSuffix(suffix, MIME_HASH.seed))] - 1;
+    return idx >= 0 && EqualSuffix(MIMES[idx].suffix, suffix) ? idx : -1;
+}
+
+// 返回 STATUSES 的下标
+constexpr int FindStatus(int code) {
+    int idx = STATUS_HASH.slot[STATUS_HASH.Slot(HashCode(code, STATUS_HASH.seed))] - 1;
+    return idx >= 0 && STATUSES[idx].code == code ? idx : -1;
+}
+
+static_assert(FindMime("/index.html") == 1 && FindMime("/a.WOFF2") >= 0 && FindMime("/a.bin") < 0, "");
+static_assert(FindStatus(404) == 3 && FindStatus(302) < 0, "");
+
+} // namespace http_tables
+
+#endif // HTTP_TABLES_H
@@ -0,0 +1,325 @@
+#include "http_upload.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+std::string HttpUpload::upload_dir = "./upload/";
+size_t HttpUpload::max_total_bytes = 1ull << 30;
+size_t HttpUpload::max_total_files = 10000;
+std::atomic<unsigned> HttpUpload::counter_(0);
+std::atomic<size_t> HttpUpload::used_bytes_(0);
+std::atomic<size_t> HttpUpload::used_files_(0);
+const int HttpUpload::MAX_FILES;
+const size_t HttpUpload::CHUNK_SIZE;
+
+HttpUpload::HttpUpload()
+    : active_(false), multipart_(false), error_(0), left_(0), reserved_(0), file_fd_(-1) {
+    pipe_fd_[0] = pipe_fd_[1] = -1;
+}
+
+HttpUpload::~HttpUpload() {
+    Abort();
+}
+
+bool HttpUpload::MakeDir(const std::string& dir) {
+    if (mkdir(dir.c_str(), 0755) < 0 && errno != EEXIST) {
+        LOG_ERROR("Upload dir %s: %s", dir.c_str(), strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool HttpUpload::SetDir(const std::string& dir) {
+    std::string path = dir.empty() || dir.back() != '/' ? dir + "/" : dir;
+    if (!MakeDir(path))
+        return false;
+    DIR* d = opendir(path.c_str());
+    if (d == nullptr) {
+        LOG_ERROR("Upload dir %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    size_t bytes = 0, files = 0;
+    while (struct dirent* entry = readdir(d)) {
+        struct stat st;
+        if (fstatat(dirfd(d), entry->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISREG(st.st_mode)) {
+            bytes += st.st_size;
+            ++files;
+        }
+    }
+    closedir(d);
+    upload_dir = path;
+    used_bytes_ = bytes;
+    used_files_ = files;
+    LOG_INFO("Upload dir: %s, %zu files, %zu bytes", path.c_str(), files, bytes);
+    return true;
+}
+
+bool HttpUpload::Start(const std::string& content_type, size_t length) {
+    assert(!active_);
+    std::string boundary = MultipartParser::GetBoundary(content_type);
+    multipart_ = content_type.compare(0, 10, "multipart/") == 0;
+    if (multipart_ && boundary.empty()) {
+        LOG_WARN("Upload without boundary: %s", content_type.c_str());
+        return false;
+    }
+    active_ = true;
+    left_ = length;
+    error_ = 0;
+    // 请求体长度是保存的文件大小的上限，先按它预留，保存后换成实际大小
+    reserved_ = length;
+    size_t used = used_bytes_.fetch_add(reserved_) + reserved_;
+    if (max_total_bytes > 0 && used > max_total_bytes) {
+        LOG_WARN("Upload quota exceeded: %zu bytes", used - reserved_);
+        error_ = 507;
+    } else if (multipart_) {
+        using namespace std::placeholders;
+        parser_.Init(boundary, std::bind(&HttpUpload::OnPartBegin, this, _1, _2),
+                     std::bind(&HttpUpload::OnPartData, this, _1, _2),
+                     std::bind(&HttpUpload::OnPartEnd, this));
+    } else if (!OpenTemp(RawFileName(content_type))) {
+        error_ = 503;
+    } else if (pipe2(pipe_fd_, O_CLOEXEC | O_NONBLOCK) < 0) {
+        // 没有管道时退回 read/write
+        LOG_WARN("Upload pipe error: %s", strerror(errno));
+        pipe_fd_[0] = pipe_fd_[1] = -1;
+    }
+    return true;
+}
+
+void HttpUpload::Feed(Buffer& buff) {
+    size_t len = std::min(buff.ReadableBytes(), left_);
+    Feed(buff.ReadBegin(), len);
+    buff.Retrieve(len);
+}
+
+void HttpUpload::Feed(const char* data, size_t len) {
+    assert(active_);
+    len = std::min(len, left_);
+    Consume(data, len);
+    left_ -= len;
+}
+
+ssize_t HttpUpload::ReadFrom(int fd, int* save_errno, bool loop) {
+    assert(active_);
+    if (pipe_fd_[0] >= 0 && error_ == 0)
+        return SpliceFrom(fd, save_errno, loop);
+    if (!chunk_)
+        chunk_.reset(new char[CHUNK_SIZE]);
+    ssize_t len = -1;
+    do {
+        len = read(fd, chunk_.get(), std::min(left_, CHUNK_SIZE));
+        if (len <= 0) {
+            *save_errno = len < 0 ? errno : 0;
+            break;
+        }
+        left_ -= len;
+        Consume(chunk_.get(), len);
+    } while (loop && left_ > 0); // 边沿触发时读到没有数据或请求体收完为止
+    return len;
+}
+
+// socket -> 管道 -> 文件，数据只在内核的页之间移动
+ssize_t HttpUpload::SpliceFrom(int fd, int* save_errno, bool loop) {
+    ssize_t len = -1;
+    do {
+        len = splice(fd, nullptr, pipe_fd_[1], nullptr, std::min(left_, CHUNK_SIZE),
+                     SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (len <= 0) {
+            *save_errno = len < 0 ? errno : 0;
+            break;
+        }
+        left_ -= len;
+        for (ssize_t rest = len; rest > 0;) {
+            ssize_t moved = splice(pipe_fd_[0], nullptr, file_fd_, nullptr, rest, SPLICE_F_MOVE);
+            if (moved <= 0) {
+                LOG_ERROR("Upload write error: %s", strerror(errno));
+                error_ = 503;
+                ClosePipe(); // 管道中剩下的数据随管道一起丢弃，之后的请求体读出来丢弃
+                return len;
+            }
+            rest -= moved;
+        }
+    } while (loop && left_ > 0);
+    return len;
+}
+
+void HttpUpload::Consume(const char* data, size_t len) {
+    if (error_ != 0 || len == 0)
+        return;
+    if (!multipart_) {
+        if (!WriteAll(data, len))
+            error_ = 503;
+    } else if (!parser_.Feed(data, len) && error_ == 0) {
+        LOG_WARN("Bad multipart body");
+        error_ = 400;
+    }
+}
+
+int HttpUpload::Finish() {
+    assert(IsFinished());
+    int code = error_;
+    if (code == 0 && multipart_ && !parser_.IsDone()) { // 缺少结束分隔符
+        LOG_WARN("Incomplete multipart body");
+        code = 400;
+    }
+    CloseFile();
+    size_t counted = 0;
+    if (code == 0) {
+        counted = files_.size();
+        size_t used = used_files_.fetch_add(counted) + counted;
+        if (max_total_files > 0 && used > max_total_files) {
+            LOG_WARN("Upload quota exceeded: %zu files", used - counted);
+            code = 507;
+        }
+    }
+    saved_.clear();
+    size_t bytes = 0;
+    for (const TempFile& file : files_) {
+        if (code == 0) {
+            std::string name = SavedName(file.filename);
+            struct stat st;
+            if (rename(file.path.c_str(), (upload_dir + name).c_str()) == 0) {
+                if (stat((upload_dir + name).c_str(), &st) == 0)
+                    bytes += st.st_size;
+                saved_.push_back(name);
+                continue;
+            }
+            LOG_ERROR("Upload rename error: %s", strerror(errno));
+            code = 503;
+        }
+        unlink(file.path.c_str());
+    }
+    if (code != 0) { // 已经改名的也删除，不保留一半的上传
+        for (const std::string& name : saved_)
+            unlink((upload_dir + name).c_str());
+        saved_.clear();
+        used_files_ -= counted;
+        bytes = 0;
+    }
+    used_bytes_ += bytes; // Reset 中释放预留
+    files_.clear();
+    LOG_INFO("Upload finished: %d, %zu files", code == 0 ? 200 : code, saved_.size());
+    Reset();
+    return code == 0 ? 200 : code;
+}
+
+void HttpUpload::Abort() {
+    CloseFile();
+    for (const TempFile& file : files_)
+        unlink(file.path.c_str());
+    files_.clear();
+    Reset();
+}
+
+void HttpUpload::Reset() {
+    used_bytes_ -= reserved_;
+    reserved_ = 0;
+    ClosePipe();
+    chunk_.reset();
+    active_ = false;
+    left_ = 0;
+    error_ = 0;
+}
+
+bool HttpUpload::OpenTemp(const std::string& filename) {
+    std::string path = upload_dir + ".upload-XXXXXX";
+    std::vector<char> templ(path.begin(), path.end());
+    templ.push_back('\0');
+    file_fd_ = mkostemp(templ.data(), O_CLOEXEC);
+    if (file_fd_ < 0) {
+        LOG_ERROR("Upload open error: %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    files_.push_back({templ.data(), filename});
+    fchmod(file_fd_, 0644); // mkstemp 只给所有者权限，上传的图片需要能被读取
+    return true;
+}
+
+bool HttpUpload::WriteAll(const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(file_fd_, data, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            LOG_ERROR("Upload write error: %s", strerror(errno));
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+void HttpUpload::CloseFile() {
+    if (file_fd_ >= 0) {
+        close(file_fd_);
+        file_fd_ = -1;
+    }
+}
+
+void HttpUpload::ClosePipe() {
+    for (int& fd : pipe_fd_) {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+}
+
+// 只保存带文件名的分段，普通表单字段丢弃
+bool HttpUpload::OnPartBegin(const std::string& name, const std::string& filename) {
+    LOG_DEBUG("Upload part: %s, %s", name.c_str(), filename.c_str());
+    if (filename.empty())
+        return true;
+    if (files_.size() >= static_cast<size_t>(MAX_FILES)) {
+        LOG_WARN("Too many files in upload");
+        return false;
+    }
+    if (!OpenTemp(filename)) {
+        error_ = 503;
+        return false;
+    }
+    return true;
+}
+
+bool HttpUpload::OnPartData(const char* data, size_t len) {
+    if (file_fd_ < 0)
+        return true;
+    if (!WriteAll(data, len)) {
+        error_ = 503;
+        return false;
+    }
+    return true;
+}
+
+bool HttpUpload::OnPartEnd() {
+    CloseFile();
+    return true;
+}
+
+// 文件名由服务端生成，客户端给出的文件名只用来取图片的扩展名，避免路径穿越和覆盖
+std::string HttpUpload::SavedName(const std::string& filename) {
+    static const char* IMAGE_SUFFIX[] = {".jpg", ".jpeg", ".png", ".gif", ".webp", ".bmp"};
+    std::string suffix = ".bin";
+    std::string::size_type idx = filename.find_last_of('.');
+    if (idx != std::string::npos) {
+        std::string ext = filename.substr(idx);
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        for (const char* image : IMAGE_SUFFIX) {
+            if (ext == image)
+                suffix = ext;
+        }
+    }
+    long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    return std::to_string(ms) + "-" + std::to_string(counter_++) + suffix;
+}
+
+std::string HttpUpload::RawFileName(const std::string& content_type) {
+    if (content_type.compare(0, 6, "image/") == 0)
+        return "upload." + content_type.substr(6, content_type.find(';') - 6);
+    return "upload";
+}
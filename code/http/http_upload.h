@@ -0,0 +1,93 @@
+#ifndef HTTP_UPLOAD_H
+#define HTTP_UPLOAD_H
+
+#include <fcntl.h>     // splice
+#include <unistd.h>
+#include <sys/stat.h>  // mkdir
+#include <dirent.h>    // opendir
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+
+#include "../buffer/buffer.h"
+#include "../log/log.h"
+#include "multipart_parser.h"
+
+// 上传请求体的接收：请求头解析完后，请求体不再进入读缓冲，而是边读边写入临时文件，
+// 全部收完后改名到 upload_dir，内存占用与上传的大小无关
+// multipart/form-data 用固定大小的缓冲读取并解析出其中的文件；
+// 其他类型整个请求体就是文件内容，经管道用 splice 从 socket 直接搬到文件，不经过用户态
+// upload_dir 中文件的总字节数和文件数有上限：开始上传时按请求体长度预留空间，保存时计入文件数，
+// 超出时请求体照常读完后丢弃，返回 507；统计从 SetDir 时目录中已有的文件开始，不感知外部的删除
+class HttpUpload {
+public:
+    static std::string upload_dir; // 保存目录，以 '/' 结尾
+    static const int MAX_FILES = 16; // 一个请求中最多保存的文件数
+    static size_t max_total_bytes; // upload_dir 中文件的总字节数上限，0 不限制
+    static size_t max_total_files; // upload_dir 中的文件数上限，0 不限制
+
+    HttpUpload();
+    ~HttpUpload();
+
+    // length 为请求体长度；multipart 缺少 boundary 时返回 false
+    bool Start(const std::string& content_type, size_t length);
+    void Feed(Buffer& buff); // 读缓冲中已经读到的请求体
+    void Feed(const char* data, size_t len); // 已经从连接中取出的请求体，如 HTTP/2 的 DATA 帧
+    ssize_t ReadFrom(int fd, int* save_errno, bool loop); // 剩余的请求体直接从 socket 读取
+    // 请求体收完后保存文件，返回响应码：200、400（格式错误）、503（写文件失败）或 507（超出配额）
+    int Finish();
+    void Abort(); // 连接关闭时丢弃未完成的上传
+
+    bool IsActive() const { return active_; }
+    bool IsFinished() const { return active_ && left_ == 0; }
+    const std::vector<std::string>& Saved() const { return saved_; } // 最近一次保存的文件名
+
+    static bool MakeDir(const std::string& dir);
+    // 设置保存目录，不存在时创建，并以其中已有的文件作为配额的初始用量
+    static bool SetDir(const std::string& dir);
+    static size_t UsedBytes() { return used_bytes_; } // 已保存的文件和进行中的上传预留的字节数
+    static size_t UsedFiles() { return used_files_; }
+
+private:
+    static const size_t CHUNK_SIZE = 65536; // 每次从 socket 读取或 splice 的最大长度
+
+    struct TempFile {
+        std::string path;     // 临时文件
+        std::string filename; // 客户端给出的文件名，只用来取扩展名
+    };
+
+    void Consume(const char* data, size_t len);
+    ssize_t SpliceFrom(int fd, int* save_errno, bool loop);
+    bool OpenTemp(const std::string& filename);
+    bool WriteAll(const char* data, size_t len);
+    void CloseFile();
+    void ClosePipe();
+    void Reset();
+
+    bool OnPartBegin(const std::string& name, const std::string& filename);
+    bool OnPartData(const char* data, size_t len);
+    bool OnPartEnd();
+
+    static std::string SavedName(const std::string& filename);
+    static std::string RawFileName(const std::string& content_type);
+
+    static std::atomic<unsigned> counter_; // 生成不重复的文件名
+    static std::atomic<size_t> used_bytes_;
+    static std::atomic<size_t> used_files_;
+
+    bool active_;
+    bool multipart_;
+    int error_;    // 出错后剩余的请求体照常读完再丢弃，以便回复错误页面
+    size_t left_;  // 还未读到的请求体长度
+    size_t reserved_; // 本次上传在 used_bytes_ 中预留的字节数
+    int file_fd_;
+    int pipe_fd_[2];
+    MultipartParser parser_;
+    std::vector<TempFile> files_;
+    std::vector<std::string> saved_;
+    std::unique_ptr<char[]> chunk_;
+};
+
+#endif // HTTP_UPLOAD_H
@@ -0,0 +1,207 @@
+#include "multipart_parser.h"
+
+#include <cstring>
+#include <algorithm>
+
+namespace {
+
+std::string ToLower(std::string str) {
+    std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+    return str;
+}
+
+std::string Trim(const std::string& str) {
+    size_t begin = str.find_first_not_of(" \t");
+    if (begin == std::string::npos)
+        return "";
+    size_t end = str.find_last_not_of(" \t");
+    return str.substr(begin, end - begin + 1);
+}
+
+// 从 pos 开始读一个参数值，可以带引号；返回值之后的位置
+size_t ReadValue(const std::string& str, size_t pos, std::string* value) {
+    value->clear();
+    if (pos < str.size() && str[pos] == '"') {
+        for (++pos; pos < str.size() && str[pos] != '"'; ++pos) {
+            if (str[pos] == '\\' && pos + 1 < str.size())
+                ++pos;
+            *value += str[pos];
+        }
+        return pos + 1; // 跳过右引号
+    }
+    size_t end = std::min(str.find(';', pos), str.size());
+    *value = Trim(str.substr(pos, end - pos));
+    return end;
+}
+
+} // namespace
+
+void MultipartParser::Init(const std::string& boundary, PartBegin on_begin, PartData on_data, PartEnd on_end) {
+    state_ = boundary.empty() ? ERROR : PREAMBLE;
+    delim_ = "\r\n--" + boundary;
+    tail_ = "\r\n"; // 第一个分隔符前面没有回车换行，当作已经读到
+    line_.clear();
+    header_size_ = 0;
+    name_.clear();
+    filename_.clear();
+    on_begin_ = std::move(on_begin);
+    on_data_ = std::move(on_data);
+    on_end_ = std::move(on_end);
+}
+
+bool MultipartParser::Feed(const char* data, size_t len) {
+    size_t pos = 0;
+    while (pos < len && state_ != DONE && state_ != ERROR) {
+        switch (state_) {
+        case PREAMBLE:
+            pos += ScanDelimiter(data + pos, len - pos, false);
+            break;
+        case DATA:
+            pos += ScanDelimiter(data + pos, len - pos, true);
+            break;
+        case AFTER_BOUNDARY:
+            line_ += data[pos++];
+            if (line_.size() < 2)
+                break;
+            if (line_ == "\r\n") {
+                state_ = HEADERS;
+                header_size_ = 0;
+                name_.clear();
+                filename_.clear();
+            } else if (line_ == "--") {
+                state_ = DONE;
+            } else {
+                Fail();
+            }
+            line_.clear();
+            break;
+        case HEADERS:
+            pos += ParseHeaders(data + pos, len - pos);
+            break;
+        default:
+            break;
+        }
+    }
+    return state_ != ERROR;
+}
+
+// 在数据中查找分隔符，emit 为 true 时把分隔符之前的内容作为分段数据交出；返回消耗的字节数
+size_t MultipartParser::ScanDelimiter(const char* data, size_t len, bool emit) {
+    size_t consumed = 0;
+    if (!tail_.empty()) {
+        size_t need = delim_.size() - tail_.size();
+        size_t take = std::min(need, len);
+        if (memcmp(data, delim_.data() + tail_.size(), take) == 0) {
+            if (take < need) {
+                tail_.append(data, take);
+                return take;
+            }
+            tail_.clear();
+            state_ = AFTER_BOUNDARY;
+            if (emit && !on_end_())
+                Fail();
+            return take;
+        }
+        // 分隔符只以 '\r' 开头，而 tail_ 中只有第一个字节是 '\r'，所以 tail_ 整个都是数据
+        if (emit && !on_data_(tail_.data(), tail_.size())) {
+            Fail();
+            return len;
+        }
+        tail_.clear();
+    }
+    const char* found = static_cast<const char*>(memmem(data, len, delim_.data(), delim_.size()));
+    if (found) {
+        consumed = found - data;
+        if (emit && consumed > 0 && !on_data_(data, consumed)) {
+            Fail();
+            return len;
+        }
+        state_ = AFTER_BOUNDARY;
+        if (emit && !on_end_())
+            Fail();
+        return consumed + delim_.size();
+    }
+    // 末尾可能是被截断的分隔符，先留下来，等下次的数据再判断
+    size_t keep = 0;
+    for (size_t i = len > delim_.size() ? len - delim_.size() + 1 : 0; i < len; ++i) {
+        if (data[i] == '\r' && memcmp(data + i, delim_.data(), len - i) == 0) {
+            keep = len - i;
+            break;
+        }
+    }
+    if (emit && len > keep && !on_data_(data, len - keep)) {
+        Fail();
+        return len;
+    }
+    tail_.assign(data + len - keep, keep);
+    return len;
+}
+
+size_t MultipartParser::ParseHeaders(const char* data, size_t len) {
+    const char* end = static_cast<const char*>(memchr(data, '\n', len));
+    size_t n = end ? end - data + 1 : len;
+    line_.append(data, n);
+    header_size_ += n;
+    if (header_size_ > MAX_HEADER_SIZE) {
+        Fail();
+        return len;
+    }
+    if (!end)
+        return n;
+    line_.pop_back(); // '\n'
+    if (!line_.empty() && line_.back() == '\r')
+        line_.pop_back();
+    if (line_.empty()) { // 头部结束
+        state_ = DATA;
+        if (!on_begin_(name_, filename_))
+            Fail();
+    } else if (!ParseHeaderLine(line_)) {
+        Fail();
+    }
+    line_.clear();
+    return n;
+}
+
+// Content-Disposition: form-data; name="picture"; filename="a.jpg"
+bool MultipartParser::ParseHeaderLine(const std::string& line) {
+    size_t colon = line.find(':');
+    if (colon == std::string::npos)
+        return false;
+    if (ToLower(Trim(line.substr(0, colon))) != "content-disposition")
+        return true; // 其他头部（如 Content-Type）不需要
+    size_t pos = line.find(';', colon);
+    while (pos != std::string::npos && pos < line.size()) {
+        size_t eq = line.find('=', pos);
+        if (eq == std::string::npos)
+            break;
+        std::string key = ToLower(Trim(line.substr(pos + 1, eq - pos - 1)));
+        std::string value;
+        pos = ReadValue(line, eq + 1, &value);
+        if (key == "name")
+            name_ = value;
+        else if (key == "filename")
+            filename_ = value;
+        pos = line.find(';', pos);
+    }
+    return true;
+}
+
+bool MultipartParser::Fail() {
+    state_ = ERROR;
+    return false;
+}
+
+// multipart/form-data; boundary=----WebKitFormBoundary7MA4YWxkTrZu0gW
+std::string MultipartParser::GetBoundary(const std::string& content_type) {
+    std::string lower = ToLower(content_type);
+    if (lower.compare(0, 19, "multipart/form-data") != 0)
+        return "";
+    size_t pos = lower.find("boundary=");
+    if (pos == std::string::npos)
+        return "";
+    std::string boundary;
+    ReadValue(content_type, pos + 9, &boundary);
+    if (boundary.size() > 70) // RFC 2046 限制 1~70 个字符
+        return "";
+    return boundary;
+}
@@ -0,0 +1,59 @@
+#ifndef MULTIPART_PARSER_H
+#define MULTIPART_PARSER_H
+
+#include <string>
+#include <functional>
+
+// multipart/form-data 的增量解析器，不做任何 I/O
+// 数据可以按任意长度分多次传入；分段的数据通过回调交出，除了可能是分隔符开头的
+// 少量字节外不做缓存，内存占用与上传文件的大小无关
+class MultipartParser {
+public:
+    enum STATE {
+        PREAMBLE,       // 第一个分隔符之前的内容，丢弃
+        AFTER_BOUNDARY, // 分隔符之后，"\r\n" 开始一个分段，"--" 表示结束
+        HEADERS,        // 分段头部
+        DATA,           // 分段数据
+        DONE,           // 遇到结束分隔符，之后的内容丢弃
+        ERROR
+    };
+
+    // name/filename 来自 Content-Disposition，普通表单字段的 filename 为空
+    // 回调返回 false 时中止解析
+    using PartBegin = std::function<bool(const std::string& name, const std::string& filename)>;
+    using PartData = std::function<bool(const char* data, size_t len)>;
+    using PartEnd = std::function<bool()>;
+
+    MultipartParser() : state_(ERROR), header_size_(0) {}
+
+    void Init(const std::string& boundary, PartBegin on_begin, PartData on_data, PartEnd on_end);
+    bool Feed(const char* data, size_t len); // 格式错误或回调中止时返回 false
+
+    bool IsDone() const { return state_ == DONE; }
+    STATE State() const { return state_; }
+
+    // 从 Content-Type 中取出 boundary，不是 multipart/form-data 时返回空串
+    static std::string GetBoundary(const std::string& content_type);
+
+private:
+    static const size_t MAX_HEADER_SIZE = 8192; // 单个分段头部的最大长度
+
+    size_t ScanDelimiter(const char* data, size_t len, bool emit);
+    size_t ParseHeaders(const char* data, size_t len);
+    bool ParseHeaderLine(const std::string& line);
+    bool Fail();
+
+    STATE state_;
+    std::string delim_;  // "\r\n--" + boundary
+    std::string tail_;   // 上次数据末尾可能是分隔符开头的部分
+    std::string line_;   // 未读完的头部行，或分隔符之后的两个字节
+    size_t header_size_;
+    std::string name_;
+    std::string filename_;
+
+    PartBegin on_begin_;
+    PartData on_data_;
+    PartEnd on_end_;
+};
+
+#endif // MULTIPART_PARSER_H
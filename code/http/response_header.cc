@@ -0,0 +1,108 @@
+#include "response_header.h"
+
+#include <cstring>
+
+using namespace http_tables;
+
+namespace {
+
+// 无符号整数转十进制，返回写入的字节数
+size_t FormatNumber(char* out, size_t value) {
+    char digits[20];
+    size_t n = 0;
+    do {
+        digits[n++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    for (size_t i = 0; i < n; ++i)
+        out[i] = digits[n - 1 - i];
+    return n;
+}
+
+size_t Copy(char* out, const char* str, size_t len) {
+    memcpy(out, str, len);
+    return len;
+}
+
+} // namespace
+
+ResponseHeader* ResponseHeader::instance() {
+    static ResponseHeader header;
+    return &header;
+}
+
+ResponseHeader::ResponseHeader() {
+    templates_.reserve(STATUS_COUNT * MIME_COUNT * 2);
+    for (const http_tables::Status& status : STATUSES) {
+        for (const http_tables::Mime& mime : MIMES) {
+            for (int keep_alive = 0; keep_alive < 2; ++keep_alive) {
+                std::string head = "HTTP/1.1 " + std::to_string(status.code) + " ";
+                head.append(status.reason);
+                head += "\r\nConnection: ";
+                head += keep_alive ? "keep-alive" : "close";
+                head += "\r\nContent-type: ";
+                head.append(mime.type);
+                head += "\r\n";
+                templates_.push_back(std::move(head));
+            }
+        }
+    }
+}
+
+void ResponseHeader::Append(Buffer& buff, int code, int mime, bool keep_alive,
+                            int timeout_s, int max_requests, size_t content_len) const {
+    static const char KEEP_ALIVE[] = "Keep-Alive: ";
+    static const char TIMEOUT[] = "timeout=";
+    static const char MAX[] = "max=";
+    static const char CONTENT_LENGTH[] = "Content-length: ";
+    // 参数的最大长度：两个 int 和一个 size_t 的十进制位数
+    static const size_t MAX_DYNAMIC = sizeof(KEEP_ALIVE) + sizeof(TIMEOUT) + sizeof(MAX) + 2 + 10 + 10
+                                      + sizeof(CONTENT_LENGTH) + 20 + 6;
+
+    int code_idx = FindStatus(code);
+    if (code_idx < 0)
+        code_idx = FindStatus(400);
+    if (mime < 0 || mime >= MIME_COUNT)
+        mime = 0;
+    const std::string& head = templates_[(code_idx * MIME_COUNT + mime) * 2 + (keep_alive ? 1 : 0)];
+    const std::string& date = Date();
+
+    buff.EnsureWriteable(head.size() + date.size() + MAX_DYNAMIC);
+    char* begin = buff.WriteBegin();
+    char* p = begin;
+    p += Copy(p, head.data(), head.size());
+    p += Copy(p, date.data(), date.size());
+    if (keep_alive && (timeout_s > 0 || max_requests > 0)) {
+        p += Copy(p, KEEP_ALIVE, sizeof(KEEP_ALIVE) - 1);
+        if (timeout_s > 0) {
+            p += Copy(p, TIMEOUT, sizeof(TIMEOUT) - 1);
+            p += FormatNumber(p, timeout_s);
+        }
+        if (max_requests > 0) {
+            if (timeout_s > 0)
+                p += Copy(p, ", ", 2);
+            p += Copy(p, MAX, sizeof(MAX) - 1);
+            p += FormatNumber(p, max_requests);
+        }
+        p += Copy(p, "\r\n", 2);
+    }
+    p += Copy(p, CONTENT_LENGTH, sizeof(CONTENT_LENGTH) - 1);
+    p += FormatNumber(p, content_len);
+    p += Copy(p, "\r\n\r\n", 4);
+    buff.HasWritten(p - begin);
+}
+
+const std::string& ResponseHeader::Date() {
+    thread_local time_t last = -1;
+    thread_local std::string date;
+    time_t now = time(nullptr);
+    if (now != last) {
+        char buf[64];
+        tm gmt;
+        gmtime_r(&now, &gmt);
+        size_t len = strftime(buf, sizeof(buf), "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &gmt);
+        date.assign(buf, len);
+        last = now;
+    }
+    return date;
+}
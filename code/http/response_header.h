@@ -0,0 +1,54 @@
+#ifndef RESPONSE_HEADER_H
+#define RESPONSE_HEADER_H
+
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../buffer/buffer.h"
+#include "http_tables.h"
+
+// 响应头的生成
+// 状态行和不变的头部按 (状态码, 文件类型, 是否保持连接) 的每种组合在第一次使用时拼好，
+// Date 头部每个线程缓存一份、每秒刷新一次；生成响应头时只需拷贝这两段，
+// 再填入 Keep-Alive 的参数和 Content-length，整个过程只向缓冲区追加一次
+class ResponseHeader {
+public:
+    static ResponseHeader* instance();
+
+    // 写出完整的响应头（含结尾的空行），未知的状态码按 400 处理
+    // timeout_s、max_requests 为 Keep-Alive 头部的参数，0 表示不写出该项，只在保持连接时使用
+    void Append(Buffer& buff, int code, int mime, bool keep_alive,
+                int timeout_s, int max_requests, size_t content_len) const;
+
+    // 按扩展名查找文件类型，未知的为 text/plain
+    static int MimeIndex(std::string_view path) {
+        int mime = http_tables::FindMime(path);
+        return mime < 0 ? 0 : mime;
+    }
+    static std::string_view MimeType(int mime) {
+        return http_tables::MIMES[mime >= 0 && mime < http_tables::MIME_COUNT ? mime : 0].type;
+    }
+    // 未知的状态码返回空
+    static std::string_view Status(int code) {
+        int idx = http_tables::FindStatus(code);
+        return idx < 0 ? std::string_view() : http_tables::STATUSES[idx].reason;
+    }
+    // 状态码对应的错误页面，没有时返回空
+    static std::string_view ErrorPage(int code) {
+        int idx = http_tables::FindStatus(code);
+        return idx < 0 ? std::string_view() : http_tables::STATUSES[idx].page;
+    }
+
+    // 当前线程缓存的 "Date: ...\r\n"，与上次调用不在同一秒时重新生成
+    static const std::string& Date();
+
+private:
+    ResponseHeader();
+    ~ResponseHeader() = default;
+
+    std::vector<std::string> templates_; // 下标为 (状态码下标 * MIME_COUNT + 文件类型) * 2 + 是否保持连接
+};
+
+#endif // RESPONSE_HEADER_H
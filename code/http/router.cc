@@ -0,0 +1,182 @@
+#include "router.h"
+
+std::string_view RouteParams::Get(std::string_view name) const {
+    for (int i = 0; i < count; ++i) {
+        if (names[i] == name)
+            return values[i];
+    }
+    return std::string_view();
+}
+
+Router::Node::Node() : param(-1), wildcard(-1) {
+    for (int& route : routes)
+        route = -1;
+}
+
+Router* Router::instance() {
+    static Router router;
+    return &router;
+}
+
+Router::Router() {
+    Clear();
+}
+
+void Router::Clear() {
+    nodes_.clear();
+    nodes_.emplace_back();
+    routes_.clear();
+}
+
+Router::METHOD Router::ParseMethod(std::string_view method) {
+    switch (method.size()) {
+    case 3:
+        if (method == "GET") return GET;
+        if (method == "PUT") return PUT;
+        break;
+    case 4:
+        if (method == "POST") return POST;
+        if (method == "HEAD") return HEAD;
+        break;
+    case 5:
+        if (method == "PATCH") return PATCH;
+        break;
+    case 6:
+        if (method == "DELETE") return DELETE;
+        break;
+    case 7:
+        if (method == "OPTIONS") return OPTIONS;
+        break;
+    default:
+        break;
+    }
+    return METHOD_COUNT;
+}
+
+// 把静态字符串插入 node 之下，必要时拆分已有的节点；返回字符串结束处的节点
+int Router::AddStatic(int node, std::string_view text) {
+    while (!text.empty()) {
+        size_t i = nodes_[node].indices.find(text[0]);
+        if (i == std::string::npos) {
+            Node child;
+            child.prefix.assign(text.data(), text.size());
+            nodes_.push_back(std::move(child));
+            nodes_[node].indices += text[0];
+            nodes_[node].children.push_back(nodes_.size() - 1);
+            return nodes_.size() - 1;
+        }
+        int child = nodes_[node].children[i];
+        const std::string& prefix = nodes_[child].prefix;
+        size_t len = 0;
+        while (len < prefix.size() && len < text.size() && prefix[len] == text[len])
+            ++len;
+        if (len < prefix.size()) { // 公共前缀比子节点短，拆出中间节点
+            Node mid;
+            mid.prefix = prefix.substr(0, len);
+            mid.indices = prefix[len];
+            mid.children.push_back(child);
+            nodes_[child].prefix.erase(0, len);
+            nodes_.push_back(std::move(mid));
+            child = nodes_.size() - 1;
+            nodes_[node].children[i] = child;
+        }
+        node = child;
+        text.remove_prefix(len);
+    }
+    return node;
+}
+
+bool Router::Add(std::string_view method, std::string_view pattern, Handler handler, int flags) {
+    METHOD m = method == "*" ? ANY : ParseMethod(method);
+    if (m == METHOD_COUNT || pattern.empty() || pattern[0] != '/' || !handler)
+        return false;
+    int node = 0;
+    size_t pos = 0;
+    while (pos < pattern.size()) {
+        size_t special = pattern.find_first_of(":*", pos);
+        node = AddStatic(node, pattern.substr(pos, special == std::string_view::npos ? special : special - pos));
+        if (special == std::string_view::npos)
+            break;
+        // 参数和通配只能占据完整的一段
+        size_t end = pattern.find('/', special);
+        std::string_view name = pattern.substr(special + 1, end == std::string_view::npos ? end : end - special - 1);
+        bool wildcard = pattern[special] == '*';
+        if (pattern[special - 1] != '/' || name.empty() || (wildcard && end != std::string_view::npos))
+            return false;
+        int child = wildcard ? nodes_[node].wildcard : nodes_[node].param;
+        if (child < 0) {
+            nodes_.emplace_back();
+            child = nodes_.size() - 1;
+            nodes_[child].name.assign(name.data(), name.size());
+            (wildcard ? nodes_[node].wildcard : nodes_[node].param) = child;
+        } else if (nodes_[child].name != name) { // 同一位置的参数名不一致，匹配结果会有歧义
+            return false;
+        }
+        node = child;
+        pos = end;
+    }
+    if (nodes_[node].routes[m] >= 0)
+        return false;
+    routes_.push_back({std::string(pattern), std::move(handler), flags});
+    nodes_[node].routes[m] = routes_.size() - 1;
+    return true;
+}
+
+const Router::Route* Router::Match(std::string_view method, std::string_view path, RouteParams* params) const {
+    params->Clear();
+    const Route* route = nullptr;
+    MatchNode(0, path, ParseMethod(method), params, &route);
+    return route;
+}
+
+// path 为到达 node 之后还没有匹配的部分
+bool Router::MatchNode(int idx, std::string_view path, int method, RouteParams* params, const Route** route) const {
+    const Node& node = nodes_[idx];
+    if (path.empty() && Accept(node, method, route))
+        return true;
+    if (!path.empty()) {
+        size_t i = node.indices.find(path[0]);
+        if (i != std::string::npos) {
+            const Node& child = nodes_[node.children[i]];
+            if (path.compare(0, child.prefix.size(), child.prefix) == 0 &&
+                MatchNode(node.children[i], path.substr(child.prefix.size()), method, params, route))
+                return true;
+        }
+        size_t end = path.find('/');
+        if (node.param >= 0 && end != 0) {
+            int saved = params->count;
+            std::string_view rest = end == std::string_view::npos ? std::string_view() : path.substr(end);
+            if (PushParam(params, nodes_[node.param].name, path.substr(0, end)) &&
+                MatchNode(node.param, rest, method, params, route))
+                return true;
+            params->count = saved;
+        }
+    }
+    if (node.wildcard >= 0) {
+        int saved = params->count;
+        if (PushParam(params, nodes_[node.wildcard].name, path) && Accept(nodes_[node.wildcard], method, route))
+            return true;
+        params->count = saved;
+    }
+    return false;
+}
+
+// 先找请求的方法，再找 "*"
+bool Router::Accept(const Node& node, int method, const Route** route) const {
+    int idx = method < ANY ? node.routes[method] : -1;
+    if (idx < 0)
+        idx = node.routes[ANY];
+    if (idx < 0)
+        return false;
+    *route = &routes_[idx];
+    return true;
+}
+
+bool Router::PushParam(RouteParams* params, const std::string& name, std::string_view value) {
+    if (params->count >= RouteParams::MAX_PARAMS)
+        return false;
+    params->names[params->count] = name;
+    params->values[params->count] = value;
+    ++params->count;
+    return true;
+}
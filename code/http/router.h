@@ -0,0 +1,92 @@
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+
+class HttpRequest;
+class HttpResponse;
+
+// 路径参数，指向请求路径中的片段，只在请求处理完之前有效
+struct RouteParams {
+    static const int MAX_PARAMS = 8;
+
+    int count = 0;
+    std::string_view names[MAX_PARAMS];
+    std::string_view values[MAX_PARAMS];
+
+    void Clear() { count = 0; }
+    std::string_view Get(std::string_view name) const; // 不存在时返回空
+};
+
+// 按方法和路径把请求分派给处理函数的路由表
+// 路径按压缩前缀树（radix trie）组织，模式中可以有参数段 "/user/:id" 和末尾的通配段 "/static/*path"；
+// 匹配时静态段优先，其次参数段，最后通配段，只在前者匹配不到时回退，参数写入定长数组，不分配内存
+// 路由在服务启动前注册，之后只读，多个工作线程可以同时匹配
+class Router {
+public:
+    enum METHOD {
+        GET,
+        HEAD,
+        POST,
+        PUT,
+        DELETE,
+        PATCH,
+        OPTIONS,
+        ANY,     // 注册时用 "*"，匹配任何方法，优先级低于具体的方法
+        METHOD_COUNT
+    };
+    enum FLAG {
+        STREAM_BODY = 1, // 请求体不读入内存，由 HttpUpload 写入文件，收完后再调用处理函数
+        FORWARD = 2      // 请求体（Content-Length）留在 socket 中，请求头解析完就调用处理函数，由它转发给上游
+    };
+
+    // 在工作线程上调用；response 已按请求路径（静态文件）和状态码初始化，
+    // 处理函数可以换成别的文件、直接给出响应内容，或者让 request 进入等待验证状态
+    using Handler = std::function<void(HttpRequest& request, HttpResponse& response)>;
+
+    struct Route {
+        std::string pattern; // 注册时的模式，用于日志
+        Handler handler;
+        int flags;
+    };
+
+    static Router* instance();
+
+    Router();
+    ~Router() = default;
+
+    // method 为 "GET"、"POST" 等或 "*"；模式必须以 '/' 开头，参数名在同一位置必须一致，
+    // 通配段只能在末尾；重复注册或模式非法时返回 false
+    bool Add(std::string_view method, std::string_view pattern, Handler handler, int flags = 0);
+    // 没有匹配的路由时返回 nullptr
+    const Route* Match(std::string_view method, std::string_view path, RouteParams* params) const;
+    void Clear();
+
+    static METHOD ParseMethod(std::string_view method); // 未知的方法返回 METHOD_COUNT
+
+private:
+    struct Node {
+        std::string prefix;    // 从父节点到这里的静态字符串，参数和通配节点为空
+        std::string indices;   // 各静态子节点前缀的首字节，与 children 一一对应
+        std::vector<int> children;
+        int param;             // ":name" 子节点
+        int wildcard;          // "*name" 子节点
+        std::string name;      // 参数或通配节点的名称
+        int routes[METHOD_COUNT]; // routes_ 中的下标，-1 为没有
+
+        Node();
+    };
+
+    int AddStatic(int node, std::string_view text);
+    bool MatchNode(int node, std::string_view path, int method, RouteParams* params, const Route** route) const;
+    bool Accept(const Node& node, int method, const Route** route) const;
+    static bool PushParam(RouteParams* params, const std::string& name, std::string_view value);
+
+    std::vector<Node> nodes_; // nodes_[0] 为根，对应空前缀
+    std::vector<Route> routes_;
+};
+
+#endif // ROUTER_H
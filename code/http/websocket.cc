@@ -0,0 +1,492 @@
+#include "websocket.h"
+
+#include <cstring>
+#include <openssl/evp.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+int WebSocket::ping_interval_ms = 30000;
+size_t WebSocket::max_message_size = 1 << 20;
+const size_t WebSocket::MAX_PENDING_BYTES;
+const size_t WebSocket::MAX_CONTROL_PAYLOAD;
+
+namespace {
+
+const char* const GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+bool IsBase64(char c) {
+    return isalnum(static_cast<unsigned char>(c)) || c == '+' || c == '/';
+}
+
+// 1004-1006、1015 是保留的，不能出现在关闭帧中
+bool IsValidCloseCode(uint16_t code) {
+    return (code >= 1000 && code <= 1003) || (code >= 1007 && code <= 1014) || (code >= 3000 && code <= 4999);
+}
+
+} // namespace
+
+bool WebSocket::IsValidKey(std::string_view key) {
+    if (key.size() != 24 || key[22] != '=' || key[23] != '=')
+        return false;
+    for (size_t i = 0; i < 22; ++i) {
+        if (!IsBase64(key[i]))
+            return false;
+    }
+    return true;
+}
+
+std::string WebSocket::AcceptKey(std::string_view key) {
+    std::string input(key);
+    input += GUID;
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_len = 0;
+    EVP_Digest(input.data(), input.size(), digest, &digest_len, EVP_sha1(), nullptr);
+    char accept[32]; // 20 字节的 SHA-1 编码为 28 个字符
+    int len = EVP_EncodeBlock(reinterpret_cast<unsigned char*>(accept), digest, digest_len);
+    return std::string(accept, len);
+}
+
+WebSocket::Frame WebSocket::MakeFrame(OPCODE opcode, std::string_view payload) {
+    auto frame = std::make_shared<std::string>();
+    size_t len = payload.size();
+    frame->reserve(len + 10);
+    frame->push_back(static_cast<char>(0x80 | opcode)); // FIN，服务端不分片
+    if (len < 126) {
+        frame->push_back(static_cast<char>(len));
+    } else if (len <= 0xffff) {
+        frame->push_back(126);
+        frame->push_back(static_cast<char>(len >> 8));
+        frame->push_back(static_cast<char>(len));
+    } else {
+        frame->push_back(127);
+        for (int shift = 56; shift >= 0; shift -= 8)
+            frame->push_back(static_cast<char>(static_cast<uint64_t>(len) >> shift));
+    }
+    frame->append(payload.data(), len);
+    return frame;
+}
+
+WebSocket::Frame WebSocket::MakeClose(uint16_t code, std::string_view reason) {
+    if (code == NO_STATUS || code == ABNORMAL)
+        return MakeFrame(CLOSE, "");
+    char payload[MAX_CONTROL_PAYLOAD];
+    payload[0] = static_cast<char>(code >> 8);
+    payload[1] = static_cast<char>(code);
+    size_t len = std::min(reason.size(), MAX_CONTROL_PAYLOAD - 2);
+    memcpy(payload + 2, reason.data(), len);
+    return MakeFrame(CLOSE, std::string_view(payload, len + 2));
+}
+
+// 载荷从掩码的第 0 字节开始对齐，向量部分按 4 的倍数前进，剩下的字节按位置取掩码
+void WebSocket::Unmask(char* data, size_t len, const uint8_t mask[4]) {
+    uint8_t* p = reinterpret_cast<uint8_t*>(data);
+    uint32_t key;
+    memcpy(&key, mask, 4);
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i key256 = _mm256_set1_epi32(static_cast<int>(key));
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p + i), _mm256_xor_si256(v, key256));
+    }
+    const __m128i key128 = _mm256_castsi256_si128(key256);
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i), _mm_xor_si128(v, key128));
+    }
+#elif defined(__SSE2__)
+    const __m128i key128 = _mm_set1_epi32(static_cast<int>(key));
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i), _mm_xor_si128(v, key128));
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t key128 = vreinterpretq_u8_u32(vdupq_n_u32(key));
+    for (; i + 16 <= len; i += 16)
+        vst1q_u8(p + i, veorq_u8(vld1q_u8(p + i), key128));
+#endif
+    const uint64_t key64 = static_cast<uint64_t>(key) << 32 | key;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t v;
+        memcpy(&v, p + i, 8);
+        v ^= key64;
+        memcpy(p + i, &v, 8);
+    }
+    for (; i < len; ++i)
+        p[i] ^= mask[i & 3];
+}
+
+// 拒绝过长编码、代理项和超过 U+10FFFF 的码点；ASCII 一次检查 8 字节
+bool WebSocket::IsValidUtf8(const char* data, size_t len) {
+    const uint8_t* s = reinterpret_cast<const uint8_t*>(data);
+    size_t i = 0;
+    while (i < len) {
+        if (i + 8 <= len) {
+            uint64_t word;
+            memcpy(&word, s + i, 8);
+            if ((word & 0x8080808080808080ULL) == 0) {
+                i += 8;
+                continue;
+            }
+        }
+        uint8_t c = s[i];
+        if (c < 0x80) {
+            ++i;
+            continue;
+        }
+        size_t n;
+        uint32_t cp;
+        if (c >= 0xc2 && c <= 0xdf) {
+            n = 1;
+            cp = c & 0x1f;
+        } else if ((c & 0xf0) == 0xe0) {
+            n = 2;
+            cp = c & 0x0f;
+        } else if (c >= 0xf0 && c <= 0xf4) {
+            n = 3;
+            cp = c & 0x07;
+        } else {
+            return false;
+        }
+        if (len - i <= n)
+            return false;
+        for (size_t k = 1; k <= n; ++k) {
+            uint8_t b = s[i + k];
+            if ((b & 0xc0) != 0x80)
+                return false;
+            cp = cp << 6 | (b & 0x3f);
+        }
+        if (n == 2 && (cp < 0x800 || (cp >= 0xd800 && cp <= 0xdfff)))
+            return false;
+        if (n == 3 && (cp < 0x10000 || cp > 0x10ffff))
+            return false;
+        i += n + 1;
+    }
+    return true;
+}
+
+WebSocket::WebSocket(std::shared_ptr<const WebSocketHandler> handler, std::function<void()> wake)
+    : handler_(std::move(handler)), wake_(std::move(wake)), pending_bytes_(0), parked_(false), parked_write_(false),
+      close_sent_(false), close_received_(false), failed_(false), shut_(false), awaiting_pong_(false),
+      message_opcode_(0), close_code_(ABNORMAL) {
+}
+
+bool WebSocket::Send(std::string_view message, bool binary) {
+    return Post(MakeFrame(binary ? BINARY : TEXT, message));
+}
+
+bool WebSocket::Post(const Frame& frame) {
+    bool wake = false;
+    bool ok = true;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if (shut_ || close_sent_)
+            return false;
+        if (pending_bytes_ + frame->size() > MAX_PENDING_BYTES) {
+            // 对端长时间不读，丢弃积压的消息并关闭，不能让一个连接占住越来越多的内存
+            LOG_WARN("WebSocket: %zu bytes pending, close slow consumer", pending_bytes_);
+            outbox_.clear();
+            pending_bytes_ = 0;
+            failed_ = true;
+            close_sent_ = true;
+            wake = Push(MakeClose(POLICY_VIOLATION, "slow consumer"));
+            ok = false;
+        } else {
+            wake = Push(frame);
+        }
+    }
+    if (wake)
+        wake_();
+    return ok;
+}
+
+void WebSocket::Close(uint16_t code, std::string_view reason) {
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if (shut_ || close_sent_)
+            return;
+        close_sent_ = true;
+        wake = Push(MakeClose(code, reason));
+    }
+    if (wake)
+        wake_();
+}
+
+bool WebSocket::IsOpen() const {
+    std::lock_guard<std::mutex> locker(mtx_);
+    return !shut_ && !close_sent_;
+}
+
+bool WebSocket::Push(const Frame& frame) {
+    if (shut_)
+        return false;
+    pending_bytes_ += frame->size();
+    outbox_.push_back(frame);
+    if (!parked_)
+        return false;
+    parked_ = false;
+    return true;
+}
+
+void WebSocket::Open() {
+    if (handler_->on_open)
+        handler_->on_open(shared_from_this());
+}
+
+void WebSocket::Process(Buffer& in) {
+    while (!IsDone()) {
+        size_t avail = in.ReadableBytes();
+        if (avail < 2)
+            return;
+        uint8_t* p = reinterpret_cast<uint8_t*>(const_cast<char*>(in.ReadBegin()));
+        bool fin = p[0] & 0x80;
+        uint8_t opcode = p[0] & 0x0f;
+        bool control = opcode & 0x08;
+        if (p[0] & 0x70) { // 没有协商扩展，RSV 位必须为 0
+            Fail(PROTOCOL_ERROR, "reserved bits set");
+            break;
+        }
+        if (!(p[1] & 0x80)) {
+            Fail(PROTOCOL_ERROR, "unmasked client frame");
+            break;
+        }
+        uint64_t len = p[1] & 0x7f;
+        size_t head = 2;
+        if (len == 126) {
+            if (avail < 4)
+                return;
+            len = static_cast<uint64_t>(p[2]) << 8 | p[3];
+            head = 4;
+        } else if (len == 127) {
+            if (avail < 10)
+                return;
+            len = 0;
+            for (int i = 0; i < 8; ++i)
+                len = len << 8 | p[2 + i];
+            head = 10;
+        }
+        if (control && (!fin || len > MAX_CONTROL_PAYLOAD)) {
+            Fail(PROTOCOL_ERROR, "invalid control frame");
+            break;
+        }
+        // 在收齐载荷之前就按长度拒绝，不为过大的消息分配读缓冲
+        if (!control && (len > max_message_size || message_.size() + len > max_message_size)) {
+            Fail(MESSAGE_TOO_BIG, "message too big");
+            break;
+        }
+        head += 4;
+        if (avail < head + len)
+            return;
+        char* payload = reinterpret_cast<char*>(p + head);
+        Unmask(payload, len, p + head - 4);
+        awaiting_pong_ = false; // 收到任何帧都说明连接仍然存活
+        bool go_on = OnFrame(opcode, fin, payload, len);
+        in.Retrieve(head + len);
+        if (!go_on)
+            break;
+    }
+    in.RetrieveAll(); // 关闭之后到达的数据丢弃
+}
+
+bool WebSocket::OnFrame(uint8_t opcode, bool fin, char* payload, size_t len) {
+    switch (opcode) {
+    case CONTINUATION:
+        if (!message_opcode_) {
+            Fail(PROTOCOL_ERROR, "unexpected continuation frame");
+            return false;
+        }
+        message_.append(payload, len);
+        break;
+    case TEXT:
+    case BINARY:
+        if (message_opcode_) {
+            Fail(PROTOCOL_ERROR, "expected continuation frame");
+            return false;
+        }
+        message_opcode_ = opcode;
+        message_.assign(payload, len);
+        break;
+    case PING: { // 控制帧可以插在分片之间，直接应答
+        std::lock_guard<std::mutex> locker(mtx_);
+        if (!close_sent_)
+            Push(MakeFrame(PONG, std::string_view(payload, len)));
+        return true;
+    }
+    case PONG:
+        return true;
+    case CLOSE:
+        OnClose(payload, len);
+        return false;
+    default:
+        Fail(PROTOCOL_ERROR, "unknown opcode");
+        return false;
+    }
+    if (!fin)
+        return true;
+    bool binary = message_opcode_ == BINARY;
+    message_opcode_ = 0;
+    if (!binary && !IsValidUtf8(message_.data(), message_.size())) {
+        Fail(INVALID_DATA, "invalid utf-8");
+        return false;
+    }
+    if (handler_->on_message)
+        handler_->on_message(shared_from_this(), message_, binary);
+    // 较大的消息用完后释放，连接空闲时不占用内存
+    if (message_.capacity() > 65536) {
+        std::string().swap(message_);
+    } else {
+        message_.clear();
+    }
+    return true;
+}
+
+// 回应对端的关闭帧，带关闭码时原样返回
+void WebSocket::OnClose(const char* payload, size_t len) {
+    uint16_t code = NO_STATUS;
+    if (len == 1) {
+        Fail(PROTOCOL_ERROR, "invalid close frame");
+        return;
+    }
+    if (len >= 2) {
+        code = static_cast<uint16_t>(static_cast<uint8_t>(payload[0]) << 8 | static_cast<uint8_t>(payload[1]));
+        if (!IsValidCloseCode(code) || !IsValidUtf8(payload + 2, len - 2)) {
+            Fail(PROTOCOL_ERROR, "invalid close frame");
+            return;
+        }
+    }
+    close_code_ = code;
+    std::lock_guard<std::mutex> locker(mtx_);
+    close_received_ = true;
+    if (!close_sent_) {
+        close_sent_ = true;
+        Push(MakeClose(code, ""));
+    }
+}
+
+void WebSocket::Fail(uint16_t code, const char* reason) {
+    LOG_DEBUG("WebSocket: close %d, %s", code, reason);
+    std::lock_guard<std::mutex> locker(mtx_);
+    failed_ = true;
+    if (!close_sent_) {
+        close_sent_ = true;
+        Push(MakeClose(code, reason));
+    }
+}
+
+bool WebSocket::TakeFrames(std::vector<Frame>* frames, size_t max_frames) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    while (!outbox_.empty() && frames->size() < max_frames) {
+        pending_bytes_ -= outbox_.front()->size();
+        frames->push_back(std::move(outbox_.front()));
+        outbox_.pop_front();
+    }
+    return !outbox_.empty();
+}
+
+bool WebSocket::IsDone() const {
+    std::lock_guard<std::mutex> locker(mtx_);
+    return shut_ || failed_ || (close_sent_ && close_received_);
+}
+
+bool WebSocket::Park(bool idle, const std::function<void()>& arm) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    if (idle && !outbox_.empty())
+        return false;
+    parked_ = true;
+    parked_write_ = !idle;
+    arm();
+    return true;
+}
+
+bool WebSocket::Unpark(bool hangup, bool writable) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    if (!parked_ || (!hangup && writable != parked_write_))
+        return false;
+    parked_ = false;
+    return true;
+}
+
+// 返回 false 时连接已取消停放，此后的 Post 不会再唤醒，由调用方关闭
+bool WebSocket::Ping() {
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if (shut_)
+            return true;
+        if (awaiting_pong_ || close_sent_) { // ping 没有回应，或关闭握手超时
+            if (!parked_)
+                return true;
+            parked_ = false;
+            return false;
+        }
+        awaiting_pong_ = true;
+        wake = Push(MakeFrame(PING, ""));
+    }
+    if (wake)
+        wake_();
+    return true;
+}
+
+void WebSocket::Shutdown() {
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if (shut_)
+            return;
+        shut_ = true;
+        parked_ = false;
+        outbox_.clear();
+        pending_bytes_ = 0;
+    }
+    if (handler_->on_close)
+        handler_->on_close(shared_from_this(), close_code_);
+}
+
+void WebSocketChannel::Join(const std::shared_ptr<WebSocket>& ws) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    members_.push_back(ws);
+}
+
+void WebSocketChannel::Leave(const std::shared_ptr<WebSocket>& ws) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    for (size_t i = 0; i < members_.size(); ++i) {
+        if (members_[i] == ws) {
+            members_[i] = std::move(members_.back());
+            members_.pop_back();
+            return;
+        }
+    }
+}
+
+size_t WebSocketChannel::Broadcast(std::string_view message, bool binary) {
+    return Broadcast(WebSocket::MakeFrame(binary ? WebSocket::BINARY : WebSocket::TEXT, message));
+}
+
+// Post 可能在锁内唤醒连接（交给线程池），不会回调到频道，不会死锁
+size_t WebSocketChannel::Broadcast(const WebSocket::Frame& frame) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    size_t sent = 0;
+    for (size_t i = 0; i < members_.size();) {
+        if (members_[i]->Post(frame)) {
+            ++sent;
+            ++i;
+        } else if (!members_[i]->IsOpen()) {
+            members_[i] = std::move(members_.back());
+            members_.pop_back();
+        } else {
+            ++i;
+        }
+    }
+    return sent;
+}
+
+size_t WebSocketChannel::Size() const {
+    std::lock_guard<std::mutex> locker(mtx_);
+    return members_.size();
+}
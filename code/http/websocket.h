@@ -0,0 +1,145 @@
+#ifndef WEBSOCKET_H
+#define WEBSOCKET_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <functional>
+
+#include "../buffer/buffer.h"
+#include "../log/log.h"
+
+class WebSocket;
+
+// 应用的回调，都在连接所在的工作线程上调用（on_close 也可能在主线程上）
+// 回调中可以直接 Send/Close，也可以保存 shared_ptr 之后在任意线程上使用
+struct WebSocketHandler {
+    std::function<void(const std::shared_ptr<WebSocket>& ws)> on_open;
+    // 完整的消息（分片已拼好，文本已校验为 UTF-8），message 可以被移走
+    std::function<void(const std::shared_ptr<WebSocket>& ws, std::string& message, bool binary)> on_message;
+    // 连接关闭后调用一次，code 为对端给出的关闭码，没有收到关闭帧时为 1006
+    std::function<void(const std::shared_ptr<WebSocket>& ws, uint16_t code)> on_close;
+};
+
+// WebSocket（RFC 6455）连接
+// 工作线程在读缓冲上解析客户端的帧：原地去掩码，拼接分片，应答 ping 和关闭握手；
+// 要发送的帧由任意线程放入待发队列，每个帧编码一次后以 shared_ptr 共享，广播时所有连接引用同一份数据，
+// 由 HttpConnect 取出后和 HTTP 响应一样 writev 写出
+//
+// 连接在 epoll 中注册事件、没有工作线程处理时处于"停放"状态；其他线程发送消息时若连接已停放，
+// 就由它取消停放并通过 wake 把连接交给线程池，否则由正在处理的工作线程在重新注册事件前取走，
+// 停放状态在锁内和事件注册一起修改，同一时刻只有一个线程处理连接
+class WebSocket : public std::enable_shared_from_this<WebSocket> {
+public:
+    using Frame = std::shared_ptr<const std::string>;
+
+    enum OPCODE {
+        CONTINUATION = 0x0,
+        TEXT = 0x1,
+        BINARY = 0x2,
+        CLOSE = 0x8,
+        PING = 0x9,
+        PONG = 0xa
+    };
+    enum CLOSE_CODE {
+        NORMAL = 1000,
+        GOING_AWAY = 1001,
+        PROTOCOL_ERROR = 1002,
+        NO_STATUS = 1005,     // 关闭帧没有关闭码，不在帧中发送
+        ABNORMAL = 1006,      // 没有收到关闭帧，不在帧中发送
+        INVALID_DATA = 1007,
+        POLICY_VIOLATION = 1008,
+        MESSAGE_TOO_BIG = 1009
+    };
+
+    static int ping_interval_ms;      // 连接空闲多久后发送 ping，再过一个间隔仍没有任何数据时关闭
+    static size_t max_message_size;   // 一条消息（拼接分片后）的最大长度，超过时以 1009 关闭
+    static const size_t MAX_PENDING_BYTES = 4 << 20; // 待发队列的上限，消费过慢的连接以 1008 关闭
+    static const size_t MAX_CONTROL_PAYLOAD = 125;
+
+    // 握手：Sec-WebSocket-Key 是否为 16 字节的 base64，以及对应的 Sec-WebSocket-Accept
+    static bool IsValidKey(std::string_view key);
+    static std::string AcceptKey(std::string_view key);
+
+    // 服务端的帧不加掩码
+    static Frame MakeFrame(OPCODE opcode, std::string_view payload);
+    static Frame MakeClose(uint16_t code, std::string_view reason);
+    // 按 4 字节的掩码异或，SSE2/AVX2/NEON 一次处理 16/32 字节
+    static void Unmask(char* data, size_t len, const uint8_t mask[4]);
+    static bool IsValidUtf8(const char* data, size_t len);
+
+    // wake 在其他线程发送消息、连接已停放时调用，应把连接交给线程池
+    WebSocket(std::shared_ptr<const WebSocketHandler> handler, std::function<void()> wake);
+    ~WebSocket() = default;
+
+    // 以下可以在任意线程调用；连接已关闭或正在关闭时返回 false
+    bool Send(std::string_view message, bool binary = false);
+    bool Post(const Frame& frame); // 发送已编码的帧，用于广播
+    void Close(uint16_t code = NORMAL, std::string_view reason = "");
+    bool IsOpen() const;
+
+    // 以下由处理连接的工作线程调用
+    void Open();               // 握手完成，调用 on_open
+    void Process(Buffer& in);  // 处理 in 中所有完整的帧
+    // 取出最多 max_frames 个待发的帧，返回队列中是否还有剩余
+    bool TakeFrames(std::vector<Frame>* frames, size_t max_frames);
+    bool IsDone() const;       // 关闭握手已完成或出错，待发的帧写完后关闭连接
+    // 重新注册事件：idle 为 true（没有要写的数据，等待读）而队列中有新的帧时返回 false，调用方应继续处理；
+    // 否则调用 arm 注册事件并停放连接
+    bool Park(bool idle, const std::function<void()>& arm);
+
+    // 主线程收到连接的事件时取消停放；连接没有停放（正由工作线程处理），或事件的方向与停放时注册的不同
+    // （epoll_wait 返回后连接被唤醒处理并重新注册，事件来自上一次注册）时返回 false，事件丢弃
+    bool Unpark(bool hangup, bool writable);
+    // 主线程的定时器：发送 ping；上一个 ping 之后没有收到任何数据且连接已停放时返回 false，由调用方关闭
+    bool Ping();
+    // 连接关闭：丢弃待发的帧，调用 on_close
+    void Shutdown();
+
+private:
+    bool Push(const Frame& frame); // 需持有 mtx_，返回是否需要唤醒
+    void Fail(uint16_t code, const char* reason); // 协议错误：发送关闭帧，不等待回应
+    bool OnFrame(uint8_t opcode, bool fin, char* payload, size_t len); // 返回 false 时停止处理
+    void OnClose(const char* payload, size_t len);
+
+    std::shared_ptr<const WebSocketHandler> handler_;
+    std::function<void()> wake_;
+
+    mutable std::mutex mtx_;
+    std::deque<Frame> outbox_;
+    size_t pending_bytes_;
+    bool parked_;
+    bool parked_write_; // 停放时注册的是写事件
+    bool close_sent_;
+    bool close_received_;
+    bool failed_;
+    bool shut_;
+    std::atomic<bool> awaiting_pong_; // 发送 ping 之后还没有收到任何帧
+
+    // 只在工作线程上访问
+    std::string message_;   // 正在拼接的分片消息
+    uint8_t message_opcode_; // TEXT/BINARY，0 为没有未完成的消息
+    uint16_t close_code_;
+};
+
+// 一组 WebSocket 连接，广播的消息只编码一次，所有成员共享同一个帧；可以在任意线程使用
+class WebSocketChannel {
+public:
+    void Join(const std::shared_ptr<WebSocket>& ws);
+    void Leave(const std::shared_ptr<WebSocket>& ws);
+    // 返回收到消息的连接数，已关闭的连接顺便移除
+    size_t Broadcast(std::string_view message, bool binary = false);
+    size_t Broadcast(const WebSocket::Frame& frame);
+    size_t Size() const;
+
+private:
+    mutable std::mutex mtx_;
+    std::vector<std::shared_ptr<WebSocket>> members_;
+};
+
+#endif // WEBSOCKET_H
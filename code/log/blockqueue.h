@@ -29,6 +29,8 @@ public:
 
     void push_front(const T& item);
     void push_back(const T& item);
+    bool try_push_back(const T& item);
+    bool push_back_overwrite(const T& item);
     bool pop(T& item);
     bool pop(T& item, int timeout);
 
@@ -37,6 +39,7 @@ public:
     
     void flush();
     void close();
+    bool is_closed();
 };
 
 
@@ -103,6 +106,35 @@ void BlockQueue<T>::push_back(const T& item){
     condition_consumer_.notify_one();
 }
 
+//非阻塞入队，队列满或已关闭时返回false
+template <class T>
+bool BlockQueue<T>::try_push_back(const T& item){
+    std::lock_guard<std::mutex>locker(mtx_);
+    if(is_close || deque_.size() >= capacity_){
+        return false;
+    }
+    deque_.push_back(item);
+    condition_consumer_.notify_one();
+    return true;
+}
+
+//非阻塞入队，队列满时丢弃最旧的元素，返回是否有元素被丢弃
+template <class T>
+bool BlockQueue<T>::push_back_overwrite(const T& item){
+    std::lock_guard<std::mutex>locker(mtx_);
+    if(is_close){
+        return false;
+    }
+    bool dropped = false;
+    while(deque_.size() >= capacity_){
+        deque_.pop_front();
+        dropped = true;
+    }
+    deque_.push_back(item);
+    condition_consumer_.notify_one();
+    return dropped;
+}
+
 template <class T>
 bool BlockQueue<T>::pop(T& item){
     std::unique_lock<std::mutex>locker(mtx_);
@@ -165,4 +197,10 @@ void BlockQueue<T>::close(){
     condition_producer_.notify_all();
 }
 
+template <class T>
+bool BlockQueue<T>::is_closed(){
+    std::lock_guard<std::mutex>locker(mtx_);
+    return is_close;
+}
+
 #endif
\ No newline at end of file
@@ -1,35 +1,52 @@
 #include "log.h"
 
-Log::Log() 
-    : is_async_(false), today_(0),
-      line_count_(0), fp_(nullptr),
-      deque_(nullptr), write_thread_(nullptr) {}
+Log::Log()
+    : is_async_(false), is_binary_(false),
+      line_count_(0), file_size_(0), file_index_(0),
+      next_day_(0), next_interval_(0), fp_(nullptr),
+      deque_(nullptr), write_thread_(nullptr),
+      max_lines_(MAX_LINES), max_file_size_(0), rotate_interval_(0),
+      compress_(LOG_COMPRESS_NONE), keep_files_(0),
+      archive_deque_(nullptr), archive_thread_(nullptr),
+      unarchived_(0), total_unarchived_(0),
+      overflow_policy_(LOG_OVERFLOW_DROP_NEWEST), sample_rate_(10),
+      overflow_count_(0), dropped_(0), total_dropped_(0),
+      has_pending_formats_(false) {}
 
 Log::~Log() {
-    while (!deque_->empty())
-        deque_->flush(); // 唤醒消费者，处理剩下数据
-    deque_->close();
-    write_thread_->join(); // 等待线程退出
+    if (deque_) {
+        while (!deque_->empty())
+            deque_->flush(); // 唤醒消费者，处理剩下数据
+        deque_->close();
+        write_thread_->join(); // 等待线程退出
+    }
     if (fp_) {
         std::lock_guard<std::mutex> locker(mtx_);
-        Flush();
+        if (has_pending_formats_)
+            fwrite(pending_formats_.data(), 1, pending_formats_.size(), fp_);
+        fflush(fp_);
         fclose(fp_);
     }
+    if (archive_deque_) {
+        archive_deque_->push_back(""); // 空文件名通知归档线程退出
+        archive_thread_->join();
+    }
 }
 
 // 初始化
 void Log::Init(int level, const char* path,
-              const char* suffix, 
-              int max_capacity) {
+              const char* suffix,
+              int max_capacity, bool is_binary) {
     is_open_ = true;
-    level_ = level; 
+    is_binary_ = is_binary;
+    level_ = level;
     path_ = path;
     suffix_ = suffix;
 
     if (max_capacity) { // 异步
         is_async_ = true;
         if (!deque_) {
-            std::unique_ptr<BlockQueue<string>> new_deque(new BlockQueue<string>);
+            std::unique_ptr<BlockQueue<string>> new_deque(new BlockQueue<string>(max_capacity));
             deque_ = std::move(new_deque); // 所有权转移
             std::unique_ptr<thread> new_thread(new thread(FLushLogThread));
             write_thread_ = std::move(new_thread);
@@ -38,95 +55,378 @@ void Log::Init(int level, const char* path,
         is_async_ = false;
     }
 
-    line_count_ = 0;
+    time_t now = time(nullptr);
+    struct tm t;
+    localtime_r(&now, &t);
+    file_index_ = 0;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        SwitchFile(MakeFileName(t, file_index_), FormatSnapshot(), now);
+    }
+}
 
-    path_ = path;
-    suffix_ = suffix;
-    time_t timer = time(nullptr);
-    struct tm* sys_time = localtime(&timer);
-    struct tm t = *sys_time;
+void Log::SetRotation(size_t max_file_size, int max_lines, int rotate_interval) {
+    assert(max_lines >= 0 && rotate_interval >= 0);
+    std::lock_guard<std::mutex> locker(file_mtx_);
+    max_file_size_ = max_file_size;
+    max_lines_ = max_lines;
+    rotate_interval_ = rotate_interval;
+    next_interval_ = rotate_interval_ ? time(nullptr) + rotate_interval_ : 0;
+}
+
+void Log::SetArchive(LogCompress compress, int keep_files) {
+    assert(keep_files >= 0);
+    std::lock_guard<std::mutex> locker(mtx_);
+    compress_ = compress;
+    keep_files_ = keep_files;
+    if ((compress_ != LOG_COMPRESS_NONE || keep_files_ > 0) && !archive_deque_) {
+        std::unique_ptr<BlockQueue<string>> new_deque(new BlockQueue<string>(ARCHIVE_QUEUE_SIZE));
+        archive_deque_ = std::move(new_deque);
+        std::unique_ptr<thread> new_thread(new thread(ArchiveLogThread));
+        archive_thread_ = std::move(new_thread);
+    }
+}
+
+// 日志文件名：path + 日期 [+ "-序号"] + suffix
+string Log::MakeFileName(const struct tm& t, int index) const {
     char filename[Log_NAME_LENGTH] = {0};
-    snprintf(filename, Log_NAME_LENGTH - 1, "%s%04d_%02d_%0d%s",
-             path_, t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, suffix_);
-    today_ = t.tm_mday;
+    if (index == 0)
+        snprintf(filename, Log_NAME_LENGTH - 1, "%s%04d_%02d_%02d%s",
+                 path_, t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, suffix_);
+    else
+        snprintf(filename, Log_NAME_LENGTH - 1, "%s%04d_%02d_%02d-%d%s",
+                 path_, t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, index, suffix_);
+    return filename;
+}
 
-    {
+// 二进制日志的文件头和全部格式定义，调用者需持有 mtx_
+string Log::FormatSnapshot() {
+    string header;
+    if (!is_binary_)
+        return header;
+    header.append(LOG_BINARY_MAGIC, sizeof(LOG_BINARY_MAGIC));
+    for (size_t i = 0; i < formats_.size(); ++i)
+        AppendFormatRecord(i, header);
+    // 快照已包含所有格式，之前待写的定义不必再写
+    pending_formats_.clear();
+    has_pending_formats_ = false;
+    return header;
+}
+
+// 关闭当前文件并打开新文件，返回旧文件名
+string Log::SwitchFile(const string& filename, const string& header, time_t now) {
+    std::lock_guard<std::mutex> locker(file_mtx_);
+    if (fp_)
+        fclose(fp_);
+    fp_ = fopen(filename.c_str(), "a");
+    if (fp_ == nullptr) {
+        mkdir(path_, 0777); // 777最大权限
+        fp_ = fopen(filename.c_str(), "a");
+    }
+    assert(fp_ != nullptr);
+    // 每个二进制文件都带文件头和全部格式定义，可单独解码
+    fwrite(header.data(), 1, header.size(), fp_);
+
+    line_count_ = 0;
+    file_size_ = header.size();
+    struct tm t;
+    localtime_r(&now, &t);
+    t.tm_hour = t.tm_min = t.tm_sec = 0;
+    t.tm_mday += 1;
+    next_day_ = mktime(&t);
+    next_interval_ = rotate_interval_ ? now + rotate_interval_ : 0;
+
+    string old_file;
+    old_file.swap(file_name_);
+    file_name_ = filename;
+    return old_file;
+}
+
+bool Log::NeedRotate(time_t now) const {
+    return now >= next_day_ ||
+           (max_lines_ && line_count_ >= max_lines_) ||
+           (max_file_size_ && file_size_ >= max_file_size_) ||
+           (rotate_interval_ && now >= next_interval_);
+}
+
+// 切换到新文件，旧文件交给归档线程压缩和清理；归档队列满时不等待，旧文件保持未压缩。
+// 异步模式只在写线程执行；同步模式下调用者已持有 mtx_
+void Log::Rotate(time_t now) {
+    struct tm t;
+    localtime_r(&now, &t);
+    string header;
+    if (now >= next_day_) {
+        file_index_ = 0;
+    } else {
+        ++file_index_;
+    }
+    if (is_async_) {
         std::lock_guard<std::mutex> locker(mtx_);
-        if (fp_) {
-            Flush(); 
-            fclose(fp_);
-        }
-        fp_ = fopen(filename, "a");
-        if (fp_ == nullptr) {
-            mkdir(path_, 0777); // 777最大权限
-            fp_ = fopen(filename, "a");
-        }
-        assert(fp_ != nullptr);
+        header = FormatSnapshot();
+    } else {
+        header = FormatSnapshot();
+    }
+    string old_file = SwitchFile(MakeFileName(t, file_index_), header, now);
+    if (archive_deque_ && !old_file.empty() && old_file != file_name_ &&
+        !archive_deque_->try_push_back(old_file)) {
+        ++unarchived_;
+        ++total_unarchived_;
     }
 }
 
+// 写出一条记录，必要时先切换文件
+void Log::WriteRecord(const char* data, size_t len) {
+    time_t now = time(nullptr);
+    if (NeedRotate(now))
+        Rotate(now);
+    if (has_pending_formats_)
+        WritePendingFormats();
+
+    std::lock_guard<std::mutex> locker(file_mtx_);
+    fwrite(data, 1, len, fp_);
+    file_size_ += len;
+    ++line_count_;
+}
+
 void Log::AppendLogLevel(int level) {
-    const char* level_title[] = {"[DEBUG]: ", "[INFO] : ", "[WARN] : ",
-                                "[ERROR]: ", "[FATAL]: "};
-    int valid_level = (level >= 0 && level <= 4) ? level : 1;
-    buff_.Append(level_title[valid_level], 9);
+    buff_.Append(LogLevelTitle(level), 9);
 }
 
-void Log::Write(int level, const char* format, ...) {
-    struct timeval now = {0, 0};
-    gettimeofday(&now, nullptr);
-    time_t time_second =  now.tv_sec;
-    struct tm* sys_time = localtime(&time_second);
-    struct tm t = *sys_time;
-
-    // 日期不对或行数满了
-    if (today_ != t.tm_mday || (line_count_ && (line_count_ % MAX_LINES == 0))) {
-        std::unique_lock<std::mutex> locker(mtx_);
-        locker.unlock();
-
-        char new_file[Log_NAME_LENGTH];
-        char tail[36];
-        snprintf(tail, 36, "%04d_%02d_%02d", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
-
-        if (today_ != t.tm_mday) {
-            snprintf(new_file, Log_NAME_LENGTH - 72, "%s%s%s", path_, tail, suffix_);
-            today_ = t.tm_mday;
+int Log::RegisterFormat(const char* format) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    return RegisterFormatLocked(format);
+}
+
+// 每个格式串只注册一次，二进制模式下同时写出格式定义记录
+int Log::RegisterFormatLocked(const char* format) {
+    auto it = format_ids_.find(format);
+    if (it != format_ids_.end())
+        return it->second;
+    int id = formats_.size();
+    formats_.push_back(ParseLogFormat(format));
+    format_ids_[format] = id;
+    if (is_binary_ && fp_) {
+        // 格式定义不经过队列，避免被溢出策略丢弃；异步模式由写线程在写条目前补写
+        if (is_async_ && deque_) {
+            AppendFormatRecord(id, pending_formats_);
+            has_pending_formats_ = true;
         } else {
-            int num = line_count_ / MAX_LINES;
-            snprintf(new_file, Log_NAME_LENGTH, "%s%s-%d%s", path_, tail, num, suffix_);
+            string record;
+            AppendFormatRecord(id, record);
+            std::lock_guard<std::mutex> locker(file_mtx_);
+            fwrite(record.data(), 1, record.size(), fp_);
+            file_size_ += record.size();
         }
+    }
+    return id;
+}
 
-        {
-            std::lock_guard<std::mutex> locker(mtx_);
-            Flush();
-            fclose(fp_);
-            fp_ = fopen(new_file, "a");
-            assert(fp_ != nullptr);
-        }
+void Log::AppendFormatRecord(int format_id, string& out) {
+    const string& format = formats_[format_id].format;
+    uint8_t type = LOG_RECORD_FORMAT;
+    uint32_t id = format_id;
+    uint32_t len = format.size();
+    out.append(reinterpret_cast<const char*>(&type), sizeof(type));
+    out.append(reinterpret_cast<const char*>(&id), sizeof(id));
+    out.append(reinterpret_cast<const char*>(&len), sizeof(len));
+    out.append(format);
+}
+
+void Log::Write(int level, const char* format, ...) {
+    va_list vaList;
+    va_start(vaList, format);
+    WriteV(level, -1, format, vaList);
+    va_end(vaList);
+}
+
+void Log::Write(int level, int format_id, const char* format, ...) {
+    va_list vaList;
+    va_start(vaList, format);
+    WriteV(level, format_id, format, vaList);
+    va_end(vaList);
+}
+
+// 调用线程只负责编码，文件切换由写线程（异步）或 WriteRecord（同步）完成
+void Log::WriteV(int level, int format_id, const char* format, va_list args) {
+    struct timeval now = {0, 0};
+    gettimeofday(&now, nullptr);
+    struct tm t;
+    if (!is_binary_) { // 二进制日志不需要在调用线程上转换日期
+        time_t time_second = now.tv_sec;
+        localtime_r(&time_second, &t);
     }
 
+    string record;
     {
         std::lock_guard<std::mutex> locker(mtx_);
-        line_count_++;
-
-        int n = snprintf(buff_.WriteBegin(), 128, "%d-%02d-%02d %02d:%02d:%02d.%06ld ",     
-                         t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, 
-                         t.tm_hour, t.tm_min, t.tm_sec, now.tv_usec);
-        buff_.HasWritten(n);
-        AppendLogLevel(level);
-
-        va_list vaList;
-        va_start(vaList, format);
-        int m = vsnprintf(buff_.WriteBegin(), buff_.WritableBytes(), format, vaList);
-        va_end(vaList);
+        AppendRecord(level, format_id, format, now, t, args);
+        if (!is_async_ || !deque_) { // 同步模式-直接写入
+            WriteRecord(buff_.ReadBegin(), buff_.ReadableBytes());
+            buff_.RetrieveAll();
+            return;
+        }
+        record = buff_.RetrieveAllAsString();
+    }
+    // 入队时不持有 mtx_，BLOCK 策略下等待的生产者不会挡住写线程切换文件
+    Emit(record);
+}
+
+// 按当前模式把一条日志编码进 buff_，调用者需持有 mtx_
+void Log::AppendRecord(int level, int format_id, const char* format,
+                       const struct timeval& now, const struct tm& t, va_list args) {
+    if (is_binary_) {
+        if (format_id < 0 || static_cast<size_t>(format_id) >= formats_.size())
+            format_id = RegisterFormatLocked(format);
+        AppendEntry(level, format_id, now, args);
+    } else {
+        AppendText(level, now, t, format, args);
+    }
+}
+
+void Log::AppendRecordf(int level, int format_id, const char* format, ...) {
+    struct timeval now = {0, 0};
+    gettimeofday(&now, nullptr);
+    time_t time_second = now.tv_sec;
+    struct tm t;
+    localtime_r(&time_second, &t);
+
+    va_list vaList;
+    va_start(vaList, format);
+    AppendRecord(level, format_id, format, now, t, vaList);
+    va_end(vaList);
+}
+
+void Log::AppendText(int level, const struct timeval& now, const struct tm& t,
+                     const char* format, va_list args) {
+    int n = snprintf(buff_.WriteBegin(), 128, "%d-%02d-%02d %02d:%02d:%02d.%06ld ",
+                     t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
+                     t.tm_hour, t.tm_min, t.tm_sec, now.tv_usec);
+    buff_.HasWritten(n);
+    AppendLogLevel(level);
+
+    va_list args_copy;
+    va_copy(args_copy, args);
+    int m = vsnprintf(buff_.WriteBegin(), buff_.WritableBytes(), format, args);
+    if (m >= 0 && static_cast<size_t>(m) >= buff_.WritableBytes()) { // 被截断，扩容后重写
+        buff_.EnsureWriteable(m + 1);
+        vsnprintf(buff_.WriteBegin(), buff_.WritableBytes(), format, args_copy);
+    }
+    va_end(args_copy);
+    if (m > 0)
         buff_.HasWritten(m);
-        buff_.Append("\n\0", 2);
+    buff_.Append("\n", 1);
+}
+
+// 二进制条目：只记录格式id、时间戳和原始参数，格式化留给 logdecode
+void Log::AppendEntry(int level, int format_id, const struct timeval& now, va_list args) {
+    arg_buff_.RetrieveAll();
+    for (LogArgType type : formats_[format_id].args) {
+        switch (type) {
+        case LOG_ARG_INT: {
+            int32_t v = va_arg(args, int);
+            arg_buff_.Append(&v, sizeof(v));
+            break;
+        }
+        case LOG_ARG_LONG: {
+            int64_t v = va_arg(args, long);
+            arg_buff_.Append(&v, sizeof(v));
+            break;
+        }
+        case LOG_ARG_LONG_LONG: {
+            int64_t v = va_arg(args, long long);
+            arg_buff_.Append(&v, sizeof(v));
+            break;
+        }
+        case LOG_ARG_SIZE: {
+            int64_t v = va_arg(args, size_t);
+            arg_buff_.Append(&v, sizeof(v));
+            break;
+        }
+        case LOG_ARG_INTMAX: {
+            int64_t v = va_arg(args, intmax_t);
+            arg_buff_.Append(&v, sizeof(v));
+            break;
+        }
+        case LOG_ARG_DOUBLE: {
+            double v = va_arg(args, double);
+            arg_buff_.Append(&v, sizeof(v));
+            break;
+        }
+        case LOG_ARG_LONG_DOUBLE: {
+            double v = static_cast<double>(va_arg(args, long double));
+            arg_buff_.Append(&v, sizeof(v));
+            break;
+        }
+        case LOG_ARG_POINTER: {
+            uint64_t v = reinterpret_cast<uintptr_t>(va_arg(args, void*));
+            arg_buff_.Append(&v, sizeof(v));
+            break;
+        }
+        case LOG_ARG_STRING: {
+            const char* str = va_arg(args, const char*);
+            if (str == nullptr)
+                str = "(null)";
+            uint32_t len = strlen(str);
+            arg_buff_.Append(&len, sizeof(len));
+            arg_buff_.Append(str, len);
+            break;
+        }
+        case LOG_ARG_WSTRING: { // 与文本模式一样按当前 locale 转换，无法转换时为空
+            const wchar_t* wstr = va_arg(args, const wchar_t*);
+            std::string str;
+            size_t n = wstr ? wcstombs(nullptr, wstr, 0) : static_cast<size_t>(-1);
+            if (n != static_cast<size_t>(-1)) {
+                str.resize(n + 1);
+                wcstombs(&str[0], wstr, n + 1);
+                str.resize(n);
+            }
+            uint32_t len = str.size();
+            arg_buff_.Append(&len, sizeof(len));
+            arg_buff_.Append(str.data(), len);
+            break;
+        }
+        }
+    }
+
+    uint8_t type = LOG_RECORD_ENTRY;
+    uint8_t lv = static_cast<uint8_t>(level);
+    uint32_t id = format_id;
+    int64_t sec = now.tv_sec;
+    int32_t usec = now.tv_usec;
+    uint32_t len = arg_buff_.ReadableBytes();
+    buff_.Append(&type, sizeof(type));
+    buff_.Append(&lv, sizeof(lv));
+    buff_.Append(&id, sizeof(id));
+    buff_.Append(&sec, sizeof(sec));
+    buff_.Append(&usec, sizeof(usec));
+    buff_.Append(&len, sizeof(len));
+    buff_.Append(arg_buff_);
+}
 
-        if (is_async_ && deque_) // 异步模式-生产者
-            deque_->push_back(buff_.RetrieveAllAsString());
-        else // 同步模式-直接写入
-            fputs(buff_.ReadBegin(), fp_);    
-        buff_.RetrieveAll(); 
+// 异步模式-生产者：把一条记录交给写线程，除 BLOCK 外都不会因为写盘慢而阻塞调用线程
+void Log::Emit(const string& record) {
+    bool dropped = false;
+    switch (overflow_policy_) {
+    case LOG_OVERFLOW_BLOCK:
+        deque_->push_back(record);
+        break;
+    case LOG_OVERFLOW_DROP_NEWEST:
+        dropped = !deque_->try_push_back(record);
+        break;
+    case LOG_OVERFLOW_DROP_OLDEST:
+        dropped = deque_->push_back_overwrite(record);
+        break;
+    case LOG_OVERFLOW_SAMPLE:
+        if (!deque_->try_push_back(record)) {
+            dropped = true;
+            if (++overflow_count_ % sample_rate_ == 0)
+                deque_->push_back_overwrite(record); // 保留这条，挤掉最旧的
+        }
+        break;
+    }
+    if (dropped) {
+        ++dropped_;
+        ++total_dropped_;
     }
 }
 
@@ -142,32 +442,191 @@ void Log::FLushLogThread() {
     Log::GetInstance()->AsyncWrite();
 }
 
-// 写线程真正的执行函数
+// 归档线程函数
+void Log::ArchiveLogThread() {
+    Log::GetInstance()->Archive();
+}
+
+// 写线程真正的执行函数，文件切换也在这里完成
 void Log::AsyncWrite() {
     string str = "";
-    while (deque_->pop(str)) { // 异步模式-消费者
+    time_t last_report = time(nullptr);
+    while (true) {
+        bool popped = deque_->pop(str, POP_TIMEOUT_MS); // 异步模式-消费者
+        if (!popped && deque_->is_closed())
+            break;
+        if (popped) {
+            WriteRecord(str.data(), str.size());
+        } else if (fp_ && NeedRotate(time(nullptr))) { // 空闲时也按时间切换
+            Rotate(time(nullptr));
+        }
+        if (deque_->empty()) { // 队列已清空，由写线程负责刷盘
+            std::lock_guard<std::mutex> locker(file_mtx_);
+            if (fp_)
+                fflush(fp_);
+        }
+
+        time_t now = time(nullptr);
+        if (now - last_report >= DROP_REPORT_INTERVAL) {
+            if (dropped_)
+                ReportDropped(now - last_report);
+            if (unarchived_)
+                ReportUnarchived();
+            last_report = now;
+        }
+    }
+}
+
+// 写出新注册的格式定义，保证其先于引用它的条目落盘
+void Log::WritePendingFormats() {
+    string formats;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        formats.swap(pending_formats_);
+        has_pending_formats_ = false;
+    }
+    std::lock_guard<std::mutex> locker(file_mtx_);
+    fwrite(formats.data(), 1, formats.size(), fp_);
+    file_size_ += formats.size();
+}
+
+// 把丢弃统计作为一条普通日志写进日志文件
+void Log::ReportDropped(int seconds) {
+    static const char* policy_name[] = {"block", "drop-newest", "drop-oldest", "sample"};
+    static const char* format = "log queue full: %zu lines dropped in the last %d s (policy: %s)";
+    string record;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        AppendRecordf(2, -1, format, dropped_.exchange(0), seconds,
+                      policy_name[overflow_policy_]);
+        record = buff_.RetrieveAllAsString();
+    }
+    WriteRecord(record.data(), record.size());
+}
+
+// 归档跟不上切换时，把留下未压缩的文件数写进日志文件
+void Log::ReportUnarchived() {
+    static const char* format = "log archive queue full: %zu rotated files left uncompressed";
+    string record;
+    {
         std::lock_guard<std::mutex> locker(mtx_);
-        fputs(str.c_str(), fp_);
+        AppendRecordf(2, -1, format, unarchived_.exchange(0));
+        record = buff_.RetrieveAllAsString();
+    }
+    WriteRecord(record.data(), record.size());
+}
+
+// 归档线程：以最低优先级压缩切换下来的文件，并按保留个数清理旧文件
+void Log::Archive() {
+    setpriority(PRIO_PROCESS, syscall(SYS_gettid), 19);
+    string filename;
+    while (archive_deque_->pop(filename)) {
+        LogCompress compress;
+        int keep_files;
+        {
+            std::lock_guard<std::mutex> locker(mtx_);
+            compress = compress_;
+            keep_files = keep_files_;
+        }
+        if (!filename.empty() && compress == LOG_COMPRESS_GZIP)
+            CompressFile(filename);
+        // 积压的文件都处理完再清理，此时修改时间与切换顺序一致
+        if (keep_files > 0 && (filename.empty() || archive_deque_->empty()))
+            RemoveOldFiles(keep_files);
+        if (filename.empty()) // 退出通知
+            break;
+    }
+}
+
+// gzip 压缩后删除原文件；目标已存在时追加为新的 gzip member
+bool Log::CompressFile(const string& filename) {
+    FILE* in = fopen(filename.c_str(), "rb");
+    if (in == nullptr)
+        return false;
+    string gz_name = filename + ".gz";
+    gzFile out = gzopen(gz_name.c_str(), "ab6");
+    if (out == nullptr) {
+        fclose(in);
+        return false;
+    }
+    char buf[64 * 1024];
+    size_t n = 0;
+    bool ok = true;
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        if (gzwrite(out, buf, n) != static_cast<int>(n)) {
+            ok = false;
+            break;
+        }
+    }
+    fclose(in);
+    if (gzclose(out) != Z_OK)
+        ok = false;
+    if (ok)
+        unlink(filename.c_str());
+    return ok;
+}
+
+// 只保留最新的 keep_files 个已切换的日志文件（含压缩后的），当前文件不计入
+void Log::RemoveOldFiles(int keep_files) {
+    string current;
+    {
+        std::lock_guard<std::mutex> locker(file_mtx_);
+        current = file_name_;
     }
+    DIR* dir = opendir(path_);
+    if (dir == nullptr)
+        return;
+    string suffix = suffix_;
+    string gz_suffix = suffix + ".gz";
+    std::vector<std::pair<int64_t, string>> files; // (修改时间ns, 文件名)
+    while (struct dirent* entry = readdir(dir)) {
+        string name = entry->d_name;
+        auto ends_with = [&name](const string& s) {
+            return name.size() > s.size() &&
+                   name.compare(name.size() - s.size(), s.size(), s) == 0;
+        };
+        // 只处理本模块生成的文件：日期开头，以后缀结尾
+        if (name.empty() || !isdigit(static_cast<unsigned char>(name[0])) ||
+            !(ends_with(suffix) || ends_with(gz_suffix)))
+            continue;
+        string full = string(path_) + name;
+        struct stat st;
+        if (full == current || stat(full.c_str(), &st) < 0 || !S_ISREG(st.st_mode))
+            continue;
+        files.emplace_back(st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec, full);
+    }
+    closedir(dir);
+
+    if (files.size() <= static_cast<size_t>(keep_files))
+        return;
+    std::sort(files.begin(), files.end());
+    for (size_t i = 0; i + keep_files < files.size(); ++i)
+        unlink(files[i].second.c_str());
 }
 
-// 唤醒消费者，开始写日志
+// 唤醒消费者，开始写日志；异步模式下刷盘由写线程完成
 void Log::Flush() {
     if (is_async_)
         deque_->flush();
-    fflush(fp_);
+    else
+        fflush(fp_);
 }
 
 int Log::GetLevel() {
-    std::lock_guard<std::mutex> lock(mtx_);
     return level_;
 }
 
 void Log::SetLevel(int level) {
-    std::lock_guard<std::mutex> lock(mtx_);
     level_ = level;
 }
 
+void Log::SetOverflowPolicy(LogOverflowPolicy policy, int sample_rate) {
+    assert(sample_rate > 0);
+    std::lock_guard<std::mutex> lock(mtx_);
+    overflow_policy_ = policy;
+    sample_rate_ = sample_rate;
+}
+
 bool Log::IsOpen() {
     return is_open_;
-}
\ No newline at end of file
+}
@@ -4,36 +4,77 @@
 
 #include <sys/stat.h> // mkdir
 #include <sys/time.h> // gettimeofday
+#include <sys/resource.h> // setpriority
+#include <sys/syscall.h>  // SYS_gettid
+#include <unistd.h>   // unlink
+#include <dirent.h>   // opendir
+#include <zlib.h>     // gzopen
 #include <cstdio>   // FILE
 #include <cstdarg>  // va_start
+#include <cstring>  // strlen
+#include <cstdlib>  // wcstombs
 #include <ctime>
 #include <cassert>
 #include <string>
 #include <utility>  // move
 #include <memory>   // unique_ptr
 #include <thread>
+#include <atomic>
+#include <vector>
+#include <unordered_map>
+#include <algorithm> // sort
 
 #include "blockqueue.h"
+#include "log_format.h"
 #include "../buffer/buffer.h"
 
 using std::string;
 using std::thread;
 
+// 异步日志队列满时的处理策略
+enum LogOverflowPolicy {
+    LOG_OVERFLOW_BLOCK,       // 阻塞生产者，直到队列有空位
+    LOG_OVERFLOW_DROP_NEWEST, // 丢弃新日志
+    LOG_OVERFLOW_DROP_OLDEST, // 丢弃队首最旧的日志
+    LOG_OVERFLOW_SAMPLE,      // 每 sample_rate 条溢出日志保留一条（挤掉最旧的），其余丢弃
+};
+
+// 切换下来的日志文件的压缩方式
+enum LogCompress {
+    LOG_COMPRESS_NONE,
+    LOG_COMPRESS_GZIP,
+};
+
 class Log{
 public:
     void Init(int level, const char* path = "./log", 
               const char* suffix = ".log", 
-              int max_capacity = 1024);
+              int max_capacity = 1024, bool is_binary = false);
 
     static Log* GetInstance();
     static void FLushLogThread();  
+    static void ArchiveLogThread();
 
     void Flush();
+    int RegisterFormat(const char* format); // 注册格式串，返回格式id
     void Write(int level, const char* format, ...);
+    void Write(int level, int format_id, const char* format, ...);
 
     int GetLevel();
     void SetLevel(int level);
     bool IsOpen();
+    bool IsBinary() const { return is_binary_; }
+
+    void SetOverflowPolicy(LogOverflowPolicy policy, int sample_rate = 10);
+    LogOverflowPolicy GetOverflowPolicy() const { return overflow_policy_; }
+    size_t DroppedLines() const { return total_dropped_; } // 累计丢弃的日志行数
+
+    // 切换条件：文件大小（字节）、行数、时间间隔（秒），0 表示不按该条件切换；跨天总会切换
+    // 异步模式在写线程上切换；同步模式下由触发切换的那次 Write 在调用线程上关闭、打开文件
+    void SetRotation(size_t max_file_size, int max_lines = MAX_LINES, int rotate_interval = 0);
+    // 切换下来的文件在后台压缩，keep_files > 0 时只保留最新的 keep_files 个
+    void SetArchive(LogCompress compress, int keep_files = 0);
+    size_t UnarchivedFiles() const { return total_unarchived_; } // 归档队列满、未压缩就留下的文件数
 
 private:
     Log();
@@ -41,34 +82,91 @@ private:
 
     void AppendLogLevel(int level);
     void AsyncWrite();
+    void WritePendingFormats();
+    void ReportDropped(int seconds);
+    void ReportUnarchived();
+
+    void WriteV(int level, int format_id, const char* format, va_list args);
+    void AppendRecord(int level, int format_id, const char* format,
+                      const struct timeval& now, const struct tm& t, va_list args);
+    void AppendRecordf(int level, int format_id, const char* format, ...);
+    void AppendText(int level, const struct timeval& now, const struct tm& t,
+                    const char* format, va_list args);
+    void AppendEntry(int level, int format_id, const struct timeval& now, va_list args);
+    void AppendFormatRecord(int format_id, string& out);
+    int RegisterFormatLocked(const char* format);
+    void Emit(const string& record);
+
+    string MakeFileName(const struct tm& t, int index) const;
+    string FormatSnapshot();
+    string SwitchFile(const string& filename, const string& header, time_t now);
+    bool NeedRotate(time_t now) const;
+    void Rotate(time_t now);
+    void WriteRecord(const char* data, size_t len);
+
+    void Archive();
+    bool CompressFile(const string& filename);
+    void RemoveOldFiles(int keep_files);
 
     static const int Log_NAME_LENGTH = 256; //日志文件名最大长度
     static const int MAX_LINES = 50000; //日志文件最大行数
+    static const int POP_TIMEOUT_MS = 1000; //写线程等待日志的超时时间
+    static const int DROP_REPORT_INTERVAL = 5; //丢弃统计的上报间隔（秒）
+    static const int ARCHIVE_QUEUE_SIZE = 64; //待归档文件队列长度
 
     const char* path_; //日志文件路径
     const char* suffix_; //日志文件后缀
 
     bool is_open_; //日志是否打开
-    int level_; //日志等级
+    std::atomic<int> level_; //日志等级
     bool is_async_; //是否异步写日志
+    bool is_binary_; //是否写二进制日志
 
-    int today_;      //记录当前是哪一天
+    // 以下文件状态异步模式下只由写线程修改
     int line_count_; //记录当前日志文件的行数
+    size_t file_size_; //当前日志文件的字节数
+    int file_index_; //当天的文件序号
+    time_t next_day_; //下一次跨天切换的时间
+    time_t next_interval_; //下一次按时间间隔切换的时间
+    string file_name_; //当前日志文件名
 
     Buffer buff_;  //日志缓冲区
+    Buffer arg_buff_; //二进制日志参数缓冲区
     FILE* fp_;     //日志文件指针
 
-    std::mutex mtx_; //互斥锁
+    std::mutex mtx_; //互斥锁，保护缓冲区、格式表和文件切换
+    std::mutex file_mtx_; //写线程写文件时持有，不阻塞生产者
     std::unique_ptr<BlockQueue<string>> deque_; //日志阻塞队列
     std::unique_ptr<thread> write_thread_; //日志写入线程
-    
+
+    int max_lines_; //单个文件最大行数
+    size_t max_file_size_; //单个文件最大字节数
+    int rotate_interval_; //按时间切换的间隔（秒）
+    LogCompress compress_; //切换下来的文件的压缩方式
+    int keep_files_; //保留的历史文件个数
+    std::unique_ptr<BlockQueue<string>> archive_deque_; //待压缩/清理的文件
+    std::unique_ptr<thread> archive_thread_; //低优先级归档线程
+    std::atomic<size_t> unarchived_; //上次上报以来未能交给归档线程的文件数
+    std::atomic<size_t> total_unarchived_; //累计未能交给归档线程的文件数
+
+    LogOverflowPolicy overflow_policy_; //队列满时的处理策略
+    int sample_rate_; //采样策略下每多少条溢出日志保留一条
+    std::atomic<size_t> overflow_count_; //溢出事件计数，用于采样
+    std::atomic<size_t> dropped_; //上次上报以来丢弃的行数
+    std::atomic<size_t> total_dropped_; //累计丢弃的行数
+
+    std::vector<LogFormat> formats_; //已注册的格式串，下标即格式id
+    std::unordered_map<string, int> format_ids_; //格式串 -> 格式id
+    string pending_formats_; //异步模式下尚未写入文件的格式定义记录
+    std::atomic<bool> has_pending_formats_;
 };
 
 #define LOG_BASE(level, format, ...) \
     do { \
         Log* log = Log::GetInstance(); \
         if (log->IsOpen() && log->GetLevel() <= level) { \
-            log->Write(level, format, ##__VA_ARGS__); \
+            static const int log_format_id = log->RegisterFormat(format); \
+            log->Write(level, log_format_id, format, ##__VA_ARGS__); \
             log->Flush(); \
         } \
     } while(0);
@@ -0,0 +1,39 @@
+// logdecode: 将二进制日志还原为文本日志
+// 用法: logdecode <xxx.blog> [输出文件]，未指定输出文件时写到标准输出
+#include <cstdio>
+
+#include "log_format.h"
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <binary log> [output]\n", argv[0]);
+        return 1;
+    }
+    FILE* in = fopen(argv[1], "rb");
+    if (in == nullptr) {
+        perror(argv[1]);
+        return 1;
+    }
+    FILE* out = stdout;
+    if (argc > 2) {
+        out = fopen(argv[2], "w");
+        if (out == nullptr) {
+            perror(argv[2]);
+            fclose(in);
+            return 1;
+        }
+    }
+
+    LogDecoder decoder;
+    bool ok = decoder.Decode(in, out);
+    fclose(in);
+    if (out != stdout)
+        fclose(out);
+
+    if (!ok)
+        fprintf(stderr, "%s: truncated or corrupted log\n", argv[1]);
+    if (decoder.BadRecords())
+        fprintf(stderr, "%zu of %zu records could not be decoded\n",
+                decoder.BadRecords(), decoder.Records());
+    return ok ? 0 : 2;
+}
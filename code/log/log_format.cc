@@ -0,0 +1,321 @@
+#include "log_format.h"
+
+#include <ctime>
+#include <cstring>
+#include <cctype>
+#include <cwchar>
+
+namespace {
+
+// 按类型从 payload 中取出一个定长值
+template <typename T>
+bool ReadValue(const char*& cur, const char* end, T* value) {
+    if (static_cast<size_t>(end - cur) < sizeof(T))
+        return false;
+    memcpy(value, cur, sizeof(T));
+    cur += sizeof(T);
+    return true;
+}
+
+template <typename T>
+bool ReadRaw(FILE* in, T* value) {
+    return fread(value, sizeof(T), 1, in) == 1;
+}
+
+// 用还原后的说明符格式化单个参数，追加到 out
+template <typename T>
+void AppendFormatted(std::string& out, const std::string& spec,
+                     int star_count, const int* stars, T value) {
+    char buf[256];
+    int n = 0;
+    if (star_count == 0)
+        n = snprintf(buf, sizeof(buf), spec.c_str(), value);
+    else if (star_count == 1)
+        n = snprintf(buf, sizeof(buf), spec.c_str(), stars[0], value);
+    else
+        n = snprintf(buf, sizeof(buf), spec.c_str(), stars[0], stars[1], value);
+    if (n < 0)
+        return;
+    if (static_cast<size_t>(n) < sizeof(buf)) {
+        out.append(buf, n);
+        return;
+    }
+    // 超长的参数（通常是字符串），按实际长度重新格式化
+    std::vector<char> big(n + 1);
+    if (star_count == 0)
+        snprintf(big.data(), big.size(), spec.c_str(), value);
+    else if (star_count == 1)
+        snprintf(big.data(), big.size(), spec.c_str(), stars[0], value);
+    else
+        snprintf(big.data(), big.size(), spec.c_str(), stars[0], stars[1], value);
+    out.append(big.data(), n);
+}
+
+// 去掉说明符中的长度修饰符，必要时换成 modifier
+std::string RewriteLength(const std::string& spec, const char* modifier) {
+    size_t conv = spec.size() - 1;
+    size_t pos = conv;
+    while (pos > 0 && strchr("hlLqjzZt", spec[pos - 1]))
+        --pos;
+    return spec.substr(0, pos) + modifier + spec[conv];
+}
+
+bool ReadMagic(FILE* in) {
+    char magic[sizeof(LOG_BINARY_MAGIC)];
+    return fread(magic, sizeof(magic), 1, in) == 1 &&
+           memcmp(magic, LOG_BINARY_MAGIC, sizeof(magic)) == 0;
+}
+
+} // namespace
+
+LogFormat ParseLogFormat(const char* format) {
+    LogFormat res;
+    res.format = format ? format : "";
+    const char* p = res.format.c_str();
+    LogFormatPiece piece{"", "", 0, LOG_ARG_INT};
+
+    while (*p) {
+        if (*p != '%') {
+            piece.text += *p++;
+            continue;
+        }
+        if (p[1] == '%') { // %% -> %
+            piece.text += '%';
+            p += 2;
+            continue;
+        }
+        const char* start = p++;
+        while (*p && strchr("-+ #0'", *p)) // flags
+            ++p;
+        if (*p == '*') { // 宽度
+            ++piece.star_count;
+            ++p;
+        } else {
+            while (isdigit(static_cast<unsigned char>(*p)))
+                ++p;
+        }
+        if (*p == '.') { // 精度
+            ++p;
+            if (*p == '*') {
+                ++piece.star_count;
+                ++p;
+            } else {
+                while (isdigit(static_cast<unsigned char>(*p)))
+                    ++p;
+            }
+        }
+
+        LogArgType int_type = LOG_ARG_INT;
+        bool long_double = false;
+        if (*p == 'h') {
+            ++p;
+            if (*p == 'h')
+                ++p;
+        } else if (*p == 'l') {
+            ++p;
+            int_type = LOG_ARG_LONG;
+            if (*p == 'l') {
+                ++p;
+                int_type = LOG_ARG_LONG_LONG;
+            }
+        } else if (*p == 'q') {
+            ++p;
+            int_type = LOG_ARG_LONG_LONG;
+        } else if (*p == 'L') {
+            ++p;
+            int_type = LOG_ARG_LONG_LONG;
+            long_double = true;
+        } else if (*p == 'j' || *p == 't') {
+            ++p;
+            int_type = LOG_ARG_INTMAX;
+        } else if (*p == 'z' || *p == 'Z') {
+            ++p;
+            int_type = LOG_ARG_SIZE;
+        }
+
+        char conv = *p;
+        if (conv == '\0') { // 不完整的说明符，按字面文本处理
+            piece.text.append(start, p);
+            piece.star_count = 0;
+            break;
+        }
+        ++p;
+
+        LogArgType type;
+        switch (conv) {
+        case 'd': case 'i': case 'u': case 'o':
+        case 'x': case 'X':
+            type = int_type;
+            break;
+        case 'c': // char 和 wint_t 都按提升后的 int 传递
+            type = LOG_ARG_INT;
+            break;
+        case 'f': case 'F': case 'e': case 'E':
+        case 'g': case 'G': case 'a': case 'A':
+            type = long_double ? LOG_ARG_LONG_DOUBLE : LOG_ARG_DOUBLE;
+            break;
+        case 'p': case 'n':
+            type = LOG_ARG_POINTER;
+            break;
+        case 's':
+            type = int_type == LOG_ARG_LONG ? LOG_ARG_WSTRING : LOG_ARG_STRING;
+            break;
+        default: // %m 等不消耗参数的说明符，原样保留
+            piece.text.append(start, p);
+            piece.star_count = 0;
+            continue;
+        }
+
+        piece.spec.assign(start, p);
+        piece.type = type;
+        for (int i = 0; i < piece.star_count; ++i)
+            res.args.push_back(LOG_ARG_INT);
+        res.args.push_back(type);
+        res.pieces.push_back(piece);
+        piece = LogFormatPiece{"", "", 0, LOG_ARG_INT};
+    }
+    if (!piece.text.empty())
+        res.pieces.push_back(piece);
+    return res;
+}
+
+const char* LogLevelTitle(int level) {
+    static const char* level_title[] = {"[DEBUG]: ", "[INFO] : ", "[WARN] : ",
+                                        "[ERROR]: ", "[FATAL]: "};
+    int valid_level = (level >= 0 && level <= 4) ? level : 1;
+    return level_title[valid_level];
+}
+
+bool LogDecoder::Decode(FILE* in, FILE* out) {
+    if (!ReadMagic(in))
+        return false;
+
+    std::string data;
+    while (true) {
+        int type = fgetc(in);
+        if (type == EOF)
+            break;
+        if (type == LOG_BINARY_MAGIC[0]) { // 追加写入的新文件头
+            ungetc(type, in);
+            if (!ReadMagic(in))
+                return false;
+            continue;
+        }
+
+        if (type == LOG_RECORD_FORMAT) {
+            uint32_t id, len;
+            if (!ReadRaw(in, &id) || !ReadRaw(in, &len))
+                return false;
+            data.resize(len);
+            if (len && fread(&data[0], len, 1, in) != 1)
+                return false;
+            formats_[id] = ParseLogFormat(data.c_str());
+        } else if (type == LOG_RECORD_ENTRY) {
+            uint8_t level;
+            uint32_t id, len;
+            int64_t sec;
+            int32_t usec;
+            if (!ReadRaw(in, &level) || !ReadRaw(in, &id) || !ReadRaw(in, &sec) ||
+                !ReadRaw(in, &usec) || !ReadRaw(in, &len))
+                return false;
+            data.resize(len);
+            if (len && fread(&data[0], len, 1, in) != 1)
+                return false;
+            ++records_;
+            if (!DecodeEntry(data.data(), len, level, id, sec, usec, out))
+                ++bad_records_;
+        } else { // 记录边界已丢失，无法继续解码
+            ++bad_records_;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LogDecoder::DecodeEntry(const char* data, size_t len, int level, uint32_t id,
+                             int64_t sec, int32_t usec, FILE* out) {
+    time_t time_second = static_cast<time_t>(sec);
+    struct tm t;
+    localtime_r(&time_second, &t);
+    char head[128];
+    int n = snprintf(head, sizeof(head), "%d-%02d-%02d %02d:%02d:%02d.%06ld ",
+                     t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
+                     t.tm_hour, t.tm_min, t.tm_sec, static_cast<long>(usec));
+    line_.assign(head, n);
+    line_ += LogLevelTitle(level);
+
+    auto it = formats_.find(id);
+    if (it == formats_.end()) {
+        line_ += "<unknown format #" + std::to_string(id) + ">\n";
+        fwrite(line_.data(), 1, line_.size(), out);
+        return false;
+    }
+
+    const char* cur = data;
+    const char* end = data + len;
+    bool ok = true;
+    for (const LogFormatPiece& piece : it->second.pieces) {
+        line_ += piece.text;
+        if (piece.spec.empty())
+            continue;
+        int stars[2] = {0, 0};
+        for (int i = 0; i < piece.star_count && ok; ++i)
+            ok = ReadValue(cur, end, &stars[i]);
+        if (!ok)
+            break;
+
+        switch (piece.type) {
+        case LOG_ARG_INT: {
+            int32_t v;
+            if (!(ok = ReadValue(cur, end, &v)))
+                break;
+            if (piece.spec.back() == 'c' && piece.spec.find('l') != std::string::npos) // %lc
+                AppendFormatted(line_, piece.spec, piece.star_count, stars, static_cast<wint_t>(v));
+            else
+                AppendFormatted(line_, piece.spec, piece.star_count, stars, static_cast<int>(v));
+            break;
+        }
+        case LOG_ARG_LONG:
+        case LOG_ARG_LONG_LONG:
+        case LOG_ARG_SIZE:
+        case LOG_ARG_INTMAX: {
+            int64_t v;
+            if ((ok = ReadValue(cur, end, &v)))
+                AppendFormatted(line_, RewriteLength(piece.spec, "ll"), piece.star_count,
+                                stars, static_cast<long long>(v));
+            break;
+        }
+        case LOG_ARG_DOUBLE:
+        case LOG_ARG_LONG_DOUBLE: {
+            double v;
+            if ((ok = ReadValue(cur, end, &v)))
+                AppendFormatted(line_, RewriteLength(piece.spec, ""), piece.star_count, stars, v);
+            break;
+        }
+        case LOG_ARG_POINTER: {
+            uint64_t v;
+            if ((ok = ReadValue(cur, end, &v)) && piece.spec.back() == 'p')
+                AppendFormatted(line_, piece.spec, piece.star_count, stars,
+                                reinterpret_cast<void*>(static_cast<uintptr_t>(v)));
+            break;
+        }
+        case LOG_ARG_STRING:
+        case LOG_ARG_WSTRING: { // 宽字符串在写入端已转换为多字节，按 %s 输出
+            uint32_t n;
+            if ((ok = ReadValue(cur, end, &n) && static_cast<size_t>(end - cur) >= n)) {
+                std::string s(cur, n);
+                cur += n;
+                const std::string& spec =
+                    piece.type == LOG_ARG_STRING ? piece.spec : RewriteLength(piece.spec, "");
+                AppendFormatted(line_, spec, piece.star_count, stars, s.c_str());
+            }
+            break;
+        }
+        }
+        if (!ok)
+            break;
+    }
+    line_ += '\n';
+    fwrite(line_.data(), 1, line_.size(), out);
+    return ok && cur == end;
+}
@@ -0,0 +1,78 @@
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+#include <cstdio>   // FILE
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// 二进制日志文件格式（字节序与写入端主机一致）：
+//   文件头:   LOG_BINARY_MAGIC
+//   格式定义: u8 type=LOG_RECORD_FORMAT, u32 id, u32 len, char[len]
+//   日志条目: u8 type=LOG_RECORD_ENTRY, u8 level, u32 id,
+//             i64 tv_sec, i32 tv_usec, u32 len, payload[len]
+// payload 按格式串中的参数顺序存放原始参数：
+//   整型 -> i32 / i64，浮点 -> double，指针 -> u64，字符串 -> u32 len + bytes
+static const char LOG_BINARY_MAGIC[8] = {'W', 'S', 'B', 'L', 'O', 'G', '1', '\n'};
+
+enum LogRecordType : uint8_t {
+    LOG_RECORD_FORMAT = 1, // 格式串定义
+    LOG_RECORD_ENTRY = 2,  // 日志条目
+};
+
+// 参数在 va_list 中的类型，决定写入端如何取参以及在 payload 中的宽度
+enum LogArgType : uint8_t {
+    LOG_ARG_INT,        // int/short/char/wint_t   -> i32
+    LOG_ARG_LONG,       // long                    -> i64
+    LOG_ARG_LONG_LONG,  // long long               -> i64
+    LOG_ARG_SIZE,       // size_t/ssize_t          -> i64
+    LOG_ARG_INTMAX,     // intmax_t/ptrdiff_t      -> i64
+    LOG_ARG_DOUBLE,     // double                  -> double
+    LOG_ARG_LONG_DOUBLE,// long double             -> double
+    LOG_ARG_POINTER,    // %p/%n                   -> u64
+    LOG_ARG_STRING,     // %s                      -> u32 len + bytes
+    LOG_ARG_WSTRING,    // %ls                     -> u32 len + 按写入端 locale 转换后的 bytes
+};
+
+// 格式串被切分为若干片段：一段字面文本 + 至多一个转换说明符
+struct LogFormatPiece {
+    std::string text;   // 说明符之前的字面文本（%% 已还原为 %）
+    std::string spec;   // 转换说明符，如 "%-5.2f"；为空表示只有字面文本
+    int star_count;     // 宽度/精度中 '*' 的个数，每个消耗一个 int 参数
+    LogArgType type;    // 说明符本身消耗的参数类型
+};
+
+struct LogFormat {
+    std::string format;
+    std::vector<LogFormatPiece> pieces;
+    std::vector<LogArgType> args; // 展开后的参数类型序列（含 '*'）
+};
+
+// 解析 printf 风格的格式串
+LogFormat ParseLogFormat(const char* format);
+
+// 日志等级标题，文本日志与解码器共用
+const char* LogLevelTitle(int level);
+
+// 二进制日志解码器：还原为与文本模式一致的日志行
+class LogDecoder {
+public:
+    LogDecoder() : records_(0), bad_records_(0) {}
+
+    bool Decode(FILE* in, FILE* out);
+
+    size_t Records() const { return records_; }
+    size_t BadRecords() const { return bad_records_; }
+
+private:
+    bool DecodeEntry(const char* data, size_t len, int level, uint32_t id,
+                     int64_t sec, int32_t usec, FILE* out);
+
+    std::unordered_map<uint32_t, LogFormat> formats_;
+    std::string line_;
+    size_t records_;
+    size_t bad_records_;
+};
+
+#endif // LOG_FORMAT_H
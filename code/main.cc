@@ -1,9 +1,20 @@
 #include "server/web_server.h"
 
-int main(){
+int main(int argc, char* argv[]){
     WebServer server(8080, 3, 60000, 3306, 
                     "aihu", "password", "web_server",
-                    12, 8, true, 1, 1024);
+                    12, 8, true, 1, 1024, false);
+    // 日志按天和 64MB 切换，历史文件压缩后保留 30 个
+    server.SetLogRotation(64 << 20, 0, 0);
+    server.SetLogArchive(LOG_COMPRESS_GZIP, 30);
+    // 命令行参数为 MySQL 从库的 host[:port]，登录查询发往延迟不超过 3 秒的从库
+    for (int i = 1; i < argc; ++i) {
+        std::string replica = argv[i];
+        size_t colon = replica.rfind(':');
+        int port = colon == std::string::npos ? 3306 : atoi(replica.c_str() + colon + 1);
+        server.AddSqlReplica(replica.substr(0, colon).c_str(), port, 4);
+    }
+    server.SetSqlReplicaLag(3000);
     server.start();
     return 0;
 }
\ No newline at end of file
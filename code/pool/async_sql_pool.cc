@@ -0,0 +1,745 @@
+#include "async_sql_pool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <mysql/errmsg.h>
+
+const int AsyncSqlPool::PING_IDLE_MS;
+const int AsyncSqlPool::GROW_WAIT_MS;
+const int AsyncSqlPool::SHRINK_IDLE_MS;
+const int AsyncSqlPool::RETRY_MIN_MS;
+const int AsyncSqlPool::RETRY_MAX_MS;
+const int AsyncSqlPool::STATS_INTERVAL_MS;
+const int AsyncSqlPool::LAG_CHECK_MS;
+const int AsyncSqlPool::ROUTE_WAIT;
+const int AsyncSqlPool::ROUTE_NONE;
+
+AsyncSqlPool::AsyncSqlPool()
+    : wake_fd_(-1), epoller_(nullptr), acquire_timeout_ms_(500), ping_idle_ms_(PING_IDLE_MS),
+      shrink_idle_ms_(SHRINK_IDLE_MS), max_lag_ms_(3000),
+      lag_sql_("SHOW SLAVE STATUS"), dispatching_(false) {
+}
+
+AsyncSqlPool* AsyncSqlPool::instance() {
+    static AsyncSqlPool pool;
+    return &pool;
+}
+
+void AsyncSqlPool::Init(const char* host, int port,
+                        const char* user, const char* pwd,
+                        const char* db_name, int connect_size, int max_size) {
+    assert(connect_size > 0 && endpoints_.empty());
+    user_ = user;
+    pwd_ = pwd;
+    db_name_ = db_name;
+    AddEndpoint(host, port, connect_size, max_size);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    assert(wake_fd_ >= 0);
+    stats_at_ = Clock::now() + std::chrono::milliseconds(STATS_INTERVAL_MS);
+}
+
+void AsyncSqlPool::AddReplica(const char* host, int port, int connect_size, int max_size) {
+    assert(connect_size > 0 && !endpoints_.empty()); // 先 Init 主库
+    AddEndpoint(host, port, connect_size, max_size);
+}
+
+void AsyncSqlPool::SetReplicaLag(int max_lag_ms, const std::string& lag_sql) {
+    max_lag_ms_ = max_lag_ms;
+    lag_sql_ = lag_sql;
+}
+
+void AsyncSqlPool::AddEndpoint(const char* host, int port, int connect_size, int max_size) {
+    Endpoint endpoint;
+    endpoint.host = host;
+    endpoint.port = port;
+    endpoint.outstanding = 0;
+    endpoint.min_size = connect_size;
+    endpoint.max_size = std::max(max_size, connect_size);
+    endpoint.lag_ms = -1; // 测量之前不让从库接收读
+    endpoint.probing = false;
+    endpoint.lag_at = Clock::now();
+    endpoints_.push_back(endpoint);
+
+    int alive = 0;
+    for (int i = 0; i < connect_size; i++) {
+        Connect conn;
+        InitSlot(conn, endpoints_.size() - 1); // 连接失败的槽位保留下来，之后在主线程上重连
+        conn.retry_at = Clock::now() + std::chrono::milliseconds(RETRY_MIN_MS);
+        conn.retry_ms = RETRY_MIN_MS;
+
+        MYSQL* connect = mysql_init(nullptr);
+        if (!connect) {
+            LOG_ERROR("MySQL init fail!");
+        } else {
+            // 必须在连接前开启，之后同一连接既可以用阻塞 API 也可以用 _start/_cont
+            mysql_options(connect, MYSQL_OPT_NONBLOCK, 0);
+            if (!mysql_real_connect(connect, host, user_.c_str(), pwd_.c_str(), db_name_.c_str(),
+                                    port, nullptr, 0)) {
+                LOG_ERROR("MySql failed to connect to database: Error: %s", mysql_error(connect));
+                mysql_close(connect);
+            } else if (mysql_get_socket(connect) < 0) {
+                LOG_ERROR("AsyncSqlPool: invalid socket for connection");
+                mysql_close(connect);
+            } else {
+                conn.sql = connect;
+                conn.fd = mysql_get_socket(connect);
+                conn.stage = IDLE;
+                conn.retry_ms = 0;
+                fd_index_[conn.fd] = connects_.size();
+                if (epoller_) // 已经 Attach 过
+                    epoller_->AddFd(conn.fd, EPOLLRDHUP);
+                alive++;
+            }
+        }
+        connects_.push_back(std::move(conn));
+    }
+    if (alive == 0)
+        LOG_ERROR("AsyncSqlPool: no database connection available for %s:%d!", host, port);
+    LOG_INFO("AsyncSqlPool %s %s:%d num: %d/%d, max: %d", endpoints_.size() == 1 ? "primary" : "replica",
+             host, port, alive, connect_size, endpoints_.back().max_size);
+}
+
+// 未连接的槽位，到 retry_at 后连接
+void AsyncSqlPool::InitSlot(Connect& conn, size_t endpoint) {
+    conn.endpoint = endpoint;
+    conn.sql = nullptr;
+    conn.fd = -1;
+    conn.stage = BROKEN;
+    conn.error = 0;
+    conn.res = nullptr;
+    conn.stmt = nullptr;
+    conn.connected = nullptr;
+    conn.idle_since = Clock::now();
+    conn.used_at = conn.idle_since;
+    conn.retry_at = conn.idle_since;
+    conn.retry_ms = 0;
+}
+
+void AsyncSqlPool::Attach(Epoller* epoller) {
+    assert(epoller);
+    epoller_ = epoller;
+    if (wake_fd_ < 0)
+        return;
+    epoller_->AddFd(wake_fd_, EPOLLIN);
+    for (Connect& conn : connects_) {
+        if (conn.fd >= 0)
+            epoller_->AddFd(conn.fd, EPOLLRDHUP); // 空闲时不关心读写，只关心服务端断开
+    }
+}
+
+void AsyncSqlPool::ClosePool() {
+    for (Connect& conn : connects_) {
+        if (epoller_ && conn.fd >= 0)
+            epoller_->DelFd(conn.fd);
+        if (conn.res)
+            mysql_free_result(conn.res);
+        for (auto& stmt : conn.stmts)
+            mysql_stmt_close(stmt.second);
+        if (conn.sql)
+            mysql_close(conn.sql);
+    }
+    connects_.clear();
+    fd_index_.clear();
+    pending_.clear();
+    endpoints_.clear();
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        incoming_.clear();
+    }
+    if (wake_fd_ >= 0) {
+        if (epoller_)
+            epoller_->DelFd(wake_fd_);
+        close(wake_fd_);
+        wake_fd_ = -1;
+    }
+    epoller_ = nullptr;
+}
+
+void AsyncSqlPool::Query(const std::string& sql, Callback callback, bool read_only) {
+    Submit({sql, false, {}, std::move(callback), Clock::now(), read_only, -1, false});
+}
+
+void AsyncSqlPool::Execute(const std::string& sql, std::vector<std::string> params,
+                           Callback callback, bool read_only) {
+    Submit({sql, true, std::move(params), std::move(callback), Clock::now(), read_only, -1, false});
+}
+
+void AsyncSqlPool::Submit(Task task) {
+    assert(task.callback);
+    if (wake_fd_ < 0 || epoller_ == nullptr) {
+        LOG_WARN("AsyncSqlPool unavailable!");
+        task.callback(false, SqlRows());
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        incoming_.push_back(std::move(task));
+    }
+    uint64_t one = 1;
+    ssize_t ret = write(wake_fd_, &one, sizeof(one));
+    (void)ret; // 计数器已非零时写入失败也无妨，主线程总会被唤醒
+}
+
+bool AsyncSqlPool::Owns(int fd) const {
+    return fd >= 0 && (fd == wake_fd_ || fd_index_.count(fd));
+}
+
+void AsyncSqlPool::OnEvent(int fd, uint32_t events) {
+    if (fd == wake_fd_) {
+        OnWakeup();
+        return;
+    }
+    auto it = fd_index_.find(fd);
+    if (it == fd_index_.end())
+        return;
+    Connect& conn = connects_[it->second];
+
+    if (conn.stage == IDLE) {
+        if (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) { // 空闲连接被服务端关闭
+            LOG_ERROR("AsyncSqlPool: connection[%d] lost", fd);
+            Break(conn); // 下一轮立即重连
+        }
+        return;
+    }
+
+    int ready = ToWaitStatus(events);
+    int status = 0;
+    switch (conn.stage) {
+    case CONNECT:
+        status = mysql_real_connect_cont(&conn.connected, conn.sql, ready);
+        break;
+    case PING:
+        status = mysql_ping_cont(&conn.error, conn.sql, ready);
+        break;
+    case QUERY:
+        status = mysql_real_query_cont(&conn.error, conn.sql, ready);
+        break;
+    case STORE:
+        status = mysql_store_result_cont(&conn.res, conn.sql, ready);
+        break;
+    case PREPARE:
+        status = mysql_stmt_prepare_cont(&conn.error, conn.stmt, ready);
+        break;
+    case EXECUTE:
+        status = mysql_stmt_execute_cont(&conn.error, conn.stmt, ready);
+        break;
+    case STMT_STORE:
+        status = mysql_stmt_store_result_cont(&conn.error, conn.stmt, ready);
+        break;
+    default:
+        return;
+    }
+    Step(conn, status);
+}
+
+// 主线程被唤醒：取走其他线程提交的查询，分配给空闲连接
+void AsyncSqlPool::OnWakeup() {
+    uint64_t count = 0;
+    ssize_t ret = read(wake_fd_, &count, sizeof(count));
+    (void)ret;
+
+    std::vector<Task> tasks;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        tasks.swap(incoming_);
+    }
+    for (Task& task : tasks)
+        pending_.push_back(std::move(task));
+    Dispatch();
+}
+
+void AsyncSqlPool::Dispatch() {
+    if (dispatching_) // Start 同步完成后再次进入，由外层继续分配
+        return;
+    dispatching_ = true;
+    while (DispatchOne()) {
+    }
+    dispatching_ = false;
+}
+
+// 按提交顺序找到第一条能分配的查询并开始执行；没有可以开始的查询时返回 false
+// 等待某个节点的查询不会挡住发往其他节点的查询
+bool AsyncSqlPool::DispatchOne() {
+    std::vector<int> alive(endpoints_.size(), 0), idle(endpoints_.size(), 0);
+    for (const Connect& conn : connects_) {
+        if (conn.stage == BROKEN || conn.stage == CONNECT || conn.stage == SPARE)
+            continue;
+        alive[conn.endpoint]++;
+        if (conn.stage == IDLE)
+            idle[conn.endpoint]++;
+    }
+    for (auto it = pending_.begin(); it != pending_.end();) {
+        int endpoint = Route(*it, alive, idle);
+        if (endpoint == ROUTE_WAIT) {
+            ++it;
+            continue;
+        }
+        Task task = std::move(*it);
+        it = pending_.erase(it);
+        if (endpoint == ROUTE_NONE) { // 能处理的节点都已断开（或正在重连），直接失败，不等到超时
+            task.callback(false, SqlRows());
+            continue;
+        }
+        for (Connect& conn : connects_) {
+            if (conn.endpoint != static_cast<size_t>(endpoint) || conn.stage != IDLE)
+                continue;
+            wait_time_.Record(std::chrono::duration_cast<std::chrono::microseconds>(
+                Clock::now() - task.enqueued).count());
+            endpoints_[endpoint].outstanding++;
+            conn.task = std::move(task);
+            Start(conn);
+            return true;
+        }
+    }
+    return false;
+}
+
+// 返回有空闲连接的节点下标，或 ROUTE_WAIT/ROUTE_NONE
+int AsyncSqlPool::Route(const Task& task, const std::vector<int>& alive,
+                        const std::vector<int>& idle) const {
+    if (task.endpoint >= 0) {
+        if (alive[task.endpoint] == 0)
+            return ROUTE_NONE;
+        return idle[task.endpoint] > 0 ? task.endpoint : ROUTE_WAIT;
+    }
+    if (task.read_only) {
+        // 在可用的从库中选择未完成查询最少的；从库都忙时排队，而不是压到主库上
+        int best = ROUTE_NONE;
+        for (size_t i = 1; i < endpoints_.size(); ++i) {
+            if (!IsReadable(i, alive))
+                continue;
+            if (best == ROUTE_NONE)
+                best = ROUTE_WAIT;
+            if (idle[i] > 0 && (best < 0 || endpoints_[i].outstanding < endpoints_[best].outstanding))
+                best = i;
+        }
+        if (best != ROUTE_NONE)
+            return best;
+        // 没有从库，或从库都已断开/延迟过大，回到主库
+    }
+    if (alive[0] == 0)
+        return ROUTE_NONE;
+    return idle[0] > 0 ? 0 : ROUTE_WAIT;
+}
+
+bool AsyncSqlPool::IsReadable(size_t endpoint, const std::vector<int>& alive) const {
+    const Endpoint& ep = endpoints_[endpoint];
+    return alive[endpoint] > 0 && (max_lag_ms_ < 0 || (ep.lag_ms >= 0 && ep.lag_ms <= max_lag_ms_));
+}
+
+// 在从库上执行 lag_sql_，结果在下一次路由时生效
+void AsyncSqlPool::ProbeLag(size_t endpoint) {
+    Endpoint& ep = endpoints_[endpoint];
+    ep.probing = true;
+    ep.lag_at = Clock::now() + std::chrono::milliseconds(LAG_CHECK_MS);
+    Callback callback = [this, endpoint](bool ok, const SqlRows& rows) {
+        Endpoint& ep = endpoints_[endpoint];
+        int lag_ms = ok ? ParseLag(rows) : -1;
+        bool was_readable = ep.lag_ms >= 0 && ep.lag_ms <= max_lag_ms_;
+        bool readable = lag_ms >= 0 && lag_ms <= max_lag_ms_;
+        if (readable && !was_readable) {
+            LOG_INFO("AsyncSqlPool replica %s:%d lag %dms, serving reads", ep.host.c_str(), ep.port, lag_ms);
+        } else if (!readable && was_readable) {
+            LOG_WARN("AsyncSqlPool replica %s:%d lag %dms, reads go to primary", ep.host.c_str(), ep.port, lag_ms);
+        }
+        ep.lag_ms = lag_ms;
+        ep.probing = false;
+    };
+    // 放在队头，避免被排队的业务查询拖到超时
+    pending_.push_front({lag_sql_, false, {}, std::move(callback), Clock::now(),
+                         true, static_cast<int>(endpoint), true});
+    Dispatch();
+}
+
+// rows 的第一行为列名；不是从库（没有结果行）或复制已停止（NULL）时返回 -1
+int AsyncSqlPool::ParseLag(const SqlRows& rows) {
+    if (rows.size() < 2)
+        return -1;
+    for (size_t i = 0; i < rows[0].size() && i < rows[1].size(); ++i) {
+        if (rows[0][i] == "Seconds_Behind_Master" || rows[0][i] == "Seconds_Behind_Source")
+            return rows[1][i].empty() ? -1 : atoi(rows[1][i].c_str()) * 1000;
+    }
+    return -1;
+}
+
+void AsyncSqlPool::Start(Connect& conn) {
+    LOG_DEBUG("%s", conn.task.sql.c_str());
+    conn.error = 0;
+    conn.rows.clear();
+    int status = 0;
+    if (!conn.task.prepared) {
+        conn.stage = QUERY;
+        status = mysql_real_query_start(&conn.error, conn.sql,
+                                        conn.task.sql.c_str(), conn.task.sql.size());
+    } else {
+        auto it = conn.stmts.find(conn.task.sql);
+        if (it != conn.stmts.end()) { // 已缓存，直接执行
+            conn.stmt = it->second;
+            status = StartExecute(conn);
+        } else {
+            conn.stmt = mysql_stmt_init(conn.sql);
+            if (conn.stmt == nullptr) {
+                LOG_ERROR("MySQL stmt init fail: Error: %s", mysql_error(conn.sql));
+                Finish(conn, false);
+                return;
+            }
+            conn.stage = PREPARE;
+            status = mysql_stmt_prepare_start(&conn.error, conn.stmt,
+                                              conn.task.sql.c_str(), conn.task.sql.size());
+        }
+    }
+    Step(conn, status);
+}
+
+// 绑定参数并开始执行预处理语句，返回值同 mysql_stmt_execute_start
+int AsyncSqlPool::StartExecute(Connect& conn) {
+    conn.stage = EXECUTE;
+    conn.params.reset(new SqlStmtParams(conn.task.params));
+    if (conn.params->Count() != mysql_stmt_param_count(conn.stmt) ||
+        mysql_stmt_bind_param(conn.stmt, conn.params->Binds())) {
+        conn.error = 1;
+        return 0;
+    }
+    return mysql_stmt_execute_start(&conn.error, conn.stmt);
+}
+
+// 推进连接上的状态机：需要等待时按 status 调整监听的事件，完成时进入下一阶段
+void AsyncSqlPool::Step(Connect& conn, int status) {
+    while (true) {
+        if (status != 0) { // 未完成，等待 socket 就绪
+            epoller_->ModFd(conn.fd, ToEpollEvents(status));
+            return;
+        }
+        switch (conn.stage) {
+        case CONNECT:
+            if (conn.connected == nullptr) {
+                LOG_WARN("AsyncSqlPool reconnect fail: Error: %s", mysql_error(conn.sql));
+                conn.retry_ms = std::min(std::max(conn.retry_ms * 2, RETRY_MIN_MS),
+                                         RETRY_MAX_MS);
+                Break(conn);
+                return;
+            }
+            LOG_INFO("AsyncSqlPool: connection[%d] reconnected", conn.fd);
+            conn.retry_ms = 0;
+            conn.used_at = Clock::now();
+            SetIdle(conn);
+            Dispatch();
+            return;
+        case PING:
+            if (conn.error) {
+                LOG_ERROR("AsyncSqlPool: connection[%d] lost: Error: %s", conn.fd, mysql_error(conn.sql));
+                Break(conn);
+                return;
+            }
+            SetIdle(conn);
+            Dispatch();
+            return;
+        case QUERY:
+            if (conn.error) {
+                LOG_ERROR("MySQL query fail: Error: %s", mysql_error(conn.sql));
+                Finish(conn, false);
+                return;
+            }
+            conn.stage = STORE;
+            conn.res = nullptr;
+            status = mysql_store_result_start(&conn.res, conn.sql);
+            break;
+        case STORE: {
+            // INSERT 等没有结果集的语句 res 为空但 field_count 为 0
+            unsigned int field_count = mysql_field_count(conn.sql);
+            bool ok = conn.res != nullptr || field_count == 0;
+            if (conn.res) {
+                if (conn.task.header)
+                    FetchResultFields(conn.res, field_count, &conn.rows);
+                FetchResultRows(conn.res, field_count, &conn.rows);
+                mysql_free_result(conn.res);
+                conn.res = nullptr;
+            } else if (!ok) {
+                LOG_ERROR("MySQL store result fail: Error: %s", mysql_error(conn.sql));
+            }
+            Finish(conn, ok);
+            return;
+        }
+        case PREPARE:
+            if (conn.error) {
+                LOG_ERROR("MySQL prepare fail: Error: %s", mysql_stmt_error(conn.stmt));
+                DropStmt(conn);
+                Finish(conn, false);
+                return;
+            }
+            conn.stmts[conn.task.sql] = conn.stmt;
+            status = StartExecute(conn);
+            break;
+        case EXECUTE:
+            if (conn.error) {
+                LOG_ERROR("MySQL execute fail: Error: %s", mysql_stmt_error(conn.stmt));
+                DropStmt(conn); // 连接出错后语句可能已失效，下次重新 prepare
+                Finish(conn, false);
+                return;
+            }
+            if (mysql_stmt_field_count(conn.stmt) == 0) { // 没有结果集
+                Finish(conn, true);
+                return;
+            }
+            conn.stage = STMT_STORE;
+            status = mysql_stmt_store_result_start(&conn.error, conn.stmt);
+            break;
+        case STMT_STORE: {
+            bool ok = !conn.error && FetchStmtRows(conn.stmt, &conn.rows);
+            if (!ok)
+                LOG_ERROR("MySQL stmt store result fail: Error: %s", mysql_stmt_error(conn.stmt));
+            mysql_stmt_free_result(conn.stmt);
+            Finish(conn, ok);
+            return;
+        }
+        default:
+            return;
+        }
+    }
+}
+
+void AsyncSqlPool::DropStmt(Connect& conn) {
+    auto it = conn.stmts.find(conn.task.sql);
+    if (it != conn.stmts.end() && it->second == conn.stmt)
+        conn.stmts.erase(it);
+    mysql_stmt_close(conn.stmt);
+    conn.stmt = nullptr;
+}
+
+void AsyncSqlPool::Finish(Connect& conn, bool ok) {
+    endpoints_[conn.endpoint].outstanding--;
+    conn.used_at = Clock::now();
+    Task task = std::move(conn.task);
+    SqlRows rows;
+    rows.swap(conn.rows);
+    conn.stmt = nullptr;
+    conn.params.reset();
+    // 查询失败可能是因为连接已断开，不再把它分配给后面的查询
+    unsigned int err = ok ? 0 : mysql_errno(conn.sql);
+    if (err == CR_SERVER_GONE_ERROR || err == CR_SERVER_LOST) {
+        LOG_ERROR("AsyncSqlPool: connection[%d] lost", conn.fd);
+        Break(conn);
+    } else {
+        SetIdle(conn);
+    }
+
+    task.callback(ok, rows);
+    Dispatch(); // 连接空闲了，继续处理排队的查询
+}
+
+void AsyncSqlPool::SetIdle(Connect& conn) {
+    conn.stage = IDLE;
+    conn.idle_since = Clock::now();
+    epoller_->ModFd(conn.fd, EPOLLRDHUP);
+}
+
+// 释放断开的连接及其语句，等到 retry_at 由 GetNextTick 重连
+void AsyncSqlPool::Break(Connect& conn) {
+    if (conn.fd >= 0) {
+        epoller_->DelFd(conn.fd);
+        fd_index_.erase(conn.fd);
+        conn.fd = -1;
+    }
+    if (conn.res) {
+        mysql_free_result(conn.res);
+        conn.res = nullptr;
+    }
+    for (auto& stmt : conn.stmts)
+        mysql_stmt_close(stmt.second);
+    conn.stmts.clear();
+    conn.stmt = nullptr;
+    conn.params.reset();
+    if (conn.sql) {
+        mysql_close(conn.sql);
+        conn.sql = nullptr;
+    }
+    conn.stage = BROKEN;
+    conn.retry_at = Clock::now() + std::chrono::milliseconds(conn.retry_ms);
+}
+
+void AsyncSqlPool::StartConnect(Connect& conn) {
+    conn.sql = mysql_init(nullptr);
+    if (conn.sql == nullptr) {
+        LOG_ERROR("MySQL init fail!");
+        conn.retry_at = Clock::now() + std::chrono::milliseconds(RETRY_MAX_MS);
+        return;
+    }
+    mysql_options(conn.sql, MYSQL_OPT_NONBLOCK, 0);
+    conn.connected = nullptr;
+    conn.stage = CONNECT;
+    const Endpoint& ep = endpoints_[conn.endpoint];
+    int status = mysql_real_connect_start(&conn.connected, conn.sql, ep.host.c_str(), user_.c_str(),
+                                          pwd_.c_str(), db_name_.c_str(), ep.port, nullptr, 0);
+    conn.fd = mysql_get_socket(conn.sql);
+    if (conn.fd < 0) { // 还没有建立 socket 就失败了
+        if (conn.connected == nullptr) {
+            LOG_WARN("AsyncSqlPool reconnect fail: Error: %s", mysql_error(conn.sql));
+        } else {
+            LOG_ERROR("AsyncSqlPool: invalid socket for connection");
+        }
+        conn.retry_ms = std::min(std::max(conn.retry_ms * 2, RETRY_MIN_MS),
+                                 RETRY_MAX_MS);
+        Break(conn);
+        return;
+    }
+    fd_index_[conn.fd] = &conn - connects_.data();
+    epoller_->AddFd(conn.fd, 0);
+    Step(conn, status);
+}
+
+void AsyncSqlPool::StartPing(Connect& conn) {
+    conn.stage = PING;
+    conn.error = 0;
+    Step(conn, mysql_ping_start(&conn.error, conn.sql));
+}
+
+int AsyncSqlPool::GetNextTick() {
+    if (wake_fd_ < 0 || epoller_ == nullptr)
+        return -1;
+    Clock::time_point now = Clock::now();
+    ExpireWaiting(now);
+
+    Clock::time_point next = std::min(Resize(now), now + std::chrono::milliseconds(ping_idle_ms_));
+    for (const Task& task : pending_)
+        next = std::min(next, task.enqueued + std::chrono::milliseconds(acquire_timeout_ms_));
+    for (size_t i = 1; i < endpoints_.size() && max_lag_ms_ >= 0; ++i) {
+        if (!endpoints_[i].probing && now >= endpoints_[i].lag_at)
+            ProbeLag(i);
+        next = std::min(next, endpoints_[i].lag_at);
+    }
+    for (Connect& conn : connects_) {
+        if (conn.stage == BROKEN && now >= conn.retry_at) {
+            StartConnect(conn);
+        } else if (conn.stage == IDLE && now - conn.idle_since >= std::chrono::milliseconds(ping_idle_ms_)) {
+            StartPing(conn);
+        }
+        // 以上可能同步完成，按最新的状态计算下次时间
+        if (conn.stage == BROKEN)
+            next = std::min(next, conn.retry_at);
+        else if (conn.stage == IDLE)
+            next = std::min(next, conn.idle_since + std::chrono::milliseconds(ping_idle_ms_));
+    }
+    LogStats(now);
+    int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(next - now).count();
+    return us <= 0 ? 0 : static_cast<int>((us + 999) / 1000);
+}
+
+// 排队等待连接超过 acquire_timeout_ms_ 的查询直接失败
+void AsyncSqlPool::ExpireWaiting(Clock::time_point now) {
+    std::chrono::milliseconds timeout(acquire_timeout_ms_);
+    for (auto it = pending_.begin(); it != pending_.end();) {
+        if (now - it->enqueued < timeout) {
+            ++it;
+            continue;
+        }
+        Task task = std::move(*it);
+        it = pending_.erase(it);
+        wait_time_.Record(std::chrono::duration_cast<std::chrono::microseconds>(now - task.enqueued).count());
+        LOG_WARN("AsyncSqlPool busy: acquire timeout");
+        task.callback(false, SqlRows());
+    }
+}
+
+// 排队超过 GROW_WAIT_MS 的查询要去的节点所有连接都在忙时，为它增加一个连接；
+// 超出常驻数量的连接空闲超过 shrink_idle_ms_ 后关闭，槽位留给以后扩容；返回下次需要检查的时间
+AsyncSqlPool::Clock::time_point AsyncSqlPool::Resize(Clock::time_point now) {
+    Clock::time_point next = Clock::time_point::max();
+    size_t n = endpoints_.size();
+    std::vector<int> size(n, 0), alive(n, 0), busy(n, 0);
+    for (const Connect& conn : connects_) {
+        if (conn.stage == SPARE)
+            continue;
+        size[conn.endpoint]++;
+        if (conn.stage == BROKEN || conn.stage == CONNECT)
+            continue;
+        alive[conn.endpoint]++;
+        if (conn.stage != IDLE)
+            busy[conn.endpoint]++;
+    }
+
+    std::chrono::milliseconds grow_wait(GROW_WAIT_MS);
+    std::vector<bool> grow(n, false);
+    for (const Task& task : pending_) {
+        // 假设每个可用节点都有空闲连接，得到查询会被分配到的节点
+        int endpoint = Route(task, alive, alive);
+        if (endpoint < 0 || size[endpoint] >= endpoints_[endpoint].max_size)
+            continue;
+        if (now - task.enqueued < grow_wait)
+            next = std::min(next, task.enqueued + grow_wait);
+        else if (busy[endpoint] == size[endpoint]) // 有正在重连或空闲的连接时不扩容
+            grow[endpoint] = true;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        if (grow[i])
+            Grow(i);
+    }
+
+    std::chrono::milliseconds shrink_idle(shrink_idle_ms_);
+    for (Connect& conn : connects_) {
+        const Endpoint& ep = endpoints_[conn.endpoint];
+        if (conn.stage != IDLE || size[conn.endpoint] <= ep.min_size)
+            continue;
+        if (now - conn.used_at < shrink_idle) {
+            next = std::min(next, conn.used_at + shrink_idle);
+            continue;
+        }
+        Break(conn);
+        conn.stage = SPARE;
+        size[conn.endpoint]--;
+        LOG_INFO("AsyncSqlPool %s:%d shrink to %d", ep.host.c_str(), ep.port, size[conn.endpoint]);
+    }
+    return next;
+}
+
+// 优先使用该节点收缩后空出的槽位；在主线程的定时处理中调用，不会有其他地方持有 connects_ 中的引用
+void AsyncSqlPool::Grow(size_t endpoint) {
+    size_t index = 0;
+    while (index < connects_.size() &&
+           (connects_[index].endpoint != endpoint || connects_[index].stage != SPARE))
+        ++index;
+    if (index == connects_.size())
+        connects_.emplace_back();
+    Connect& conn = connects_[index];
+    InitSlot(conn, endpoint);
+    const Endpoint& ep = endpoints_[endpoint];
+    int size = 0;
+    for (const Connect& other : connects_)
+        size += other.endpoint == endpoint && other.stage != SPARE;
+    LOG_INFO("AsyncSqlPool %s:%d grow to %d", ep.host.c_str(), ep.port, size);
+    StartConnect(conn);
+}
+
+// 周期性输出这段时间内排队等待连接的时间分布，然后清零
+void AsyncSqlPool::LogStats(Clock::time_point now) {
+    if (now < stats_at_)
+        return;
+    stats_at_ = now + std::chrono::milliseconds(STATS_INTERVAL_MS);
+    if (wait_time_.Count() == 0)
+        return;
+    LOG_INFO("AsyncSqlPool wait: %s, pending: %d", wait_time_.Summary().c_str(),
+             static_cast<int>(pending_.size()));
+    wait_time_.Reset();
+}
+
+uint32_t AsyncSqlPool::ToEpollEvents(int status) {
+    // 未设置读写超时，MYSQL_WAIT_TIMEOUT 不会出现
+    uint32_t events = 0;
+    if (status & MYSQL_WAIT_READ)
+        events |= EPOLLIN;
+    if (status & MYSQL_WAIT_WRITE)
+        events |= EPOLLOUT;
+    if (status & MYSQL_WAIT_EXCEPT)
+        events |= EPOLLPRI;
+    return events;
+}
+
+int AsyncSqlPool::ToWaitStatus(uint32_t events) {
+    int status = 0;
+    if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) // 出错时让客户端库自己读出错误
+        status |= MYSQL_WAIT_READ;
+    if (events & EPOLLOUT)
+        status |= MYSQL_WAIT_WRITE;
+    if (events & EPOLLPRI)
+        status |= MYSQL_WAIT_EXCEPT;
+    return status;
+}
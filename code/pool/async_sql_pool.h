@@ -0,0 +1,187 @@
+#ifndef ASYNC_SQL_POOL_H
+#define ASYNC_SQL_POOL_H
+
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <chrono>
+#include <unordered_map>
+#include <mysql/mysql.h>
+
+#include "../log/log.h"
+#include "../server/epoller.h"
+#include "sql_stmt.h"
+#include "wait_histogram.h"
+
+// 基于 MariaDB 非阻塞 API（mysql_real_query_start/_cont）的异步连接池
+// 数据库连接的 socket 注册在主线程的 Epoller 中，查询的推进和回调都在主线程上完成，
+// 工作线程只负责提交查询，不会因为等待数据库而被占用
+// 断开的连接（包括启动时连接失败的）在主线程上异步重连，空闲连接定期 ping；
+// 排队超过 acquire_timeout_ms_ 仍未分到连接的查询直接失败，请求可以快速返回 503
+// 节点的 max_size 大于 connect_size 时，查询排队超过 GROW_WAIT_MS 就为它增加一个连接，最多到 max_size；
+// 多出的连接空闲超过 shrink_idle_ms_ 后关闭
+// 可以挂多个从库，每个节点有各自的连接；只读查询发往复制延迟在阈值内、
+// 未完成查询最少的从库，没有可用从库时回到主库，写查询总是发往主库
+class AsyncSqlPool {
+public:
+    // 查询完成的回调，在主线程上执行，应尽快返回
+    using Callback = std::function<void(bool ok, const SqlRows& rows)>;
+
+    static AsyncSqlPool* instance();
+
+    void Init(const char* host, int port,
+              const char* user, const char* pwd,
+              const char* db_name, int connect_size = 4, int max_size = 0); // 主库
+    // 从库使用与主库相同的用户和数据库，在 Init 之后、主线程开始处理事件之前调用
+    void AddReplica(const char* host, int port, int connect_size = 4, int max_size = 0);
+    void Attach(Epoller* epoller); // 注册唤醒 fd 和各连接的 socket
+    void ClosePool();
+    void SetAcquireTimeout(int timeout_ms) { acquire_timeout_ms_ = timeout_ms; }
+    void SetPingInterval(int idle_ms) { ping_idle_ms_ = idle_ms; } // 空闲超过 idle_ms 的连接需要 ping
+    void SetShrinkIdle(int idle_ms) { shrink_idle_ms_ = idle_ms; } // 扩容出来的连接空闲多久后关闭
+    // 从库延迟超过 max_lag_ms 时不再接收读；max_lag_ms < 0 不检查延迟
+    // lag_sql 的结果中需要有 Seconds_Behind_Master 或 Seconds_Behind_Source 列
+    void SetReplicaLag(int max_lag_ms, const std::string& lag_sql = "SHOW SLAVE STATUS");
+
+    // 线程安全，可在任意线程提交；连接池不可用时回调会在当前线程上以失败立即执行
+    // read_only 的查询可以发往从库，需要读到自己刚写入的数据时不要设置
+    void Query(const std::string& sql, Callback callback, bool read_only = false); // 文本协议
+    // 预处理语句，每个连接对同一条 SQL 只 prepare 一次，参数按二进制协议绑定
+    void Execute(const std::string& sql, std::vector<std::string> params, Callback callback,
+                 bool read_only = false);
+
+    // 以下只在主线程调用
+    bool Owns(int fd) const; // fd 是否属于本连接池（唤醒 fd 或数据库 socket）
+    void OnEvent(int fd, uint32_t events);
+    // 处理排队超时、重连、空闲 ping 和连接数的伸缩，返回距下次需要处理的毫秒数，-1 表示不需要
+    int GetNextTick();
+    const WaitHistogram& WaitTime() const { return wait_time_; } // 本统计周期内排队等待连接的时间
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static const int PING_IDLE_MS = 30000;      // 默认空闲超过该时间的连接需要 ping
+    static const int GROW_WAIT_MS = 5;          // 查询排队超过该时间才扩容
+    static const int SHRINK_IDLE_MS = 60000;    // 默认扩容出来的连接空闲超过该时间后关闭
+    static const int RETRY_MIN_MS = 500;        // 重连失败后的首次退避
+    static const int RETRY_MAX_MS = 30000;      // 重连退避的上限
+    static const int STATS_INTERVAL_MS = 60000; // 输出等待时间直方图的周期
+    static const int LAG_CHECK_MS = 1000;       // 测量从库延迟的周期
+    static const int ROUTE_WAIT = -1;           // 可用的节点都没有空闲连接
+    static const int ROUTE_NONE = -2;           // 没有可用的节点
+
+    AsyncSqlPool();
+    ~AsyncSqlPool() {
+        ClosePool();
+    }
+
+    enum STAGE {
+        IDLE,
+        CONNECT,    // 等待 mysql_real_connect 完成
+        PING,       // 等待 mysql_ping 完成
+        QUERY,      // 等待 mysql_real_query 完成
+        STORE,      // 等待 mysql_store_result 完成
+        PREPARE,    // 等待 mysql_stmt_prepare 完成
+        EXECUTE,    // 等待 mysql_stmt_execute 完成
+        STMT_STORE, // 等待 mysql_stmt_store_result 完成
+        BROKEN,     // 连接已断开，不再分配查询，到 retry_at 后重连
+        SPARE       // 收缩后空出的槽位，同一节点扩容时重新使用
+    };
+
+    struct Task {
+        std::string sql;
+        bool prepared; // 是否走预处理语句
+        std::vector<std::string> params;
+        Callback callback;
+        Clock::time_point enqueued; // 提交的时间
+        bool read_only;             // 可以发往从库
+        int endpoint;               // 指定节点，-1 表示按读写路由
+        bool header;                // 结果的第一行为列名
+    };
+
+    // 数据库节点，下标 0 为主库
+    struct Endpoint {
+        std::string host;
+        int port;
+        int outstanding;          // 正在执行的查询数
+        int min_size;             // 常驻的连接数
+        int max_size;             // 排队时最多扩容到的连接数
+        int lag_ms;               // 最近一次测得的复制延迟，-1 表示未知或复制已中断
+        bool probing;             // 正在测量延迟
+        Clock::time_point lag_at; // 下次测量延迟的时间
+    };
+
+    struct Connect {
+        size_t endpoint;
+        MYSQL* sql; // 断开后为空
+        int fd;     // 断开后为 -1
+        STAGE stage;
+        int error;
+        MYSQL_RES* res;
+        MYSQL_STMT* stmt; // 当前任务使用的语句
+        std::unique_ptr<SqlStmtParams> params;
+        std::unordered_map<std::string, MYSQL_STMT*> stmts; // 本连接已 prepare 的语句
+        SqlRows rows;
+        Task task;
+        MYSQL* connected;             // mysql_real_connect 的结果
+        Clock::time_point idle_since; // 空闲或上次 ping 的时间
+        Clock::time_point used_at;    // 上次执行完查询的时间，用于收缩
+        Clock::time_point retry_at;   // 下次重连的时间
+        int retry_ms;                 // 重连退避，成功后清零
+    };
+
+    static uint32_t ToEpollEvents(int status);
+    static int ToWaitStatus(uint32_t events);
+
+    void Submit(Task task);
+    void OnWakeup();
+    void AddEndpoint(const char* host, int port, int connect_size, int max_size);
+    void InitSlot(Connect& conn, size_t endpoint);
+    void Dispatch();
+    bool DispatchOne();
+    int Route(const Task& task, const std::vector<int>& alive, const std::vector<int>& idle) const;
+    bool IsReadable(size_t endpoint, const std::vector<int>& alive) const;
+    void ProbeLag(size_t endpoint);
+    static int ParseLag(const SqlRows& rows);
+    void StartConnect(Connect& conn);
+    void StartPing(Connect& conn);
+    void SetIdle(Connect& conn);
+    void Break(Connect& conn);
+    void ExpireWaiting(Clock::time_point now);
+    Clock::time_point Resize(Clock::time_point now);
+    void Grow(size_t endpoint);
+    void LogStats(Clock::time_point now);
+    void Start(Connect& conn);
+    int StartExecute(Connect& conn);
+    void Step(Connect& conn, int status);
+    void DropStmt(Connect& conn);
+    void Finish(Connect& conn, bool ok);
+
+    std::vector<Connect> connects_; //所有连接，只在主线程访问
+    std::unordered_map<int, size_t> fd_index_; //socket -> connects_ 下标
+    std::deque<Task> pending_; //等待空闲连接的查询，只在主线程访问
+
+    std::mutex mtx_;
+    std::vector<Task> incoming_; //其他线程提交、尚未被主线程取走的查询
+    int wake_fd_; //eventfd，提交查询后唤醒主线程
+    Epoller* epoller_;
+
+    std::vector<Endpoint> endpoints_; //主库和从库，只在主线程访问
+    std::string user_, pwd_, db_name_;
+    int acquire_timeout_ms_; //排队等待连接的上限
+    int ping_idle_ms_; //空闲连接 ping 的间隔
+    int shrink_idle_ms_; //扩容出来的连接空闲多久后关闭
+    int max_lag_ms_; //从库可接收读的最大延迟
+    std::string lag_sql_; //测量从库延迟的语句
+    bool dispatching_; //Start 可能同步完成并再次进入 Dispatch
+    Clock::time_point stats_at_; //下次输出统计的时间
+    WaitHistogram wait_time_;
+};
+
+#endif // ASYNC_SQL_POOL_H
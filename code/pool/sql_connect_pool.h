@@ -25,7 +25,7 @@ public:
     int GetFreeConnCount();
 
 private:
-    SqlConnectPool() = default;
+    SqlConnectPool() : max_conn_(0) {}
     ~SqlConnectPool(){
         ClosePool();
     };
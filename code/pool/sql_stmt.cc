@@ -0,0 +1,81 @@
+#include "sql_stmt.h"
+
+SqlStmtParams::SqlStmtParams(const std::vector<std::string>& params)
+    : binds_(params.size()), lengths_(params.size()) {
+    for (size_t i = 0; i < params.size(); ++i) {
+        memset(&binds_[i], 0, sizeof(MYSQL_BIND));
+        lengths_[i] = params[i].size();
+        binds_[i].buffer_type = MYSQL_TYPE_STRING;
+        binds_[i].buffer = const_cast<char*>(params[i].data());
+        binds_[i].buffer_length = lengths_[i];
+        binds_[i].length = &lengths_[i];
+    }
+}
+
+bool FetchStmtRows(MYSQL_STMT* stmt, SqlRows* rows) {
+    static const unsigned long COLUMN_BUFF_SIZE = 256; // 超长的列再单独取
+    unsigned int field_count = mysql_stmt_field_count(stmt);
+    if (field_count == 0)
+        return true;
+
+    std::vector<MYSQL_BIND> binds(field_count);
+    std::vector<std::string> buffs(field_count, std::string(COLUMN_BUFF_SIZE, '\0'));
+    std::vector<unsigned long> lengths(field_count);
+    std::vector<my_bool> is_null(field_count), error(field_count);
+    for (unsigned int i = 0; i < field_count; ++i) {
+        memset(&binds[i], 0, sizeof(MYSQL_BIND));
+        binds[i].buffer_type = MYSQL_TYPE_STRING;
+        binds[i].buffer = &buffs[i][0];
+        binds[i].buffer_length = COLUMN_BUFF_SIZE;
+        binds[i].length = &lengths[i];
+        binds[i].is_null = &is_null[i];
+        binds[i].error = &error[i];
+    }
+    if (mysql_stmt_bind_result(stmt, binds.data()))
+        return false;
+
+    while (true) {
+        int ret = mysql_stmt_fetch(stmt);
+        if (ret == MYSQL_NO_DATA)
+            break;
+        if (ret == 1)
+            return false;
+        SqlRow row(field_count);
+        for (unsigned int i = 0; i < field_count; ++i) {
+            if (is_null[i])
+                continue;
+            if (lengths[i] <= COLUMN_BUFF_SIZE) {
+                row[i].assign(buffs[i].data(), lengths[i]);
+                continue;
+            }
+            // MYSQL_DATA_TRUNCATED：按实际长度重新取这一列
+            row[i].resize(lengths[i]);
+            MYSQL_BIND column = binds[i];
+            column.buffer = &row[i][0];
+            column.buffer_length = lengths[i];
+            if (mysql_stmt_fetch_column(stmt, &column, i, 0))
+                return false;
+        }
+        rows->push_back(std::move(row));
+    }
+    return true;
+}
+
+void FetchResultRows(MYSQL_RES* res, unsigned int field_count, SqlRows* rows) {
+    while (MYSQL_ROW row = mysql_fetch_row(res)) {
+        SqlRow values(field_count);
+        for (unsigned int i = 0; i < field_count; ++i) {
+            if (row[i])
+                values[i] = row[i];
+        }
+        rows->push_back(std::move(values));
+    }
+}
+
+void FetchResultFields(MYSQL_RES* res, unsigned int field_count, SqlRows* rows) {
+    MYSQL_FIELD* fields = mysql_fetch_fields(res);
+    SqlRow names(field_count);
+    for (unsigned int i = 0; fields && i < field_count; ++i)
+        names[i] = fields[i].name;
+    rows->push_back(std::move(names));
+}
@@ -0,0 +1,34 @@
+#ifndef SQL_STMT_H
+#define SQL_STMT_H
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <mysql/mysql.h>
+
+// 查询结果，所有列都按字符串取出，NULL 为空串
+using SqlRow = std::vector<std::string>;
+using SqlRows = std::vector<SqlRow>;
+
+// 预处理语句的参数绑定，按二进制协议发送，参数不会被当作 SQL 解析
+// binds/lengths 在语句执行完之前必须保持有效
+class SqlStmtParams {
+public:
+    explicit SqlStmtParams(const std::vector<std::string>& params);
+
+    MYSQL_BIND* Binds() { return binds_.empty() ? nullptr : binds_.data(); }
+    size_t Count() const { return binds_.size(); }
+
+private:
+    std::vector<MYSQL_BIND> binds_;
+    std::vector<unsigned long> lengths_;
+};
+
+// 从已 store_result 的语句中取出全部行（结果已在客户端缓存，不会阻塞）
+bool FetchStmtRows(MYSQL_STMT* stmt, SqlRows* rows);
+// 从文本查询的结果集中取出全部行
+void FetchResultRows(MYSQL_RES* res, unsigned int field_count, SqlRows* rows);
+// 取出结果集的列名，作为一行追加到 rows
+void FetchResultFields(MYSQL_RES* res, unsigned int field_count, SqlRows* rows);
+
+#endif // SQL_STMT_H
@@ -16,17 +16,18 @@ public:
     explicit ThreadPool(int thread_count = 8) : pool_(std::make_shared<Pool>()) {
         assert(thread_count > 0);
         for (int i = 0; i < thread_count; ++i) {
-            std::thread([this]() {
-                std::unique_lock<std::mutex> locker(pool_->mtx_);
+            // 线程持有 Pool 的共享指针，ThreadPool 析构后也不会访问已释放的对象
+            std::thread([pool = pool_]() {
+                std::unique_lock<std::mutex> locker(pool->mtx_);
                 while (true) {
-                    if (!pool_->tasks_.empty()) {   // 有任务，取任务执行
-                        auto task = std::move(pool_->tasks_.front());
-                        pool_->tasks_.pop();
+                    if (!pool->tasks_.empty()) {   // 有任务，取任务执行
+                        auto task = std::move(pool->tasks_.front());
+                        pool->tasks_.pop();
                         locker.unlock();
                         task();
                         locker.lock();
-                    } else if (!pool_->is_closed) { // 未关闭，等待
-                        pool_->cond_.wait(locker);
+                    } else if (!pool->is_closed) { // 未关闭，等待
+                        pool->cond_.wait(locker);
                     } else {                        // 已关闭，退出 
                         break;
                     }
@@ -37,10 +38,12 @@ public:
 
     ~ThreadPool() {
         if (pool_) {
-            std::lock_guard<std::mutex> locker(pool_->mtx_);
-            pool_->is_closed = true;
+            {
+                std::lock_guard<std::mutex> locker(pool_->mtx_);
+                pool_->is_closed = true;
+            }
+            pool_->cond_.notify_all();
         }
-        pool_->cond_.notify_all();
     }
 
     template<class T>
@@ -52,7 +55,7 @@ public:
 
 private:
     struct Pool {
-        bool is_closed;
+        bool is_closed = false;
         std::mutex mtx_;
         std::condition_variable cond_;
         std::queue<std::function<void()>> tasks_; // 任务队列
@@ -0,0 +1,511 @@
+#include "upstream_pool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+
+const int UpstreamPool::DEFAULT_CHECK_MS;
+const int UpstreamPool::MAX_FAILS;
+const size_t UpstreamPool::MAX_PROBE_READ;
+
+UpstreamPool::UpstreamPool()
+    : wake_fd_(-1), epoller_(nullptr), max_idle_(32), idle_timeout_ms_(60000),
+      connect_timeout_ms_(3000), next_tag_(0) {
+}
+
+UpstreamPool* UpstreamPool::instance() {
+    static UpstreamPool pool;
+    return &pool;
+}
+
+bool UpstreamPool::Resolve(const std::string& host, int port, sockaddr_in* addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &addr->sin_addr) == 1)
+        return true;
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || !result)
+        return false;
+    addr->sin_addr = reinterpret_cast<sockaddr_in*>(result->ai_addr)->sin_addr;
+    freeaddrinfo(result);
+    return true;
+}
+
+int UpstreamPool::Add(const std::vector<std::string>& servers, BALANCE balance) {
+    Upstream upstream;
+    upstream.balance = balance;
+    upstream.next = 0;
+    upstream.check_ms = DEFAULT_CHECK_MS;
+    for (const std::string& name : servers) {
+        size_t colon = name.rfind(':');
+        int port = 0;
+        if (colon != std::string::npos && colon + 1 < name.size() && colon + 6 >= name.size() &&
+            name.find_first_not_of("0123456789", colon + 1) == std::string::npos)
+            port = std::stoi(name.substr(colon + 1));
+        Server server;
+        if (port <= 0 || port > 65535 || !Resolve(name.substr(0, colon), port, &server.addr)) {
+            LOG_ERROR("Upstream server %s invalid!", name.c_str());
+            return -1;
+        }
+        server.name = name;
+        server.healthy = true;
+        server.fails = 0;
+        server.active = 0;
+        server.probing = false;
+        server.check_at = Clock::now() + std::chrono::milliseconds(upstream.check_ms);
+        upstream.servers.push_back(std::move(server));
+    }
+    if (upstream.servers.empty())
+        return -1;
+    upstreams_.push_back(std::move(upstream));
+    LOG_INFO("Upstream %zu: %zu servers, %s", upstreams_.size() - 1, servers.size(),
+             balance == LEAST_CONN ? "least_conn" : "round_robin");
+    return static_cast<int>(upstreams_.size() - 1);
+}
+
+bool UpstreamPool::SetHealthCheck(int upstream, const std::string& path, int interval_ms) {
+    if (upstream < 0 || upstream >= static_cast<int>(upstreams_.size()) || interval_ms <= 0 ||
+        (!path.empty() && path[0] != '/'))
+        return false;
+    Upstream& up = upstreams_[upstream];
+    up.check_path = path;
+    up.check_ms = interval_ms;
+    for (Server& server : up.servers)
+        server.check_at = Clock::now() + std::chrono::milliseconds(interval_ms);
+    return true;
+}
+
+void UpstreamPool::SetKeepAlive(size_t max_idle, int idle_timeout_ms) {
+    max_idle_ = max_idle;
+    idle_timeout_ms_ = idle_timeout_ms;
+}
+
+void UpstreamPool::Attach(Epoller* epoller) {
+    assert(epoller);
+    if (wake_fd_ < 0) {
+        wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        assert(wake_fd_ >= 0);
+    }
+    epoller_ = epoller;
+    epoller_->AddFd(wake_fd_, EPOLLIN);
+}
+
+void UpstreamPool::ClosePool() {
+    for (auto& item : conns_) {
+        if (epoller_)
+            epoller_->DelFd(item.first);
+        close(item.first);
+    }
+    conns_.clear();
+    pending_.clear();
+    for (Upstream& upstream : upstreams_) {
+        for (Server& server : upstream.servers) {
+            server.idle.clear();
+            server.active = 0;
+            server.probing = false;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        incoming_.clear();
+        released_.clear();
+    }
+    if (wake_fd_ >= 0) {
+        if (epoller_)
+            epoller_->DelFd(wake_fd_);
+        close(wake_fd_);
+        wake_fd_ = -1;
+    }
+    epoller_ = nullptr;
+}
+
+void UpstreamPool::Acquire(int upstream, Callback done, EventCallback on_event) {
+    assert(done);
+    if (wake_fd_ < 0 || epoller_ == nullptr || upstream < 0 || upstream >= static_cast<int>(upstreams_.size())) {
+        LOG_WARN("UpstreamPool unavailable for upstream %d!", upstream);
+        done(nullptr);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        incoming_.push_back({upstream, std::move(done), std::move(on_event)});
+    }
+    uint64_t one = 1;
+    ssize_t ret = write(wake_fd_, &one, sizeof(one));
+    (void)ret; // 计数器已非零时写入失败也无妨，主线程总会被唤醒
+}
+
+void UpstreamPool::Release(UpstreamConnect* conn, RELEASE how) {
+    if (!conn)
+        return;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        released_.push_back({conn, how});
+    }
+    uint64_t one = 1;
+    ssize_t ret = write(wake_fd_, &one, sizeof(one));
+    (void)ret;
+}
+
+const std::string& UpstreamPool::ServerName(const UpstreamConnect* conn) const {
+    return upstreams_[conn->upstream].servers[conn->server].name;
+}
+
+bool UpstreamPool::Owns(int fd) const {
+    return fd >= 0 && (fd == wake_fd_ || conns_.count(fd));
+}
+
+void UpstreamPool::OnEvent(int fd, uint32_t events, uint32_t tag) {
+    if (fd == wake_fd_) {
+        OnWakeup();
+        return;
+    }
+    auto it = conns_.find(fd);
+    if (it == conns_.end() || it->second->tag != tag) // fd 被复用前的旧事件
+        return;
+    UpstreamConnect* conn = it->second.get();
+    switch (conn->stage) {
+    case UpstreamConnect::CONNECT: {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        bool ok = !(events & (EPOLLERR | EPOLLHUP)) &&
+                  getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) == 0 && error == 0;
+        OnConnected(conn, ok);
+        break;
+    }
+    case UpstreamConnect::IDLE: // 空闲连接被上游关闭，或者收到了不属于任何请求的数据
+        LOG_DEBUG("Upstream connection[%d] to %s closed while idle", fd,
+                  upstreams_[conn->upstream].servers[conn->server].name.c_str());
+        {
+            std::deque<UpstreamConnect*>& idle = upstreams_[conn->upstream].servers[conn->server].idle;
+            idle.erase(std::find(idle.begin(), idle.end(), conn));
+        }
+        Destroy(conn);
+        break;
+    case UpstreamConnect::LEASED:
+        if (conn->on_event)
+            conn->on_event();
+        break;
+    default:
+        OnProbe(conn, events);
+        break;
+    }
+}
+
+// 主线程被唤醒：先收回放回的连接，它们可以直接分给新的请求
+void UpstreamPool::OnWakeup() {
+    uint64_t count = 0;
+    ssize_t ret = read(wake_fd_, &count, sizeof(count));
+    (void)ret;
+
+    std::vector<Request> requests;
+    std::vector<std::pair<UpstreamConnect*, RELEASE>> released;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        requests.swap(incoming_);
+        released.swap(released_);
+    }
+    for (auto& item : released)
+        PutBack(item.first, item.second);
+    for (Request& request : requests)
+        Dispatch(request, 0);
+}
+
+// tries 为这个请求已经尝试过的服务器数，建连失败时换下一个，都失败时返回 nullptr
+void UpstreamPool::Dispatch(Request& request, int tries) {
+    Upstream& upstream = upstreams_[request.upstream];
+    int index = tries < static_cast<int>(upstream.servers.size()) ? Pick(upstream) : -1;
+    if (index < 0) {
+        LOG_WARN("Upstream %d: no server available", request.upstream);
+        request.done(nullptr);
+        return;
+    }
+    Server& server = upstream.servers[index];
+    server.active++;
+    if (!server.idle.empty()) { // 最近放回的连接最不可能已被上游关闭
+        UpstreamConnect* conn = server.idle.back();
+        server.idle.pop_back();
+        Lease(conn, std::move(request.done), std::move(request.on_event));
+        return;
+    }
+    UpstreamConnect* conn = Connect(request.upstream, index, UpstreamConnect::CONNECT);
+    if (!conn) {
+        server.active--;
+        MarkFailed(upstream, server, true);
+        Dispatch(request, tries + 1);
+        return;
+    }
+    conn->done = std::move(request.done);
+    conn->on_event = std::move(request.on_event);
+    conn->tries = tries + 1;
+}
+
+int UpstreamPool::Pick(Upstream& upstream) {
+    size_t count = upstream.servers.size();
+    int best = -1;
+    for (size_t k = 0; k < count; ++k) {
+        size_t i = (upstream.next + k) % count;
+        const Server& server = upstream.servers[i];
+        if (!server.healthy)
+            continue;
+        if (upstream.balance == ROUND_ROBIN) {
+            best = i;
+            break;
+        }
+        if (best < 0 || server.active < upstream.servers[best].active)
+            best = i;
+    }
+    if (best >= 0)
+        upstream.next = best + 1;
+    return best;
+}
+
+// 租出期间由持有者注册事件；之前的注册换成不关心读写的 EPOLLONESHOT，
+// 这时仍可能报告一次 EPOLLHUP/EPOLLERR，持有者没有在等待时应忽略
+void UpstreamPool::Lease(UpstreamConnect* conn, Callback done, EventCallback on_event) {
+    conn->stage = UpstreamConnect::LEASED;
+    conn->on_event = std::move(on_event);
+    conn->done = nullptr;
+    epoller_->ModFd(conn->fd, EPOLLONESHOT, conn->tag);
+    done(conn);
+}
+
+void UpstreamPool::PutBack(UpstreamConnect* conn, RELEASE how) {
+    assert(conn->stage == UpstreamConnect::LEASED);
+    Upstream& upstream = upstreams_[conn->upstream];
+    Server& server = upstream.servers[conn->server];
+    server.active--;
+    conn->on_event = nullptr;
+    if (how == FAIL) {
+        MarkFailed(upstream, server, false);
+    } else if (how == REUSE) {
+        server.fails = 0;
+    }
+    if (how != REUSE || !server.healthy || server.idle.size() >= max_idle_) {
+        Destroy(conn);
+        return;
+    }
+    conn->requests++;
+    conn->stage = UpstreamConnect::IDLE;
+    conn->deadline = Clock::now();
+    // 空闲时有数据可读或对端关闭都说明连接不能再用
+    epoller_->ModFd(conn->fd, EPOLLIN | EPOLLRDHUP, conn->tag);
+    server.idle.push_back(conn);
+}
+
+UpstreamConnect* UpstreamPool::Connect(int upstream, size_t server, UpstreamConnect::STAGE stage) {
+    const Server& target = upstreams_[upstream].servers[server];
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOG_ERROR("Upstream socket error: %s", strerror(errno));
+        return nullptr;
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)); // 请求头和响应头都是一次写出
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&target.addr), sizeof(target.addr)) < 0 &&
+        errno != EINPROGRESS) {
+        LOG_WARN("Upstream connect to %s error: %s", target.name.c_str(), strerror(errno));
+        close(fd);
+        return nullptr;
+    }
+    std::unique_ptr<UpstreamConnect> conn(new UpstreamConnect());
+    conn->fd = fd;
+    conn->tag = 0x80000000u | (++next_tag_ & 0x7fffffffu); // 与客户端连接的代数（从 1 递增）区分开
+    conn->upstream = upstream;
+    conn->server = server;
+    conn->requests = 0;
+    conn->stage = stage;
+    int timeout_ms = connect_timeout_ms_;
+    if (stage != UpstreamConnect::CONNECT) // 健康检查在下一个周期之前结束
+        timeout_ms = std::min(timeout_ms, upstreams_[upstream].check_ms);
+    conn->deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+    conn->tries = 0;
+    // 立即完成的 connect 也等可写事件，流程相同
+    epoller_->AddFd(fd, EPOLLOUT | EPOLLONESHOT | EPOLLRDHUP, conn->tag);
+    UpstreamConnect* result = conn.get();
+    conns_[fd] = std::move(conn);
+    pending_.push_back(result);
+    return result;
+}
+
+void UpstreamPool::OnConnected(UpstreamConnect* conn, bool ok) {
+    pending_.erase(std::find(pending_.begin(), pending_.end(), conn));
+    if (ok) {
+        Lease(conn, std::move(conn->done), std::move(conn->on_event));
+        return;
+    }
+    Upstream& upstream = upstreams_[conn->upstream];
+    Server& server = upstream.servers[conn->server];
+    LOG_WARN("Upstream connect to %s failed", server.name.c_str());
+    server.active--;
+    MarkFailed(upstream, server, true);
+    Request request = {conn->upstream, std::move(conn->done), std::move(conn->on_event)};
+    int tries = conn->tries;
+    Destroy(conn);
+    Dispatch(request, tries);
+}
+
+void UpstreamPool::StartProbe(int upstream, size_t server) {
+    Server& target = upstreams_[upstream].servers[server];
+    target.check_at = Clock::now() + std::chrono::milliseconds(upstreams_[upstream].check_ms);
+    if (!Connect(upstream, server, UpstreamConnect::PROBE_CONNECT)) {
+        MarkFailed(upstreams_[upstream], target, true);
+        return;
+    }
+    target.probing = true;
+}
+
+void UpstreamPool::OnProbe(UpstreamConnect* conn, uint32_t events) {
+    const Upstream& upstream = upstreams_[conn->upstream];
+    if (conn->stage == UpstreamConnect::PROBE_CONNECT) {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if ((events & (EPOLLERR | EPOLLHUP)) ||
+            getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0) {
+            EndProbe(conn, false);
+            return;
+        }
+        if (upstream.check_path.empty()) {
+            EndProbe(conn, true);
+            return;
+        }
+        std::string request = "GET " + upstream.check_path + " HTTP/1.1\r\nHost: " +
+                              upstream.servers[conn->server].name + "\r\nConnection: close\r\n\r\n";
+        // 新连接的发送缓冲区是空的，短请求一次写完
+        if (send(conn->fd, request.data(), request.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(request.size())) {
+            EndProbe(conn, false);
+            return;
+        }
+        conn->stage = UpstreamConnect::PROBE_READ;
+        epoller_->ModFd(conn->fd, EPOLLIN | EPOLLONESHOT | EPOLLRDHUP, conn->tag);
+        return;
+    }
+    // HTTP/1.1 200 OK
+    char buf[MAX_PROBE_READ];
+    ssize_t len = recv(conn->fd, buf, MAX_PROBE_READ - conn->probe.size(), 0);
+    if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        epoller_->ModFd(conn->fd, EPOLLIN | EPOLLONESHOT | EPOLLRDHUP, conn->tag);
+        return;
+    }
+    if (len > 0)
+        conn->probe.append(buf, len);
+    const std::string& head = conn->probe;
+    size_t line = head.find("\r\n");
+    if (line == std::string::npos && len > 0 && head.size() < MAX_PROBE_READ) {
+        epoller_->ModFd(conn->fd, EPOLLIN | EPOLLONESHOT | EPOLLRDHUP, conn->tag);
+        return;
+    }
+    bool ok = head.size() >= 12 && head.compare(0, 7, "HTTP/1.") == 0 && head[8] == ' ' &&
+              (head[9] == '2' || head[9] == '3') && isdigit(head[10]) && isdigit(head[11]);
+    EndProbe(conn, ok);
+}
+
+void UpstreamPool::EndProbe(UpstreamConnect* conn, bool ok) {
+    Upstream& upstream = upstreams_[conn->upstream];
+    Server& server = upstream.servers[conn->server];
+    server.probing = false;
+    server.check_at = Clock::now() + std::chrono::milliseconds(upstream.check_ms);
+    pending_.erase(std::find(pending_.begin(), pending_.end(), conn));
+    Destroy(conn);
+    if (!ok) {
+        MarkFailed(upstream, server, true);
+        return;
+    }
+    if (!server.healthy) {
+        LOG_INFO("Upstream server %s recovered", server.name.c_str());
+    }
+    server.healthy = true;
+    server.fails = 0;
+}
+
+// 暂停使用时关闭它的空闲连接，它们多半也已经不能用了
+void UpstreamPool::MarkFailed(const Upstream& upstream, Server& server, bool down) {
+    server.fails++;
+    if (!server.healthy || (!down && server.fails < MAX_FAILS))
+        return;
+    LOG_WARN("Upstream server %s down after %d failures", server.name.c_str(), server.fails);
+    server.healthy = false;
+    if (!server.probing) // 暂停后过一个检查周期再试
+        server.check_at = Clock::now() + std::chrono::milliseconds(upstream.check_ms);
+    while (!server.idle.empty()) {
+        UpstreamConnect* conn = server.idle.back();
+        server.idle.pop_back();
+        Destroy(conn);
+    }
+}
+
+// conn 已不在 pending_ 和空闲池中
+void UpstreamPool::Destroy(UpstreamConnect* conn) {
+    int fd = conn->fd;
+    epoller_->DelFd(fd);
+    close(fd);
+    conns_.erase(fd);
+}
+
+void UpstreamPool::Expire(Clock::time_point now) {
+    std::vector<UpstreamConnect*> expired;
+    for (UpstreamConnect* conn : pending_) {
+        if (conn->deadline <= now)
+            expired.push_back(conn);
+    }
+    for (UpstreamConnect* conn : expired) {
+        if (conn->stage == UpstreamConnect::CONNECT) {
+            OnConnected(conn, false);
+        } else {
+            EndProbe(conn, false);
+        }
+    }
+    for (size_t i = 0; i < upstreams_.size(); ++i) {
+        Upstream& upstream = upstreams_[i];
+        for (size_t j = 0; j < upstream.servers.size(); ++j) {
+            Server& server = upstream.servers[j];
+            while (!server.idle.empty() &&
+                   server.idle.front()->deadline + std::chrono::milliseconds(idle_timeout_ms_) <= now) {
+                UpstreamConnect* conn = server.idle.front();
+                server.idle.pop_front();
+                Destroy(conn);
+            }
+            // 没有检查路径时只检查暂停的服务器，正常的靠请求的结果判断
+            if (!server.probing && server.check_at <= now && (!upstream.check_path.empty() || !server.healthy))
+                StartProbe(i, j);
+        }
+    }
+}
+
+int UpstreamPool::GetNextTick() {
+    if (upstreams_.empty() || epoller_ == nullptr)
+        return -1;
+    Clock::time_point now = Clock::now();
+    Expire(now);
+    Clock::time_point next = Clock::time_point::max();
+    for (const UpstreamConnect* conn : pending_)
+        next = std::min(next, conn->deadline);
+    for (const Upstream& upstream : upstreams_) {
+        for (const Server& server : upstream.servers) {
+            if (!server.idle.empty())
+                next = std::min(next, server.idle.front()->deadline + std::chrono::milliseconds(idle_timeout_ms_));
+            if (!server.probing && (!upstream.check_path.empty() || !server.healthy))
+                next = std::min(next, server.check_at);
+        }
+    }
+    if (next == Clock::time_point::max())
+        return -1;
+    // 向上取整，避免在到期前的最后一毫秒内反复以 0 唤醒
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(next - now + std::chrono::microseconds(999));
+    return static_cast<int>(std::max<int64_t>(ms.count(), 0));
+}
+
+bool UpstreamPool::IsHealthy(int upstream, size_t server) const {
+    return upstreams_[upstream].servers[server].healthy;
+}
+
+size_t UpstreamPool::IdleCount(int upstream, size_t server) const {
+    return upstreams_[upstream].servers[server].idle.size();
+}
@@ -0,0 +1,163 @@
+#ifndef UPSTREAM_POOL_H
+#define UPSTREAM_POOL_H
+
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <chrono>
+#include <unordered_map>
+
+#include "../log/log.h"
+#include "../server/epoller.h"
+
+// 上游服务器的一个连接；租出期间 fd、tag 和 requests 由持有它的线程使用，其余字段只在主线程访问
+struct UpstreamConnect {
+    enum STAGE {
+        CONNECT,       // 等待非阻塞 connect 完成，完成后交给等待的请求
+        IDLE,          // 在空闲池中，只关心上游断开
+        LEASED,        // 租给了一个请求，事件交给它处理
+        PROBE_CONNECT, // 健康检查：等待 connect 完成
+        PROBE_READ     // 健康检查：请求已发出，等待状态行
+    };
+
+    int fd;
+    uint32_t tag;      // 注册 epoll 时的 tag，与 fd 一起识别 fd 被复用前的旧事件
+    int upstream;
+    size_t server;
+    int requests;      // 已在这个连接上完成的请求数，大于 0 时为复用的连接
+
+    STAGE stage;
+    std::chrono::steady_clock::time_point deadline; // CONNECT/PROBE_* 的超时，IDLE 的空闲起点
+    std::function<void(UpstreamConnect* conn)> done; // CONNECT 完成后交给的请求
+    std::function<void()> on_event;                 // LEASED 期间的事件
+    int tries;                                      // CONNECT 的请求已尝试过的服务器数
+    std::string probe;                              // 健康检查读到的响应开头
+};
+
+// 反向代理的上游服务器组和保持连接的连接池
+// 上游连接的 socket 注册在主线程的 Epoller 中：建连、空闲连接的断开检测和健康检查都在主线程上完成；
+// 租出的连接由持有它的请求在工作线程上读写，事件通过 on_event 交回给它
+// 每个请求先取同一服务器上最近放回的空闲连接，没有时才建立新连接，响应完整的连接放回空闲池，
+// 请求之间不再有 TCP 握手
+// 服务器按轮询或最少连接选择；建连失败或连续出错的服务器暂停使用，由定期的健康检查
+// （TCP 建连，或者 GET 一个路径要求 2xx/3xx）恢复；设置了检查路径时正常的服务器也定期检查
+class UpstreamPool {
+public:
+    enum BALANCE {
+        ROUND_ROBIN, // 依次轮流
+        LEAST_CONN   // 租出的连接最少的服务器，相同时轮流
+    };
+    enum RELEASE {
+        REUSE, // 响应完整，连接放回空闲池
+        CLOSE, // 连接状态未知（如客户端中途断开），关闭，不算上游的错误
+        FAIL   // 上游出错（断开、响应格式错误），关闭并计入服务器的失败次数
+    };
+    // 分到的连接，没有可用的服务器时为 nullptr；在主线程上调用，应尽快返回
+    using Callback = std::function<void(UpstreamConnect* conn)>;
+    // 租出的连接上有事件，在主线程上调用
+    using EventCallback = std::function<void()>;
+
+    static UpstreamPool* instance();
+
+    // servers 为 "host:port"，host 可以是域名（此时同步解析）；返回上游的编号，地址无效时返回 -1
+    // 在 start 之前调用
+    int Add(const std::vector<std::string>& servers, BALANCE balance = ROUND_ROBIN);
+    // path 为空时只检查能否建立 TCP 连接，且只检查已暂停的服务器；interval_ms 为检查周期
+    bool SetHealthCheck(int upstream, const std::string& path, int interval_ms);
+    // 每个服务器最多保留 max_idle 个空闲连接，空闲超过 idle_timeout_ms 的关闭
+    void SetKeepAlive(size_t max_idle, int idle_timeout_ms);
+    void SetConnectTimeout(int timeout_ms) { connect_timeout_ms_ = timeout_ms; }
+    void Attach(Epoller* epoller); // 注册唤醒 fd
+    void ClosePool();
+
+    // 线程安全，可在任意线程调用；连接池不可用时 done 在当前线程上以 nullptr 立即执行
+    // on_event 在连接租出期间的事件到达时调用，由持有者按需重新注册 EPOLLONESHOT 的事件
+    void Acquire(int upstream, Callback done, EventCallback on_event);
+    void Release(UpstreamConnect* conn, RELEASE how);
+    const std::string& ServerName(const UpstreamConnect* conn) const; // "host:port"，服务器在 start 之后不再变化
+
+    // 以下只在主线程调用
+    bool Owns(int fd) const; // fd 是否属于本连接池（唤醒 fd 或上游连接）
+    void OnEvent(int fd, uint32_t events, uint32_t tag);
+    // 处理建连超时、空闲超时和健康检查，返回距下次需要处理的毫秒数，-1 表示不需要
+    int GetNextTick();
+    bool IsHealthy(int upstream, size_t server) const;
+    size_t IdleCount(int upstream, size_t server) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static const int DEFAULT_CHECK_MS = 5000;   // 默认的健康检查周期
+    static const int MAX_FAILS = 3;             // 连续出错多少次后暂停使用，建连失败立即暂停
+    static const size_t MAX_PROBE_READ = 64;    // 健康检查只读状态行的开头
+
+    UpstreamPool();
+    ~UpstreamPool() {
+        ClosePool();
+    }
+
+    struct Server {
+        std::string name; // "host:port"，用于日志和 Host 头部
+        sockaddr_in addr;
+        bool healthy;
+        int fails;        // 连续出错的次数
+        int active;       // 租出和正在为请求建立的连接数
+        std::deque<UpstreamConnect*> idle; // 最近放回的在后面，从后面取，超时的从前面关闭
+        bool probing;
+        Clock::time_point check_at; // 下次健康检查的时间
+    };
+
+    struct Upstream {
+        std::vector<Server> servers;
+        BALANCE balance;
+        size_t next;        // 轮询的下一个服务器
+        std::string check_path;
+        int check_ms;
+    };
+
+    struct Request {
+        int upstream;
+        Callback done;
+        EventCallback on_event;
+    };
+
+    void OnWakeup();
+    void Dispatch(Request& request, int tries);
+    int Pick(Upstream& upstream); // 没有可用的服务器时返回 -1
+    void Lease(UpstreamConnect* conn, Callback done, EventCallback on_event);
+    void PutBack(UpstreamConnect* conn, RELEASE how);
+    UpstreamConnect* Connect(int upstream, size_t server, UpstreamConnect::STAGE stage);
+    void OnConnected(UpstreamConnect* conn, bool ok);
+    void StartProbe(int upstream, size_t server);
+    void OnProbe(UpstreamConnect* conn, uint32_t events);
+    void EndProbe(UpstreamConnect* conn, bool ok);
+    void MarkFailed(const Upstream& upstream, Server& server, bool down);
+    void Destroy(UpstreamConnect* conn);
+    void Expire(Clock::time_point now);
+    static bool Resolve(const std::string& host, int port, sockaddr_in* addr);
+
+    std::vector<Upstream> upstreams_; //只在 start 之前修改
+    std::unordered_map<int, std::unique_ptr<UpstreamConnect>> conns_; //fd -> 连接，只在主线程访问
+    std::vector<UpstreamConnect*> pending_; //CONNECT/PROBE_* 的连接，检查超时
+
+    std::mutex mtx_;
+    std::vector<Request> incoming_; //其他线程提交、尚未被主线程取走的请求
+    std::vector<std::pair<UpstreamConnect*, RELEASE>> released_; //其他线程放回的连接
+    int wake_fd_; //eventfd，提交后唤醒主线程
+    Epoller* epoller_;
+
+    size_t max_idle_;
+    int idle_timeout_ms_;
+    int connect_timeout_ms_;
+    uint32_t next_tag_;
+};
+
+#endif // UPSTREAM_POOL_H
@@ -0,0 +1,87 @@
+#ifndef WAIT_HISTOGRAM_H
+#define WAIT_HISTOGRAM_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+
+// 等待时间直方图（微秒），按 2 的幂分桶，记录无锁
+// 桶 0 为 [0, 1us)，桶 i 为 [2^(i-1), 2^i) us，最后一个桶收纳所有更长的等待
+class WaitHistogram {
+public:
+    static const int BUCKET_COUNT = 24; // 最后一个桶从约 4s 开始
+
+    WaitHistogram() { Reset(); }
+
+    void Record(int64_t wait_us) {
+        int bucket = 0;
+        while (bucket < BUCKET_COUNT - 1 && wait_us >= (int64_t(1) << bucket))
+            ++bucket;
+        buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Reset() {
+        for (auto& bucket : buckets_)
+            bucket.store(0, std::memory_order_relaxed);
+    }
+
+    std::vector<uint64_t> Snapshot() const {
+        std::vector<uint64_t> counts(BUCKET_COUNT);
+        for (int i = 0; i < BUCKET_COUNT; ++i)
+            counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        return counts;
+    }
+
+    uint64_t Count() const {
+        uint64_t total = 0;
+        for (const auto& bucket : buckets_)
+            total += bucket.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    // 桶的上界（微秒），最后一个桶返回 -1 表示无上界
+    static int64_t BucketLimit(int bucket) {
+        return bucket >= BUCKET_COUNT - 1 ? -1 : (int64_t(1) << bucket);
+    }
+
+    // 第 p 百分位所在桶的上界，没有记录时返回 0
+    static int64_t Percentile(const std::vector<uint64_t>& counts, double p) {
+        uint64_t total = 0;
+        for (uint64_t count : counts)
+            total += count;
+        if (total == 0)
+            return 0;
+        uint64_t target = static_cast<uint64_t>(total * p / 100.0 + 0.5);
+        if (target == 0)
+            target = 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            seen += counts[i];
+            if (seen >= target)
+                return BucketLimit(i);
+        }
+        return -1;
+    }
+
+    // 用于日志的摘要，如 "n=120 p50<=8us p99<=1024us"
+    std::string Summary() const {
+        std::vector<uint64_t> counts = Snapshot();
+        uint64_t total = 0;
+        for (uint64_t count : counts)
+            total += count;
+        char buf[128];
+        snprintf(buf, sizeof(buf), "n=%llu p50<=%lldus p90<=%lldus p99<=%lldus",
+                 static_cast<unsigned long long>(total),
+                 static_cast<long long>(Percentile(counts, 50)),
+                 static_cast<long long>(Percentile(counts, 90)),
+                 static_cast<long long>(Percentile(counts, 99)));
+        return buf;
+    }
+
+private:
+    std::atomic<uint64_t> buckets_[BUCKET_COUNT];
+};
+
+#endif // WAIT_HISTOGRAM_H
@@ -0,0 +1,15 @@
+#include "connect_table.h"
+
+ConnectTable::ConnectTable(int max_fd)
+    : max_fd_(max_fd), pages_((max_fd + PAGE_SLOTS - 1) / PAGE_SLOTS) {
+    assert(max_fd > 0);
+}
+
+HttpConnect* ConnectTable::Acquire(int fd) {
+    if (fd < 0 || fd >= max_fd_)
+        return nullptr;
+    std::unique_ptr<Slot[]>& page = pages_[fd / PAGE_SLOTS];
+    if (!page)
+        page.reset(new Slot[PAGE_SLOTS]); // C++17 的 new 按 alignof(Slot) 对齐
+    return &page[fd % PAGE_SLOTS].conn;
+}
@@ -0,0 +1,44 @@
+#ifndef CONNECT_TABLE_H
+#define CONNECT_TABLE_H
+
+#include <vector>
+#include <memory>
+#include <cassert>
+
+#include "../http/http_connect.h"
+
+// 以 fd 为下标的连接表，代替 unordered_map<int, HttpConnect>
+// 按页分配，页一旦分配就不再移动或释放，工作线程持有的 HttpConnect* 始终有效；
+// 页在其中第一个 fd 接入时才分配，不在启动时为 max_fd 个槽位全部预分配，
+// 每个 HttpConnect 自带读写缓冲区，只用到少量 fd 时不必占用整张表的内存；
+// 每个槽位按缓存行对齐，相邻连接不会在同一缓存行上伪共享
+// 只在主线程查找和分配
+class ConnectTable {
+public:
+    explicit ConnectTable(int max_fd);
+
+    ConnectTable(const ConnectTable&) = delete;
+    ConnectTable& operator=(const ConnectTable&) = delete;
+
+    // fd 越界或所在页还未分配时返回 nullptr
+    HttpConnect* Get(int fd) const {
+        if (fd < 0 || fd >= max_fd_)
+            return nullptr;
+        const std::unique_ptr<Slot[]>& page = pages_[fd / PAGE_SLOTS];
+        return page ? &page[fd % PAGE_SLOTS].conn : nullptr;
+    }
+    HttpConnect* Acquire(int fd); // 同 Get，按需分配 fd 所在的页
+    int MaxFd() const { return max_fd_; }
+
+private:
+    static const int PAGE_SLOTS = 256; // 每页的槽位数
+
+    struct alignas(64) Slot {
+        HttpConnect conn;
+    };
+
+    int max_fd_;
+    std::vector<std::unique_ptr<Slot[]>> pages_;
+};
+
+#endif // CONNECT_TABLE_H
@@ -9,22 +9,22 @@ Epoller::~Epoller() {
     close(epoll_fd_);
 }
 
-bool Epoller::AddFd(int fd, uint32_t events) {
+bool Epoller::AddFd(int fd, uint32_t events, uint32_t tag) {
     if (fd < 0)
         return false;
     epoll_event ev;
     memset(&ev, 0, sizeof(epoll_event));
-    ev.data.fd = fd;
+    ev.data.u64 = (static_cast<uint64_t>(tag) << 32) | static_cast<uint32_t>(fd);
     ev.events = events;
     return epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == 0;
 }
 
-bool Epoller::ModFd(int fd, uint32_t events) {
+bool Epoller::ModFd(int fd, uint32_t events, uint32_t tag) {
     if (fd < 0)
         return false;
     epoll_event ev;
     memset(&ev, 0, sizeof(epoll_event));
-    ev.data.fd = fd;
+    ev.data.u64 = (static_cast<uint64_t>(tag) << 32) | static_cast<uint32_t>(fd);
     ev.events = events;
     return epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev) == 0;
 }
@@ -32,7 +32,7 @@ bool Epoller::ModFd(int fd, uint32_t events) {
 bool Epoller::DelFd(int fd) {
     if (fd < 0)
         return false;
-    return epoll_ctl(fd, EPOLL_CTL_DEL, fd, 0) == 0;
+    return epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, 0) == 0;
 }
 
 int Epoller::Wait(int timeout_ms) {
@@ -41,7 +41,12 @@ int Epoller::Wait(int timeout_ms) {
 
 int Epoller::GetEventsFd(size_t i) const {
     assert(i < events_.size());
-    return events_[i].data.fd;
+    return static_cast<int>(events_[i].data.u64 & 0xffffffff);
+}
+
+uint32_t Epoller::GetEventsTag(size_t i) const {
+    assert(i < events_.size());
+    return static_cast<uint32_t>(events_[i].data.u64 >> 32);
 }
 
 uint32_t Epoller::GetEvents(size_t i) const {
@@ -12,11 +12,13 @@ public:
     explicit Epoller(int max_event = 1024);
     ~Epoller();
 
-    bool AddFd(int fd, uint32_t events);
-    bool ModFd(int fd, uint32_t events);
+    // tag 和 fd 一起保存在事件中，用来识别 fd 被关闭并复用后才收到的旧事件
+    bool AddFd(int fd, uint32_t events, uint32_t tag = 0);
+    bool ModFd(int fd, uint32_t events, uint32_t tag = 0);
     bool DelFd(int fd);
     int Wait(int timeout_ms = -1);
     int GetEventsFd(size_t i) const;
+    uint32_t GetEventsTag(size_t i) const;
     uint32_t GetEvents(size_t i) const;
 
 private:
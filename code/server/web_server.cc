@@ -3,13 +3,15 @@
 WebServer::WebServer(int port, int trigger_mode, int timeout_ms,
                      int sql_port, const char* sql_user, const char* sql_pwd,
                      const char* db_name, int conn_pool_num, int thread_num, 
-                     bool open_log, int log_level, int log_que_size) 
-                     : port_(port), timeout_ms_(timeout_ms), is_close_(false), 
+                     bool open_log, int log_level, int log_que_size, bool log_binary,
+                     int user_store, const char* sql_host) 
+                     : port_(port), timeout_ms_(timeout_ms), is_close_(false), accept_batch_(64),
                        timer_(new HeapTimer()), thread_pool_(new ThreadPool(thread_num)), 
-                       epoller_(new Epoller()) {
+                       epoller_(new Epoller()), users_(MAX_FD) {
     // 初始化日志
     if(open_log) {
-        Log::GetInstance()->Init(log_level, "./logs/", ".log", log_que_size);
+        Log::GetInstance()->Init(log_level, "./logs/", log_binary ? ".blog" : ".log",
+                                 log_que_size, log_binary);
         fprintf(stderr, "Log initialized, IsOpen=%d, level=%d\n", Log::GetInstance()->IsOpen(), Log::GetInstance()->GetLevel());
         LOG_DEBUG("测试日志系统是否工作"); 
         Log::GetInstance()->Write(0, "直接测试写入");
@@ -23,17 +25,27 @@ WebServer::WebServer(int port, int trigger_mode, int timeout_ms,
                     (conn_event_ & EPOLLET) ? "ET" : "LT");
             LOG_INFO("LogSys level: %d", log_level);
             LOG_INFO("src_dir: %s", HttpConnect::src_dir);
-            LOG_INFO("SqlConnectPool num: %d, ThreadPool num: %d", conn_pool_num, thread_num);
+            LOG_INFO("AsyncSqlPool num: %d, ThreadPool num: %d", conn_pool_num, thread_num);
             fprintf(stderr, "Log initialized, IsOpen=%d, level=%d\n", Log::GetInstance()->IsOpen(), Log::GetInstance()->GetLevel());
         }
     }
     HttpConnect::use_count = 0;
+    // writev 和 OpenSSL 发送告警都不能带 MSG_NOSIGNAL，WebSocket 的推送也常常写到已断开的对端，
+    // 忽略 SIGPIPE，由返回的 EPIPE 关闭连接
+    signal(SIGPIPE, SIG_IGN);
     src_dir_ = getcwd(nullptr, 256); // 获取当前工作目录
     assert(src_dir_);
     strcat(src_dir_, "/resources/");
     HttpConnect::src_dir = src_dir_;
+    HttpConnect::AddDefaultRoutes(Router::instance());
+    HttpConnect::on_wake = [this](HttpConnect* client, uint32_t serial) {
+        thread_pool_->AddTask(std::bind(&WebServer::OnWake, this, client, serial));
+    };
+    SetKeepAlive(HttpConnect::max_requests, timeout_ms_);
 
-    SqlConnectPool::instance()->Init("localhost", sql_port, sql_user, sql_pwd, db_name, conn_pool_num);
+    InitUserStore(user_store, sql_host, sql_port, sql_user, sql_pwd, db_name, conn_pool_num);
+    PasswordHasher::instance()->Init(); // 密码哈希使用独立的线程池
+    UpstreamPool::instance()->Attach(epoller_.get());
     InitEventMode(trigger_mode);
     if(!InitSocker()){
         is_close_ = true;
@@ -44,7 +56,8 @@ WebServer::~WebServer(){
     close(listen_fd_);
     is_close_ = true;
     free(src_dir_);
-    SqlConnectPool::instance()->ClosePool();
+    AsyncSqlPool::instance()->ClosePool();
+    UpstreamPool::instance()->ClosePool();
 }
 
 void WebServer::start(){
@@ -52,9 +65,20 @@ void WebServer::start(){
     if(!is_close_){
         LOG_INFO("============== Server Start ==============");}
     while(!is_close_){
+        time_ms = -1;
         if (timeout_ms_ > 0) {
             time_ms = timer_->GetNextTick();  
         }  
+        // 数据库连接池的排队超时、重连和 ping 也在主线程上处理
+        int sql_ms = AsyncSqlPool::instance()->GetNextTick();
+        if (sql_ms >= 0 && (time_ms < 0 || sql_ms < time_ms)) {
+            time_ms = sql_ms;
+        }
+        // 上游的建连超时、空闲连接和健康检查同样如此
+        int upstream_ms = UpstreamPool::instance()->GetNextTick();
+        if (upstream_ms >= 0 && (time_ms < 0 || upstream_ms < time_ms)) {
+            time_ms = upstream_ms;
+        }
         int event_count = epoller_->Wait(time_ms);
         for(int i = 0; i < event_count; ++i){
             int fd = epoller_->GetEventsFd(i);
@@ -62,17 +86,36 @@ void WebServer::start(){
             if(fd == listen_fd_){ // 处理新连接
                 DealListen();
             }
-            else if(events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)){ // 处理异常事件
-                assert(users_.count(fd) > 0);
-                CloseConn(&users_[fd]);
+            else if(AsyncSqlPool::instance()->Owns(fd)){ // 推进数据库查询
+                AsyncSqlPool::instance()->OnEvent(fd, events);
             }
-            else if(events & EPOLLIN){ // 处理读事件
-                assert(users_.count(fd) > 0);
-                DealRead(&users_[fd]);
+            else if(UpstreamPool::instance()->Owns(fd)){ // 上游连接，租出的连接的事件交给转发的客户端
+                UpstreamPool::instance()->OnEvent(fd, events, epoller_->GetEventsTag(i));
             }
-            else if(events & EPOLLOUT){ // 处理写事件
-                assert(users_.count(fd) > 0);
-                DealWrite(&users_[fd]);
+            else {
+                HttpConnect* client = users_.Get(fd);
+                assert(client);
+                // 同一批事件中 fd 可能已被关闭并分配给新连接，代数不符的是旧连接的事件
+                if(client->IsClose() || client->Serial() != epoller_->GetEventsTag(i)){
+                    continue;
+                }
+                // WebSocket 连接被其他线程的消息唤醒、正在工作线程上处理时，事件由它处理完后重新注册
+                bool hangup = events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR);
+                if(!client->Unpark(hangup, !(events & EPOLLIN))){
+                    continue;
+                }
+                if(hangup){ // 处理异常事件
+                    CloseConn(client);
+                }
+                else if(client->IsForwarding()){ // 转发中等待的客户端事件
+                    DealForward(client);
+                }
+                else if(events & EPOLLIN){ // 处理读事件
+                    DealRead(client);
+                }
+                else if(events & EPOLLOUT){ // 处理写事件
+                    DealWrite(client);
+                }
             }
         }
     }
@@ -82,7 +125,22 @@ void WebServer::start(){
 
 int WebServer::SetFdNonBlock(int fd) {
     assert(fd > 0);
-    return fcntl(fd, F_SETFL, fcntl(fd, F_GETFD, 0) | O_NONBLOCK);
+    return fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+// Linux 上 accept 得到的 socket 继承监听 socket 的这些选项，设置在监听 socket 上一次即可，
+// 每个新连接不再需要额外的 setsockopt
+void WebServer::SetSocketOptions(int fd) {
+    int on = 1;
+    int idle = KEEPALIVE_IDLE_S, intvl = KEEPALIVE_INTVL_S, cnt = KEEPALIVE_CNT;
+    // 响应一次 writev 写出，关闭 Nagle 避免与对端的延迟确认叠加出 40ms 的延迟
+    if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)) < 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on)) < 0 ||
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle)) < 0 ||
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &intvl, sizeof(intvl)) < 0 ||
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &cnt, sizeof(cnt)) < 0) {
+        LOG_WARN("Set socket options error: %s", strerror(errno));
+    }
 }
 
 
@@ -113,7 +171,9 @@ bool WebServer::InitSocker(){
         return false;
     }
 
-    ret = listen(listen_fd_, 8);
+    SetSocketOptions(listen_fd_);
+
+    ret = listen(listen_fd_, SOMAXCONN); // 突发连接时不因队列太短而被丢弃
     if(ret < 0){
         LOG_ERROR("Listen port: %d error!", port_);
         close(listen_fd_);
@@ -132,6 +192,99 @@ bool WebServer::InitSocker(){
     return true;
 }
 
+// SQLite 时 db_name 为数据库文件路径，不连接 MySQL
+void WebServer::InitUserStore(int user_store, const char* sql_host, int sql_port,
+                              const char* sql_user, const char* sql_pwd,
+                              const char* db_name, int conn_pool_num) {
+    std::unique_ptr<UserStore> store;
+    if (user_store == USER_STORE_SQLITE) {
+        SqliteUserStore* sqlite = new SqliteUserStore(db_name);
+        store.reset(sqlite);
+        if (!sqlite->IsOpen()) {
+            LOG_ERROR("SQLite user store init fail!");
+            is_close_ = true;
+        }
+    } else {
+        // 查询排队时最多扩容到两倍，空闲后收缩回 conn_pool_num
+        AsyncSqlPool::instance()->Init(sql_host, sql_port, sql_user, sql_pwd, db_name, conn_pool_num,
+                                       conn_pool_num * 2);
+        AsyncSqlPool::instance()->Attach(epoller_.get());
+        store.reset(new MysqlUserStore());
+    }
+    // 注册写入合并成批，整批只提交一次
+    UserStore::Install(std::unique_ptr<UserStore>(new BatchUserStore(std::move(store))));
+}
+
+void WebServer::AddSqlReplica(const char* host, int port, int conn_num) {
+    AsyncSqlPool::instance()->AddReplica(host, port, conn_num, conn_num * 2);
+}
+
+bool WebServer::EnableUpload(const std::string& dir, std::string_view pattern) {
+    if (!HttpUpload::SetDir(dir))
+        return false;
+    char* real = realpath(HttpUpload::upload_dir.c_str(), nullptr);
+    if (real != nullptr) {
+        std::string path = std::string(real) + "/";
+        if (path.compare(0, strlen(src_dir_), src_dir_) == 0)
+            LOG_WARN("Upload dir %s is inside %s, uploaded files are public", real, src_dir_);
+        free(real);
+    }
+    return AddRoute("POST", pattern, HttpConnect::UploadRoute(), Router::STREAM_BODY);
+}
+
+void WebServer::SetKeepAlive(int max_requests, int idle_timeout_ms) {
+    HttpConnect::max_requests = max_requests > 0 ? max_requests : 0;
+    // 没有定时器时不会关闭空闲连接，响应头中也不写超时
+    if (timeout_ms_ <= 0)
+        idle_timeout_ms = 0;
+    else if (idle_timeout_ms <= 0 || idle_timeout_ms > timeout_ms_)
+        idle_timeout_ms = timeout_ms_;
+    HttpConnect::keep_alive_timeout_ms = idle_timeout_ms;
+}
+
+// 只建连不发数据的客户端（如端口扫描）不再占用 HttpConnect、定时器和 epoll 注册；
+// 数据到达时请求已在接收缓冲区中，accept 之后的第一次读就能拿到
+bool WebServer::SetDeferAccept(int timeout_s) {
+    if (setsockopt(listen_fd_, IPPROTO_TCP, TCP_DEFER_ACCEPT, &timeout_s, sizeof(timeout_s)) < 0) {
+        LOG_WARN("Set TCP_DEFER_ACCEPT error: %s", strerror(errno));
+        return false;
+    }
+    LOG_INFO("TCP_DEFER_ACCEPT: %ds", timeout_s);
+    return true;
+}
+
+// 带有 cookie 的回访客户端可以把请求放在 SYN 里，省去一个 RTT
+bool WebServer::SetFastOpen(int queue_len) {
+    if (setsockopt(listen_fd_, IPPROTO_TCP, TCP_FASTOPEN, &queue_len, sizeof(queue_len)) < 0) {
+        LOG_WARN("Set TCP_FASTOPEN error: %s", strerror(errno));
+        return false;
+    }
+    // 服务端 TFO 还需要 net.ipv4.tcp_fastopen 打开第 2 位（值为 2 或 3）
+    int mode = 0;
+    FILE* fp = fopen("/proc/sys/net/ipv4/tcp_fastopen", "r");
+    if (fp) {
+        if (fscanf(fp, "%d", &mode) != 1)
+            mode = 0;
+        fclose(fp);
+    }
+    if (queue_len > 0 && !(mode & 2)) {
+        LOG_WARN("TCP_FASTOPEN: net.ipv4.tcp_fastopen=%d, server side is disabled by the kernel", mode);
+    }
+    LOG_INFO("TCP_FASTOPEN queue: %d", queue_len);
+    return true;
+}
+
+bool WebServer::SetTls(const std::string& cert_file, const std::string& key_file, bool ktls) {
+    return TlsContext::instance()->Init(cert_file, key_file, ktls);
+}
+
+void WebServer::SetWebSocket(int ping_interval_ms, size_t max_message_size) {
+    if (ping_interval_ms > 0)
+        WebSocket::ping_interval_ms = ping_interval_ms;
+    if (max_message_size > 0)
+        WebSocket::max_message_size = max_message_size;
+}
+
 void WebServer::InitEventMode(int trigger_mode) {
     listen_event_ = EPOLLRDHUP; // 检测socket关闭
     conn_event_ = EPOLLONESHOT | EPOLLRDHUP; // EPOLLONESHOT由一个线程处理
@@ -158,39 +311,56 @@ void WebServer::InitEventMode(int trigger_mode) {
 
 void WebServer::AddClient(int fd, sockaddr_in addr) {
     assert(fd > 0);
-    users_[fd].Init(fd, addr);
+    HttpConnect* client = users_.Acquire(fd);
+    assert(client);
+    client->Init(fd, addr);
     if (timeout_ms_ > 0) {
-        timer_->Add(fd, timeout_ms_, std::bind(&WebServer::CloseConn, this, &users_[fd]));
+        timer_->Add(fd, timeout_ms_, std::bind(&WebServer::OnTimeout, this, client));
     }
-    epoller_->AddFd(fd, EPOLLIN | conn_event_);
-    SetFdNonBlock(fd);
-    LOG_INFO("Client[%d] in!", users_[fd].GetFd());
+    epoller_->AddFd(fd, EPOLLIN | conn_event_, client->Serial()); // fd 在 accept4 时已设为非阻塞
+    LOG_INFO("Client[%d] in!", client->GetFd());
 }
 
+// 每次唤醒最多取 accept_batch_ 个连接，避免连接风暴时长时间占住主线程
 void WebServer::DealListen() {
     struct sockaddr_in addr;
-    socklen_t len = sizeof(addr);
-    do {
-        int fd = accept(listen_fd_, (sockaddr*)&addr, &len);
-        if (fd <= 0) { return; }
-        else if (HttpConnect::use_count >= MAX_FD) {
+    for (int i = 0; i < accept_batch_; ++i) {
+        socklen_t len = sizeof(addr);
+        // 直接得到非阻塞、exec 时关闭的 fd，省去两次 fcntl
+        int fd = accept4(listen_fd_, (sockaddr*)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) // 对端在 accept 前已断开
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_WARN("Accept error: %s", strerror(errno));
+            }
+            return; // 已取完
+        }
+        if (HttpConnect::use_count >= MAX_FD || fd >= users_.MaxFd()) {
             SendError(fd, "Server busy!");
             LOG_WARN("Clients is full!");
-            return;
+            continue;
         }
         AddClient(fd, addr);
-    } while (listen_event_ & EPOLLET);
+    }
+    // 达到上限时可能还有未取的连接；边沿触发下重新注册，下一轮 epoll_wait 会再次报告
+    if (listen_event_ & EPOLLET) {
+        epoller_->ModFd(listen_fd_, listen_event_ | EPOLLIN);
+    }
 }
 
 void WebServer::DealRead(HttpConnect* client) {
     assert(client);
-    ExtendTime(client);
+    ExtendTime(client, client->IsWebSocket() ? WebSocket::ping_interval_ms : timeout_ms_);
     thread_pool_->AddTask(std::bind(&WebServer::OnRead, this, client));
 }
 
+// 写完后保持的连接进入空闲，按较短的空闲超时计时；写不完时下次 DealWrite 再延长
+// WebSocket 连接空闲时按 ping 间隔计时
 void WebServer::DealWrite(HttpConnect* client) {
     assert(client);
-    ExtendTime(client);
+    int timeout_ms = client->IsKeepAlive() ? HttpConnect::keep_alive_timeout_ms : timeout_ms_;
+    ExtendTime(client, client->IsWebSocket() ? WebSocket::ping_interval_ms : timeout_ms);
     thread_pool_->AddTask(std::bind(&WebServer::OnWrite, this, client));
 }
 
@@ -207,10 +377,123 @@ void WebServer::OnRead(HttpConnect* client) {
 }
 
 void WebServer::OnProcess(HttpConnect* client) {
-    if (client->Process()) {
-        epoller_->ModFd(client->GetFd(), conn_event_ | EPOLLOUT); // 监听写
+    while (true) {
+        if (client->Process()) {
+            Rearm(client, EPOLLOUT, false); // 监听写
+        } else if (client->IsForwarding()) {
+            Forward(client); // 先租用上游连接，EPOLLONESHOT 下暂不重新注册事件
+        } else if (client->IsSuspended()) {
+            Suspend(client); // 等待数据库，EPOLLONESHOT 下暂不重新注册事件
+        } else if (client->IsDone()) {
+            CloseConn(client); // WebSocket 的关闭帧已写出
+        } else if (!Rearm(client, EPOLLIN, true)) { // 监听读
+            continue; // 注册之前又有消息要发送
+        }
+        return;
+    }
+}
+
+bool WebServer::Rearm(HttpConnect* client, uint32_t event, bool idle) {
+    return client->Park(idle, [this, client, event]() {
+        epoller_->ModFd(client->GetFd(), conn_event_ | event, client->Serial());
+    });
+}
+
+// 发起异步验证后立即归还工作线程，结果在主线程回调，再交给线程池生成响应
+void WebServer::Suspend(HttpConnect* client) {
+    uint32_t serial = client->Serial();
+    client->Verify([this, client, serial](HttpRequest::VERIFY_RESULT result) {
+        thread_pool_->AddTask(std::bind(&WebServer::OnResume, this, client, serial, result));
+    });
+}
+
+void WebServer::OnResume(HttpConnect* client, uint32_t serial, HttpRequest::VERIFY_RESULT result) {
+    assert(client);
+    if (client->IsClose() || client->Serial() != serial) // 等待期间连接已关闭或 fd 已被复用
+        return;
+    client->Resume(result);
+    Rearm(client, EPOLLOUT, false); // 监听写
+}
+
+// 停放的 WebSocket 连接有消息要发送；上一批还没写完时继续写，新的帧在写完后取出
+void WebServer::OnWake(HttpConnect* client, uint32_t serial) {
+    assert(client);
+    if (client->IsClose() || client->Serial() != serial)
+        return;
+    if (client->ToWriteBytes() > 0) {
+        OnWrite(client);
     } else {
-        epoller_->ModFd(client->GetFd(), conn_event_ | EPOLLIN); // 监听读
+        OnProcess(client);
+    }
+}
+
+// 连接池在主线程上分配连接，交回工作线程开始转发
+void WebServer::Forward(HttpConnect* client) {
+    uint32_t serial = client->Serial();
+    UpstreamPool::instance()->Acquire(client->ForwardUpstream(),
+        [this, client, serial](UpstreamConnect* conn) {
+            thread_pool_->AddTask(std::bind(&WebServer::OnAcquire, this, client, serial, conn));
+        },
+        [this, client, serial]() { // 租出的上游连接上的事件，只在停放时处理
+            if (client->IsClose() || client->Serial() != serial || !client->IsForwarding() ||
+                !client->Unpark(false, false))
+                return;
+            DealForward(client);
+        });
+}
+
+// 每个事件都延长超时，长时间的下载不会因为超时被关闭，上游没有响应时仍按超时关闭
+void WebServer::DealForward(HttpConnect* client) {
+    ExtendTime(client, timeout_ms_);
+    thread_pool_->AddTask(std::bind(&WebServer::OnForward, this, client, client->Serial()));
+}
+
+void WebServer::OnAcquire(HttpConnect* client, uint32_t serial, UpstreamConnect* conn) {
+    assert(client);
+    if (client->IsClose() || client->Serial() != serial || !client->IsForwarding()) {
+        if (conn) // 还没有用过，可以直接放回
+            UpstreamPool::instance()->Release(conn, UpstreamPool::REUSE);
+        return;
+    }
+    client->Attach(conn);
+    Relay(client, client->Forward());
+}
+
+void WebServer::OnForward(HttpConnect* client, uint32_t serial) {
+    assert(client);
+    if (client->IsClose() || client->Serial() != serial || !client->IsForwarding())
+        return;
+    Relay(client, client->Forward());
+}
+
+void WebServer::Relay(HttpConnect* client, HttpProxy::STEP step) {
+    switch (step) {
+    case HttpProxy::WAIT_CLIENT_READ:
+        Rearm(client, EPOLLIN, false);
+        break;
+    case HttpProxy::WAIT_CLIENT_WRITE:
+        Rearm(client, EPOLLOUT, false);
+        break;
+    case HttpProxy::WAIT_UPSTREAM_READ:
+    case HttpProxy::WAIT_UPSTREAM_WRITE: {
+        const UpstreamConnect* conn = client->UpstreamConn();
+        uint32_t event = step == HttpProxy::WAIT_UPSTREAM_READ ? EPOLLIN : EPOLLOUT;
+        int fd = conn->fd;
+        uint32_t tag = conn->tag;
+        client->Park(false, [this, fd, tag, event]() {
+            epoller_->ModFd(fd, EPOLLONESHOT | EPOLLRDHUP | event, tag);
+        });
+        break;
+    }
+    case HttpProxy::RETRY:
+        Forward(client);
+        break;
+    case HttpProxy::FAILED:
+        Rearm(client, EPOLLOUT, false); // 502 响应已生成
+        break;
+    case HttpProxy::FINISHED:
+        OnWrite(client); // 没有要写的数据，保持时继续处理流水线中的请求
+        break;
     }
 }
 
@@ -221,11 +504,12 @@ void WebServer::OnWrite(HttpConnect* client) {
     ret = client->Write(&write_errno);
     if (client->ToWriteBytes() == 0) {
         if (client->IsKeepAlive()) {
-            epoller_->ModFd(client->GetFd(), conn_event_ | EPOLLIN); // 监听读
+            OnProcess(client); // 读缓冲中可能还有流水线请求，没有时重新监听读
+            return;
         }
     } else if (ret < 0) {
         if (write_errno == EAGAIN) {
-            epoller_->ModFd(client->GetFd(), conn_event_ | EPOLLOUT); // 监听写
+            Rearm(client, EPOLLOUT, false); // 监听写
             return;
         }
     }
@@ -239,6 +523,16 @@ void WebServer::CloseConn(HttpConnect* client) {
     client->Close();
 }
 
+// WebSocket 连接空闲时发送 ping 并按 ping 间隔重新计时，没有回应时关闭；其他连接直接关闭
+void WebServer::OnTimeout(HttpConnect* client) {
+    assert(client);
+    if (client->IsWebSocket() && client->Ping()) {
+        timer_->Add(client->GetFd(), WebSocket::ping_interval_ms, std::bind(&WebServer::OnTimeout, this, client));
+        return;
+    }
+    CloseConn(client);
+}
+
 void WebServer::SendError(int fd, const char* info) {
     assert(fd > 0);
     int ret = send(fd, info, strlen(info), 0);
@@ -248,9 +542,9 @@ void WebServer::SendError(int fd, const char* info) {
     close(fd);
 }
 
-void WebServer::ExtendTime(HttpConnect* client) {
+void WebServer::ExtendTime(HttpConnect* client, int timeout_ms) {
     assert(client);
     if (timeout_ms_ > 0) {
-        timer_->Adjust(client->GetFd(), timeout_ms_);
+        timer_->Adjust(client->GetFd(), timeout_ms);
     }
 }
\ No newline at end of file
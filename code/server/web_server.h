@@ -2,15 +2,24 @@
 #define WEB_SERVER_H
 
 #include <memory>
-#include <unordered_map>
 #include <functional>
+#include <fcntl.h>
+#include <csignal>
+#include <sys/socket.h>
+#include <netinet/tcp.h>
 
 #include "../log/log.h"
 #include "../pool/threadpool.h"
-#include "../pool/sql_connect_pool.h"
+#include "../pool/async_sql_pool.h"
+#include "../pool/upstream_pool.h"
+#include "../store/mysql_user_store.h"
+#include "../store/sqlite_user_store.h"
+#include "../store/batch_user_store.h"
 #include "../http/http_connect.h"
+#include "../tls/tls_context.h"
 #include "../heap_timer/heap_timer.h"
 #include "epoller.h"
+#include "connect_table.h"
 
 class WebServer
 {
@@ -19,14 +28,82 @@ public:
     WebServer(int port, int trigger_mode, int timeout_ms,
               int sql_port, const char *sql_user, const char *sql_pwd,
               const char *db_name, int conn_pool_num, int thread_num,
-              bool open_log, int log_level, int log_que_size);
+              bool open_log, int log_level, int log_que_size,
+              bool log_binary, int user_store = USER_STORE_MYSQL,
+              const char *sql_host = "localhost");
     ~WebServer();
     void start();
+    // 增加一个 MySQL 从库，登录查询等只读语句会优先发往从库；在 start 之前调用
+    void AddSqlReplica(const char *host, int port, int conn_num);
+    // 从库延迟超过 max_lag_ms 时读回到主库，< 0 不检查延迟；lag_sql 的结果中需要有 Seconds_Behind_Master 或 Seconds_Behind_Source 列
+    void SetSqlReplicaLag(int max_lag_ms, const std::string& lag_sql = "SHOW SLAVE STATUS") {
+        AsyncSqlPool::instance()->SetReplicaLag(max_lag_ms, lag_sql);
+    }
+    // 异步日志队列满时的处理策略，默认丢弃新日志；LOG_OVERFLOW_SAMPLE 时每 sample_rate 条溢出日志保留一条
+    void SetLogOverflow(LogOverflowPolicy policy, int sample_rate = 10) {
+        Log::GetInstance()->SetOverflowPolicy(policy, sample_rate);
+    }
+    // 日志文件超过 max_file_size 字节、max_lines 行或每隔 rotate_interval_s 秒切换一次，0 表示不按该条件切换
+    void SetLogRotation(size_t max_file_size, int max_lines, int rotate_interval_s) {
+        Log::GetInstance()->SetRotation(max_file_size, max_lines, rotate_interval_s);
+    }
+    // 切换下来的日志文件在后台压缩，keep_files > 0 时只保留最新的 keep_files 个
+    void SetLogArchive(LogCompress compress, int keep_files) {
+        Log::GetInstance()->SetArchive(compress, keep_files);
+    }
+    void SetAcceptBatch(int batch) { accept_batch_ = batch > 0 ? batch : 1; } // 每次唤醒最多 accept 的连接数
+    void SetMaxBodySize(size_t bytes) { HttpRequest::max_body_size = bytes; } // 请求体超过该长度时返回 413
+    void SetMaxUploadSize(size_t bytes) { HttpRequest::max_upload_size = bytes; } // 上传请求的长度上限
+    // 上传默认关闭：上传没有身份验证，开启后在 pattern 上接收 POST，文件保存到 dir（不存在时创建）；
+    // dir 不应在资源目录下，否则上传的文件会被当作静态文件对外提供；在 start 之前调用
+    bool EnableUpload(const std::string& dir = "./upload/", std::string_view pattern = "/upload");
+    // upload_dir 中文件的总字节数和文件数上限，超出时上传返回 507；0 不限制
+    void SetUploadQuota(size_t max_bytes, size_t max_files) {
+        HttpUpload::max_total_bytes = max_bytes;
+        HttpUpload::max_total_files = max_files;
+    }
+    // 增加动态路由，在 start 之前调用；内置路由都注册在 "*" 方法上，指定方法的路由优先
+    bool AddRoute(std::string_view method, std::string_view pattern, Router::Handler handler, int flags = 0) {
+        return Router::instance()->Add(method, pattern, std::move(handler), flags);
+    }
+    // WebSocket 端点：pattern 上的 GET 请求升级为 WebSocket，消息交给 handler；在 start 之前调用
+    bool AddWebSocket(std::string_view pattern, WebSocketHandler handler) {
+        return AddRoute("GET", pattern, HttpConnect::WebSocketRoute(std::make_shared<WebSocketHandler>(std::move(handler))));
+    }
+    // 反向代理：servers 为 "host:port" 的上游服务器组，返回编号，地址无效时返回 -1；
+    // AddProxy 把 pattern 上所有方法的请求转发给该组，请求体和响应体不经过内存；都在 start 之前调用
+    int AddUpstream(const std::vector<std::string>& servers, UpstreamPool::BALANCE balance = UpstreamPool::ROUND_ROBIN) {
+        return UpstreamPool::instance()->Add(servers, balance);
+    }
+    bool AddProxy(std::string_view pattern, int upstream) {
+        return AddRoute("*", pattern, HttpConnect::ProxyRoute(upstream), Router::FORWARD);
+    }
+    // 每 interval_ms GET 一次 path，要求 2xx/3xx；path 为空时只对已暂停的服务器尝试建立连接
+    bool SetUpstreamHealthCheck(int upstream, const std::string& path, int interval_ms) {
+        return UpstreamPool::instance()->SetHealthCheck(upstream, path, interval_ms);
+    }
+    // 每个上游服务器最多保留 max_idle 个空闲连接，空闲超过 idle_timeout_ms 的关闭
+    void SetUpstreamKeepAlive(size_t max_idle, int idle_timeout_ms) {
+        UpstreamPool::instance()->SetKeepAlive(max_idle, idle_timeout_ms);
+    }
+    // WebSocket 连接空闲 ping_interval_ms 后发送 ping，再过一个间隔仍没有数据时关闭（需要开启定时器）；
+    // 消息超过 max_message_size 时以 1009 关闭
+    void SetWebSocket(int ping_interval_ms, size_t max_message_size);
+    // 一个连接最多处理 max_requests 个请求（0 不限制）；响应写完后空闲 idle_timeout_ms 关闭，不超过 timeout_ms
+    void SetKeepAlive(int max_requests, int idle_timeout_ms);
+    // 可选的监听 socket 选项，在 start 之前调用
+    bool SetDeferAccept(int timeout_s); // 连接上有数据到达（或超过 timeout_s）才交给 accept，0 关闭
+    bool SetFastOpen(int queue_len);    // 请求可以随 SYN 到达，queue_len 为等待握手完成的 TFO 连接上限，0 关闭
+    // 所有连接改用 TLS（PEM 格式的证书链和私钥），内核支持时握手后开启 kTLS；在 start 之前调用
+    bool SetTls(const std::string& cert_file, const std::string& key_file, bool ktls = true);
 
 private:
     static int SetFdNonBlock(int fd);
+    static void SetSocketOptions(int fd);
 
     bool InitSocker();
+    void InitUserStore(int user_store, const char *sql_host, int sql_port, const char *sql_user, const char *sql_pwd,
+                       const char *db_name, int conn_pool_num);
     void InitEventMode(int trigger_mode);
 
     void DealListen();
@@ -35,20 +112,36 @@ private:
 
     void AddClient(int fd, sockaddr_in addr);
     void SendError(int fd, const char *info);
-    void ExtendTime(HttpConnect *client);
+    void ExtendTime(HttpConnect *client, int timeout_ms);
     void CloseConn(HttpConnect *client);
+    void OnTimeout(HttpConnect *client); // 连接的定时器到期
 
     void OnRead(HttpConnect *client);
     void OnProcess(HttpConnect *client);
     void OnWrite(HttpConnect *client);
+    void Suspend(HttpConnect *client);
+    void OnResume(HttpConnect *client, uint32_t serial, HttpRequest::VERIFY_RESULT result);
+    void OnWake(HttpConnect *client, uint32_t serial);
+    // 反向代理：租用上游连接，之后客户端和上游的事件都交给 OnForward，按 Relay 的结果注册下一个事件
+    void Forward(HttpConnect *client);
+    void DealForward(HttpConnect *client);
+    void OnAcquire(HttpConnect *client, uint32_t serial, UpstreamConnect *conn);
+    void OnForward(HttpConnect *client, uint32_t serial);
+    void Relay(HttpConnect *client, HttpProxy::STEP step);
+    // 工作线程处理完后重新注册事件；WebSocket 连接在 idle 时又有新的帧要发送时返回 false，应继续处理
+    bool Rearm(HttpConnect *client, uint32_t event, bool idle);
 
     static const int MAX_FD = 65536;
+    static const int KEEPALIVE_IDLE_S = 60;  // 空闲多久后开始发送 TCP 保活探测
+    static const int KEEPALIVE_INTVL_S = 10; // 探测间隔
+    static const int KEEPALIVE_CNT = 3;      // 连续多少次无响应后断开
 
     int port_;
     bool open_linger_;
     int timeout_ms_;
     bool is_close_;
     int listen_fd_;
+    int accept_batch_;
     char *src_dir_;
 
     uint32_t listen_event_;
@@ -57,7 +150,7 @@ private:
     std::unique_ptr<HeapTimer> timer_;
     std::unique_ptr<ThreadPool> thread_pool_;
     std::unique_ptr<Epoller> epoller_;
-    std::unordered_map<int, HttpConnect> users_;
+    ConnectTable users_; //以 fd 为下标，连接对象的地址不变
 };
 
 #endif // WEB_SERVER_H
@@ -0,0 +1,74 @@
+#include "batch_user_store.h"
+
+#include <algorithm>
+#include <iterator>
+
+BatchUserStore::BatchUserStore(std::unique_ptr<UserStore> store, size_t max_batch, int window_ms)
+    : store_(std::move(store)), max_batch_(max_batch), window_ms_(window_ms), is_close_(false) {
+    assert(store_ && max_batch_ > 0 && window_ms_ >= 0);
+    thread_ = std::thread(&BatchUserStore::Run, this);
+}
+
+// 退出前写完已入队的用户
+BatchUserStore::~BatchUserStore() {
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        is_close_ = true;
+    }
+    cond_.notify_all();
+    if (thread_.joinable())
+        thread_.join();
+}
+
+void BatchUserStore::FindUser(const std::string& name, FindCallback callback) {
+    store_->FindUser(name, std::move(callback));
+}
+
+void BatchUserStore::AddUser(const std::string& name, const std::string& pwd, AddCallback callback) {
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if (is_close_) {
+            callback(false);
+            return;
+        }
+        pending_.emplace_back(name, pwd);
+        callbacks_.push_back(std::move(callback));
+        // 新一批的第一条唤醒写线程开始计时，凑满一批时提前结束等待
+        wake = pending_.size() == 1 || pending_.size() >= max_batch_;
+    }
+    if (wake)
+        cond_.notify_one();
+}
+
+void BatchUserStore::AddUsers(const UserList& users, BatchCallback callback) {
+    store_->AddUsers(users, std::move(callback));
+}
+
+void BatchUserStore::Run() {
+    std::unique_lock<std::mutex> locker(mtx_);
+    while (true) {
+        cond_.wait(locker, [this] { return is_close_ || !pending_.empty(); });
+        if (pending_.empty()) // 已关闭且没有待写入的用户
+            break;
+        // 给后来的请求一个时间窗口，凑成一批再提交
+        cond_.wait_for(locker, std::chrono::milliseconds(window_ms_),
+                       [this] { return is_close_ || pending_.size() >= max_batch_; });
+
+        size_t count = std::min(pending_.size(), max_batch_);
+        UserList users(std::make_move_iterator(pending_.begin()),
+                       std::make_move_iterator(pending_.begin() + count));
+        std::vector<AddCallback> callbacks(std::make_move_iterator(callbacks_.begin()),
+                                           std::make_move_iterator(callbacks_.begin() + count));
+        pending_.erase(pending_.begin(), pending_.begin() + count);
+        callbacks_.erase(callbacks_.begin(), callbacks_.begin() + count);
+        locker.unlock();
+
+        LOG_DEBUG("register batch: %zu users", count);
+        store_->AddUsers(users, [callbacks](const std::vector<bool>& results) {
+            for (size_t i = 0; i < callbacks.size(); ++i)
+                callbacks[i](i < results.size() && results[i]);
+        });
+        locker.lock();
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef BATCH_USER_STORE_H
+#define BATCH_USER_STORE_H
+
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include "user_store.h"
+#include "../log/log.h"
+
+// 注册写入的合并器，包在具体存储外面
+// AddUser 只是入队；写线程在收到第一条后最多等待 window_ms，或凑满 max_batch 条，
+// 用一次 AddUsers 提交整批，再把每行各自的结果回调给对应的请求
+class BatchUserStore : public UserStore {
+public:
+    BatchUserStore(std::unique_ptr<UserStore> store, size_t max_batch = 64, int window_ms = 2);
+    ~BatchUserStore() override;
+
+    void FindUser(const std::string& name, FindCallback callback) override;
+    void AddUser(const std::string& name, const std::string& pwd, AddCallback callback) override;
+    void AddUsers(const UserList& users, BatchCallback callback) override;
+
+private:
+    void Run();
+
+    std::unique_ptr<UserStore> store_;
+    size_t max_batch_; //每批最多的行数
+    int window_ms_; //等待凑批的时间窗口
+
+    std::mutex mtx_;
+    std::condition_variable cond_;
+    UserList pending_; //等待写入的用户
+    std::vector<AddCallback> callbacks_; //与 pending_ 一一对应
+    bool is_close_;
+    std::thread thread_;
+};
+
+#endif // BATCH_USER_STORE_H
@@ -0,0 +1,124 @@
+#include "mysql_user_store.h"
+
+#include <algorithm>
+
+namespace {
+
+const size_t MAX_BATCH_ROWS = 64;
+
+// 不小于 n 的 2 的幂
+size_t BatchRows(size_t n) {
+    size_t rows = 1;
+    while (rows < n)
+        rows <<= 1;
+    return rows;
+}
+
+// 1、2、4 … MAX_BATCH_ROWS 行的 INSERT 和 SELECT；行数固定为这几种，
+// 每个连接上缓存的预处理语句不会随批次大小增长
+struct BatchSql {
+    std::string insert, select;
+};
+
+const BatchSql& GetBatchSql(size_t rows) {
+    static const std::vector<BatchSql> sqls = []() {
+        std::vector<BatchSql> sqls;
+        for (size_t n = 1; n <= MAX_BATCH_ROWS; n <<= 1) {
+            BatchSql sql;
+            // 重复的用户名什么也不更新，其余错误（如截断）仍然让语句失败，不像 INSERT IGNORE 那样变成警告
+            sql.insert = "INSERT INTO User(username, password) VALUES";
+            sql.select = "SELECT username, password FROM User WHERE username IN (";
+            for (size_t i = 0; i < n; ++i) {
+                sql.insert += i ? ",(?, ?)" : "(?, ?)";
+                sql.select += i ? ",?" : "?";
+            }
+            sql.insert += " ON DUPLICATE KEY UPDATE username=username";
+            sql.select += ")";
+            sqls.push_back(sql);
+        }
+        return sqls;
+    }();
+    size_t index = 0;
+    while ((static_cast<size_t>(1) << index) < rows)
+        ++index;
+    return sqls[index];
+}
+
+} // namespace
+
+void MysqlUserStore::FindUser(const std::string& name, FindCallback callback) {
+    static const std::string SELECT_USER = "SELECT username, password FROM User WHERE username=? LIMIT 1";
+    // 登录查询可以读从库；刚注册的用户已在缓存中，不依赖从库是否追上
+    AsyncSqlPool::instance()->Execute(SELECT_USER, {name}, [callback](bool ok, const SqlRows& rows) {
+        if (!ok) {
+            callback(false, false, "");
+            return;
+        }
+        if (rows.empty()) {
+            callback(true, false, "");
+            return;
+        }
+        LOG_DEBUG("MYSQL ROW: %s", rows[0][0].c_str()); // 不输出密码哈希
+        callback(true, true, rows[0][1]);
+    }, true);
+}
+
+void MysqlUserStore::AddUser(const std::string& name, const std::string& pwd, AddCallback callback) {
+    static const std::string INSERT_USER = "INSERT INTO User(username, password) VALUES(?, ?)";
+    AsyncSqlPool::instance()->Execute(INSERT_USER, {name, pwd}, [callback](bool ok, const SqlRows&) {
+        callback(ok);
+    });
+}
+
+// 多行 INSERT 只提交一次；重复的用户名被跳过而不是让整条语句失败，
+// 再按用户名查回哈希，和自己写入的（带随机盐）一致的行才是本次插入成功的
+// 行数补齐到 2 的幂，多出的行重复最后一个用户；超过 MAX_BATCH_ROWS 的部分拆开依次提交
+void MysqlUserStore::AddUsers(const UserList& users, BatchCallback callback) {
+    if (users.empty()) {
+        callback(std::vector<bool>());
+        return;
+    }
+    if (users.size() > MAX_BATCH_ROWS) {
+        UserList head(users.begin(), users.begin() + MAX_BATCH_ROWS);
+        UserList tail(users.begin() + MAX_BATCH_ROWS, users.end());
+        AddUsers(head, [this, tail, callback](const std::vector<bool>& results) {
+            AddUsers(tail, [results, callback](const std::vector<bool>& rest) {
+                std::vector<bool> all(results);
+                all.insert(all.end(), rest.begin(), rest.end());
+                callback(all);
+            });
+        });
+        return;
+    }
+    size_t rows = BatchRows(users.size());
+    const BatchSql& sql = GetBatchSql(rows);
+    std::vector<std::string> insert_params, select_params;
+    for (size_t i = 0; i < rows; ++i) {
+        const auto& user = users[std::min(i, users.size() - 1)];
+        insert_params.push_back(user.first);
+        insert_params.push_back(user.second);
+        select_params.push_back(user.first);
+    }
+
+    AsyncSqlPool::instance()->Execute(sql.insert, std::move(insert_params),
+        [users, select = sql.select, select_params, callback](bool ok, const SqlRows&) {
+        if (!ok) {
+            callback(std::vector<bool>(users.size(), false));
+            return;
+        }
+        // 必须读主库，从库可能还没有刚插入的行
+        AsyncSqlPool::instance()->Execute(select, select_params, [users, callback](bool ok, const SqlRows& rows) {
+            std::vector<bool> results(users.size(), false);
+            if (ok) {
+                std::unordered_map<std::string, std::string> stored;
+                for (const SqlRow& row : rows)
+                    stored[row[0]] = row[1];
+                for (size_t i = 0; i < users.size(); ++i) {
+                    auto it = stored.find(users[i].first);
+                    results[i] = it != stored.end() && it->second == users[i].second;
+                }
+            }
+            callback(results);
+        });
+    });
+}
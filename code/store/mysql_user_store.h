@@ -0,0 +1,15 @@
+#ifndef MYSQL_USER_STORE_H
+#define MYSQL_USER_STORE_H
+
+#include "user_store.h"
+#include "../pool/async_sql_pool.h"
+
+// MySQL 后端：预处理语句经 AsyncSqlPool 执行，回调在主线程上
+class MysqlUserStore : public UserStore {
+public:
+    void FindUser(const std::string& name, FindCallback callback) override;
+    void AddUser(const std::string& name, const std::string& pwd, AddCallback callback) override;
+    void AddUsers(const UserList& users, BatchCallback callback) override;
+};
+
+#endif // MYSQL_USER_STORE_H
@@ -0,0 +1,170 @@
+#include "sqlite_user_store.h"
+
+SqliteUserStore::SqliteUserStore(const std::string& path, int mmap_size_mb)
+    : path_(path), mmap_size_mb_(mmap_size_mb), is_open_(false) {
+    Connect* conn = Open();
+    if (conn == nullptr)
+        return;
+    const char* create = "CREATE TABLE IF NOT EXISTS User("
+                         "username TEXT PRIMARY KEY NOT NULL, password TEXT NOT NULL)";
+    char* err = nullptr;
+    if (sqlite3_exec(conn->db, create, nullptr, nullptr, &err) != SQLITE_OK) {
+        LOG_ERROR("SQLite create table fail: Error: %s", err);
+        sqlite3_free(err);
+        Close(conn);
+        return;
+    }
+    is_open_ = true;
+    FreeConnect(conn);
+    LOG_INFO("SQLite user store: %s", path_.c_str());
+}
+
+SqliteUserStore::~SqliteUserStore() {
+    std::lock_guard<std::mutex> locker(mtx_);
+    for (Connect* conn : free_)
+        Close(conn);
+    free_.clear();
+}
+
+SqliteUserStore::Connect* SqliteUserStore::Open() {
+    sqlite3* db = nullptr;
+    // 每个连接只被一个线程使用，不需要 SQLite 内部的互斥
+    int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX;
+    if (sqlite3_open_v2(path_.c_str(), &db, flags, nullptr) != SQLITE_OK) {
+        LOG_ERROR("SQLite open %s fail: Error: %s", path_.c_str(), db ? sqlite3_errmsg(db) : "");
+        sqlite3_close(db);
+        return nullptr;
+    }
+    sqlite3_busy_timeout(db, 1000); // 写锁冲突时最多等待 1s
+    std::string pragmas = "PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL; "
+                          "PRAGMA mmap_size=" + std::to_string(static_cast<long long>(mmap_size_mb_) << 20) + ";";
+    char* err = nullptr;
+    if (sqlite3_exec(db, pragmas.c_str(), nullptr, nullptr, &err) != SQLITE_OK) {
+        LOG_WARN("SQLite pragma fail: Error: %s", err);
+        sqlite3_free(err);
+    }
+
+    Connect* conn = new Connect{db, nullptr, nullptr};
+    return conn;
+}
+
+void SqliteUserStore::Close(Connect* conn) {
+    sqlite3_finalize(conn->select_user);
+    sqlite3_finalize(conn->insert_user);
+    sqlite3_close(conn->db);
+    delete conn;
+}
+
+SqliteUserStore::Connect* SqliteUserStore::GetConnect() {
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        if (!free_.empty()) {
+            Connect* conn = free_.back();
+            free_.pop_back();
+            return conn;
+        }
+    }
+    return Open();
+}
+
+void SqliteUserStore::FreeConnect(Connect* conn) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    free_.push_back(conn);
+}
+
+void SqliteUserStore::FindUser(const std::string& name, FindCallback callback) {
+    Connect* conn = is_open_ ? GetConnect() : nullptr;
+    if (conn == nullptr) {
+        callback(false, false, "");
+        return;
+    }
+    if (conn->select_user == nullptr &&
+        sqlite3_prepare_v2(conn->db, "SELECT password FROM User WHERE username=? LIMIT 1", -1,
+                           &conn->select_user, nullptr) != SQLITE_OK) {
+        LOG_ERROR("SQLite prepare fail: Error: %s", sqlite3_errmsg(conn->db));
+        FreeConnect(conn);
+        callback(false, false, "");
+        return;
+    }
+
+    sqlite3_stmt* stmt = conn->select_user;
+    sqlite3_bind_text(stmt, 1, name.data(), name.size(), SQLITE_STATIC);
+    bool ok = true, exists = false;
+    std::string password;
+    int ret = sqlite3_step(stmt);
+    if (ret == SQLITE_ROW) {
+        exists = true;
+        const unsigned char* text = sqlite3_column_text(stmt, 0);
+        if (text)
+            password.assign(reinterpret_cast<const char*>(text), sqlite3_column_bytes(stmt, 0));
+    } else if (ret != SQLITE_DONE) {
+        LOG_ERROR("SQLite select fail: Error: %s", sqlite3_errmsg(conn->db));
+        ok = false;
+    }
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    FreeConnect(conn);
+    callback(ok, exists, password);
+}
+
+bool SqliteUserStore::PrepareInsert(Connect* conn) {
+    if (conn->insert_user == nullptr &&
+        sqlite3_prepare_v2(conn->db, "INSERT INTO User(username, password) VALUES(?, ?)", -1,
+                           &conn->insert_user, nullptr) != SQLITE_OK) {
+        LOG_ERROR("SQLite prepare fail: Error: %s", sqlite3_errmsg(conn->db));
+        return false;
+    }
+    return true;
+}
+
+// 返回 sqlite3_step 的结果，用户名已存在时违反主键约束
+int SqliteUserStore::InsertOne(Connect* conn, const std::string& name, const std::string& pwd) {
+    sqlite3_stmt* stmt = conn->insert_user;
+    sqlite3_bind_text(stmt, 1, name.data(), name.size(), SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, pwd.data(), pwd.size(), SQLITE_STATIC);
+    int ret = sqlite3_step(stmt);
+    if (ret != SQLITE_DONE)
+        LOG_ERROR("SQLite insert fail: Error: %s", sqlite3_errmsg(conn->db));
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    return ret;
+}
+
+void SqliteUserStore::AddUser(const std::string& name, const std::string& pwd, AddCallback callback) {
+    Connect* conn = is_open_ ? GetConnect() : nullptr;
+    if (conn == nullptr) {
+        callback(false);
+        return;
+    }
+    bool ok = PrepareInsert(conn) && InsertOne(conn, name, pwd) == SQLITE_DONE;
+    FreeConnect(conn);
+    callback(ok);
+}
+
+// 整批放在一个事务里，只提交（落盘）一次；单行的约束冲突不影响其他行
+void SqliteUserStore::AddUsers(const UserList& users, BatchCallback callback) {
+    std::vector<bool> results(users.size(), false);
+    Connect* conn = is_open_ ? GetConnect() : nullptr;
+    if (conn == nullptr || users.empty()) {
+        if (conn)
+            FreeConnect(conn);
+        callback(results);
+        return;
+    }
+    if (!PrepareInsert(conn) ||
+        sqlite3_exec(conn->db, "BEGIN IMMEDIATE", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        LOG_ERROR("SQLite begin fail: Error: %s", sqlite3_errmsg(conn->db));
+        FreeConnect(conn);
+        callback(results);
+        return;
+    }
+    for (size_t i = 0; i < users.size(); ++i)
+        results[i] = InsertOne(conn, users[i].first, users[i].second) == SQLITE_DONE;
+    if (sqlite3_exec(conn->db, "COMMIT", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        LOG_ERROR("SQLite commit fail: Error: %s", sqlite3_errmsg(conn->db));
+        sqlite3_exec(conn->db, "ROLLBACK", nullptr, nullptr, nullptr);
+        results.assign(users.size(), false);
+    }
+    FreeConnect(conn);
+    callback(results);
+}
@@ -0,0 +1,48 @@
+#ifndef SQLITE_USER_STORE_H
+#define SQLITE_USER_STORE_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <sqlite3.h>
+
+#include "user_store.h"
+#include "../log/log.h"
+
+// 嵌入式 SQLite 后端：WAL 模式下读写互不阻塞，数据库文件通过 mmap 映射，
+// 查找基本都在页缓存中完成；调用在工作线程上同步执行
+class SqliteUserStore : public UserStore {
+public:
+    explicit SqliteUserStore(const std::string& path, int mmap_size_mb = 256);
+    ~SqliteUserStore() override;
+
+    bool IsOpen() const { return is_open_; }
+
+    void FindUser(const std::string& name, FindCallback callback) override;
+    void AddUser(const std::string& name, const std::string& pwd, AddCallback callback) override;
+    void AddUsers(const UserList& users, BatchCallback callback) override;
+
+private:
+    // 每个连接缓存自己的预处理语句，同一时间只被一个线程使用
+    struct Connect {
+        sqlite3* db;
+        sqlite3_stmt* select_user;
+        sqlite3_stmt* insert_user;
+    };
+
+    Connect* Open();
+    static void Close(Connect* conn);
+    Connect* GetConnect();
+    void FreeConnect(Connect* conn);
+    bool PrepareInsert(Connect* conn);
+    int InsertOne(Connect* conn, const std::string& name, const std::string& pwd);
+
+    std::string path_;
+    int mmap_size_mb_;
+    bool is_open_;
+
+    std::mutex mtx_;
+    std::vector<Connect*> free_; //空闲连接，不够时按需打开新的
+};
+
+#endif // SQLITE_USER_STORE_H
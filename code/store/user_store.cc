@@ -0,0 +1,11 @@
+#include "user_store.h"
+
+static std::unique_ptr<UserStore> g_user_store;
+
+UserStore* UserStore::instance() {
+    return g_user_store.get();
+}
+
+void UserStore::Install(std::unique_ptr<UserStore> store) {
+    g_user_store = std::move(store);
+}
@@ -0,0 +1,38 @@
+#ifndef USER_STORE_H
+#define USER_STORE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <functional>
+
+// 用户数据的存储后端
+enum USER_STORE_TYPE {
+    USER_STORE_MYSQL,  // MySQL，经 AsyncSqlPool 异步访问
+    USER_STORE_SQLITE  // 嵌入式 SQLite（WAL + mmap），无需外部服务
+};
+
+// 用户存储接口，HttpRequest 只依赖这里，不直接接触具体数据库
+// 回调可能在调用线程上同步执行（嵌入式存储），也可能稍后在主线程上执行（异步存储）
+class UserStore {
+public:
+    // ok 为 false 表示存储出错；exists 为 false 时 password 无意义
+    using FindCallback = std::function<void(bool ok, bool exists, const std::string& password)>;
+    using AddCallback = std::function<void(bool ok)>;
+    using UserList = std::vector<std::pair<std::string, std::string>>; // (用户名, 密码哈希)
+    // results[i] 对应 users[i]，用户名重复等失败只影响该行
+    using BatchCallback = std::function<void(const std::vector<bool>& results)>;
+
+    static UserStore* instance();
+    static void Install(std::unique_ptr<UserStore> store); // 启动时设置，之后不再改变
+
+    virtual ~UserStore() = default;
+
+    virtual void FindUser(const std::string& name, FindCallback callback) = 0;
+    virtual void AddUser(const std::string& name, const std::string& pwd, AddCallback callback) = 0;
+    // 一次提交多个用户，整批只做一次提交（group commit）
+    virtual void AddUsers(const UserList& users, BatchCallback callback) = 0;
+};
+
+#endif // USER_STORE_H
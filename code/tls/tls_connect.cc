@@ -0,0 +1,154 @@
+#include "tls_connect.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <openssl/err.h>
+
+const size_t TlsConnect::RECORD_SIZE;
+const size_t TlsConnect::MAX_WRITE;
+
+TlsConnect::TlsConnect()
+    : fd_(-1), ssl_(nullptr), active_(false), established_(false), want_write_(false),
+      ktls_send_(false), failed_(false) {
+}
+
+TlsConnect::~TlsConnect() {
+    Close();
+}
+
+// 创建失败时 ssl_ 为空，连接仍按 TLS 处理，握手直接失败
+void TlsConnect::Init(int fd) {
+    Close();
+    fd_ = fd;
+    active_ = true;
+    ssl_ = TlsContext::instance()->NewSsl(fd);
+}
+
+void TlsConnect::Close() {
+    if (ssl_) {
+        // 非阻塞 socket 上 close_notify 发不出去也直接放弃；出现过错误（如连接被重置）时不再发送，
+        // 但仍标记为已关闭，否则 SSL_free 会把会话从缓存中删除，客户端下次不能恢复
+        ERR_clear_error();
+        if (established_ && !failed_) {
+            SSL_shutdown(ssl_);
+        } else {
+            SSL_set_shutdown(ssl_, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+        }
+        SSL_free(ssl_);
+        ssl_ = nullptr;
+    }
+    ERR_clear_error();
+    fd_ = -1;
+    active_ = false;
+    established_ = false;
+    want_write_ = false;
+    ktls_send_ = false;
+    failed_ = false;
+}
+
+int TlsConnect::Handshake() {
+    if (!ssl_)
+        return -1;
+    ERR_clear_error();
+    int ret = SSL_do_handshake(ssl_);
+    if (ret == 1) {
+        established_ = true;
+        want_write_ = false;
+        // OpenSSL 在交换密钥后按套件和内核支持情况开启 kTLS，这里只查询结果
+        ktls_send_ = BIO_get_ktls_send(SSL_get_wbio(ssl_));
+        const unsigned char* alpn = nullptr;
+        unsigned int alpn_len = 0;
+        SSL_get0_alpn_selected(ssl_, &alpn, &alpn_len);
+        std::string protocol = alpn_len ? std::string(reinterpret_cast<const char*>(alpn), alpn_len) : "-";
+        LOG_DEBUG("TLS[%d] %s %s, alpn: %s, resumed: %d, ktls send: %d, recv: %d", fd_,
+                  SSL_get_version(ssl_), SSL_get_cipher_name(ssl_), protocol.c_str(),
+                  (int)IsResumed(), (int)ktls_send_, (int)BIO_get_ktls_recv(SSL_get_rbio(ssl_)));
+        return 1;
+    }
+    int err = SSL_get_error(ssl_, ret);
+    if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE) {
+        want_write_ = err == SSL_ERROR_WANT_WRITE;
+        return 0;
+    }
+    failed_ = true;
+    LOG_DEBUG("TLS[%d] handshake error: %d, %s", fd_, err, ERR_reason_error_string(ERR_peek_error()));
+    ERR_clear_error();
+    return -1;
+}
+
+// 读缓冲留出一个完整记录的空间，每次 SSL_read 取完一个记录，
+// OpenSSL 内部不会剩下已解密的数据，是否可读仍然只看 socket
+ssize_t TlsConnect::Read(Buffer& buff, int* save_errno) {
+    if (!ssl_) {
+        *save_errno = EPROTO;
+        return -1;
+    }
+    buff.EnsureWriteable(RECORD_SIZE);
+    ERR_clear_error();
+    int len = SSL_read(ssl_, buff.WriteBegin(), static_cast<int>(std::min(buff.WritableBytes(), MAX_WRITE)));
+    if (len > 0) {
+        buff.HasWritten(len);
+        return len;
+    }
+    return Fail(len, save_errno);
+}
+
+ssize_t TlsConnect::Writev(const struct iovec* iov, int count, int* save_errno) {
+    assert(count > 0);
+    if (!ssl_) {
+        *save_errno = EPROTO;
+        return -1;
+    }
+    if (ktls_send_) { // 内核加密，直接写明文
+        ssize_t len = writev(fd_, iov, count);
+        if (len < 0)
+            *save_errno = errno;
+        return len;
+    }
+    const void* data = iov[0].iov_base;
+    size_t len = std::min(iov[0].iov_len, MAX_WRITE);
+    if (len < RECORD_SIZE && count > 1) {
+        // 重试时 iovec 从同一位置开始，暂存区的内容和长度与上次相同
+        stage_.resize(RECORD_SIZE);
+        len = 0;
+        for (int i = 0; i < count && len < RECORD_SIZE; ++i) {
+            size_t n = std::min(iov[i].iov_len, RECORD_SIZE - len);
+            memcpy(stage_.data() + len, iov[i].iov_base, n);
+            len += n;
+        }
+        data = stage_.data();
+    }
+    ERR_clear_error();
+    int ret = SSL_write(ssl_, data, static_cast<int>(len));
+    if (ret > 0)
+        return ret;
+    return Fail(ret, save_errno);
+}
+
+bool TlsConnect::IsResumed() const {
+    return ssl_ && SSL_session_reused(ssl_);
+}
+
+ssize_t TlsConnect::Fail(int ret, int* save_errno) {
+    int err = SSL_get_error(ssl_, ret);
+    switch (err) {
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE:
+        *save_errno = EAGAIN;
+        return -1;
+    case SSL_ERROR_ZERO_RETURN: // 对端发送了 close_notify 或直接断开
+        return 0;
+    case SSL_ERROR_SYSCALL:
+        *save_errno = errno ? errno : ECONNRESET;
+        break;
+    default:
+        *save_errno = EPROTO;
+        LOG_DEBUG("TLS[%d] error: %d, %s", fd_, err, ERR_reason_error_string(ERR_peek_error()));
+        break;
+    }
+    failed_ = true;
+    ERR_clear_error();
+    return -1;
+}
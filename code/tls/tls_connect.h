@@ -0,0 +1,53 @@
+#ifndef TLS_CONNECT_H
+#define TLS_CONNECT_H
+
+#include <sys/uio.h>
+#include <vector>
+#include <openssl/ssl.h>
+
+#include "../buffer/buffer.h"
+#include "../log/log.h"
+#include "tls_context.h"
+
+// 一个连接上的 TLS 状态：非阻塞握手、解密读入读缓冲、加密写出 iovec
+// 握手后 OpenSSL 开启了 kTLS 发送时，Writev 直接 writev 明文，由内核分记录加密，文件映射不再经过用户态加密；
+// 否则用 SSL_write，较小的 iovec（如响应头）先合并，和后面的内容组成整记录
+class TlsConnect {
+public:
+    static const size_t RECORD_SIZE = 16384;   // TLS 记录的最大明文长度
+    static const size_t MAX_WRITE = 1 << 20;   // 一次 SSL_write 的上限
+
+    TlsConnect();
+    ~TlsConnect();
+
+    void Init(int fd); // 按 TlsContext 的配置开始一个服务端连接
+    void Close();      // 尽量发送 close_notify，不等待对端的回应
+
+    bool IsActive() const { return active_; }
+    bool IsEstablished() const { return established_; }
+    bool WantWrite() const { return want_write_; } // 握手在等待可写
+
+    // 推进握手：1 完成，0 需要等待读或写事件（WantWrite），-1 失败
+    int Handshake();
+    // 和 Buffer::ReadFD 相同：返回读到的明文长度，0 为对端关闭，-1 时 save_errno 为 EAGAIN 或错误
+    ssize_t Read(Buffer& buff, int* save_errno);
+    // 和 writev 相同：返回写出的明文长度，-1 时 save_errno 为 EAGAIN 或错误；重试时必须从同一位置开始
+    ssize_t Writev(const struct iovec* iov, int count, int* save_errno);
+
+    bool IsKtlsSend() const { return ktls_send_; }
+    bool IsResumed() const;
+
+private:
+    ssize_t Fail(int ret, int* save_errno); // 把 SSL 错误转换为 errno
+
+    int fd_;
+    SSL* ssl_;
+    bool active_;
+    bool established_;
+    bool want_write_;
+    bool ktls_send_;
+    bool failed_;   // 出现过致命错误
+    std::vector<char> stage_; // 合并小 iovec 的暂存区，第一次需要时分配
+};
+
+#endif // TLS_CONNECT_H
@@ -0,0 +1,126 @@
+#include "tls_context.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <openssl/err.h>
+
+const int TlsContext::SESSION_CACHE_SIZE;
+const long TlsContext::SESSION_TIMEOUT_S;
+const int TlsContext::SESSION_TICKETS;
+
+namespace {
+
+// 服务端的偏好顺序，ALPN 协商到 h2 时连接开头就是 HTTP/2 前言
+const unsigned char ALPN_PROTOCOLS[] = "\x02h2\x08http/1.1";
+
+const char SESSION_ID_CONTEXT[] = "webserver";
+
+int SelectAlpn(SSL*, const unsigned char** out, unsigned char* out_len,
+               const unsigned char* in, unsigned int in_len, void*) {
+    unsigned char* selected = nullptr;
+    if (SSL_select_next_proto(&selected, out_len, ALPN_PROTOCOLS, sizeof(ALPN_PROTOCOLS) - 1,
+                              in, in_len) != OPENSSL_NPN_NEGOTIATED) {
+        return SSL_TLSEXT_ERR_NOACK; // 没有共同的协议时不带 ALPN，按 HTTP/1.1 处理
+    }
+    *out = selected;
+    return SSL_TLSEXT_ERR_OK;
+}
+
+std::string LastError() {
+    char msg[256];
+    ERR_error_string_n(ERR_get_error(), msg, sizeof(msg));
+    ERR_clear_error();
+    return msg;
+}
+
+} // namespace
+
+TlsContext::TlsContext() : ctx_(nullptr), ktls_(false) {
+}
+
+TlsContext::~TlsContext() {
+    SSL_CTX_free(ctx_);
+}
+
+TlsContext* TlsContext::instance() {
+    static TlsContext context;
+    return &context;
+}
+
+bool TlsContext::Init(const std::string& cert_file, const std::string& key_file, bool ktls) {
+    SSL_CTX* ctx = SSL_CTX_new(TLS_server_method());
+    if (!ctx) {
+        LOG_ERROR("SSL_CTX_new error: %s", LastError().c_str());
+        return false;
+    }
+    if (SSL_CTX_use_certificate_chain_file(ctx, cert_file.c_str()) != 1 ||
+        SSL_CTX_use_PrivateKey_file(ctx, key_file.c_str(), SSL_FILETYPE_PEM) != 1 ||
+        SSL_CTX_check_private_key(ctx) != 1) {
+        LOG_ERROR("Load certificate %s / key %s error: %s", cert_file.c_str(), key_file.c_str(), LastError().c_str());
+        SSL_CTX_free(ctx);
+        return false;
+    }
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+    // TLS 1.2 只用前向安全的 AEAD 套件，AES-GCM 和 ChaCha20-Poly1305 都可以交给 kTLS
+    SSL_CTX_set_cipher_list(ctx, "ECDHE+AESGCM:ECDHE+CHACHA20");
+    // 浏览器常常不发 close_notify 就断开，按正常关闭处理；否则 OpenSSL 视为致命错误，把会话从缓存中删除
+    long options = SSL_OP_CIPHER_SERVER_PREFERENCE | SSL_OP_NO_RENEGOTIATION | SSL_OP_IGNORE_UNEXPECTED_EOF;
+    ktls = ktls && ProbeKtls();
+#ifdef SSL_OP_ENABLE_KTLS
+    if (ktls)
+        options |= SSL_OP_ENABLE_KTLS;
+#else
+    ktls = false;
+#endif
+    SSL_CTX_set_options(ctx, options);
+    // 非阻塞写：每写完一个记录就返回，重试时缓冲区地址可以变化（iovec 会被重新组织），空闲连接释放读写缓冲
+    SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER |
+                          SSL_MODE_RELEASE_BUFFERS);
+
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_sess_set_cache_size(ctx, SESSION_CACHE_SIZE);
+    SSL_CTX_set_timeout(ctx, SESSION_TIMEOUT_S);
+    SSL_CTX_set_session_id_context(ctx, reinterpret_cast<const unsigned char*>(SESSION_ID_CONTEXT),
+                                   sizeof(SESSION_ID_CONTEXT) - 1);
+    SSL_CTX_set_num_tickets(ctx, SESSION_TICKETS);
+    SSL_CTX_set_alpn_select_cb(ctx, SelectAlpn, nullptr);
+
+    SSL_CTX_free(ctx_);
+    ctx_ = ctx;
+    ktls_ = ktls;
+    LOG_INFO("TLS enabled, certificate: %s, kTLS: %s", cert_file.c_str(), ktls_ ? "on" : "off");
+    return true;
+}
+
+SSL* TlsContext::NewSsl(int fd) const {
+    assert(ctx_);
+    SSL* ssl = SSL_new(ctx_);
+    if (!ssl || SSL_set_fd(ssl, fd) != 1) {
+        LOG_ERROR("SSL_new error: %s", LastError().c_str());
+        SSL_free(ssl);
+        return nullptr;
+    }
+    SSL_set_accept_state(ssl);
+    return ssl;
+}
+
+// 在未连接的 socket 上设置 TCP_ULP：内核支持时加载 tls 模块后因未连接而失败（ENOTCONN），
+// 不支持时为 ENOENT；OpenSSL 在不支持的内核上会静默回退，这里提前在日志中说明
+bool TlsContext::ProbeKtls() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return false;
+    int ret = setsockopt(fd, IPPROTO_TCP, TCP_ULP, "tls", sizeof("tls"));
+    int err = errno;
+    close(fd);
+    if (ret < 0 && (err == ENOENT || err == ENOPROTOOPT)) {
+        LOG_WARN("kTLS unavailable (tls ULP: %s), using userspace TLS", strerror(err));
+        return false;
+    }
+    return true;
+}
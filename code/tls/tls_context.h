@@ -0,0 +1,39 @@
+#ifndef TLS_CONTEXT_H
+#define TLS_CONTEXT_H
+
+#include <string>
+#include <openssl/ssl.h>
+
+#include "../log/log.h"
+
+// 服务端的 TLS 配置，所有连接共用一个 SSL_CTX
+// 会话恢复同时支持会话票据（无状态，TLS 1.3 与支持票据的 1.2 客户端）和服务端会话缓存（按会话 ID）；
+// 握手完成后由 OpenSSL 尝试开启内核 TLS（kTLS），之后加密在内核中完成，
+// 静态文件的映射可以直接 writev 到 socket，不再经过 SSL_write 的用户态加密和拷贝
+class TlsContext {
+public:
+    static const int SESSION_CACHE_SIZE = 20480; // 会话缓存的条目上限
+    static const long SESSION_TIMEOUT_S = 3600;  // 会话和票据的有效期
+    static const int SESSION_TICKETS = 1;        // TLS 1.3 握手后发给客户端的票据数
+
+    static TlsContext* instance();
+
+    // 加载 PEM 格式的证书链和私钥；ktls 为 false 时只用用户态加密（用于对比）
+    // 失败时返回 false，已有的配置不变；只在启动时调用
+    bool Init(const std::string& cert_file, const std::string& key_file, bool ktls = true);
+    bool IsEnabled() const { return ctx_ != nullptr; }
+    bool IsKtlsEnabled() const { return ktls_; } // 配置了 kTLS 且内核支持
+
+    SSL* NewSsl(int fd) const; // 服务端模式的 SSL 对象，失败时返回 nullptr
+
+private:
+    TlsContext();
+    ~TlsContext();
+
+    static bool ProbeKtls(); // 内核是否提供 tls ULP
+
+    SSL_CTX* ctx_;
+    bool ktls_;
+};
+
+#endif // TLS_CONTEXT_H
@@ -0,0 +1,410 @@
+#include "../code/pool/async_sql_pool.h"
+#include "../code/store/mysql_user_store.h"
+#include "mock_mysql.h"
+#include <iostream>
+#include <cassert>
+#include <map>
+#include <algorithm>
+#include <set>
+#include <thread>
+
+// 主线程的事件循环：把数据库 socket 的事件交给连接池，直到 done 或超过 max_ms
+bool Pump(Epoller& epoller, const std::function<bool()>& done, int max_ms = 2000) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(max_ms);
+    AsyncSqlPool* pool = AsyncSqlPool::instance();
+    while (!done()) {
+        if (std::chrono::steady_clock::now() >= deadline)
+            return false;
+        int timeout = pool->GetNextTick();
+        if (timeout < 0 || timeout > 10)
+            timeout = 10;
+        int n = epoller.Wait(timeout);
+        for (int i = 0; i < n; ++i) {
+            int fd = epoller.GetEventsFd(i);
+            if (pool->Owns(fd))
+                pool->OnEvent(fd, epoller.GetEvents(i));
+        }
+    }
+    return true;
+}
+
+// 模拟 User 表：SELECT 按用户名查找，INSERT 写入；多行语句的参数依次为每行的值
+// 带 ON DUPLICATE KEY UPDATE 时跳过已存在的用户名，否则整条语句失败
+mock_mysql::Handler UserTable(std::map<std::string, std::string>* users) {
+    return [users](const std::string& sql, const std::vector<std::string>& params) {
+        mock_mysql::Result result;
+        if (sql.compare(0, 6, "SELECT") == 0) {
+            result.columns = {"username", "password"};
+            std::set<std::string> names(params.begin(), params.end());
+            for (const std::string& name : names) {
+                auto it = users->find(name);
+                if (it != users->end())
+                    result.rows.push_back({it->first, it->second});
+            }
+        } else if (sql.compare(0, 6, "INSERT") == 0) {
+            bool upsert = sql.find("ON DUPLICATE KEY UPDATE") != std::string::npos;
+            for (size_t i = 0; i + 1 < params.size(); i += 2) {
+                if (users->count(params[i]) && !upsert) {
+                    result.ok = false;
+                    result.error = 1062; // ER_DUP_ENTRY
+                    return result;
+                }
+            }
+            for (size_t i = 0; i + 1 < params.size(); i += 2) {
+                if (users->emplace(params[i], params[i + 1]).second)
+                    result.affected++;
+            }
+        }
+        return result;
+    };
+}
+
+// 测试文本查询和预处理语句经过事件循环完成，语句在连接上只 prepare 一次
+void TestQuery() {
+    mock_mysql::Reset();
+    mock_mysql::Server& server = mock_mysql::Instance("localhost", 3306);
+    server.handler = [](const std::string& sql, const std::vector<std::string>& params) {
+        mock_mysql::Result result;
+        if (sql == "SELECT 1") {
+            result.columns = {"1"};
+            result.rows = {{"1"}};
+        } else if (sql == "SELECT name FROM t WHERE id=?") {
+            result.columns = {"name"};
+            result.rows = {{"name" + params[0]}};
+        } else if (sql == "BAD") {
+            result.ok = false;
+        }
+        return result;
+    };
+    Epoller epoller;
+    AsyncSqlPool* pool = AsyncSqlPool::instance();
+    pool->Init("localhost", 3306, "root", "root", "webserver", 1);
+    pool->Attach(&epoller);
+    assert(server.connects == 1);
+
+    int done = 0;
+    pool->Query("SELECT 1", [&](bool ok, const SqlRows& rows) {
+        assert(ok && rows.size() == 1 && rows[0][0] == "1");
+        ++done;
+    });
+    assert(done == 0); // 回调在事件循环中执行
+    for (int i = 0; i < 3; ++i) {
+        pool->Execute("SELECT name FROM t WHERE id=?", {std::to_string(i)}, [&, i](bool ok, const SqlRows& rows) {
+            assert(ok && rows.size() == 1 && rows[0][0] == "name" + std::to_string(i));
+            ++done;
+        });
+    }
+    assert(Pump(epoller, [&]() { return done == 4; }));
+    assert(server.prepares == 1);
+
+    // 查询出错不影响连接，后面的查询照常执行
+    pool->Query("BAD", [&](bool ok, const SqlRows&) {
+        assert(!ok);
+        ++done;
+    });
+    pool->Query("INSERT INTO t VALUES(1)", [&](bool ok, const SqlRows& rows) {
+        assert(ok && rows.empty());
+        ++done;
+    });
+    assert(Pump(epoller, [&]() { return done == 6; }));
+    assert(server.connects == 1);
+
+    // 其他线程提交的查询由唤醒 fd 交给主线程
+    std::thread worker([&]() {
+        pool->Query("SELECT 1", [&](bool ok, const SqlRows&) {
+            assert(ok);
+            ++done;
+        });
+    });
+    worker.join();
+    assert(Pump(epoller, [&]() { return done == 7; }));
+    pool->ClosePool();
+
+    // 关闭后提交的查询在当前线程上立即失败
+    bool failed = false;
+    pool->Query("SELECT 1", [&](bool ok, const SqlRows&) { failed = !ok; });
+    assert(failed);
+    assert(mock_mysql::Connections("localhost", 3306) == 0);
+}
+
+// 测试空闲连接被服务端关闭后重连，重连失败时查询立即失败，恢复后继续服务
+void TestReconnect() {
+    mock_mysql::Reset();
+    mock_mysql::Server& server = mock_mysql::Instance("localhost", 3306);
+    Epoller epoller;
+    AsyncSqlPool* pool = AsyncSqlPool::instance();
+    pool->Init("localhost", 3306, "root", "root", "webserver", 1);
+    pool->Attach(&epoller);
+
+    server.down = true;
+    mock_mysql::Kill("localhost", 3306);
+    bool ok = true, called = false;
+    assert(Pump(epoller, [&]() { return mock_mysql::Connections("localhost", 3306) == 0; }));
+    pool->Query("SELECT 1", [&](bool result, const SqlRows&) {
+        ok = result;
+        called = true;
+    });
+    assert(Pump(epoller, [&]() { return called; }));
+    assert(!ok); // 没有可用的连接，不等到排队超时
+
+    server.down = false;
+    called = false;
+    assert(Pump(epoller, [&]() { return server.connects == 2; })); // 退避后重连成功
+    pool->Query("SELECT 1", [&](bool result, const SqlRows&) {
+        ok = result;
+        called = true;
+    });
+    assert(Pump(epoller, [&]() { return called; }));
+    assert(ok);
+    pool->ClosePool();
+}
+
+// 测试空闲连接 ping 失败后重连
+void TestPingReconnect() {
+    mock_mysql::Reset();
+    mock_mysql::Server& server = mock_mysql::Instance("localhost", 3306);
+    Epoller epoller;
+    AsyncSqlPool* pool = AsyncSqlPool::instance();
+    pool->SetPingInterval(20);
+    pool->Init("localhost", 3306, "root", "root", "webserver", 1);
+    pool->Attach(&epoller);
+
+    // 服务端已断开但 socket 没有关闭，只有 ping 能发现
+    server.fail_ping = true;
+    assert(Pump(epoller, [&]() { return server.pings >= 1 && server.connects >= 2; }));
+    server.fail_ping = false;
+    int pings = server.pings;
+    assert(Pump(epoller, [&]() { return server.pings >= pings + 2; })); // 新连接照常 ping
+    int connects = server.connects;
+    assert(connects <= 3);
+    bool ok = false, called = false;
+    pool->Query("SELECT 1", [&](bool result, const SqlRows&) {
+        ok = result;
+        called = true;
+    });
+    assert(Pump(epoller, [&]() { return called; }));
+    assert(ok && server.connects == connects);
+    pool->ClosePool();
+    pool->SetPingInterval(30000);
+}
+
+// 测试排队超过 acquire timeout 的查询直接失败，已在执行的查询不受影响
+void TestAcquireTimeout() {
+    mock_mysql::Reset();
+    mock_mysql::Server& server = mock_mysql::Instance("localhost", 3306);
+    Epoller epoller;
+    AsyncSqlPool* pool = AsyncSqlPool::instance();
+    pool->SetAcquireTimeout(50);
+    pool->Init("localhost", 3306, "root", "root", "webserver", 1);
+    pool->Attach(&epoller);
+
+    server.hang = true;
+    int first = -1, second = -1;
+    pool->Query("SELECT 1", [&](bool ok, const SqlRows&) { first = ok; });
+    pool->Query("SELECT 2", [&](bool ok, const SqlRows&) { second = ok; });
+    size_t waits = pool->WaitTime().Count();
+    auto start = std::chrono::steady_clock::now();
+    assert(Pump(epoller, [&]() { return second >= 0; }));
+    auto waited = std::chrono::steady_clock::now() - start;
+    assert(second == 0 && first == -1);
+    assert(waited >= std::chrono::milliseconds(50) && waited < std::chrono::milliseconds(500));
+    assert(pool->WaitTime().Count() == waits + 2); // 分到连接的和超时的都计入等待时间
+    assert(server.queries == 1);
+
+    server.hang = false;
+    mock_mysql::Release();
+    assert(Pump(epoller, [&]() { return first >= 0; }));
+    assert(first == 1);
+    pool->ClosePool();
+    pool->SetAcquireTimeout(500);
+}
+
+// 测试查询排队时扩容到 max_size，空闲后收缩回常驻的连接数
+void TestElastic() {
+    mock_mysql::Reset();
+    mock_mysql::Server& server = mock_mysql::Instance("localhost", 3306);
+    Epoller epoller;
+    AsyncSqlPool* pool = AsyncSqlPool::instance();
+    pool->SetShrinkIdle(50);
+    pool->Init("localhost", 3306, "root", "root", "webserver", 1, 3);
+    pool->Attach(&epoller);
+
+    server.hang = true;
+    int done = 0;
+    for (int i = 0; i < 4; ++i)
+        pool->Query("SELECT 1", [&](bool ok, const SqlRows&) {
+            assert(ok);
+            ++done;
+        });
+    assert(Pump(epoller, [&]() { return server.queries == 3; }));
+    Pump(epoller, []() { return false; }, 30);
+    assert(server.connects == 3 && server.queries == 3); // 不超过 max_size，第 4 个继续排队
+
+    server.hang = false;
+    mock_mysql::Release();
+    assert(Pump(epoller, [&]() { return done == 4; }));
+    assert(Pump(epoller, []() { return mock_mysql::Connections("localhost", 3306) == 1; }));
+
+    // 收缩后的槽位在下次扩容时重新使用
+    server.hang = true;
+    for (int i = 0; i < 2; ++i)
+        pool->Query("SELECT 1", [&](bool ok, const SqlRows&) {
+            assert(ok);
+            ++done;
+        });
+    assert(Pump(epoller, [&]() { return server.queries == 6; }));
+    assert(server.connects == 4 && mock_mysql::Connections("localhost", 3306) == 2);
+    server.hang = false;
+    mock_mysql::Release();
+    assert(Pump(epoller, [&]() { return done == 6; }));
+    pool->ClosePool();
+    pool->SetShrinkIdle(60000);
+}
+
+int CountSql(const mock_mysql::Server& server, const std::string& sql) {
+    return std::count(server.sqls.begin(), server.sqls.end(), sql);
+}
+
+// 测试从库的延迟测量和读写路由：延迟在阈值内时读发往从库，延迟过大、复制中断或从库断开时回到主库
+void TestReplica() {
+    mock_mysql::Reset();
+    mock_mysql::Server& primary = mock_mysql::Instance("localhost", 3306);
+    mock_mysql::Server& replica = mock_mysql::Instance("replica", 3307);
+    const std::string LAG_SQL = "SHOW SLAVE STATUS";
+    const std::string READ = "SELECT v FROM t";
+    std::string lag = "0", lag_column = "Seconds_Behind_Master";
+    replica.handler = [&](const std::string& sql, const std::vector<std::string>&) {
+        mock_mysql::Result result;
+        if (sql == LAG_SQL) {
+            result.columns = {"Slave_IO_State", lag_column, "Master_Host"};
+            result.rows = {{"Waiting for master to send event", lag, "localhost"}};
+        }
+        return result;
+    };
+    Epoller epoller;
+    AsyncSqlPool* pool = AsyncSqlPool::instance();
+    pool->SetReplicaLag(1000, LAG_SQL);
+    pool->Init("localhost", 3306, "root", "root", "webserver", 1);
+    pool->AddReplica("replica", 3307, 1);
+    pool->Attach(&epoller);
+
+    // 等到第 probes 次测量完成
+    auto probe = [&](int probes) {
+        assert(Pump(epoller, [&]() { return CountSql(replica, LAG_SQL) >= probes; }));
+        Pump(epoller, []() { return false; }, 20);
+    };
+    // 执行一次查询，返回它被发往的节点
+    auto route = [&](bool read_only) {
+        int on_primary = CountSql(primary, READ);
+        bool done = false;
+        pool->Query(READ, [&](bool ok, const SqlRows&) {
+            assert(ok);
+            done = true;
+        }, read_only);
+        assert(Pump(epoller, [&]() { return done; }));
+        return CountSql(primary, READ) > on_primary ? "primary" : "replica";
+    };
+
+    probe(1);
+    assert(route(true) == std::string("replica"));
+    assert(route(false) == std::string("primary")); // 写查询总是发往主库
+
+    lag = "5"; // 超过 1000ms 的阈值
+    probe(2);
+    assert(route(true) == std::string("primary"));
+
+    lag = ""; // 复制已停止，延迟为 NULL
+    probe(3);
+    assert(route(true) == std::string("primary"));
+
+    lag = "1";
+    lag_column = "Seconds_Behind_Source"; // MySQL 8.0.22 之后的列名
+    probe(4);
+    assert(route(true) == std::string("replica"));
+
+    // 从库断开且无法重连
+    replica.down = true;
+    mock_mysql::Kill("replica", 3307);
+    assert(Pump(epoller, []() { return mock_mysql::Connections("replica", 3307) == 0; }));
+    assert(route(true) == std::string("primary"));
+    pool->ClosePool();
+    pool->SetReplicaLag(3000);
+}
+
+// 测试 MySQL 用户存储的查找和注册
+void TestMysqlUserStore() {
+    mock_mysql::Reset();
+    std::map<std::string, std::string> users = {{"alice", "123"}};
+    mock_mysql::Instance("localhost", 3306).handler = UserTable(&users);
+    Epoller epoller;
+    AsyncSqlPool* pool = AsyncSqlPool::instance();
+    pool->Init("localhost", 3306, "root", "root", "webserver", 2);
+    pool->Attach(&epoller);
+
+    MysqlUserStore store;
+    int done = 0;
+    store.FindUser("alice", [&](bool ok, bool exists, const std::string& password) {
+        assert(ok && exists && password == "123");
+        ++done;
+    });
+    store.FindUser("bob", [&](bool ok, bool exists, const std::string&) {
+        assert(ok && !exists);
+        ++done;
+    });
+    store.AddUser("bob", "456", [&](bool ok) {
+        assert(ok);
+        ++done;
+    });
+    assert(Pump(epoller, [&]() { return done == 3; }));
+    store.AddUser("bob", "789", [&](bool ok) {
+        assert(!ok); // 用户名已存在
+        ++done;
+    });
+    assert(Pump(epoller, [&]() { return done == 4; }));
+    assert(users["bob"] == "456");
+
+    // 批量注册：已存在的用户名只让该行失败，行数补齐到 2 的幂
+    UserStore::UserList batch = {{"alice", "a"}, {"carol", "c"}, {"dave", "d"}};
+    std::vector<bool> results;
+    store.AddUsers(batch, [&](const std::vector<bool>& ret) { results = ret; });
+    assert(Pump(epoller, [&]() { return !results.empty(); }));
+    assert(results == std::vector<bool>({false, true, true}));
+    assert(users["alice"] == "123" && users["dave"] == "d");
+
+    // 超过 64 行时拆成两批，各批的行数都是 2 的幂
+    batch.clear();
+    for (int i = 0; i < 70; ++i)
+        batch.push_back({"user" + std::to_string(i), std::to_string(i)});
+    batch.push_back({"bob", "000"});
+    results.clear();
+    store.AddUsers(batch, [&](const std::vector<bool>& ret) { results = ret; });
+    assert(Pump(epoller, [&]() { return !results.empty(); }));
+    assert(results.size() == 71 && !results.back());
+    for (int i = 0; i < 70; ++i)
+        assert(results[i] && users["user" + std::to_string(i)] == std::to_string(i));
+
+    std::set<size_t> sizes;
+    for (const std::string& sql : mock_mysql::Instance("localhost", 3306).sqls) {
+        if (sql.compare(0, 6, "INSERT") != 0 || sql.find("ON DUPLICATE KEY UPDATE") == std::string::npos)
+            continue;
+        size_t rows = 0;
+        for (size_t pos = sql.find("(?, ?)"); pos != std::string::npos; pos = sql.find("(?, ?)", pos + 1))
+            ++rows;
+        sizes.insert(rows);
+    }
+    assert(sizes == std::set<size_t>({4, 8, 64}));
+    pool->ClosePool();
+}
+
+int main() {
+    Log::GetInstance()->Init(0, "./logs/", ".log", 0);
+    TestQuery();
+    TestReconnect();
+    TestPingReconnect();
+    TestAcquireTimeout();
+    TestElastic();
+    TestReplica();
+    TestMysqlUserStore();
+    std::cout << "All tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include "../code/http/chunk_scanner.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+
+// 按 step 字节喂给扫描器，像转发时一样：框架交给 Scan，块内容只跳过；返回拼出的块内容
+// 报文结束后剩下的字节留在 rest 中；格式错误时返回 false
+bool Decode(const std::string& body, size_t step, std::string* content, std::string* rest) {
+    ChunkScanner scanner;
+    content->clear();
+    size_t pos = 0;
+    while (pos < body.size() && !scanner.IsDone()) {
+        size_t len = std::min(step, body.size() - pos);
+        if (scanner.DataLeft() > 0) {
+            size_t n = std::min(len, scanner.DataLeft());
+            content->append(body, pos, n);
+            scanner.Skip(n);
+            pos += n;
+            continue;
+        }
+        long n = scanner.Scan(body.data() + pos, len);
+        if (n < 0)
+            return false;
+        pos += n;
+    }
+    *rest = body.substr(pos);
+    return scanner.IsDone();
+}
+
+void TestDecode() {
+    const std::string body = "4\r\nWiki\r\n5;name=value\r\npedia\r\nE\r\n in\r\n\r\nchunks.\r\n0\r\n\r\n";
+    const std::string expect = "Wikipedia in\r\n\r\nchunks.";
+    for (size_t step : {1, 2, 3, 7, 64, 1000}) {
+        std::string content, rest;
+        assert(Decode(body + "GET / HTTP/1.1\r\n", step, &content, &rest));
+        assert(content == expect);
+        assert(rest == "GET / HTTP/1.1\r\n"); // 下一个报文不属于这个报文体
+    }
+}
+
+// 尾部字段和大写的十六进制
+void TestTrailer() {
+    std::string data(0x1A, 'x');
+    const std::string body = "1A\r\n" + data + "\r\n0\r\nExpires: never\r\nX-Sum: 1\r\n\r\n";
+    for (size_t step : {1, 5, 1000}) {
+        std::string content, rest;
+        assert(Decode(body, step, &content, &rest));
+        assert(content == data && rest.empty());
+    }
+}
+
+// Scan 停在块内容开头，返回的都是框架的字节数
+void TestStopAtData() {
+    ChunkScanner scanner;
+    const char* frame = "10\r\nabcdefghijklmnop\r\n";
+    assert(scanner.Scan(frame, 22) == 4);
+    assert(scanner.State() == ChunkScanner::DATA && scanner.DataLeft() == 16);
+    assert(scanner.Scan(frame + 4, 5) == 0); // 块内容不由 Scan 处理
+    scanner.Skip(10);
+    assert(scanner.DataLeft() == 6);
+    scanner.Skip(6);
+    assert(scanner.State() == ChunkScanner::DATA_CR && scanner.DataLeft() == 0);
+    assert(scanner.Scan("\r", 1) == 1); // 框架可以被分在两次之间
+    assert(scanner.Scan("\n0", 2) == 2);
+    assert(scanner.Scan("\r\n\r\nHTTP", 8) == 4);
+    assert(scanner.IsDone());
+    assert(scanner.Scan("HTTP", 4) == 0);
+}
+
+void TestErrors() {
+    const char* bad[] = {
+        "\r\n",                  // 没有块大小
+        "g\r\n",                 // 不是十六进制
+        "5\n",                   // 缺少回车
+        "1\r\nab\r\n",           // 内容比块大小长
+        "1000000000000000\r\n",  // 块大小超过 15 位
+        "0\r\nX: 1\r\n\n",       // 结尾的空行缺少回车
+    };
+    for (const char* body : bad) {
+        std::string content, rest;
+        assert(!Decode(body, 1, &content, &rest));
+    }
+    // 块扩展或尾部字段行过长
+    std::string content, rest;
+    assert(!Decode("1;" + std::string(5000, 'e') + "\r\nx\r\n0\r\n\r\n", 100, &content, &rest));
+    assert(Decode("1;" + std::string(4000, 'e') + "\r\nx\r\n0\r\n\r\n", 100, &content, &rest));
+    assert(!Decode("0\r\n" + std::string(5000, 't') + "\r\n\r\n", 100, &content, &rest));
+
+    ChunkScanner scanner;
+    assert(scanner.Scan("zz", 2) == -1 && scanner.State() == ChunkScanner::ERROR);
+    scanner.Init();
+    assert(scanner.Scan("0\r\n\r\n", 5) == 5 && scanner.IsDone());
+}
+
+int main() {
+    TestDecode();
+    TestTrailer();
+    TestStopAtData();
+    TestErrors();
+    std::cout << "All tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "../code/pool/wait_histogram.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+// 建连速率基准：多个线程不断地 建连 ->（可选）发一个请求并读完响应 -> 关闭，
+// 统计每秒完成的连接数和单次建连的耗时分布，用于比较 accept 路径的改动
+// 用法：connect_bench [ip] [port] [seconds] [threads] [mode]
+// mode 0: 只建连后关闭（模拟扫描）；1: 建连后发请求；2: 请求随 SYN 发送（TCP Fast Open）
+// 服务端需要先启动；请求模式下使用 Connection: close，由服务端关闭连接
+// mode 2 需要客户端 net.ipv4.tcp_fastopen 打开第 1 位，服务端打开第 2 位
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string ip = "127.0.0.1";
+    int port = 8080;
+    int seconds = 5;
+    int threads = 4;
+    int mode = 0;
+};
+
+enum MODE {
+    MODE_CONNECT,
+    MODE_REQUEST,
+    MODE_FASTOPEN
+};
+
+void Worker(const Options& opt, std::atomic<bool>& stop, std::atomic<long>& done,
+            std::atomic<long>& failed, WaitHistogram& connect_time) {
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opt.port);
+    inet_pton(AF_INET, opt.ip.c_str(), &addr.sin_addr);
+    const char* req = "GET /index.html HTTP/1.1\r\nHost: bench\r\nConnection: close\r\n\r\n";
+    char buf[16384];
+
+    while (!stop) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            failed++;
+            continue;
+        }
+        // 客户端主动关闭会留下大量 TIME_WAIT，用 RST 关闭避免耗尽本地端口
+        linger lg = {1, 0};
+        setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+        Clock::time_point start = Clock::now();
+        bool ok = true;
+        if (opt.mode == MODE_FASTOPEN) {
+            // 有 cookie 时数据放在 SYN 中，否则内核退回普通握手后再发送
+            ok = sendto(fd, req, strlen(req), MSG_FASTOPEN, (sockaddr*)&addr, sizeof(addr)) ==
+                 static_cast<ssize_t>(strlen(req));
+        } else {
+            ok = connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0;
+        }
+        if (!ok) {
+            failed++;
+            close(fd);
+            continue;
+        }
+        connect_time.Record(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+        if (opt.mode != MODE_CONNECT) {
+            if (opt.mode == MODE_REQUEST)
+                ok = write(fd, req, strlen(req)) == static_cast<ssize_t>(strlen(req));
+            ssize_t total = 0, len = 0;
+            while (ok && (len = read(fd, buf, sizeof(buf))) > 0)
+                total += len;
+            ok = ok && total > 0;
+        }
+        close(fd);
+        if (ok)
+            done++;
+        else
+            failed++;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    if (argc > 1) opt.ip = argv[1];
+    if (argc > 2) opt.port = atoi(argv[2]);
+    if (argc > 3) opt.seconds = atoi(argv[3]);
+    if (argc > 4) opt.threads = atoi(argv[4]);
+    if (argc > 5) opt.mode = std::min(std::max(atoi(argv[5]), 0), static_cast<int>(MODE_FASTOPEN));
+
+    std::atomic<bool> stop(false);
+    std::atomic<long> done(0), failed(0);
+    WaitHistogram connect_time;
+    std::vector<std::thread> threads;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < opt.threads; ++i)
+        threads.emplace_back(Worker, std::cref(opt), std::ref(stop), std::ref(done),
+                             std::ref(failed), std::ref(connect_time));
+    std::this_thread::sleep_for(std::chrono::seconds(opt.seconds));
+    stop = true;
+    for (auto& thread : threads)
+        thread.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    const char* names[] = {"connect", "connect+request", "fastopen+request"};
+    std::cout << names[opt.mode] << " " << opt.ip << ":" << opt.port
+              << " threads=" << opt.threads << std::endl;
+    std::cout << "done=" << done << " failed=" << failed
+              << " rate=" << static_cast<long>(done / elapsed) << "/s" << std::endl;
+    std::cout << "connect " << connect_time.Summary() << std::endl;
+    return 0;
+}
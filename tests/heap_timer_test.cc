@@ -1,6 +1,7 @@
 #include "../code/heap_timer/heap_timer.h"
 #include "../code/log/log.h"
 #include <cassert>
+#include <iostream>
 
 void CallbackFunction() {
     LOG_DEBUG("Callback function is called!")
@@ -31,6 +32,56 @@ void TestTick() {
     assert(timer.Size() == 0);
 }
 
+// 回调中为同一个 id 重新添加定时器（如 WebSocket 的 ping），新的定时器保留
+void TestReAddInCallback() {
+    HeapTimer timer;
+    int id = 1;
+    int calls = 0;
+    std::function<void()> cb = [&]() {
+        if (++calls < 2)
+            timer.Add(id, 10, cb);
+    };
+    timer.Add(id, 0, cb);
+    timer.Tick();
+    assert(calls == 1 && timer.Size() == 1);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    timer.Tick();
+    assert(calls == 2 && timer.Size() == 0);
+}
+
+// 新加入的更早到期的定时器要上浮到堆顶，即使它的父节点就是堆顶
+void TestSiftUpToRoot() {
+    HeapTimer timer;
+    timer.Add(1, 1000, CallbackFunction);
+    timer.Add(2, 10, CallbackFunction);
+    assert(timer.GetNextTick() <= 10);
+    timer.Add(3, 0, CallbackFunction);
+    assert(timer.GetNextTick() <= 10 && timer.Size() == 2); // 3 已到期被移除
+}
+
+// 删除倒数第二个节点（两个定时器时弹出堆顶）时移除的是它本身，而不是最后一个节点
+void TestDeleteSecondToLast() {
+    HeapTimer timer;
+    int first = 0, second = 0;
+    timer.Add(1, 0, [&]() { ++first; });
+    timer.Add(2, 1000, [&]() { ++second; });
+    timer.Tick();
+    assert(first == 1 && second == 0 && timer.Size() == 1);
+    assert(timer.GetNextTick() > 500);
+
+    // 三个节点时删除中间的
+    timer.Clear();
+    first = second = 0;
+    timer.Add(1, 0, [&]() { ++first; });
+    timer.Add(2, 1000, [&]() { ++second; });
+    timer.Add(3, 2000, [&]() { ++second; });
+    timer.Tick();
+    assert(first == 1 && second == 0 && timer.Size() == 2);
+    int next = timer.GetNextTick();
+    assert(next > 500 && next <= 1000);
+}
+
 // 测试 GetNextTick 函数
 void TestGetNextTick() {
     HeapTimer timer;
@@ -48,6 +99,10 @@ int main() {
 
     TestAdd();
     TestTick();
+    TestReAddInCallback();
+    TestSiftUpToRoot();
+    TestDeleteSecondToLast();
     TestGetNextTick();
+    std::cout << "All tests passed!" << std::endl;
     return 0;
 }
@@ -0,0 +1,173 @@
+#include "../code/http/hpack.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <utility>
+
+using Headers = std::vector<std::pair<std::string, std::string>>;
+
+std::string FromHex(const char* hex) {
+    std::string out;
+    for (const char* p = hex; *p; ) {
+        if (*p == ' ') {
+            ++p;
+            continue;
+        }
+        out.push_back(static_cast<char>(std::stoi(std::string(p, 2), nullptr, 16)));
+        p += 2;
+    }
+    return out;
+}
+
+bool Decode(HpackDecoder& decoder, const std::string& block, Headers* headers) {
+    headers->clear();
+    return decoder.Decode(reinterpret_cast<const uint8_t*>(block.data()), block.size(),
+        [headers](const std::string& name, const std::string& value) {
+            headers->emplace_back(name, value);
+            return true;
+        });
+}
+
+// RFC 7541 C.1
+void TestInteger() {
+    std::string out;
+    Hpack::EncodeInteger(10, 5, 0, &out);
+    assert(out == FromHex("0a"));
+    out.clear();
+    Hpack::EncodeInteger(1337, 5, 0, &out);
+    assert(out == FromHex("1f 9a 0a"));
+    out.clear();
+    Hpack::EncodeInteger(42, 8, 0, &out);
+    assert(out == FromHex("2a"));
+
+    std::string in = FromHex("1f 9a 0a");
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(in.data());
+    uint64_t value = 0;
+    assert(Hpack::DecodeInteger(&p, p + in.size(), 5, &value) && value == 1337);
+    in = FromHex("1f 9a"); // 不完整
+    p = reinterpret_cast<const uint8_t*>(in.data());
+    assert(!Hpack::DecodeInteger(&p, p + in.size(), 5, &value));
+    in = FromHex("7f ff ff ff ff ff ff ff ff ff ff 01"); // 溢出
+    p = reinterpret_cast<const uint8_t*>(in.data());
+    assert(!Hpack::DecodeInteger(&p, p + in.size(), 7, &value));
+}
+
+// RFC 7541 C.4.1 与 C.6.1 中的 Huffman 字符串
+void TestHuffman() {
+    std::string out;
+    Hpack::HuffmanEncode("www.example.com", &out);
+    assert(out == FromHex("f1e3 c2e5 f23a 6ba0 ab90 f4ff"));
+    assert(Hpack::HuffmanLength("www.example.com") == out.size());
+    out.clear();
+    Hpack::HuffmanEncode("Mon, 21 Oct 2013 20:13:21 GMT", &out);
+    assert(out == FromHex("d07a be94 1054 d444 a820 0595 040b 8166 e082 a62d 1bff"));
+
+    std::string all;
+    for (int i = 0; i < 256; ++i)
+        all.push_back(static_cast<char>(i));
+    std::string encoded, decoded;
+    Hpack::HuffmanEncode(all, &encoded);
+    assert(Hpack::HuffmanDecode(reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size(), &decoded));
+    assert(decoded == all);
+
+    // 填充超过 7 位、填充不全为 1 都是错误
+    std::string bad = FromHex("ff");
+    assert(!Hpack::HuffmanDecode(reinterpret_cast<const uint8_t*>(bad.data()), bad.size(), &decoded));
+    bad = FromHex("00"); // '0' 为 00000，后 3 位填充为 0
+    assert(!Hpack::HuffmanDecode(reinterpret_cast<const uint8_t*>(bad.data()), bad.size(), &decoded));
+    bad = FromHex("07"); // '0' 加 3 位全 1 的填充
+    assert(Hpack::HuffmanDecode(reinterpret_cast<const uint8_t*>(bad.data()), bad.size(), &decoded));
+    assert(decoded == "0");
+}
+
+// RFC 7541 C.4：使用 Huffman 编码、共享动态表的三个请求
+void TestRequests() {
+    HpackDecoder decoder;
+    Headers headers;
+    assert(Decode(decoder, FromHex("8286 8441 8cf1 e3c2 e5f2 3a6b a0ab 90f4 ff"), &headers));
+    assert((headers == Headers{{":method", "GET"}, {":scheme", "http"}, {":path", "/"},
+                               {":authority", "www.example.com"}}));
+    assert(decoder.TableSize() == 57 && decoder.TableEntries() == 1);
+
+    assert(Decode(decoder, FromHex("8286 84be 5886 a8eb 1064 9cbf"), &headers));
+    assert((headers == Headers{{":method", "GET"}, {":scheme", "http"}, {":path", "/"},
+                               {":authority", "www.example.com"}, {"cache-control", "no-cache"}}));
+    assert(decoder.TableSize() == 110 && decoder.TableEntries() == 2);
+
+    assert(Decode(decoder, FromHex("8287 85bf 4088 25a8 49e9 5ba9 7d7f 8925 a849 e95b b8e8 b4bf"), &headers));
+    assert((headers == Headers{{":method", "GET"}, {":scheme", "https"}, {":path", "/index.html"},
+                               {":authority", "www.example.com"}, {"custom-key", "custom-value"}}));
+    assert(decoder.TableSize() == 164 && decoder.TableEntries() == 3);
+}
+
+// RFC 7541 C.5：动态表上限为 256，第三个响应会淘汰旧的项
+void TestEviction() {
+    HpackDecoder decoder(256);
+    Headers headers;
+    assert(Decode(decoder, FromHex(
+        "4803 3330 3258 0770 7269 7661 7465 611d 4d6f 6e2c 2032 3120 4f63 7420 3230 3133 "
+        "2032 303a 3133 3a32 3120 474d 546e 1768 7474 7073 3a2f 2f77 7777 2e65 7861 6d70 "
+        "6c65 2e63 6f6d"), &headers));
+    assert(headers.size() == 4 && headers[0].second == "302");
+    assert(decoder.TableSize() == 222 && decoder.TableEntries() == 4);
+
+    assert(Decode(decoder, FromHex("4803 3330 37c1 c0bf"), &headers));
+    assert(headers[0].second == "307" && headers[3].second == "https://www.example.com");
+    assert(decoder.TableSize() == 222 && decoder.TableEntries() == 4);
+
+    assert(Decode(decoder, FromHex(
+        "88c1 611d 4d6f 6e2c 2032 3120 4f63 7420 3230 3133 2032 303a 3133 3a32 3220 474d "
+        "54c0 5a04 677a 6970 7738 666f 6f3d 4153 444a 4b48 514b 425a 584f 5157 454f 5049 "
+        "5541 5851 5745 4f49 553b 206d 6178 2d61 6765 3d33 3630 303b 2076 6572 7369 6f6e "
+        "3d31"), &headers));
+    assert(headers.size() == 6 && headers[0].second == "200" && headers[4].first == "content-encoding");
+    assert(decoder.TableSize() == 215 && decoder.TableEntries() == 3);
+}
+
+void TestErrors() {
+    HpackDecoder decoder(256);
+    Headers headers;
+    assert(!Decode(decoder, FromHex("80"), &headers));    // 下标 0
+    assert(!Decode(decoder, FromHex("be"), &headers));    // 动态表为空
+    assert(!Decode(decoder, FromHex("3f e2 1f"), &headers)); // 大小更新超过上限
+    assert(Decode(decoder, FromHex("20"), &headers));      // 开头的大小更新
+    assert(!Decode(decoder, FromHex("82 20"), &headers));  // 大小更新不在开头
+    assert(!Decode(decoder, FromHex("41 85 ab"), &headers)); // 字符串被截断
+
+    // 回调返回 false 时中止
+    std::string block = FromHex("8286");
+    int calls = 0;
+    assert(!decoder.Decode(reinterpret_cast<const uint8_t*>(block.data()), block.size(),
+        [&calls](const std::string&, const std::string&) { return ++calls < 1; }));
+    assert(calls == 1);
+}
+
+// 编码的结果用解码器还原
+void TestEncode() {
+    std::string block;
+    Hpack::EncodeStatus(200, &block);
+    Hpack::EncodeStatus(413, &block);
+    Hpack::EncodeHeader(Hpack::NAME_CONTENT_TYPE, "text/html", &block);
+    Hpack::EncodeHeader(Hpack::NAME_CONTENT_LENGTH, "1234", &block);
+    Hpack::EncodeHeader("x-custom", "a", &block);
+    assert(static_cast<uint8_t>(block[0]) == 0x88);
+
+    HpackDecoder decoder;
+    Headers headers;
+    assert(Decode(decoder, block, &headers));
+    assert((headers == Headers{{":status", "200"}, {":status", "413"}, {"content-type", "text/html"},
+                               {"content-length", "1234"}, {"x-custom", "a"}}));
+    assert(decoder.TableEntries() == 0);
+}
+
+int main() {
+    TestInteger();
+    TestHuffman();
+    TestRequests();
+    TestEviction();
+    TestErrors();
+    TestEncode();
+    std::cout << "All tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,486 @@
+#include "../code/http/http2_session.h"
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+// 帧类型、标志和错误码按 RFC 9113 的取值
+enum {
+    DATA = 0x0, HEADERS = 0x1, RST_STREAM = 0x3, SETTINGS = 0x4, PUSH_PROMISE = 0x5,
+    PING = 0x6, GOAWAY = 0x7, WINDOW_UPDATE = 0x8, CONTINUATION = 0x9
+};
+enum { END_STREAM = 0x1, ACK = 0x1, END_HEADERS = 0x4 };
+enum {
+    NO_ERROR = 0x0, PROTOCOL_ERROR = 0x1, FLOW_CONTROL_ERROR = 0x3, STREAM_CLOSED = 0x5,
+    FRAME_SIZE_ERROR = 0x6, REFUSED_STREAM = 0x7, CANCEL = 0x8, COMPRESSION_ERROR = 0x9, ENHANCE_YOUR_CALM = 0xb
+};
+enum { ENABLE_PUSH = 0x2, MAX_CONCURRENT_STREAMS = 0x3, INITIAL_WINDOW_SIZE = 0x4, MAX_FRAME_SIZE = 0x5,
+       MAX_HEADER_LIST_SIZE = 0x6 };
+
+const char* SRC_DIR = "/tmp/http2_session_test/";
+const char PREFACE[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+const size_t SMALL_LEN = 100;
+const size_t BIG_LEN = 200000;
+
+std::string Uint32(uint32_t value) {
+    return std::string{static_cast<char>(value >> 24), static_cast<char>(value >> 16),
+                       static_cast<char>(value >> 8), static_cast<char>(value)};
+}
+
+std::string Setting(uint16_t key, uint32_t value) {
+    return std::string{static_cast<char>(key >> 8), static_cast<char>(key)} + Uint32(value);
+}
+
+std::string Frame(uint8_t type, uint8_t flags, uint32_t id, const std::string& payload) {
+    size_t len = payload.size();
+    std::string frame{static_cast<char>(len >> 16), static_cast<char>(len >> 8), static_cast<char>(len),
+                      static_cast<char>(type), static_cast<char>(flags)};
+    return frame + Uint32(id) + payload;
+}
+
+// 请求的头部块，extra 中的头部跟在伪头部之后
+std::string Request(const std::string& method, const std::string& path,
+                    const std::vector<std::pair<std::string, std::string>>& extra = {}) {
+    std::string block;
+    Hpack::EncodeHeader(":method", method, &block);
+    Hpack::EncodeHeader(":scheme", "http", &block);
+    Hpack::EncodeHeader(":path", path, &block);
+    Hpack::EncodeHeader(":authority", "localhost", &block);
+    for (const auto& header : extra)
+        Hpack::EncodeHeader(header.first, header.second, &block);
+    return block;
+}
+
+std::string Get(uint32_t id, const std::string& path = "/small.html") {
+    return Frame(HEADERS, END_HEADERS | END_STREAM, id, Request("GET", path));
+}
+
+// 服务端写出的一帧
+struct OutFrame {
+    uint8_t type;
+    uint8_t flags;
+    uint32_t id;
+    std::string payload;
+};
+using Frames = std::vector<OutFrame>;
+
+// 模拟 HttpConnect：读缓冲送入会话，写缓冲中的帧读回；DATA 的内容直接拷贝到帧头之后
+struct Peer {
+    Buffer in;
+    Buffer out;
+    Http2Session session;
+    HpackDecoder decoder;
+
+    explicit Peer(int max_streams = 0)
+        : session(SRC_DIR, max_streams, &out, [this](const char* data, size_t len) { out.Append(data, len); }) {}
+
+    Frames Read() {
+        Frames frames;
+        while (out.ReadableBytes() >= Http2Session::FRAME_HEADER_LEN) {
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(out.ReadBegin());
+            size_t len = (size_t(p[0]) << 16) | (size_t(p[1]) << 8) | p[2];
+            assert(out.ReadableBytes() >= Http2Session::FRAME_HEADER_LEN + len);
+            uint32_t id = ((uint32_t(p[5]) << 24) | (uint32_t(p[6]) << 16) | (uint32_t(p[7]) << 8) | p[8]) & 0x7fffffff;
+            frames.push_back({p[3], p[4], id, std::string(out.ReadBegin() + Http2Session::FRAME_HEADER_LEN, len)});
+            out.Retrieve(Http2Session::FRAME_HEADER_LEN + len);
+        }
+        assert(out.ReadableBytes() == 0);
+        return frames;
+    }
+
+    Frames Send(const std::string& data) {
+        in.Append(data);
+        session.Process(in);
+        return Read();
+    }
+
+    // 前言和 SETTINGS 交换，settings 为客户端的设置
+    void Start(const std::string& settings = "") {
+        Frames frames = Send(std::string(PREFACE) + Frame(SETTINGS, 0, 0, settings));
+        assert(frames.size() == 3);
+        assert(frames[0].type == SETTINGS && frames[0].flags == 0 && frames[0].id == 0);
+        assert(frames[1].type == WINDOW_UPDATE && frames[1].id == 0);
+        assert(frames[2].type == SETTINGS && frames[2].flags == ACK && frames[2].payload.empty());
+    }
+
+    std::string Status(const OutFrame& frame) {
+        assert(frame.type == HEADERS);
+        std::string status;
+        bool ok = decoder.Decode(reinterpret_cast<const uint8_t*>(frame.payload.data()), frame.payload.size(),
+            [&status](const std::string& name, const std::string& value) {
+                if (name == ":status")
+                    status = value;
+                return true;
+            });
+        assert(ok);
+        return status;
+    }
+};
+
+bool IsRst(const OutFrame& frame, uint32_t id, uint32_t code) {
+    return frame.type == RST_STREAM && frame.id == id && frame.payload == Uint32(code);
+}
+
+bool IsGoAway(const OutFrame& frame, uint32_t last_stream, uint32_t code) {
+    return frame.type == GOAWAY && frame.id == 0 && frame.payload == Uint32(last_stream) + Uint32(code);
+}
+
+// 新连接上握手后送入 data，应当以 code 关闭连接
+void ExpectGoAway(const std::string& data, uint32_t code, uint32_t last_stream = 0) {
+    Peer peer;
+    peer.Start();
+    Frames frames = peer.Send(data);
+    assert(!frames.empty() && IsGoAway(frames.back(), last_stream, code));
+    assert(peer.session.IsClosing());
+    assert(peer.Send(Frame(PING, 0, 0, "12345678")).empty()); // 之后的帧不再处理
+}
+
+// 一个流的全部 DATA 帧拼起来的内容
+std::string Body(const Frames& frames, uint32_t id, bool* end = nullptr) {
+    std::string body;
+    for (const OutFrame& frame : frames) {
+        if (frame.type == DATA && frame.id == id) {
+            body += frame.payload;
+            if (end)
+                *end = frame.flags & END_STREAM;
+        }
+    }
+    return body;
+}
+
+std::string FileContent(size_t len) {
+    std::string content;
+    for (size_t i = 0; i < len; ++i)
+        content.push_back(static_cast<char>('a' + i % 26));
+    return content;
+}
+
+void WriteFile(const std::string& name, const std::string& content) {
+    std::string path = std::string(SRC_DIR) + name;
+    FILE* fp = fopen(path.c_str(), "w");
+    assert(fp);
+    size_t written = fwrite(content.data(), 1, content.size(), fp);
+    fclose(fp);
+    assert(written == content.size());
+    chmod(path.c_str(), 0644);
+}
+
+// 测试前言和 SETTINGS 交换、PING，以及格式错误的前言和设置
+void TestHandshake() {
+    assert(Http2Session::MatchPreface(PREFACE, 10) == 0);
+    assert(Http2Session::MatchPreface(PREFACE, Http2Session::PREFACE_LEN) == 1);
+    assert(Http2Session::MatchPreface("GET / HTTP/1.1\r\n", 16) == -1);
+
+    Peer peer;
+    assert(peer.Send(std::string(PREFACE, 10)).empty()); // 前言不完整时等待
+    Frames frames = peer.Send(std::string(PREFACE + 10) + Frame(SETTINGS, 0, 0, ""));
+    assert(frames.size() == 3);
+    assert(frames[0].type == SETTINGS && frames[0].flags == 0);
+    assert(frames[0].payload == Setting(MAX_CONCURRENT_STREAMS, 100) + Setting(INITIAL_WINDOW_SIZE, 1 << 20) +
+                                Setting(MAX_HEADER_LIST_SIZE, 65536));
+    assert(frames[1].type == WINDOW_UPDATE && frames[1].id == 0 && frames[1].payload == Uint32((1 << 20) - 65535));
+    assert(frames[2].type == SETTINGS && frames[2].flags == ACK);
+
+    frames = peer.Send(Frame(PING, 0, 0, "12345678"));
+    assert(frames.size() == 1 && frames[0].type == PING && frames[0].flags == ACK && frames[0].payload == "12345678");
+    assert(peer.Send(Frame(PING, ACK, 0, "12345678")).empty());
+    assert(peer.Send(Frame(SETTINGS, ACK, 0, "")).empty());
+    assert(peer.Send(Frame(0xfa, 0, 0, "unknown")).empty()); // 未知的帧类型忽略
+    // 一帧分几次到达
+    std::string ping = Frame(PING, 0, 0, "abcdefgh");
+    assert(peer.Send(ping.substr(0, 5)).empty());
+    assert(peer.Send(ping.substr(5, 6)).empty());
+    frames = peer.Send(ping.substr(11));
+    assert(frames.size() == 1 && frames[0].payload == "abcdefgh");
+    assert(!peer.session.IsClosing());
+
+    Peer bad;
+    frames = bad.Send("GET / HTTP/1.1\r\n\r\n");
+    assert(frames.size() == 1 && IsGoAway(frames[0], 0, PROTOCOL_ERROR));
+    assert(bad.session.IsClosing());
+
+    ExpectGoAway(Frame(SETTINGS, 0, 0, "12345"), FRAME_SIZE_ERROR);
+    ExpectGoAway(Frame(SETTINGS, ACK, 0, Setting(ENABLE_PUSH, 0)), FRAME_SIZE_ERROR);
+    ExpectGoAway(Frame(SETTINGS, 0, 1, ""), PROTOCOL_ERROR);
+    ExpectGoAway(Frame(SETTINGS, 0, 0, Setting(ENABLE_PUSH, 2)), PROTOCOL_ERROR);
+    ExpectGoAway(Frame(SETTINGS, 0, 0, Setting(MAX_FRAME_SIZE, 100)), PROTOCOL_ERROR);
+    ExpectGoAway(Frame(SETTINGS, 0, 0, Setting(INITIAL_WINDOW_SIZE, 0x80000000)), FLOW_CONTROL_ERROR);
+    ExpectGoAway(Frame(PING, 0, 1, "12345678"), PROTOCOL_ERROR);
+    ExpectGoAway(Frame(PING, 0, 0, "1234"), FRAME_SIZE_ERROR);
+    ExpectGoAway(Frame(PING, 0, 0, std::string(16385, 'x')), FRAME_SIZE_ERROR); // 超过 16384 的帧
+}
+
+// 测试请求和响应，以及流状态不对时的流错误和连接错误
+void TestStreams() {
+    Peer peer;
+    peer.Start();
+    Frames frames = peer.Send(Get(1));
+    assert(frames.size() == 2);
+    assert(frames[0].id == 1 && frames[0].flags == END_HEADERS && peer.Status(frames[0]) == "200");
+    assert(frames[1].type == DATA && frames[1].id == 1 && frames[1].flags == END_STREAM);
+    assert(frames[1].payload == FileContent(SMALL_LEN));
+    frames = peer.Send(Get(3, "/missing.html"));
+    assert(frames.size() == 2 && peer.Status(frames[0]) == "404");
+    frames = peer.Send(Frame(HEADERS, END_HEADERS | END_STREAM, 5, Request("HEAD", "/small.html")));
+    assert(frames.size() == 1 && frames[0].flags == (END_HEADERS | END_STREAM) && peer.Status(frames[0]) == "200");
+
+    // 格式错误的请求只重置这个流
+    frames = peer.Send(Frame(HEADERS, END_HEADERS | END_STREAM, 7, Request("GET", "/small.html", {{"X-Upper", "1"}})));
+    assert(frames.size() == 1 && IsRst(frames[0], 7, PROTOCOL_ERROR));
+    frames = peer.Send(Frame(HEADERS, END_HEADERS | END_STREAM, 9, Request("GET", "/small.html", {{"connection", "close"}})));
+    assert(frames.size() == 1 && IsRst(frames[0], 9, PROTOCOL_ERROR));
+    std::string block;
+    Hpack::EncodeHeader(":method", "GET", &block); // 没有 :path
+    frames = peer.Send(Frame(HEADERS, END_HEADERS | END_STREAM, 11, block));
+    assert(frames.size() == 1 && IsRst(frames[0], 11, PROTOCOL_ERROR));
+    // 尾部字段必须结束请求
+    assert(peer.Send(Frame(HEADERS, END_HEADERS, 13, Request("POST", "/small.html"))).empty());
+    frames = peer.Send(Frame(HEADERS, END_HEADERS, 13, ""));
+    assert(frames.size() == 1 && IsRst(frames[0], 13, PROTOCOL_ERROR));
+    assert(peer.Send(Frame(DATA, END_STREAM, 13, "late")).empty()); // 已重置的流上的数据丢弃
+    frames = peer.Send(Get(15));
+    assert(frames.size() == 2 && peer.Status(frames[0]) == "200");
+    assert(!peer.session.IsClosing());
+
+    // 对端已结束的流上又收到 DATA：窗口为 0 时响应发不完，流保持打开
+    Peer half;
+    half.Start(Setting(INITIAL_WINDOW_SIZE, 0));
+    frames = half.Send(Get(1));
+    assert(frames.size() == 1 && frames[0].flags == END_HEADERS);
+    frames = half.Send(Frame(DATA, 0, 1, "x"));
+    assert(frames.size() == 1 && IsRst(frames[0], 1, STREAM_CLOSED));
+    assert(half.Send(Frame(DATA, 0, 1, "x")).empty());
+    assert(half.Send(Frame(WINDOW_UPDATE, 0, 1, Uint32(100))).empty()); // 已关闭的流
+
+    ExpectGoAway(Frame(HEADERS, END_HEADERS, 0, Request("GET", "/")), PROTOCOL_ERROR);
+    ExpectGoAway(Frame(HEADERS, END_HEADERS, 2, Request("GET", "/")), PROTOCOL_ERROR);
+    ExpectGoAway(Get(3) + Get(1), PROTOCOL_ERROR, 3); // 流 id 必须递增
+    ExpectGoAway(Frame(DATA, 0, 1, "x"), PROTOCOL_ERROR); // 空闲的流
+    ExpectGoAway(Frame(WINDOW_UPDATE, 0, 5, Uint32(1)), PROTOCOL_ERROR);
+    ExpectGoAway(Frame(PUSH_PROMISE, END_HEADERS, 1, Uint32(2)), PROTOCOL_ERROR);
+    ExpectGoAway(Frame(HEADERS, END_HEADERS, 1, "\x80"), COMPRESSION_ERROR, 1); // 下标 0
+}
+
+// 测试并发流上限：超过的流被拒绝，RST_STREAM 关闭的流让出名额
+void TestConcurrentStreams() {
+    Peer peer;
+    peer.Start(Setting(INITIAL_WINDOW_SIZE, 0)); // 响应都发不完，流一直打开
+    uint32_t id = 1;
+    for (uint32_t i = 0; i < Http2Session::MAX_CONCURRENT_STREAMS; ++i, id += 2) {
+        Frames frames = peer.Send(Get(id));
+        assert(frames.size() == 1 && frames[0].id == id && peer.Status(frames[0]) == "200");
+    }
+    Frames frames = peer.Send(Get(id));
+    assert(frames.size() == 1 && IsRst(frames[0], id, REFUSED_STREAM));
+    id += 2;
+
+    assert(peer.Send(Frame(RST_STREAM, 0, 1, Uint32(CANCEL))).empty());
+    assert(peer.Send(Frame(RST_STREAM, 0, 1, Uint32(CANCEL))).empty()); // 重复的重置
+    assert(peer.Send(Frame(WINDOW_UPDATE, 0, 1, Uint32(100))).empty()); // 已重置的流不再发送
+    frames = peer.Send(Get(id));
+    assert(frames.size() == 1 && frames[0].id == id && peer.Status(frames[0]) == "200");
+    id += 2;
+    frames = peer.Send(Get(id));
+    assert(frames.size() == 1 && IsRst(frames[0], id, REFUSED_STREAM));
+    assert(!peer.session.IsClosing());
+
+    ExpectGoAway(Frame(RST_STREAM, 0, 1, Uint32(CANCEL)), PROTOCOL_ERROR); // 空闲的流
+    ExpectGoAway(Get(1) + Frame(RST_STREAM, 0, 1, "123"), FRAME_SIZE_ERROR, 1);
+}
+
+// 测试流和连接两级的发送窗口，WINDOW_UPDATE 和 SETTINGS 扩大窗口后继续发送，以及接收窗口的更新
+void TestFlowControl() {
+    Peer peer;
+    peer.Start(Setting(INITIAL_WINDOW_SIZE, 0));
+    Frames frames = peer.Send(Get(1));
+    assert(frames.size() == 1 && frames[0].flags == END_HEADERS);
+    frames = peer.Send(Frame(WINDOW_UPDATE, 0, 1, Uint32(40)));
+    assert(frames.size() == 1 && frames[0].type == DATA && frames[0].flags == 0);
+    std::string body = frames[0].payload;
+    assert(body.size() == 40);
+    // 初始窗口的变化按差值作用于已有的流
+    frames = peer.Send(Frame(SETTINGS, 0, 0, Setting(INITIAL_WINDOW_SIZE, 50)));
+    assert(frames.size() == 2 && frames[0].type == SETTINGS && frames[0].flags == ACK);
+    assert(frames[1].type == DATA && frames[1].payload.size() == 50 && frames[1].flags == 0);
+    body += frames[1].payload;
+    frames = peer.Send(Frame(WINDOW_UPDATE, 0, 1, Uint32(1000)));
+    assert(frames.size() == 1 && frames[0].flags == END_STREAM);
+    body += frames[0].payload;
+    assert(body == FileContent(SMALL_LEN));
+
+    // 连接窗口默认 65535，用完后等连接级的 WINDOW_UPDATE；帧长度不超过对端的 MAX_FRAME_SIZE
+    Peer big;
+    big.Start(Setting(INITIAL_WINDOW_SIZE, 1 << 20) + Setting(MAX_FRAME_SIZE, 32768));
+    frames = big.Send(Get(1, "/big.bin"));
+    assert(frames.size() == 3 && big.Status(frames[0]) == "200");
+    assert(frames[1].payload.size() == 32768 && frames[2].payload.size() == 32767);
+    body = Body(frames, 1);
+    assert(big.Send(Frame(WINDOW_UPDATE, 0, 1, Uint32(1000))).empty()); // 流的窗口不是瓶颈
+    frames = big.Send(Frame(WINDOW_UPDATE, 0, 0, Uint32(100000)));
+    assert(Body(frames, 1).size() == 100000);
+    body += Body(frames, 1);
+    bool end = false;
+    frames = big.Send(Frame(WINDOW_UPDATE, 0, 0, Uint32(1 << 20)));
+    body += Body(frames, 1, &end);
+    assert(end && body == FileContent(BIG_LEN));
+
+    // 窗口溢出和增量为 0
+    Peer errors;
+    errors.Start(Setting(INITIAL_WINDOW_SIZE, 0));
+    errors.Send(Get(1));
+    frames = errors.Send(Frame(WINDOW_UPDATE, 0, 1, Uint32(0)));
+    assert(frames.size() == 1 && IsRst(frames[0], 1, PROTOCOL_ERROR));
+    errors.Send(Get(3, "/big.bin"));
+    // 连接窗口用完后流的窗口保持接近上限，再增加就溢出
+    frames = errors.Send(Frame(WINDOW_UPDATE, 0, 3, Uint32(0x7fffffff)) + Frame(WINDOW_UPDATE, 0, 3, Uint32(0x7fffffff)));
+    assert(IsRst(frames.back(), 3, FLOW_CONTROL_ERROR));
+    ExpectGoAway(Frame(WINDOW_UPDATE, 0, 0, Uint32(0)), PROTOCOL_ERROR);
+    ExpectGoAway(Frame(WINDOW_UPDATE, 0, 0, Uint32(0x7fffffff)), FLOW_CONTROL_ERROR);
+    ExpectGoAway(Frame(WINDOW_UPDATE, 0, 0, "123"), FRAME_SIZE_ERROR);
+
+    // 接收：收到一半窗口的数据后，连接和流各自补满窗口
+    Peer upload;
+    upload.Start();
+    assert(upload.Send(Frame(HEADERS, END_HEADERS, 1, Request("POST", "/small.html"))).empty());
+    const std::string chunk(16384, 'x');
+    const int HALF = Http2Session::LOCAL_WINDOW / 2 / 16384;
+    for (int i = 0; i < HALF - 1; ++i)
+        assert(upload.Send(Frame(DATA, 0, 1, chunk)).empty());
+    frames = upload.Send(Frame(DATA, 0, 1, chunk));
+    assert(frames.size() == 2);
+    assert(frames[0].type == WINDOW_UPDATE && frames[0].id == 0 && frames[0].payload == Uint32(HALF * 16384));
+    assert(frames[1].type == WINDOW_UPDATE && frames[1].id == 1 && frames[1].payload == Uint32(HALF * 16384));
+    frames = upload.Send(Frame(DATA, END_STREAM, 1, "end"));
+    assert(frames.size() == 2 && upload.Status(frames[0]) == "200");
+}
+
+// 测试 CONTINUATION：头部块跨多帧时在最后一帧处理，中间插入其他帧或换了流都是连接错误
+void TestContinuation() {
+    Peer peer;
+    peer.Start();
+    std::string block = Request("GET", "/small.html", {{"user-agent", "http2-session-test"}});
+    size_t third = block.size() / 3;
+    assert(peer.Send(Frame(HEADERS, END_STREAM, 1, block.substr(0, third))).empty());
+    assert(peer.Send(Frame(CONTINUATION, 0, 1, block.substr(third, third))).empty());
+    Frames frames = peer.Send(Frame(CONTINUATION, END_HEADERS, 1, block.substr(third * 2)));
+    assert(frames.size() == 2 && frames[0].id == 1 && peer.Status(frames[0]) == "200");
+    assert(frames[1].flags == END_STREAM && frames[1].payload == FileContent(SMALL_LEN));
+    // 之后的头部块仍能正确解码
+    frames = peer.Send(Frame(HEADERS, END_STREAM, 3, block) + Frame(CONTINUATION, END_HEADERS, 3, ""));
+    assert(frames.size() == 2 && peer.Status(frames[0]) == "200");
+
+    ExpectGoAway(Frame(HEADERS, END_STREAM, 1, block) + Frame(PING, 0, 0, "12345678"), PROTOCOL_ERROR);
+    ExpectGoAway(Frame(HEADERS, END_STREAM, 1, block) + Frame(CONTINUATION, END_HEADERS, 3, ""), PROTOCOL_ERROR);
+    ExpectGoAway(Frame(CONTINUATION, END_HEADERS, 1, block), PROTOCOL_ERROR);
+    ExpectGoAway(Get(1) + Frame(CONTINUATION, END_HEADERS, 1, ""), PROTOCOL_ERROR, 1);
+    std::string flood = Frame(HEADERS, 0, 1, std::string(16384, 'x'));
+    for (int i = 0; i < 4; ++i)
+        flood += Frame(CONTINUATION, 0, 1, std::string(16384, 'x'));
+    ExpectGoAway(flood, ENHANCE_YOUR_CALM);
+}
+
+// 测试 GOAWAY：对端发出后不再接受新的流，已有的发完后关闭；达到流数上限时由服务端发出
+void TestGoAway() {
+    Peer peer;
+    peer.Start(Setting(INITIAL_WINDOW_SIZE, 0));
+    assert(peer.Send(Get(1)).size() == 1);
+    assert(peer.Send(Frame(GOAWAY, 0, 0, Uint32(1) + Uint32(NO_ERROR))).empty());
+    assert(!peer.session.IsClosing());
+    assert(peer.Send(Get(3)).empty()); // 对端已知不会处理，不回复 RST_STREAM
+    Frames frames = peer.Send(Frame(WINDOW_UPDATE, 0, 1, Uint32(1000)));
+    assert(frames.size() == 2);
+    assert(frames[0].type == DATA && frames[0].flags == END_STREAM && frames[0].payload.size() == SMALL_LEN);
+    assert(IsGoAway(frames[1], 3, NO_ERROR));
+    assert(peer.session.IsClosing());
+    ExpectGoAway(Frame(GOAWAY, 0, 0, Uint32(0)), FRAME_SIZE_ERROR);
+    ExpectGoAway(Frame(GOAWAY, 0, 1, Uint32(0) + Uint32(NO_ERROR)), PROTOCOL_ERROR);
+
+    Peer limited(2);
+    limited.Start();
+    frames = limited.Send(Get(1));
+    assert(frames.size() == 2 && !limited.session.IsClosing());
+    frames = limited.Send(Get(3));
+    assert(frames.size() == 3);
+    assert(IsGoAway(frames[0], 3, NO_ERROR));
+    assert(frames[1].id == 3 && limited.Status(frames[1]) == "200" && frames[2].flags == END_STREAM);
+    assert(limited.session.IsClosing());
+}
+
+// 按 HTTP/1.1 解析出 h2c 升级请求
+void ParseUpgrade(HttpRequest& request, const std::string& method, const std::string& settings) {
+    Buffer buff;
+    buff.Append(method + " /small.html HTTP/1.1\r\nHost: localhost\r\n"
+                "Connection: Upgrade, HTTP2-Settings\r\nUpgrade: h2c\r\n"
+                "HTTP2-Settings: " + settings + "\r\n\r\n");
+    request.Init();
+    assert(request.Parse(buff) == HttpRequest::PARSE_OK);
+}
+
+// 测试 h2c 升级：101 之后是服务端的 SETTINGS，升级的请求作为流 1 回复，HTTP2-Settings 在收到前言前生效
+void TestUpgrade() {
+    HttpRequest request;
+    HttpResponse response;
+    ParseUpgrade(request, "GET", "AAQAAAAy"); // INITIAL_WINDOW_SIZE = 50
+    assert(Http2Session::IsUpgrade(request));
+    Peer peer;
+    response.Init(request.Path(), SRC_DIR, 200);
+    assert(peer.session.Upgrade(request, response));
+    const std::string SWITCHING = "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+    assert(std::string(peer.out.ReadBegin(), SWITCHING.size()) == SWITCHING);
+    peer.out.Retrieve(SWITCHING.size());
+    Frames frames = peer.Read();
+    assert(frames.size() == 3);
+    assert(frames[0].type == SETTINGS && frames[1].type == WINDOW_UPDATE);
+    assert(frames[2].id == 1 && frames[2].flags == END_HEADERS && peer.Status(frames[2]) == "200");
+
+    // 前言之后只回复 SETTINGS 的确认，不再发送服务端的 SETTINGS
+    frames = peer.Send(std::string(PREFACE) + Frame(SETTINGS, 0, 0, ""));
+    assert(frames.size() == 2 && frames[0].type == SETTINGS && frames[0].flags == ACK);
+    assert(frames[1].type == DATA && frames[1].id == 1 && frames[1].payload.size() == 50);
+    std::string body = frames[1].payload;
+    frames = peer.Send(Frame(WINDOW_UPDATE, 0, 1, Uint32(1000)));
+    assert(frames.size() == 1 && frames[0].flags == END_STREAM);
+    assert(body + frames[0].payload == FileContent(SMALL_LEN));
+    frames = peer.Send(Get(1)); // 流 1 已被升级的请求占用
+    assert(frames.size() == 1 && IsGoAway(frames[0], 1, PROTOCOL_ERROR));
+
+    // HEAD 的响应没有内容
+    ParseUpgrade(request, "HEAD", "");
+    assert(!Http2Session::IsUpgrade(request)); // 没有 HTTP2-Settings 的值
+    ParseUpgrade(request, "HEAD", "AAMAAABk");
+    Peer head;
+    response.Init(request.Path(), SRC_DIR, 200);
+    assert(head.session.Upgrade(request, response));
+    head.out.Retrieve(SWITCHING.size());
+    frames = head.Read();
+    assert(frames.size() == 3 && frames[2].flags == (END_HEADERS | END_STREAM));
+
+    // HTTP2-Settings 格式错误时什么也不写，由调用方按 HTTP/1.1 回复
+    ParseUpgrade(request, "GET", "AA!AAAAy");
+    Peer bad;
+    assert(!bad.session.Upgrade(request, response));
+    ParseUpgrade(request, "GET", "AAQAAAA"); // 5 字节
+    assert(!bad.session.Upgrade(request, response));
+    ParseUpgrade(request, "GET", "AAIAAAAC"); // ENABLE_PUSH = 2
+    assert(!bad.session.Upgrade(request, response));
+    assert(bad.out.ReadableBytes() == 0);
+    response.UnmapFile();
+}
+
+int main() {
+    Log::GetInstance()->Init(0, "./logs/", ".log", 0);
+    mkdir(SRC_DIR, 0755);
+    WriteFile("small.html", FileContent(SMALL_LEN));
+    WriteFile("big.bin", FileContent(BIG_LEN));
+    TestHandshake();
+    TestStreams();
+    TestConcurrentStreams();
+    TestFlowControl();
+    TestContinuation();
+    TestGoAway();
+    TestUpgrade();
+    std::cout << "All tests passed!" << std::endl;
+    return 0;
+}
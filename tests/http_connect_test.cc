@@ -1,5 +1,8 @@
 #include "../code/http/http_connect.h"
+#include "../code/store/mysql_user_store.h"
+#include "mock_mysql.h"
 #include <iostream>
+#include <map>
 #include <sys/socket.h>
 #include <unistd.h>
 
@@ -11,57 +14,226 @@ void CreateSocketPair(int& sock1, int& sock2) {
     sock2 = socks[1];
 }
 
-void TestHttpConnect() {
-    Log* logger = Log::GetInstance();
-    logger->Init(0, "./logs/", ".log", 1024);
+// 主线程的事件循环：把数据库 socket 的事件交给连接池，直到 done 或超过 max_ms
+bool Pump(Epoller& epoller, const std::function<bool()>& done, int max_ms = 2000) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(max_ms);
+    AsyncSqlPool* pool = AsyncSqlPool::instance();
+    while (!done()) {
+        if (std::chrono::steady_clock::now() >= deadline)
+            return false;
+        int timeout = pool->GetNextTick();
+        if (timeout < 0 || timeout > 10)
+            timeout = 10;
+        int n = epoller.Wait(timeout);
+        for (int i = 0; i < n; ++i) {
+            int fd = epoller.GetEventsFd(i);
+            if (pool->Owns(fd))
+                pool->OnEvent(fd, epoller.GetEvents(i));
+        }
+    }
+    return true;
+}
+
+// 写出本批次的响应，从客户端一侧读回
+std::string Reply(HttpConnect& conn, int client) {
+    int save_errno = 0;
+    size_t total = conn.ToWriteBytes();
+    ssize_t len = conn.Write(&save_errno);
+    assert(len == static_cast<ssize_t>(total) && conn.ToWriteBytes() == 0);
+    std::string reply;
+    char buf[4096];
+    while (reply.size() < total) {
+        ssize_t n = recv(client, buf, sizeof(buf), 0);
+        assert(n > 0);
+        reply.append(buf, n);
+    }
+    return reply;
+}
+
+std::string FormPost(const std::string& path, const std::string& body) {
+    return "POST " + path + " HTTP/1.1\r\nHost: localhost\r\n"
+           "Content-Type: application/x-www-form-urlencoded\r\n"
+           "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+// 登录/注册请求在等待数据库时挂起，结果由事件循环上的回调给出后恢复，生成跳转页面
+std::string Submit(HttpConnect& conn, int client, Epoller& epoller, const std::string& request) {
+    int save_errno = 0;
+    assert(write(client, request.data(), request.size()) == static_cast<ssize_t>(request.size()));
+    assert(conn.Read(&save_errno) == static_cast<ssize_t>(request.size()));
+    assert(!conn.Process()); // 没有要立即写出的响应
+    assert(conn.IsSuspended());
+
+    bool done = false;
+    HttpRequest::VERIFY_RESULT result = HttpRequest::VERIFY_FAIL;
+    conn.Verify([&](HttpRequest::VERIFY_RESULT ret) {
+        result = ret;
+        done = true;
+    });
+    assert(Pump(epoller, [&]() { return done; }));
+    assert(conn.Resume(result));
+    assert(!conn.IsSuspended());
+    return Reply(conn, client);
+}
+
+// 测试登录和注册经过异步连接池验证，数据库不可用时返回 503
+void TestVerify() {
+    mock_mysql::Reset();
+    std::map<std::string, std::string> users = {{"alice", "secret"}}; // 旧的明文记录
+    mock_mysql::Server& server = mock_mysql::Instance("localhost", 3306);
+    server.handler = [&users](const std::string& sql, const std::vector<std::string>& params) {
+        mock_mysql::Result result;
+        if (sql.compare(0, 6, "SELECT") == 0) {
+            result.columns = {"username", "password"};
+            auto it = users.find(params[0]);
+            if (it != users.end())
+                result.rows.push_back({it->first, it->second});
+        } else if (sql.compare(0, 6, "INSERT") == 0) {
+            users[params[0]] = params[1];
+            result.affected = 1;
+        }
+        return result;
+    };
+    Epoller epoller;
+    AsyncSqlPool::instance()->Init("localhost", 3306, "root", "root", "webserver", 2);
+    AsyncSqlPool::instance()->Attach(&epoller);
+    UserStore::Install(std::unique_ptr<UserStore>(new MysqlUserStore()));
+
+    int client, server_sock;
+    CreateSocketPair(client, server_sock);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    HttpConnect conn;
+    conn.Init(server_sock, addr);
+
+    std::string reply = Submit(conn, client, epoller, FormPost("/login", "username=alice&password=secret"));
+    assert(reply.find("HTTP/1.1 200 OK\r\n") == 0);
+    assert(reply.find("<title>") != std::string::npos);
+    assert(server.sqls.back().find("SELECT") == 0);
+    assert(conn.IsKeepAlive());
+
+    reply = Submit(conn, client, epoller, FormPost("/login", "username=alice&password=wrong"));
+    assert(reply.find("HTTP/1.1 200 OK\r\n") == 0); // 跳到错误页，哈希已在缓存中，不再查询
+    assert(server.queries == 1);
+
+    // 注册：查询确认用户名未被使用后写入带盐的哈希
+    reply = Submit(conn, client, epoller, FormPost("/register", "username=bob&password=pass"));
+    assert(reply.find("HTTP/1.1 200 OK\r\n") == 0);
+    assert(server.queries == 3);
+    assert(users["bob"].find("$scrypt$") == 0);
 
-    int client_sock, server_sock;
-    CreateSocketPair(client_sock, server_sock);
+    // 数据库断开且无法重连：查询立即失败，返回 503 而不是挂起到超时
+    server.down = true;
+    mock_mysql::Kill("localhost", 3306);
+    assert(Pump(epoller, []() { return mock_mysql::Connections("localhost", 3306) == 0; }));
+    reply = Submit(conn, client, epoller, FormPost("/login", "username=carol&password=pass"));
+    assert(reply.find("HTTP/1.1 503 ") == 0);
 
-    sockaddr_in addr;
+    conn.Close();
+    close(client);
+    AsyncSqlPool::instance()->ClosePool();
+}
+
+// 送入 request，返回这一批的响应
+std::string Send(HttpConnect& conn, int client, const std::string& request) {
+    int save_errno = 0;
+    assert(write(client, request.data(), request.size()) == static_cast<ssize_t>(request.size()));
+    assert(conn.Read(&save_errno) == static_cast<ssize_t>(request.size()));
+    assert(conn.Process());
+    return Reply(conn, client);
+}
+
+size_t Count(const std::string& text, const std::string& part) {
+    size_t count = 0;
+    for (size_t pos = text.find(part); pos != std::string::npos; pos = text.find(part, pos + part.size()))
+        ++count;
+    return count;
+}
+
+// 测试 Keep-Alive 头部的 max 随请求递减，用完后回复 Connection: close，以及 HTTP/1.0 的默认值
+void TestKeepAliveMax() {
+    int max_requests = HttpConnect::max_requests, timeout_ms = HttpConnect::keep_alive_timeout_ms;
+    HttpConnect::max_requests = 3;
+    HttpConnect::keep_alive_timeout_ms = 5000;
+    const std::string GET = "GET /index.html HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    sockaddr_in addr = {};
     addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = INADDR_ANY;
-    addr.sin_port = htons(8080);
 
+    int client, server_sock;
+    CreateSocketPair(client, server_sock);
     HttpConnect conn;
     conn.Init(server_sock, addr);
+    std::string reply = Send(conn, client, GET);
+    assert(reply.find("HTTP/1.1 200 OK\r\nConnection: keep-alive\r\n") == 0);
+    assert(reply.find("Keep-Alive: timeout=5, max=2\r\n") != std::string::npos);
+    assert(conn.IsKeepAlive());
 
-    // 测试Read函数
-    {
-        int save_errno;
-        std::string http_request = "GET /index.html HTTP/1.1\r\n"
-                                   "Host: example.com\r\n"
-                                   "Connection: keep-alive\r\n"
-                                   "\r\n";
-        // client_sock 和 server_sock 是相互连接的
-        // 以写入到 client_sock 的数据会被自动传输到 server_sock 的接收缓冲区中。
-        write(client_sock, http_request.c_str(), http_request.size());
-        ssize_t len = conn.Read(&save_errno);
-        assert(len == (ssize_t)http_request.size());
-    }
+    // 流水线中的第二个请求用完次数，之后的请求不再处理
+    reply = Send(conn, client, GET + GET + GET);
+    assert(Count(reply, "HTTP/1.1 200 OK\r\n") == 2);
+    assert(reply.find("Keep-Alive: timeout=5, max=1\r\n") != std::string::npos);
+    const std::string CLOSE = "HTTP/1.1 200 OK\r\nConnection: close\r\n";
+    size_t last = reply.rfind("HTTP/1.1 200 OK\r\n");
+    assert(reply.compare(last, CLOSE.size(), CLOSE) == 0);
+    assert(reply.find("Keep-Alive:", last) == std::string::npos);
+    assert(!conn.IsKeepAlive());
+    conn.Close();
+    close(client);
 
-    // 测试Process函数
-    {
-        HttpConnect::src_dir = "/home/aihu/webserver/resources";
-        bool result = conn.Process();
-        assert(result);
-    }
+    // HTTP/1.0 默认关闭，带 Connection: keep-alive 才保持
+    CreateSocketPair(client, server_sock);
+    conn.Init(server_sock, addr);
+    reply = Send(conn, client, "GET /index.html HTTP/1.0\r\n\r\n");
+    assert(reply.find(CLOSE) == 0);
+    assert(!conn.IsKeepAlive());
+    conn.Close();
+    close(client);
 
-    // 测试Write函数
-    {
-        int saveErrno;
-        ssize_t len = conn.Write(&saveErrno);
-        assert(len >= -1);
+    CreateSocketPair(client, server_sock);
+    conn.Init(server_sock, addr);
+    reply = Send(conn, client, "GET /index.html HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n");
+    assert(reply.find("HTTP/1.1 200 OK\r\nConnection: keep-alive\r\n") == 0);
+    assert(reply.find("Keep-Alive: timeout=5, max=2\r\n") != std::string::npos);
+    assert(conn.IsKeepAlive());
+    conn.Close();
+    close(client);
 
-        char buffer[10240];
-        ssize_t recv_len = recv(client_sock, buffer, sizeof(buffer) - 1, 0);
-        assert(recv_len == len);
-    }
-    close(client_sock);
-    close(server_sock);
+    // 不限次数时只有 timeout
+    HttpConnect::max_requests = 0;
+    CreateSocketPair(client, server_sock);
+    conn.Init(server_sock, addr);
+    reply = Send(conn, client, GET);
+    assert(reply.find("Keep-Alive: timeout=5\r\n") != std::string::npos);
+    conn.Close();
+    close(client);
+
+    HttpConnect::max_requests = max_requests;
+    HttpConnect::keep_alive_timeout_ms = timeout_ms;
+}
+
+// 测试不支持的传输编码返回 501，并关闭连接
+void TestNotImplemented() {
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    int client, server_sock;
+    CreateSocketPair(client, server_sock);
+    HttpConnect conn;
+    conn.Init(server_sock, addr);
+    std::string reply = Send(conn, client, "POST /index.html HTTP/1.1\r\nTransfer-Encoding: gzip, chunked\r\n\r\n"
+                                           "2\r\nab\r\n0\r\n\r\n");
+    assert(reply.find("HTTP/1.1 501 Not Implemented\r\n") == 0);
+    assert(!conn.IsKeepAlive());
+    conn.Close();
+    close(client);
 }
 
 int main() {
-    TestHttpConnect();
+    Log::GetInstance()->Init(0, "./logs/", ".log", 0);
+    HttpConnect::src_dir = RESOURCES_DIR;
+    HttpConnect::AddDefaultRoutes(Router::instance());
+    TestVerify();
+    TestKeepAliveMax();
+    TestNotImplemented();
+    std::cout << "All tests passed!" << std::endl;
     return 0;
 }
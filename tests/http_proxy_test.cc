@@ -0,0 +1,310 @@
+#include "../code/http/http_proxy.h"
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+
+// 上游服务器组的地址只用于补 Host，测试中不建立连接，上游连接都是 socketpair
+const char* SERVER = "127.0.0.1:8081";
+
+void CreateSocketPair(int& sock1, int& sock2) {
+    int socks[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, socks) == 0);
+    sock1 = socks[0];
+    sock2 = socks[1];
+}
+
+// 读走 fd 中已有的数据，不等待
+std::string Drain(int fd) {
+    std::string data;
+    char buf[65536];
+    ssize_t len;
+    while ((len = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+        data.append(buf, len);
+    return data;
+}
+
+void WriteAll(int fd, const std::string& data) {
+    assert(write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size()));
+}
+
+// 一个转发中的客户端连接：client 为客户端一侧，上游由测试扮演（stub），连接的另一端交给 HttpProxy
+struct Forward {
+    int client;
+    int client_fd;
+    int stub;
+    UpstreamConnect conn;
+    HttpRequest request;
+    Buffer client_in;
+    HttpProxy proxy;
+    std::string reply; // 客户端收到的全部数据
+
+    Forward() : stub(-1) {
+        CreateSocketPair(client, client_fd);
+        fcntl(client_fd, F_SETFL, fcntl(client_fd, F_GETFL) | O_NONBLOCK);
+        conn.fd = -1;
+    }
+
+    ~Forward() {
+        proxy.Close();
+        Disconnect();
+        close(client);
+        close(client_fd);
+    }
+
+    void Disconnect() {
+        CloseUpstream();
+        if (conn.fd >= 0)
+            close(conn.fd);
+        conn.fd = -1;
+    }
+
+    // 新的上游连接，requests 大于 0 时为从空闲池取出的复用连接；旧的连接已由代理放回
+    void Connect(int requests) {
+        Disconnect();
+        CreateSocketPair(conn.fd, stub);
+        fcntl(conn.fd, F_SETFL, fcntl(conn.fd, F_GETFL) | O_NONBLOCK);
+        conn.tag = 0;
+        conn.upstream = 0;
+        conn.server = 0;
+        conn.requests = requests;
+        conn.stage = UpstreamConnect::LEASED;
+    }
+
+    // 上游关闭连接
+    void CloseUpstream() {
+        if (stub >= 0)
+            close(stub);
+        stub = -1;
+    }
+
+    // 解析客户端的请求头，路由决定转发后开始，租到的连接为 conn
+    void Start(const std::string& text, bool keep_alive = true) {
+        request.Init();
+        client_in.Append(text);
+        assert(request.Parse(client_in) == HttpRequest::PARSE_OK);
+        assert(request.ForwardTo(0));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        reply.clear();
+        proxy.Start(request, client_fd, nullptr, addr, client_in, keep_alive, 5, 10);
+        proxy.Attach(&conn);
+    }
+
+    // 推进到需要等待客户端读、上游或者结束，写给客户端的数据随时读走
+    HttpProxy::STEP Step() {
+        while (true) {
+            HttpProxy::STEP step = proxy.Step(client_in);
+            reply += Drain(client);
+            if (step != HttpProxy::WAIT_CLIENT_WRITE)
+                return step;
+        }
+    }
+};
+
+// Connection 和 Keep-Alive 由代理生成，timeout=5, max=10 来自 Start 的参数
+const std::string KEEP_ALIVE = "Connection: keep-alive\r\nKeep-Alive: timeout=5, max=10\r\n\r\n";
+
+// 测试请求头：逐跳的头部和 Connection 中列出的头部不转发，X-Forwarded-For 合并并加上客户端地址；
+// 响应头同样去掉逐跳的头部，Content-Length 的响应体随响应头一起或之后到达
+void TestContentLength() {
+    Forward f;
+    f.Connect(0);
+    f.Start("GET /api/a HTTP/1.1\r\nHost: example.com\r\nConnection: keep-alive, X-Drop\r\nX-Drop: 1\r\n"
+            "Keep-Alive: 300\r\nX-Forwarded-For: 10.0.0.1\r\nX-Forwarded-Proto: https\r\nTE: trailers\r\n"
+            "Upgrade: h2c\r\nProxy-Connection: keep-alive\r\nX-Keep: 1\r\n\r\n");
+    assert(f.proxy.IsActive());
+    assert(f.Step() == HttpProxy::WAIT_UPSTREAM_READ);
+    assert(Drain(f.stub) == "GET /api/a HTTP/1.1\r\nhost: example.com\r\nx-keep: 1\r\n"
+                            "x-forwarded-for: 10.0.0.1, 127.0.0.1\r\nx-forwarded-proto: http\r\n\r\n");
+    WriteAll(f.stub, "HTTP/1.1 200 OK\r\nContent-Length: 5\r\nConnection: X-Secret\r\nX-Secret: s\r\n"
+                     "Keep-Alive: timeout=9\r\nProxy-Connection: keep-alive\r\nX-Up: 1\r\n\r\nhello");
+    assert(f.Step() == HttpProxy::FINISHED);
+    assert(f.reply == "HTTP/1.1 200 OK\r\nContent-Length: 5\r\nX-Up: 1\r\n" + KEEP_ALIVE + "hello");
+    assert(!f.proxy.IsActive() && f.proxy.IsKeepAlive());
+
+    // 响应体较大时经管道搬运，分几次到达
+    f.Connect(1);
+    f.Start("GET /api/big HTTP/1.1\r\nHost: example.com\r\n\r\n");
+    assert(f.Step() == HttpProxy::WAIT_UPSTREAM_READ);
+    Drain(f.stub);
+    const std::string HEAD = "HTTP/1.1 200 OK\r\nContent-Length: 100000\r\n\r\n";
+    WriteAll(f.stub, HEAD);
+    assert(f.Step() == HttpProxy::WAIT_UPSTREAM_READ);
+    assert(f.reply == "HTTP/1.1 200 OK\r\nContent-Length: 100000\r\n" + KEEP_ALIVE);
+    std::string body;
+    for (size_t i = 0; i < 100000; ++i)
+        body.push_back(static_cast<char>('a' + i % 26));
+    WriteAll(f.stub, body.substr(0, 30000));
+    assert(f.Step() == HttpProxy::WAIT_UPSTREAM_READ);
+    WriteAll(f.stub, body.substr(30000));
+    assert(f.Step() == HttpProxy::FINISHED);
+    assert(f.reply == "HTTP/1.1 200 OK\r\nContent-Length: 100000\r\n" + KEEP_ALIVE + body);
+    assert(f.proxy.IsKeepAlive());
+
+    // HEAD 的响应没有响应体，Content-Length 只是 GET 时的长度
+    f.Connect(1);
+    f.Start("HEAD /api/a HTTP/1.1\r\nHost: example.com\r\n\r\n");
+    assert(f.Step() == HttpProxy::WAIT_UPSTREAM_READ);
+    assert(Drain(f.stub).find("HEAD /api/a HTTP/1.1\r\n") == 0);
+    WriteAll(f.stub, "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\n");
+    assert(f.Step() == HttpProxy::FINISHED);
+    assert(f.reply == "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n" + KEEP_ALIVE);
+}
+
+// 测试分块编码的响应：框架和块内容原样转发；HTTP/1.0 的客户端只收到块内容，以关闭连接结束
+void TestChunked() {
+    Forward f;
+    f.Connect(0);
+    f.Start("GET /api/chunked HTTP/1.1\r\nHost: example.com\r\n\r\n");
+    assert(f.Step() == HttpProxy::WAIT_UPSTREAM_READ);
+    Drain(f.stub);
+    WriteAll(f.stub, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nTrailer: X-T\r\n\r\n");
+    assert(f.Step() == HttpProxy::WAIT_UPSTREAM_READ);
+    // 块在框架和内容的中间断开
+    WriteAll(f.stub, "5\r\nhel");
+    assert(f.Step() == HttpProxy::WAIT_UPSTREAM_READ);
+    WriteAll(f.stub, "lo\r\n6;ext=1\r");
+    assert(f.Step() == HttpProxy::WAIT_UPSTREAM_READ);
+    WriteAll(f.stub, "\n world\r\n0\r\nX-T: 1\r\n\r\n");
+    assert(f.Step() == HttpProxy::FINISHED);
+    assert(f.reply == "HTTP/1.1 200 OK\r\nTrailer: X-T\r\nTransfer-Encoding: chunked\r\n" + KEEP_ALIVE +
+                      "5\r\nhello\r\n6;ext=1\r\n world\r\n0\r\nX-T: 1\r\n\r\n");
+    assert(f.proxy.IsKeepAlive());
+
+    // HTTP/1.0 的请求没有 Host，按上游服务器补上
+    f.Connect(1);
+    f.Start("GET /api/chunked HTTP/1.0\r\n\r\n");
+    assert(f.Step() == HttpProxy::WAIT_UPSTREAM_READ);
+    assert(Drain(f.stub) == "GET /api/chunked HTTP/1.1\r\nhost: " + std::string(SERVER) +
+                            "\r\nx-forwarded-for: 127.0.0.1\r\nx-forwarded-proto: http\r\n\r\n");
+    WriteAll(f.stub, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nTrailer: X-T\r\n\r\n"
+                     "5\r\nhello\r\n6\r\n world\r\n0\r\nX-T: 1\r\n\r\n");
+    assert(f.Step() == HttpProxy::FINISHED);
+    assert(f.reply == "HTTP/1.1 200 OK\r\nConnection: close\r\n\r\nhello world");
+    assert(!f.proxy.IsKeepAlive());
+
+    // 格式错误的块在响应头之后，只能关闭客户端连接
+    Forward bad;
+    bad.Connect(0);
+    bad.Start("GET /api/chunked HTTP/1.1\r\nHost: example.com\r\n\r\n");
+    assert(bad.Step() == HttpProxy::WAIT_UPSTREAM_READ);
+    WriteAll(bad.stub, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nxyz\r\n");
+    assert(bad.Step() == HttpProxy::FINISHED);
+    assert(bad.reply.find("HTTP/1.1 200 OK\r\n") == 0);
+    assert(!bad.proxy.IsKeepAlive());
+}
+
+// 测试没有长度的响应体：上游关闭连接时结束，客户端连接也不再保持
+void TestUntilClose() {
+    Forward f;
+    f.Connect(0);
+    f.Start("GET /api/stream HTTP/1.1\r\nHost: example.com\r\n\r\n");
+    assert(f.Step() == HttpProxy::WAIT_UPSTREAM_READ);
+    WriteAll(f.stub, "HTTP/1.0 200 OK\r\nX-Up: 1\r\n\r\npart one, ");
+    assert(f.Step() == HttpProxy::WAIT_UPSTREAM_READ);
+    WriteAll(f.stub, "part two");
+    shutdown(f.stub, SHUT_WR);
+    assert(f.Step() == HttpProxy::FINISHED);
+    assert(f.reply == "HTTP/1.1 200 OK\r\nX-Up: 1\r\nConnection: close\r\n\r\npart one, part two");
+    assert(!f.proxy.IsKeepAlive());
+}
+
+// 测试留在客户端 socket 中的请求体：100 Continue 由代理回复，请求体经管道转发给上游
+void TestRequestBody() {
+    Forward f;
+    f.Connect(1);
+    f.Start("POST /api/upload HTTP/1.1\r\nHost: example.com\r\nContent-Length: 10\r\n"
+            "Expect: 100-continue\r\n\r\n01234");
+    assert(f.client_in.ReadableBytes() == 0); // 已读到的请求体随请求头发出
+    assert(f.Step() == HttpProxy::WAIT_CLIENT_READ);
+    assert(f.reply == "HTTP/1.1 100 Continue\r\n\r\n");
+    WriteAll(f.client, "56789");
+    assert(f.Step() == HttpProxy::WAIT_UPSTREAM_READ);
+    assert(Drain(f.stub) == "POST /api/upload HTTP/1.1\r\nhost: example.com\r\nx-forwarded-for: 127.0.0.1\r\n"
+                            "x-forwarded-proto: http\r\ncontent-length: 10\r\n\r\n0123456789");
+    // 请求体已经从客户端读走，复用的连接失效也不能重试
+    f.CloseUpstream();
+    assert(f.Step() == HttpProxy::FAILED);
+    assert(f.proxy.IsKeepAlive()); // 请求体已读完，可以继续读下一个请求
+}
+
+// 测试复用的连接在收到响应之前被上游关闭时换一个连接重试，以及没有得到响应头时的 502
+void TestRetry() {
+    Forward f;
+    f.Connect(1);
+    f.Start("GET /api/a HTTP/1.1\r\nHost: example.com\r\n\r\n");
+    assert(f.Step() == HttpProxy::WAIT_UPSTREAM_READ);
+    std::string sent = Drain(f.stub);
+    f.CloseUpstream();
+    assert(f.Step() == HttpProxy::RETRY);
+    assert(f.proxy.Connect() == nullptr); // 失效的连接已放回
+    f.Connect(0);
+    f.proxy.Attach(&f.conn);
+    assert(f.Step() == HttpProxy::WAIT_UPSTREAM_READ);
+    assert(Drain(f.stub) == sent); // 重新发送同样的请求
+    WriteAll(f.stub, "HTTP/1.1 204 No Content\r\n\r\n");
+    assert(f.Step() == HttpProxy::FINISHED);
+    assert(f.reply == "HTTP/1.1 204 No Content\r\n" + KEEP_ALIVE);
+
+    // 新建立的连接出错不重试，还没有写出响应时由调用方回复 502
+    f.Connect(0);
+    f.Start("GET /api/a HTTP/1.1\r\nHost: example.com\r\n\r\n");
+    assert(f.Step() == HttpProxy::WAIT_UPSTREAM_READ);
+    f.CloseUpstream();
+    assert(f.Step() == HttpProxy::FAILED);
+    assert(f.reply.empty() && f.proxy.IsKeepAlive() && !f.proxy.IsActive());
+
+    // 复用的连接已经读到了部分响应头
+    f.Connect(1);
+    f.Start("GET /api/a HTTP/1.1\r\nHost: example.com\r\n\r\n");
+    assert(f.Step() == HttpProxy::WAIT_UPSTREAM_READ);
+    WriteAll(f.stub, "HTTP/1.1 20");
+    assert(f.Step() == HttpProxy::WAIT_UPSTREAM_READ);
+    f.CloseUpstream();
+    assert(f.Step() == HttpProxy::FAILED);
+    assert(f.reply.empty());
+
+    // 格式错误的状态行，以及两个不同的 Content-Length
+    f.Connect(0);
+    f.Start("GET /api/a HTTP/1.1\r\nHost: example.com\r\n\r\n");
+    WriteAll(f.stub, "garbage\r\n\r\n");
+    assert(f.Step() == HttpProxy::FAILED);
+    f.Connect(0);
+    f.Start("GET /api/a HTTP/1.1\r\nHost: example.com\r\n\r\n");
+    WriteAll(f.stub, "HTTP/1.1 200 OK\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\nab");
+    assert(f.Step() == HttpProxy::FAILED);
+    assert(f.reply.empty());
+
+    // 没有可用的服务器
+    f.Start("GET /api/a HTTP/1.1\r\nHost: example.com\r\n\r\n");
+    f.proxy.Attach(nullptr);
+    assert(f.Step() == HttpProxy::FAILED);
+
+    // 响应头已写出后上游断开：只能关闭客户端连接
+    f.Connect(0);
+    f.Start("GET /api/a HTTP/1.1\r\nHost: example.com\r\n\r\n");
+    WriteAll(f.stub, "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nabc");
+    assert(f.Step() == HttpProxy::WAIT_UPSTREAM_READ);
+    f.CloseUpstream();
+    assert(f.Step() == HttpProxy::FINISHED);
+    assert(f.reply == "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n" + KEEP_ALIVE + "abc");
+    assert(!f.proxy.IsKeepAlive());
+}
+
+int main() {
+    Log::GetInstance()->Init(0, "./logs/", ".log", 0);
+    // 上游连接都由测试提供，连接池不注册到事件循环，放回的连接只是排队
+    assert(UpstreamPool::instance()->Add({SERVER}) == 0);
+    Router::instance()->Add("*", "/api/*path", [](HttpRequest&, HttpResponse&) {}, Router::FORWARD);
+    TestContentLength();
+    TestChunked();
+    TestUntilClose();
+    TestRequestBody();
+    TestRetry();
+    UpstreamPool::instance()->ClosePool();
+    std::cout << "All tests passed!" << std::endl;
+    return 0;
+}
@@ -1,76 +1,293 @@
 #include "../code/http/http_request.h"
 #include <iostream>
+#include <cassert>
 
-void TestHttpRequest() {
-    // 初始化日志系统
-    Log* logger = Log::GetInstance();
-    logger->Init(0, "./logs/", ".log", 1024);
-
-    // 初始化测试
-    HttpRequest request;
-
-    // 初始化数据库连接池
-    SqlConnectPool* conn_pool = SqlConnectPool::instance();
-    conn_pool->Init("localhost", 3306, "aihu", "password", "web_server", 10);
+// 解析出的一个请求
+struct Parsed {
+    std::string method, path, body;
+    bool operator==(const Parsed& other) const {
+        return method == other.method && path == other.path && body == other.body;
+    }
+};
 
+// 解析 buff 中所有完整的请求，不完整的留在 buff 中，和 HttpConnect::Process 一样每个请求之后 Init
+void ParseAll(HttpRequest& request, Buffer& buff, std::vector<Parsed>* out) {
+    while (true) {
+        HttpRequest::PARSE_RESULT ret = request.Parse(buff);
+        if (ret == HttpRequest::PARSE_AGAIN)
+            return;
+        assert(ret == HttpRequest::PARSE_OK);
+        out->push_back({request.Method(), request.Path(), request.Body()});
+        request.Init();
+    }
+}
 
-    // 解析请求测试
-    std::string http_request = "GET /index.html HTTP/1.1\r\n"
-                               "Host: example.com\r\n"
-                               "Connection: keep-alive\r\n"
-                               "\r\n";
+void TestParse() {
+    HttpRequest request;
     Buffer buff;
-    buff.Append(http_request);
-    bool parseResult = request.Parse(buff);
-    assert(parseResult);
-
-    // 访问器方法测试
+    buff.Append("GET /index.html HTTP/1.1\r\n"
+                "Host: example.com\r\n"
+                "Connection: keep-alive\r\n"
+                "\r\n");
+    assert(request.Parse(buff) == HttpRequest::PARSE_OK);
     assert(request.Method() == "GET");
     assert(request.Path() == "/index.html");
     assert(request.Version() == "1.1");
+    assert(request.GetHeader("HOST") == "example.com");
+    assert(buff.ReadableBytes() == 0);
 
-    // 模拟注册 POST 请求
-    std::string register_request = "POST /register.html HTTP/1.1\r\n"
-                                   "Host: example.com\r\n"
-                                   "Content-Type: application/x-www-form-urlencoded\r\n"
-                                   "Content-Length: 29\r\n"
-                                   "\r\n"
-                                   "username=test&password=123456";
+    // 表单数据
     request.Init();
-    buff.Append(register_request);
-    parseResult = request.Parse(buff);
-    assert(parseResult);
-
+    buff.Append("POST /register.html HTTP/1.1\r\n"
+                "Host: example.com\r\n"
+                "Content-Type: application/x-www-form-urlencoded\r\n"
+                "Content-Length: 29\r\n"
+                "\r\n"
+                "username=test&password=123456");
+    assert(request.Parse(buff) == HttpRequest::PARSE_OK);
     assert(request.Method() == "POST");
-    assert(request.Path() == "/welcome.html");
-    assert(request.Version() == "1.1");
+    assert(request.Path() == "/register.html");
+    assert(request.IsForm());
     assert(request.GetPost("username") == "test");
     assert(request.GetPost("password") == "123456");
+}
+
+// 流水线：一次读到的多个请求，包括带请求体的和分块编码的
+const std::string PIPELINE =
+    "GET /a HTTP/1.1\r\nHost: x\r\n\r\n"
+    "POST /b HTTP/1.1\r\nHost: x\r\nContent-Length: 5\r\n\r\nhello"
+    "\r\n" // 请求之间多余的空行
+    "POST /c HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n2;ext=1\r\nde\r\n0\r\nTrailer: t\r\n\r\n"
+    "GET /d HTTP/1.1\r\n\r\n";
 
-    // Post 数据获取测试
-    // 模拟登录 POST 请求
-    std::string login_request = "POST /login HTTP/1.1\r\n"
-                               "Content-Type: application/x-www-form-urlencoded\r\n"
-                               "Content-Length: 29\r\n"
-                               "\r\n"
-                               "username=test&password=123456"
-                               "\r\n";
-    buff.Append(login_request);
+const std::vector<Parsed> EXPECTED = {
+    {"GET", "/a", ""}, {"POST", "/b", "hello"}, {"POST", "/c", "abcde"}, {"GET", "/d", ""}};
+
+// 测试一个缓冲区中的多个请求按顺序解析，每次只取走属于当前请求的数据
+void TestPipeline() {
+    HttpRequest request;
+    Buffer buff;
+    buff.Append(PIPELINE);
+    std::vector<Parsed> parsed;
+    ParseAll(request, buff, &parsed);
+    assert(parsed == EXPECTED);
+    assert(buff.ReadableBytes() == 0);
+    assert(request.IsIdle());
+
+    // 最后一个请求不完整时，前面的照常解析，剩下的等待后续数据
+    buff.Append(PIPELINE.substr(0, PIPELINE.size() - 3));
+    parsed.clear();
+    ParseAll(request, buff, &parsed);
+    assert(parsed.size() == 3 && parsed[2] == EXPECTED[2]);
+    buff.Append(PIPELINE.substr(PIPELINE.size() - 3));
+    ParseAll(request, buff, &parsed);
+    assert(parsed == EXPECTED);
+}
+
+// 测试请求在任意位置被拆成两次到达，以及逐字节到达，结果都和一次到达相同
+void TestSplit() {
+    for (size_t split = 0; split <= PIPELINE.size(); ++split) {
+        HttpRequest request;
+        Buffer buff;
+        std::vector<Parsed> parsed;
+        buff.Append(PIPELINE.substr(0, split));
+        ParseAll(request, buff, &parsed);
+        buff.Append(PIPELINE.substr(split));
+        ParseAll(request, buff, &parsed);
+        assert(parsed == EXPECTED);
+        assert(buff.ReadableBytes() == 0);
+    }
+
+    HttpRequest request;
+    Buffer buff;
+    std::vector<Parsed> parsed;
+    for (char ch : PIPELINE) {
+        buff.Append(&ch, 1);
+        ParseAll(request, buff, &parsed);
+    }
+    assert(parsed == EXPECTED);
+}
+
+// 一次送入 text，返回解析结果
+HttpRequest::PARSE_RESULT ParseText(HttpRequest& request, const std::string& text) {
     request.Init();
+    Buffer buff;
+    buff.Append(text);
+    return request.Parse(buff);
+}
 
-    parseResult = request.Parse(buff);
-    assert(parseResult);
+// 测试分块编码：十六进制大小、块扩展和尾部字段都不进入请求体
+void TestChunked() {
+    HttpRequest request;
+    assert(ParseText(request, "POST /c HTTP/1.1\r\nTransfer-Encoding: chunked\r\n"
+                              "Content-Type: application/x-www-form-urlencoded\r\n\r\n"
+                              "A;name=\"value\";x\r\nusername=a\r\n"
+                              "C\r\n&password=1b\r\n"
+                              "0;last\r\nX-Checksum: 1\r\nX-Other: 2\r\n\r\n") == HttpRequest::PARSE_OK);
+    assert(request.Body() == "username=a&password=1b");
+    assert(request.GetPost("password") == "1b");
+    assert(request.GetHeader("X-Checksum").empty()); // 尾部字段忽略
+    // 编码不区分大小写，列表中的空元素忽略，也可以分在多个头部中
+    assert(ParseText(request, "POST /c HTTP/1.1\r\nTransfer-Encoding: , Chunked \r\n\r\n"
+                              "2\r\nab\r\n0\r\n\r\n") == HttpRequest::PARSE_OK);
+    assert(request.Body() == "ab");
+    assert(ParseText(request, "POST /c HTTP/1.1\r\nTransfer-Encoding:\r\nTransfer-Encoding: chunked\r\n\r\n"
+                              "2\r\nab\r\n0\r\n\r\n") == HttpRequest::PARSE_OK);
 
-    assert(request.Method() == "POST");
-    assert(request.Path() == "/welcome.html");
-    assert(request.Version() == "1.1");
-    assert(request.GetPost("username") == "test");
-    assert(request.GetPost("password") == "123456");
+    const char* HEAD = "POST /c HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n";
+    assert(ParseText(request, std::string(HEAD) + "xyz\r\n") == HttpRequest::PARSE_ERROR);
+    assert(ParseText(request, std::string(HEAD) + ";ext\r\n") == HttpRequest::PARSE_ERROR);  // 没有大小
+    assert(ParseText(request, std::string(HEAD) + "2\r\nabc\r\n") == HttpRequest::PARSE_ERROR); // 数据后不是回车换行
+    assert(ParseText(request, std::string(HEAD) + "1000000000000000\r\n") == HttpRequest::PARSE_ERROR);
 
-    std::cout << "All tests passed!" << std::endl;
+    // chunked 必须是最后一个编码且只出现一次，只匹配完整的编码名
+    auto post = [&request](const std::string& encodings) {
+        return ParseText(request, "POST /c HTTP/1.1\r\n" + encodings + "\r\n2\r\nab\r\n0\r\n\r\n");
+    };
+    assert(post("Transfer-Encoding: gzip\r\n") == HttpRequest::PARSE_ERROR);
+    assert(post("Transfer-Encoding: xchunked\r\n") == HttpRequest::PARSE_ERROR);
+    assert(post("Transfer-Encoding: gzip;chunked\r\n") == HttpRequest::PARSE_ERROR);
+    assert(post("Transfer-Encoding: chunked, gzip\r\n") == HttpRequest::PARSE_ERROR);
+    assert(post("Transfer-Encoding: chunked, chunked\r\n") == HttpRequest::PARSE_ERROR);
+    assert(post("Transfer-Encoding: chunked\r\nTransfer-Encoding: gzip\r\n") == HttpRequest::PARSE_ERROR);
+    assert(post("Transfer-Encoding: \r\n") == HttpRequest::PARSE_ERROR);
+    // 其他编码放在 chunked 之前也无法还原请求体（501）
+    assert(post("Transfer-Encoding: gzip, chunked\r\n") == HttpRequest::PARSE_NOT_IMPLEMENTED);
+    assert(post("Transfer-Encoding: gzip\r\nTransfer-Encoding: chunked\r\n") == HttpRequest::PARSE_NOT_IMPLEMENTED);
+    assert(HttpRequest::ErrorCode(HttpRequest::PARSE_NOT_IMPLEMENTED) == 501);
+    assert(HttpRequest::ErrorCode(HttpRequest::PARSE_TOO_LARGE) == 413);
+    assert(HttpRequest::ErrorCode(HttpRequest::PARSE_ERROR) == 400);
+}
+
+// 测试请求体长度：Content-Length 的格式、重复的 Content-Length，以及和 Transfer-Encoding 同时出现
+void TestContentLength() {
+    HttpRequest request;
+    auto post = [](const std::string& headers) {
+        return "POST /b HTTP/1.1\r\n" + headers + "\r\nhello";
+    };
+    assert(ParseText(request, post("Content-Length: 5\r\n")) == HttpRequest::PARSE_OK);
+    assert(request.Body() == "hello");
+    assert(ParseText(request, post("Content-Length: -5\r\n")) == HttpRequest::PARSE_ERROR);
+    assert(ParseText(request, post("Content-Length: 5x\r\n")) == HttpRequest::PARSE_ERROR);
+    assert(ParseText(request, post("Content-Length:\r\n")) == HttpRequest::PARSE_ERROR);
+    assert(ParseText(request, post("Content-Length: 1234567890123456789\r\n")) == HttpRequest::PARSE_ERROR);
+
+    // 取值相同的重复头部或列表按一个处理，不同时无法确定边界
+    assert(ParseText(request, post("Content-Length: 5\r\nContent-Length: 5\r\n")) == HttpRequest::PARSE_OK);
+    assert(request.Body() == "hello");
+    assert(ParseText(request, post("Content-Length: 5, 5\r\n")) == HttpRequest::PARSE_OK);
+    assert(ParseText(request, post("Content-Length: 5\r\nContent-Length: 6\r\n")) == HttpRequest::PARSE_ERROR);
+    assert(ParseText(request, post("Content-Length: 6\r\nContent-Length: 5\r\n")) == HttpRequest::PARSE_ERROR);
+    assert(ParseText(request, post("Content-Length: 5, 6\r\n")) == HttpRequest::PARSE_ERROR);
+    assert(ParseText(request, post("Content-Length: 5,\r\n")) == HttpRequest::PARSE_ERROR);
+
+    // 请求走私：两者同时出现时拒绝，不论先后
+    assert(ParseText(request, post("Content-Length: 5\r\nTransfer-Encoding: chunked\r\n")) == HttpRequest::PARSE_ERROR);
+    assert(ParseText(request, post("Transfer-Encoding: chunked\r\nContent-Length: 5\r\n")) == HttpRequest::PARSE_ERROR);
+}
+
+// 测试请求行和请求头的格式错误，以及请求头值的空白和名字的大小写
+void TestMalformed() {
+    HttpRequest request;
+    assert(ParseText(request, "GET /a\r\n\r\n") == HttpRequest::PARSE_ERROR);           // 没有版本
+    assert(ParseText(request, "GET /a HTTP/\r\n\r\n") == HttpRequest::PARSE_ERROR);     // 版本号为空
+    assert(ParseText(request, "GET /a http/1.1\r\n\r\n") == HttpRequest::PARSE_ERROR);  // 协议名区分大小写
+    assert(ParseText(request, "GET  /a HTTP/1.1\r\n\r\n") == HttpRequest::PARSE_ERROR); // 多余的空格
+    assert(ParseText(request, "GET /a HTTP/1.1 \r\n\r\n") == HttpRequest::PARSE_ERROR);
+    assert(ParseText(request, "GET /a b HTTP/1.1\r\n\r\n") == HttpRequest::PARSE_ERROR);
+    assert(ParseText(request, "GET\r\n\r\n") == HttpRequest::PARSE_ERROR);
+
+    assert(ParseText(request, "GET /a HTTP/1.1\r\nHost\r\n\r\n") == HttpRequest::PARSE_ERROR);  // 没有冒号
+    assert(ParseText(request, "GET /a HTTP/1.1\r\n: x\r\n\r\n") == HttpRequest::PARSE_ERROR);   // 名字为空
+    assert(ParseText(request, "GET /a HTTP/1.1\r\nX-Empty:\r\nX-Pad: \t a b \t\r\nX-Url: http://h:1/\r\n\r\n") ==
+           HttpRequest::PARSE_OK);
+    assert(request.GetHeader("x-empty").empty());
+    assert(request.GetHeader("X-PAD") == "a b");            // 去掉两端的空格和制表符，中间的保留
+    assert(request.GetHeader("x-url") == "http://h:1/"); // 只在第一个冒号处分开
+    assert(request.GetHeader("X-Missing").empty());
+
+    // 请求头个数上限
+    std::string headers;
+    for (size_t i = 0; i < 100; ++i)
+        headers += "X-" + std::to_string(i) + ": v\r\n";
+    assert(ParseText(request, "GET /a HTTP/1.1\r\n" + headers + "\r\n") == HttpRequest::PARSE_OK);
+    assert(request.GetHeader("x-99") == "v");
+    assert(ParseText(request, "GET /a HTTP/1.1\r\n" + headers + "X-100: v\r\n\r\n") == HttpRequest::PARSE_ERROR);
+
+    // 一行超过 8192 字节仍没有回车换行时不再等待
+    std::string line = "GET /a HTTP/1.1\r\nX-Long: " + std::string(8100, 'a');
+    assert(ParseText(request, line) == HttpRequest::PARSE_AGAIN);
+    assert(ParseText(request, line + std::string(100, 'a')) == HttpRequest::PARSE_ERROR);
+    assert(ParseText(request, "GET /" + std::string(8200, 'a')) == HttpRequest::PARSE_ERROR);
+}
+
+// 测试逗号分隔列表中的 token 匹配和 Connection 决定的连接保持
+void TestKeepAlive() {
+    assert(HttpRequest::HasToken("keep-alive", "keep-alive"));
+    assert(HttpRequest::HasToken("Keep-Alive, Upgrade", "upgrade"));
+    assert(HttpRequest::HasToken("Keep-Alive, Upgrade", "keep-alive"));
+    assert(HttpRequest::HasToken(" close ", "close"));
+    assert(HttpRequest::HasToken("a,\tclose\t,b", "close"));
+    assert(HttpRequest::HasToken(",,close", "close"));
+    assert(!HttpRequest::HasToken("closed", "close"));
+    assert(!HttpRequest::HasToken("not-close", "close"));
+    assert(!HttpRequest::HasToken("clo se", "close"));
+    assert(!HttpRequest::HasToken("", "close"));
+    assert(!HttpRequest::HasToken(" , ", "close"));
+
+    HttpRequest request;
+    auto get = [&request](const std::string& version, const std::string& headers) {
+        assert(ParseText(request, "GET /a HTTP/" + version + "\r\n" + headers + "\r\n") == HttpRequest::PARSE_OK);
+        return request.IsKeepAlive();
+    };
+    assert(get("1.1", ""));                                   // HTTP/1.1 默认保持
+    assert(!get("1.1", "Connection: close\r\n"));
+    assert(!get("1.1", "Connection: Upgrade, Close\r\n"));
+    assert(!get("1.1", "Connection: keep-alive, close\r\n")); // close 优先
+    assert(get("1.1", "Connection: closed\r\n"));
+    assert(!get("1.0", ""));                                  // HTTP/1.0 默认关闭
+    assert(get("1.0", "Connection: Keep-Alive\r\n"));
+    assert(get("1.0", "Connection: upgrade, keep-alive\r\n"));
+    assert(!get("1.0", "Connection: keep-alived\r\n"));
+}
+
+// 测试超过长度上限时返回 PARSE_TOO_LARGE（413），Content-Length 超限时不等请求体到达
+void TestTooLarge() {
+    size_t max_body = HttpRequest::max_body_size, max_upload = HttpRequest::max_upload_size;
+    HttpRequest::max_body_size = 16;
+    HttpRequest::max_upload_size = 32;
+    HttpRequest request;
+    assert(ParseText(request, "POST /b HTTP/1.1\r\nContent-Length: 16\r\n\r\n0123456789abcdef") == HttpRequest::PARSE_OK);
+    assert(ParseText(request, "POST /b HTTP/1.1\r\nContent-Length: 17\r\n\r\n") == HttpRequest::PARSE_TOO_LARGE);
+    // 分块编码按已收到的总长度计算
+    assert(ParseText(request, "POST /b HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                              "a\r\n0123456789\r\n7\r\n") == HttpRequest::PARSE_TOO_LARGE);
+
+    // 上传和转发的请求体不进内存，按 max_upload_size 限制
+    Router::instance()->Add("POST", "/upload_test", [](HttpRequest&, HttpResponse&) {}, Router::STREAM_BODY);
+    Router::instance()->Add("*", "/proxy_test/*path", [](HttpRequest&, HttpResponse&) {}, Router::FORWARD);
+    assert(ParseText(request, "POST /upload_test HTTP/1.1\r\nContent-Length: 32\r\n\r\n") == HttpRequest::PARSE_OK);
+    assert(request.IsUpload() && request.BodyLength() == 32);
+    assert(ParseText(request, "POST /upload_test HTTP/1.1\r\nContent-Length: 33\r\n\r\n") == HttpRequest::PARSE_TOO_LARGE);
+    assert(ParseText(request, "POST /upload_test HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n") == HttpRequest::PARSE_ERROR);
+    assert(ParseText(request, "PUT /proxy_test/a HTTP/1.1\r\nContent-Length: 32\r\n\r\n") == HttpRequest::PARSE_OK);
+    assert(request.HasStreamedBody() && request.BodyLength() == 32);
+    assert(ParseText(request, "PUT /proxy_test/a HTTP/1.1\r\nContent-Length: 33\r\n\r\n") == HttpRequest::PARSE_TOO_LARGE);
+
+    HttpRequest::max_body_size = max_body;
+    HttpRequest::max_upload_size = max_upload;
 }
 
 int main() {
-    TestHttpRequest();
+    Log::GetInstance()->Init(0, "./logs/", ".log", 0);
+    TestParse();
+    TestPipeline();
+    TestSplit();
+    TestChunked();
+    TestContentLength();
+    TestMalformed();
+    TestKeepAlive();
+    TestTooLarge();
+    std::cout << "All tests passed!" << std::endl;
     return 0;
 }
@@ -0,0 +1,89 @@
+#include "../code/http/http_upload.h"
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+
+// 在临时目录中测试上传的保存和 upload_dir 的配额
+
+const std::string BOUNDARY = "----WebKitFormBoundary7MA4YWxkTrZu0gW";
+
+std::string Multipart(const std::vector<std::string>& files) {
+    std::string body;
+    for (size_t i = 0; i < files.size(); ++i) {
+        body += "--" + BOUNDARY + "\r\n"
+                "Content-Disposition: form-data; name=\"file\"; filename=\"" + std::to_string(i) + ".png\"\r\n"
+                "Content-Type: image/png\r\n\r\n" + files[i] + "\r\n";
+    }
+    return body + "--" + BOUNDARY + "--\r\n";
+}
+
+// 和 HttpConnect 一样：Start 失败时不再读请求体，否则读完后 Finish
+int Upload(const std::string& content_type, const std::string& body) {
+    HttpUpload upload;
+    if (!upload.Start(content_type, body.size()))
+        return 400;
+    upload.Feed(body.data(), body.size());
+    return upload.Finish();
+}
+
+void RemoveAll(const std::string& dir) {
+    std::string cmd = "rm -rf " + dir;
+    assert(system(cmd.c_str()) == 0);
+}
+
+void TestSave(const std::string& dir) {
+    assert(HttpUpload::SetDir(dir));
+    assert(HttpUpload::UsedBytes() == 0 && HttpUpload::UsedFiles() == 0);
+    std::string multipart = "multipart/form-data; boundary=" + BOUNDARY;
+    assert(Upload(multipart, Multipart({"abc", "defgh"})) == 200);
+    assert(HttpUpload::UsedBytes() == 8 && HttpUpload::UsedFiles() == 2);
+    assert(Upload("image/png", "0123456789") == 200);
+    assert(HttpUpload::UsedBytes() == 18 && HttpUpload::UsedFiles() == 3);
+
+    // 格式错误时不保存，也不占用配额
+    assert(Upload(multipart, "--" + BOUNDARY + "\r\n") == 400);
+    assert(HttpUpload::UsedBytes() == 18 && HttpUpload::UsedFiles() == 3);
+
+    // 重新设置目录时以已有的文件作为用量
+    assert(HttpUpload::SetDir(dir));
+    assert(HttpUpload::UsedBytes() == 18 && HttpUpload::UsedFiles() == 3);
+}
+
+void TestQuota(const std::string& dir) {
+    assert(HttpUpload::SetDir(dir));
+    std::string multipart = "multipart/form-data; boundary=" + BOUNDARY;
+
+    // 按请求体长度预留，超过字节数上限时整个请求体丢弃
+    HttpUpload::max_total_bytes = 100;
+    std::string big(101, 'x');
+    assert(Upload("image/png", big) == 507);
+    assert(HttpUpload::UsedBytes() == 0 && HttpUpload::UsedFiles() == 0);
+    assert(Upload("image/png", std::string(100, 'x')) == 200);
+    assert(HttpUpload::UsedBytes() == 100 && HttpUpload::UsedFiles() == 1);
+    assert(Upload("image/png", "x") == 507);
+
+    // 超过文件数上限时，同一请求中已经保存的文件也删除
+    HttpUpload::max_total_bytes = 0;
+    HttpUpload::max_total_files = 2;
+    assert(Upload(multipart, Multipart({"a", "b"})) == 507);
+    assert(HttpUpload::UsedFiles() == 1);
+    assert(Upload(multipart, Multipart({"a"})) == 200);
+    assert(Upload("image/png", "x") == 507);
+    assert(HttpUpload::UsedBytes() == 101 && HttpUpload::UsedFiles() == 2);
+
+    // 目录中只剩已保存的文件，没有残留的临时文件
+    assert(HttpUpload::SetDir(dir));
+    assert(HttpUpload::UsedBytes() == 101 && HttpUpload::UsedFiles() == 2);
+    HttpUpload::max_total_files = 10000;
+}
+
+int main() {
+    char templ[] = "/tmp/http_upload_test_XXXXXX";
+    assert(mkdtemp(templ) != nullptr);
+    std::string root = templ;
+    TestSave(root + "/save");
+    TestQuota(root + "/quota");
+    RemoveAll(root);
+    std::cout << "All tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,274 @@
+#include "../code/log/log.h"
+#include <iostream>
+#include <cassert>
+#include <thread>
+#include <chrono>
+#include <cwchar>
+
+// 测试格式串解析
+void TestParseLogFormat() {
+    LogFormat fmt = ParseLogFormat("Client[%d][%s:%d] in, %zu bytes, %.2f%% %-*s");
+    assert(fmt.args.size() == 7);
+    assert(fmt.args[0] == LOG_ARG_INT);
+    assert(fmt.args[1] == LOG_ARG_STRING);
+    assert(fmt.args[3] == LOG_ARG_SIZE);
+    assert(fmt.args[4] == LOG_ARG_DOUBLE);
+    assert(fmt.args[5] == LOG_ARG_INT);   // '*' 宽度
+    assert(fmt.args[6] == LOG_ARG_STRING);
+
+    // 长度修饰符只让整型转换变宽，%c/%lc 按提升后的 int 传递，%ls 是宽字符串
+    fmt = ParseLogFormat("%c %lc %ls %lx %hhd %lf");
+    assert(fmt.args.size() == 6);
+    assert(fmt.args[0] == LOG_ARG_INT);
+    assert(fmt.args[1] == LOG_ARG_INT);
+    assert(fmt.args[2] == LOG_ARG_WSTRING);
+    assert(fmt.args[3] == LOG_ARG_LONG);
+    assert(fmt.args[4] == LOG_ARG_INT);
+    assert(fmt.args[5] == LOG_ARG_DOUBLE);
+}
+
+// 测试日志队列的非阻塞入队
+void TestBlockQueueOverflow() {
+    BlockQueue<int> queue(2);
+    assert(queue.try_push_back(1));
+    assert(queue.try_push_back(2));
+    assert(!queue.try_push_back(3));    // 满了，丢弃新元素
+    assert(queue.push_back_overwrite(4)); // 满了，丢弃最旧的元素
+    int item = 0;
+    assert(queue.pop(item) && item == 2);
+    assert(queue.pop(item) && item == 4);
+    assert(!queue.push_back_overwrite(5));
+    queue.close();
+    assert(queue.is_closed());
+    assert(!queue.try_push_back(6));
+}
+
+// 测试二进制日志写入后能还原为文本
+void TestBinaryLog() {
+    Log* logger = Log::GetInstance();
+    logger->Init(0, "./logs/", ".blog", 0, true); // 同步模式，便于立即读取
+    assert(logger->IsBinary());
+
+    LOG_INFO("Client[%d][%s:%d] in, user count: %d", 7, "127.0.0.1", 8080, 1);
+    LOG_WARN("filesize: %zu, ratio %.2f%%", (size_t)4096, 12.5);
+    logger->Write(2, "direct %s %ld", "write", 42L);
+    LOG_INFO("char %c%c %lc %-4ls| %lx %hhd", 'o', 'k', static_cast<wint_t>(L'w'), L"ws", 255L, 300);
+    logger->Flush();
+
+    time_t timer = time(nullptr);
+    struct tm t = *localtime(&timer);
+    char filename[256];
+    snprintf(filename, sizeof(filename), "./logs/%04d_%02d_%02d.blog",
+             t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
+    FILE* in = fopen(filename, "rb");
+    assert(in != nullptr);
+    FILE* out = tmpfile();
+    LogDecoder decoder;
+    assert(decoder.Decode(in, out));
+    assert(decoder.BadRecords() == 0);
+    fclose(in);
+
+    std::string text;
+    char line[512];
+    rewind(out);
+    while (fgets(line, sizeof(line), out))
+        text += line;
+    fclose(out);
+    assert(text.find("[INFO] : Client[7][127.0.0.1:8080] in, user count: 1\n") != std::string::npos);
+    assert(text.find("[WARN] : filesize: 4096, ratio 12.50%\n") != std::string::npos);
+    assert(text.find("[WARN] : direct write 42\n") != std::string::npos);
+    assert(text.find("[INFO] : char ok w ws  | ff 44\n") != std::string::npos);
+}
+
+// 目录下的文件名，按名字排序
+std::vector<std::string> ListFiles(const std::string& dir) {
+    std::vector<std::string> files;
+    DIR* d = opendir(dir.c_str());
+    assert(d);
+    while (struct dirent* entry = readdir(d)) {
+        if (entry->d_name[0] != '.')
+            files.push_back(entry->d_name);
+    }
+    closedir(d);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+// 清空并返回测试用的日志目录，路径以 / 结尾
+std::string PrepareDir(const char* name) {
+    mkdir("./logs/", 0777);
+    std::string dir = std::string("./logs/") + name + "/";
+    mkdir(dir.c_str(), 0777);
+    for (const std::string& file : ListFiles(dir))
+        unlink((dir + file).c_str());
+    return dir;
+}
+
+size_t CountLines(const std::string& file) {
+    FILE* fp = fopen(file.c_str(), "r");
+    assert(fp);
+    size_t lines = 0;
+    int c;
+    while ((c = fgetc(fp)) != EOF)
+        lines += c == '\n';
+    fclose(fp);
+    return lines;
+}
+
+// 等待归档线程处理完，目录下的文件满足 pred
+template <typename Pred>
+bool WaitFiles(const std::string& dir, Pred pred) {
+    for (int i = 0; i < 200; ++i) {
+        if (pred(ListFiles(dir)))
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+size_t CountGz(const std::vector<std::string>& files) {
+    size_t count = 0;
+    for (const std::string& file : files)
+        count += file.size() > 3 && file.compare(file.size() - 3, 3, ".gz") == 0;
+    return count;
+}
+
+// 测试按行数切换：同一天的文件依次编号
+void TestRotateByLines() {
+    std::string dir = PrepareDir("rotate_lines");
+    Log* logger = Log::GetInstance();
+    logger->Init(0, dir.c_str(), ".log", 0);
+    logger->SetRotation(0, 3, 0);
+    for (int i = 0; i < 7; ++i)
+        logger->Write(1, "line %d", i);
+    logger->Flush();
+
+    std::vector<std::string> files = ListFiles(dir);
+    assert(files.size() == 3);
+    size_t total = 0;
+    for (const std::string& file : files) {
+        size_t lines = CountLines(dir + file);
+        assert(lines == 3 || lines == 1);
+        total += lines;
+    }
+    assert(total == 7);
+    // 第一个文件不带序号，之后是 -1、-2
+    assert(files[0].find("-1.log") != std::string::npos);
+    assert(files[1].find("-2.log") != std::string::npos);
+    assert(CountLines(dir + files[1]) == 1); // 当前文件
+}
+
+// 测试按文件大小切换：写入前已达到上限就换文件，每个文件最多超出一行
+void TestRotateBySize() {
+    std::string dir = PrepareDir("rotate_size");
+    Log* logger = Log::GetInstance();
+    logger->Init(0, dir.c_str(), ".log", 0);
+    logger->SetRotation(200, 0, 0);
+    std::string payload(60, 'x');
+    for (int i = 0; i < 20; ++i)
+        logger->Write(1, "%s", payload.c_str());
+    logger->Flush();
+
+    std::vector<std::string> files = ListFiles(dir);
+    assert(files.size() > 3);
+    size_t total = 0;
+    for (const std::string& file : files) {
+        struct stat st;
+        assert(stat((dir + file).c_str(), &st) == 0);
+        assert(static_cast<size_t>(st.st_size) < 200 + 128);
+        total += CountLines(dir + file);
+    }
+    assert(total == 20);
+}
+
+// 测试按时间间隔切换
+void TestRotateByInterval() {
+    std::string dir = PrepareDir("rotate_interval");
+    Log* logger = Log::GetInstance();
+    // 从一秒的开头开始，两次写入之间不会跨过切换时间
+    time_t start = time(nullptr);
+    while (time(nullptr) == start)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    logger->Init(0, dir.c_str(), ".log", 0);
+    logger->SetRotation(0, 0, 1);
+    logger->Write(1, "before");
+    logger->Write(1, "before");
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    logger->Write(1, "after");
+    logger->Flush();
+
+    std::vector<std::string> files = ListFiles(dir);
+    assert(files.size() == 2);
+    assert(CountLines(dir + files[0]) + CountLines(dir + files[1]) == 3);
+}
+
+// 测试归档：切换下来的文件被 gzip 压缩，只保留最新的 keep_files 个
+void TestArchive() {
+    std::string dir = PrepareDir("archive");
+    Log* logger = Log::GetInstance();
+    logger->Init(0, dir.c_str(), ".log", 0);
+    logger->SetRotation(0, 2, 0);
+    logger->SetArchive(LOG_COMPRESS_GZIP, 0);
+    for (int i = 0; i < 6; ++i)
+        logger->Write(1, "archived %d", i);
+    logger->Flush();
+    // 两个切换下来的 .log.gz 加上当前文件
+    assert(WaitFiles(dir, [](const std::vector<std::string>& files) {
+        return files.size() == 3 && CountGz(files) == 2;
+    }));
+    std::vector<std::string> files = ListFiles(dir);
+    std::string text;
+    for (const std::string& file : files) {
+        if (!CountGz({file}))
+            continue;
+        gzFile in = gzopen((dir + file).c_str(), "rb");
+        assert(in);
+        char buf[1024];
+        int n = 0;
+        while ((n = gzread(in, buf, sizeof(buf))) > 0)
+            text.append(buf, n);
+        gzclose(in);
+    }
+    for (int i = 0; i < 4; ++i)
+        assert(text.find("archived " + std::to_string(i) + "\n") != std::string::npos);
+
+    // 只保留最新的 2 个历史文件，当前文件不计入
+    dir = PrepareDir("retention");
+    logger->Init(0, dir.c_str(), ".log", 0);
+    logger->SetArchive(LOG_COMPRESS_NONE, 2);
+    for (int i = 0; i < 10; ++i) {
+        logger->Write(1, "kept %d", i);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2)); // 修改时间区分先后
+    }
+    logger->Flush();
+    assert(WaitFiles(dir, [](const std::vector<std::string>& files) { return files.size() == 3; }));
+    files = ListFiles(dir);
+    std::string kept;
+    for (const std::string& file : files) {
+        FILE* fp = fopen((dir + file).c_str(), "r");
+        char line[256];
+        while (fgets(line, sizeof(line), fp))
+            kept += line;
+        fclose(fp);
+    }
+    // 10 行分在 5 个文件中，最旧的两个被删除
+    for (int i = 0; i < 4; ++i)
+        assert(kept.find("kept " + std::to_string(i) + "\n") == std::string::npos);
+    for (int i = 4; i < 10; ++i)
+        assert(kept.find("kept " + std::to_string(i) + "\n") != std::string::npos);
+
+    logger->SetArchive(LOG_COMPRESS_NONE, 0);
+    logger->SetRotation(0);
+}
+
+int main() {
+    TestParseLogFormat();
+    TestBlockQueueOverflow();
+    TestBinaryLog();
+    TestRotateByLines();
+    TestRotateBySize();
+    TestRotateByInterval();
+    TestArchive();
+    std::cout << "All tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,496 @@
+#include "mock_mysql.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mysql/mysql.h>
+#include <mysql/errmsg.h>
+
+namespace mock_mysql {
+
+namespace {
+
+const unsigned int PARSE_ERROR = 1064; // ER_PARSE_ERROR
+
+struct Conn {
+    std::string name;   // 连接的实例，host:port
+    int fds[2] = {-1, -1}; // fds[0] 交给调用方，fds[1] 为服务端一侧
+    bool gone = false;  // 服务端已关闭
+    bool stalled = false; // hang 时没有写入唤醒字节
+    unsigned int error = 0;
+    std::string error_text;
+    Result result;      // 最近一次查询的结果
+    MYSQL* connected = nullptr; // connect_start 的结果
+};
+
+struct Res {
+    Result result;
+    size_t next = 0;
+    std::vector<std::vector<char*>> rows; // 指向 result.rows 中的字符串
+    std::vector<MYSQL_FIELD> fields;
+};
+
+struct Stmt {
+    MYSQL* mysql;
+    std::string sql;
+    MYSQL_BIND* params = nullptr;
+    MYSQL_BIND* binds = nullptr;
+    Result result;
+    size_t next = 0;
+    unsigned int error = 0;
+    std::string error_text;
+};
+
+std::map<std::string, Server>& Servers() {
+    static std::map<std::string, Server> servers;
+    return servers;
+}
+
+std::map<MYSQL*, Conn>& Conns() {
+    static std::map<MYSQL*, Conn> conns;
+    return conns;
+}
+
+std::map<MYSQL_STMT*, Stmt>& Stmts() {
+    static std::map<MYSQL_STMT*, Stmt> stmts;
+    return stmts;
+}
+
+std::map<MYSQL_RES*, std::unique_ptr<Res>>& Results() {
+    static std::map<MYSQL_RES*, std::unique_ptr<Res>> results;
+    return results;
+}
+
+std::string Name(const char* host, unsigned int port) {
+    return std::string(host ? host : "localhost") + ":" + std::to_string(port);
+}
+
+void SetError(Conn& conn, unsigned int error, const std::string& text) {
+    conn.error = error;
+    conn.error_text = text;
+}
+
+// 建立连接的 socket；实例拒绝连接时 socket 仍然建立，结果在 _cont 时给出
+bool Open(MYSQL* mysql, const char* host, unsigned int port) {
+    Conn& conn = Conns()[mysql];
+    conn.name = Name(host, port);
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, conn.fds) < 0)
+        return false;
+    return true;
+}
+
+bool Accept(Conn& conn) {
+    Server& server = Servers()[conn.name];
+    if (server.down) {
+        SetError(conn, CR_CONN_HOST_ERROR, "Can't connect to MySQL server on " + conn.name);
+        return false;
+    }
+    server.connects++;
+    SetError(conn, 0, "");
+    return true;
+}
+
+// 开始一次需要等待的操作：服务端一侧写入一个字节，调用方等待 socket 可读
+int Begin(Conn& conn) {
+    if (conn.gone)
+        return MYSQL_WAIT_READ; // 读到 EOF 时完成
+    if (Servers()[conn.name].hang) {
+        conn.stalled = true;
+        return MYSQL_WAIT_READ;
+    }
+    char byte = 0;
+    ssize_t ret = write(conn.fds[1], &byte, 1);
+    (void)ret;
+    return MYSQL_WAIT_READ;
+}
+
+// 操作是否已完成：读到唤醒字节，或服务端已关闭
+bool Ready(Conn& conn) {
+    char byte;
+    ssize_t len = read(conn.fds[0], &byte, 1);
+    if (len == 1)
+        return true;
+    if (len == 0 || conn.gone) {
+        conn.gone = true;
+        SetError(conn, CR_SERVER_LOST, "Lost connection to MySQL server during query");
+        return true;
+    }
+    return false;
+}
+
+Result Run(Conn& conn, const std::string& sql, const std::vector<std::string>& params) {
+    Server& server = Servers()[conn.name];
+    server.queries++;
+    server.sqls.push_back(sql);
+    Result result;
+    if (server.handler)
+        result = server.handler(sql, params);
+    if (!result.ok && result.error == 0)
+        result.error = PARSE_ERROR;
+    return result;
+}
+
+void Finish(Conn& conn, const Result& result) {
+    conn.result = result;
+    if (result.ok)
+        SetError(conn, 0, "");
+    else
+        SetError(conn, result.error, "mock error " + std::to_string(result.error));
+}
+
+Conn* Find(MYSQL* mysql) {
+    auto it = Conns().find(mysql);
+    return it == Conns().end() ? nullptr : &it->second;
+}
+
+} // namespace
+
+Server& Instance(const std::string& host, int port) {
+    return Servers()[host + ":" + std::to_string(port)];
+}
+
+void Reset() {
+    Servers().clear();
+}
+
+void Kill(const std::string& host, int port) {
+    std::string name = host + ":" + std::to_string(port);
+    for (auto& item : Conns()) {
+        Conn& conn = item.second;
+        if (conn.name != name || conn.fds[1] < 0 || conn.gone)
+            continue;
+        close(conn.fds[1]);
+        conn.fds[1] = -1;
+        conn.gone = true;
+    }
+}
+
+void Release() {
+    for (auto& item : Conns()) {
+        Conn& conn = item.second;
+        if (!conn.stalled)
+            continue;
+        conn.stalled = false;
+        if (!conn.gone) {
+            char byte = 0;
+            ssize_t ret = write(conn.fds[1], &byte, 1);
+            (void)ret;
+        }
+    }
+}
+
+int Connections(const std::string& host, int port) {
+    std::string name = host + ":" + std::to_string(port);
+    int count = 0;
+    for (auto& item : Conns())
+        count += item.second.name == name && item.second.fds[0] >= 0 && !item.second.gone;
+    return count;
+}
+
+} // namespace mock_mysql
+
+using namespace mock_mysql;
+
+extern "C" {
+
+MYSQL* mysql_init(MYSQL* mysql) {
+    if (mysql == nullptr)
+        mysql = static_cast<MYSQL*>(calloc(1, sizeof(MYSQL)));
+    Conns()[mysql] = Conn();
+    return mysql;
+}
+
+int mysql_options(MYSQL*, enum mysql_option, const void*) {
+    return 0;
+}
+
+MYSQL* mysql_real_connect(MYSQL* mysql, const char* host, const char*, const char*, const char*,
+                          unsigned int port, const char*, unsigned long) {
+    if (!Open(mysql, host, port))
+        return nullptr;
+    Conn& conn = Conns()[mysql];
+    if (!Accept(conn))
+        return nullptr;
+    return mysql;
+}
+
+int mysql_real_connect_start(MYSQL** ret, MYSQL* mysql, const char* host, const char*, const char*,
+                             const char*, unsigned int port, const char*, unsigned long) {
+    *ret = nullptr;
+    if (!Open(mysql, host, port))
+        return 0;
+    Conn& conn = Conns()[mysql];
+    conn.connected = Accept(conn) ? mysql : nullptr;
+    char byte = 0;
+    ssize_t len = write(conn.fds[1], &byte, 1);
+    (void)len;
+    return MYSQL_WAIT_READ;
+}
+
+int mysql_real_connect_cont(MYSQL** ret, MYSQL* mysql, int) {
+    Conn& conn = Conns()[mysql];
+    if (!Ready(conn))
+        return MYSQL_WAIT_READ;
+    *ret = conn.connected;
+    return 0;
+}
+
+void mysql_close(MYSQL* mysql) {
+    auto it = Conns().find(mysql);
+    if (it == Conns().end())
+        return;
+    for (int fd : it->second.fds) {
+        if (fd >= 0)
+            close(fd);
+    }
+    Conns().erase(it);
+    free(mysql);
+}
+
+my_socket mysql_get_socket(MYSQL* mysql) {
+    Conn* conn = Find(mysql);
+    return conn ? conn->fds[0] : -1;
+}
+
+const char* mysql_error(MYSQL* mysql) {
+    Conn* conn = Find(mysql);
+    return conn ? conn->error_text.c_str() : "";
+}
+
+unsigned int mysql_errno(MYSQL* mysql) {
+    Conn* conn = Find(mysql);
+    return conn ? conn->error : 0;
+}
+
+unsigned int mysql_field_count(MYSQL* mysql) {
+    Conn* conn = Find(mysql);
+    return conn ? conn->result.columns.size() : 0;
+}
+
+int mysql_ping_start(int* ret, MYSQL* mysql) {
+    Conn& conn = Conns()[mysql];
+    Servers()[conn.name].pings++;
+    *ret = 1;
+    return Begin(conn);
+}
+
+int mysql_ping_cont(int* ret, MYSQL* mysql, int) {
+    Conn& conn = Conns()[mysql];
+    if (!Ready(conn))
+        return MYSQL_WAIT_READ;
+    if (!conn.gone && Servers()[conn.name].fail_ping)
+        SetError(conn, CR_SERVER_GONE_ERROR, "MySQL server has gone away");
+    else if (!conn.gone)
+        SetError(conn, 0, "");
+    *ret = conn.error ? 1 : 0;
+    return 0;
+}
+
+int mysql_real_query_start(int* ret, MYSQL* mysql, const char* query, unsigned long length) {
+    Conn& conn = Conns()[mysql];
+    *ret = 1;
+    if (!conn.gone)
+        Finish(conn, Run(conn, std::string(query, length), {}));
+    return Begin(conn);
+}
+
+int mysql_real_query_cont(int* ret, MYSQL* mysql, int) {
+    Conn& conn = Conns()[mysql];
+    if (!Ready(conn))
+        return MYSQL_WAIT_READ;
+    *ret = conn.gone || !conn.result.ok ? 1 : 0;
+    return 0;
+}
+
+int mysql_store_result_start(MYSQL_RES** ret, MYSQL* mysql) {
+    *ret = nullptr;
+    return Begin(Conns()[mysql]);
+}
+
+int mysql_store_result_cont(MYSQL_RES** ret, MYSQL* mysql, int) {
+    Conn& conn = Conns()[mysql];
+    if (!Ready(conn))
+        return MYSQL_WAIT_READ;
+    *ret = nullptr;
+    if (conn.gone || conn.result.columns.empty())
+        return 0;
+    MYSQL_RES* res = static_cast<MYSQL_RES*>(calloc(1, sizeof(MYSQL_RES)));
+    std::unique_ptr<Res> data(new Res());
+    data->result = conn.result;
+    for (auto& row : data->result.rows) {
+        std::vector<char*> values;
+        for (std::string& value : row)
+            values.push_back(&value[0]);
+        data->rows.push_back(std::move(values));
+    }
+    data->fields.resize(data->result.columns.size());
+    for (size_t i = 0; i < data->fields.size(); ++i) {
+        memset(&data->fields[i], 0, sizeof(MYSQL_FIELD));
+        data->fields[i].name = &data->result.columns[i][0];
+    }
+    Results()[res] = std::move(data);
+    *ret = res;
+    return 0;
+}
+
+MYSQL_ROW mysql_fetch_row(MYSQL_RES* res) {
+    Res& data = *Results()[res];
+    if (data.next >= data.rows.size())
+        return nullptr;
+    return data.rows[data.next++].data();
+}
+
+MYSQL_FIELD* mysql_fetch_fields(MYSQL_RES* res) {
+    return Results()[res]->fields.data();
+}
+
+void mysql_free_result(MYSQL_RES* res) {
+    Results().erase(res);
+    free(res);
+}
+
+MYSQL_STMT* mysql_stmt_init(MYSQL* mysql) {
+    MYSQL_STMT* stmt = static_cast<MYSQL_STMT*>(calloc(1, sizeof(MYSQL_STMT)));
+    Stmts()[stmt].mysql = mysql;
+    return stmt;
+}
+
+int mysql_stmt_prepare_start(int* ret, MYSQL_STMT* stmt, const char* query, unsigned long length) {
+    Stmt& data = Stmts()[stmt];
+    Conn& conn = Conns()[data.mysql];
+    data.sql.assign(query, length);
+    data.error = 0;
+    *ret = 1;
+    if (!conn.gone)
+        Servers()[conn.name].prepares++;
+    return Begin(conn);
+}
+
+int mysql_stmt_prepare_cont(int* ret, MYSQL_STMT* stmt, int) {
+    Stmt& data = Stmts()[stmt];
+    Conn& conn = Conns()[data.mysql];
+    if (!Ready(conn))
+        return MYSQL_WAIT_READ;
+    if (conn.gone) {
+        data.error = conn.error;
+        data.error_text = conn.error_text;
+    }
+    *ret = conn.gone ? 1 : 0;
+    return 0;
+}
+
+unsigned long mysql_stmt_param_count(MYSQL_STMT* stmt) {
+    const std::string& sql = Stmts()[stmt].sql;
+    return std::count(sql.begin(), sql.end(), '?');
+}
+
+my_bool mysql_stmt_bind_param(MYSQL_STMT* stmt, MYSQL_BIND* binds) {
+    Stmts()[stmt].params = binds;
+    return 0;
+}
+
+int mysql_stmt_execute_start(int* ret, MYSQL_STMT* stmt) {
+    Stmt& data = Stmts()[stmt];
+    Conn& conn = Conns()[data.mysql];
+    *ret = 1;
+    if (!conn.gone) {
+        std::vector<std::string> params;
+        for (unsigned long i = 0; i < mysql_stmt_param_count(stmt); ++i) {
+            const MYSQL_BIND& bind = data.params[i];
+            params.emplace_back(static_cast<const char*>(bind.buffer), *bind.length);
+        }
+        Finish(conn, Run(conn, data.sql, params));
+        data.result = conn.result;
+        data.next = 0;
+    }
+    return Begin(conn);
+}
+
+int mysql_stmt_execute_cont(int* ret, MYSQL_STMT* stmt, int) {
+    Stmt& data = Stmts()[stmt];
+    Conn& conn = Conns()[data.mysql];
+    if (!Ready(conn))
+        return MYSQL_WAIT_READ;
+    data.error = conn.error;
+    data.error_text = conn.error_text;
+    *ret = conn.gone || !data.result.ok ? 1 : 0;
+    return 0;
+}
+
+unsigned int mysql_stmt_field_count(MYSQL_STMT* stmt) {
+    return Stmts()[stmt].result.columns.size();
+}
+
+int mysql_stmt_store_result_start(int* ret, MYSQL_STMT* stmt) {
+    *ret = 1;
+    return Begin(Conns()[Stmts()[stmt].mysql]);
+}
+
+int mysql_stmt_store_result_cont(int* ret, MYSQL_STMT* stmt, int) {
+    Conn& conn = Conns()[Stmts()[stmt].mysql];
+    if (!Ready(conn))
+        return MYSQL_WAIT_READ;
+    *ret = conn.gone ? 1 : 0;
+    return 0;
+}
+
+my_bool mysql_stmt_bind_result(MYSQL_STMT* stmt, MYSQL_BIND* binds) {
+    Stmts()[stmt].binds = binds;
+    return 0;
+}
+
+int mysql_stmt_fetch(MYSQL_STMT* stmt) {
+    Stmt& data = Stmts()[stmt];
+    if (data.next >= data.result.rows.size())
+        return MYSQL_NO_DATA;
+    const std::vector<std::string>& row = data.result.rows[data.next++];
+    int ret = 0;
+    for (size_t i = 0; i < row.size(); ++i) {
+        MYSQL_BIND& bind = data.binds[i];
+        *bind.length = row[i].size();
+        if (bind.is_null)
+            *bind.is_null = 0;
+        memcpy(bind.buffer, row[i].data(), std::min<size_t>(row[i].size(), bind.buffer_length));
+        if (row[i].size() > bind.buffer_length)
+            ret = MYSQL_DATA_TRUNCATED;
+    }
+    return ret;
+}
+
+int mysql_stmt_fetch_column(MYSQL_STMT* stmt, MYSQL_BIND* bind, unsigned int column, unsigned long offset) {
+    Stmt& data = Stmts()[stmt];
+    const std::string& value = data.result.rows[data.next - 1][column];
+    size_t len = value.size() - offset;
+    memcpy(bind->buffer, value.data() + offset, std::min<size_t>(len, bind->buffer_length));
+    if (bind->length)
+        *bind->length = len;
+    return 0;
+}
+
+unsigned long long mysql_stmt_affected_rows(MYSQL_STMT* stmt) {
+    return Stmts()[stmt].result.affected;
+}
+
+my_bool mysql_stmt_free_result(MYSQL_STMT*) {
+    return 0;
+}
+
+my_bool mysql_stmt_close(MYSQL_STMT* stmt) {
+    Stmts().erase(stmt);
+    free(stmt);
+    return 0;
+}
+
+const char* mysql_stmt_error(MYSQL_STMT* stmt) {
+    return Stmts()[stmt].error_text.c_str();
+}
+
+unsigned int mysql_stmt_errno(MYSQL_STMT* stmt) {
+    return Stmts()[stmt].error;
+}
+
+} // extern "C"
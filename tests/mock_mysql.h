@@ -0,0 +1,45 @@
+#ifndef MOCK_MYSQL_H
+#define MOCK_MYSQL_H
+
+#include <string>
+#include <vector>
+#include <functional>
+
+// 测试用的 MariaDB 客户端库替身，链接到测试程序中代替 libmysqlclient，不需要数据库服务
+// 每个连接是一对本地 socket：非阻塞 API 的 _start 在服务端一侧写入一个字节后返回 MYSQL_WAIT_READ，
+// 事件循环等到 socket 可读后调用 _cont 完成，和真实的库一样经过 Epoller
+// 数据库实例按 host:port 区分，查询的结果由测试给出的 handler 决定
+namespace mock_mysql {
+
+struct Result {
+    bool ok = true;
+    unsigned int error = 0;       // ok 为 false 时的错误码，默认 ER_PARSE_ERROR
+    std::vector<std::string> columns; // 为空时没有结果集（INSERT 等）
+    std::vector<std::vector<std::string>> rows;
+    unsigned long long affected = 0;
+};
+
+// 文本协议的查询 params 为空
+using Handler = std::function<Result(const std::string& sql, const std::vector<std::string>& params)>;
+
+struct Server {
+    bool down = false;      // 拒绝新连接
+    bool fail_ping = false; // ping 失败（连接已被服务端断开）
+    bool hang = false;      // 查询不返回，直到 Release
+    Handler handler;        // 为空时所有查询成功且没有结果集
+    int connects = 0;       // 成功建立的连接数
+    int queries = 0;        // 收到的查询数（含预处理语句的执行）
+    int pings = 0;
+    int prepares = 0;
+    std::vector<std::string> sqls; // 收到的 SQL，按顺序
+};
+
+Server& Instance(const std::string& host, int port);
+void Reset(); // 清除所有实例的设置和统计，应在连接都关闭后调用
+void Kill(const std::string& host, int port); // 服务端关闭该实例上所有已建立的连接
+void Release(); // 让 hang 时卡住的查询继续
+int Connections(const std::string& host, int port); // 该实例上当前打开的连接数
+
+} // namespace mock_mysql
+
+#endif // MOCK_MYSQL_H
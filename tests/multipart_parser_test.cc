@@ -0,0 +1,104 @@
+#include "../code/http/multipart_parser.h"
+#include <iostream>
+#include <cassert>
+#include <vector>
+
+struct Part {
+    std::string name;
+    std::string filename;
+    std::string data;
+    bool closed = false;
+};
+
+// 按 step 字节一次喂给解析器，收集解析出的分段
+bool Parse(const std::string& boundary, const std::string& body, size_t step,
+           std::vector<Part>* parts, bool* done) {
+    MultipartParser parser;
+    parts->clear();
+    parser.Init(boundary,
+        [parts](const std::string& name, const std::string& filename) {
+            parts->push_back(Part());
+            parts->back().name = name;
+            parts->back().filename = filename;
+            return true;
+        },
+        [parts](const char* data, size_t len) {
+            parts->back().data.append(data, len);
+            return true;
+        },
+        [parts]() {
+            parts->back().closed = true;
+            return true;
+        });
+    bool ok = true;
+    for (size_t pos = 0; pos < body.size() && ok; pos += step)
+        ok = parser.Feed(body.data() + pos, std::min(step, body.size() - pos));
+    *done = parser.IsDone();
+    return ok;
+}
+
+const std::string BOUNDARY = "----WebKitFormBoundary7MA4YWxkTrZu0gW";
+
+std::string MakeBody(const std::string& file) {
+    return "preamble\r\n"
+           "--" + BOUNDARY + "\r\n"
+           "Content-Disposition: form-data; name=\"title\"\r\n"
+           "\r\n"
+           "hello\r\n"
+           "--" + BOUNDARY + "\r\n"
+           "Content-Disposition: form-data; name=\"picture\"; filename=\"a;b \\\"1\\\".jpg\"\r\n"
+           "Content-Type: image/jpeg\r\n"
+           "\r\n" + file + "\r\n"
+           "--" + BOUNDARY + "--\r\n"
+           "epilogue";
+}
+
+// 测试任意切分方式下都能得到同样的分段
+void TestSplit() {
+    // 文件内容中有回车换行和不完整的分隔符
+    std::string file = "\r\n--" + BOUNDARY.substr(0, 10) + "\r\r\n-\r\n--" + std::string("\0\xff", 2) +
+                       std::string(1000, 'x') + "\r";
+    std::string body = MakeBody(file);
+    for (size_t step = 1; step <= body.size(); step += (step < 80 ? 1 : 97)) {
+        std::vector<Part> parts;
+        bool done = false;
+        assert(Parse(BOUNDARY, body, step, &parts, &done));
+        assert(done);
+        assert(parts.size() == 2);
+        assert(parts[0].name == "title" && parts[0].filename == "" && parts[0].data == "hello");
+        assert(parts[1].name == "picture" && parts[1].filename == "a;b \"1\".jpg");
+        assert(parts[1].data == file);
+        assert(parts[0].closed && parts[1].closed);
+    }
+}
+
+// 测试没有结束分隔符和格式错误
+void TestIncomplete() {
+    std::vector<Part> parts;
+    bool done = false;
+    std::string body = MakeBody("abc");
+    assert(Parse(BOUNDARY, body.substr(0, body.size() - 20), 7, &parts, &done));
+    assert(!done);
+    assert(parts.size() == 2 && !parts[1].closed);
+
+    std::string bad = "--" + BOUNDARY + "xx\r\n";
+    assert(!Parse(BOUNDARY, bad, 3, &parts, &done));
+
+    std::string long_header = "--" + BOUNDARY + "\r\nX: " + std::string(10000, 'a') + "\r\n\r\n";
+    assert(!Parse(BOUNDARY, long_header, 512, &parts, &done));
+}
+
+void TestBoundary() {
+    assert(MultipartParser::GetBoundary("multipart/form-data; boundary=abc") == "abc");
+    assert(MultipartParser::GetBoundary("Multipart/Form-Data; boundary=\"a b\"; x=1") == "a b");
+    assert(MultipartParser::GetBoundary("application/x-www-form-urlencoded") == "");
+    assert(MultipartParser::GetBoundary("multipart/form-data") == "");
+}
+
+int main() {
+    TestSplit();
+    TestIncomplete();
+    TestBoundary();
+    std::cout << "All tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include "../code/auth/password_hasher.h"
+#include <iostream>
+#include <cassert>
+#include <mutex>
+#include <condition_variable>
+
+// 测试同步哈希和校验
+void TestHashNow() {
+    PasswordHasher* hasher = PasswordHasher::instance();
+    std::string hash = hasher->HashNow("123456");
+    assert(hash.compare(0, 8, "$scrypt$") == 0);
+    assert(hash != hasher->HashNow("123456")); // 每次盐不同
+    assert(PasswordHasher::VerifyNow("123456", hash));
+    assert(!PasswordHasher::VerifyNow("12345", hash));
+    assert(!PasswordHasher::VerifyNow("123456", "$scrypt$16384$8$1$zz$00"));
+    assert(PasswordHasher::VerifyNow("plain", "plain")); // 旧的明文记录
+    assert(!PasswordHasher::VerifyNow("plain", "plain2"));
+}
+
+// 测试线程池上的异步哈希和排队上限
+void TestAsync() {
+    PasswordHasher* hasher = PasswordHasher::instance();
+    hasher->Init(1, 2, 16384);
+    std::mutex mtx;
+    std::condition_variable cond;
+    int finished = 0, rejected = 0;
+    std::string hash;
+    for (int i = 0; i < 8; ++i) {
+        hasher->Hash("secret", [&](bool ok, const std::string& h) {
+            std::lock_guard<std::mutex> locker(mtx);
+            if (ok)
+                hash = h;
+            else
+                ++rejected;
+            ++finished;
+            cond.notify_all();
+        });
+    }
+    {
+        std::unique_lock<std::mutex> locker(mtx);
+        cond.wait(locker, [&] { return finished == 8; });
+    }
+    assert(rejected >= 1); // 超过排队上限的任务直接失败
+    assert(rejected <= 6);
+
+    bool matched = false;
+    finished = 0;
+    hasher->Verify("secret", hash, [&](bool ok, bool match) {
+        std::lock_guard<std::mutex> locker(mtx);
+        matched = ok && match;
+        ++finished;
+        cond.notify_all();
+    });
+    std::unique_lock<std::mutex> locker(mtx);
+    cond.wait(locker, [&] { return finished == 1; });
+    assert(matched);
+}
+
+int main() {
+    TestHashNow();
+    TestAsync();
+    std::cout << "All tests passed!" << std::endl;
+    return 0;
+}
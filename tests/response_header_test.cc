@@ -0,0 +1,91 @@
+#include "../code/http/response_header.h"
+#include <iostream>
+#include <cassert>
+
+std::string Make(int code, const std::string& path, bool keep_alive, int timeout_s, int max_requests, size_t len) {
+    Buffer buff;
+    ResponseHeader::instance()->Append(buff, code, ResponseHeader::MimeIndex(path), keep_alive,
+                                       timeout_s, max_requests, len);
+    return buff.RetrieveAllAsString();
+}
+
+// 去掉 Date 头部，其余内容逐字比较
+std::string WithoutDate(const std::string& head) {
+    size_t begin = head.find("Date: ");
+    assert(begin != std::string::npos);
+    size_t end = head.find("\r\n", begin);
+    return head.substr(0, begin) + head.substr(end + 2);
+}
+
+void TestHeader() {
+    assert(WithoutDate(Make(200, "/index.html", true, 60, 99, 1234)) ==
+           "HTTP/1.1 200 OK\r\n"
+           "Connection: keep-alive\r\n"
+           "Content-type: text/html\r\n"
+           "Keep-Alive: timeout=60, max=99\r\n"
+           "Content-length: 1234\r\n\r\n");
+    assert(WithoutDate(Make(404, "/404.html", false, 60, 99, 0)) ==
+           "HTTP/1.1 404 Not Found\r\n"
+           "Connection: close\r\n"
+           "Content-type: text/html\r\n"
+           "Content-length: 0\r\n\r\n");
+    assert(WithoutDate(Make(200, "/a.png", true, 0, 5, 1)).find("Keep-Alive: max=5\r\n") != std::string::npos);
+    assert(WithoutDate(Make(200, "/a.png", true, 7, 0, 1)).find("Keep-Alive: timeout=7\r\n") != std::string::npos);
+    assert(WithoutDate(Make(200, "/a.png", true, 0, 0, 1)).find("Keep-Alive") == std::string::npos);
+    // 未知的状态码和扩展名
+    std::string head = Make(999, "/noext", false, 0, 0, 18446744073709551615ULL);
+    assert(head.compare(0, 25, "HTTP/1.1 400 Bad Requeset") == 0);
+    assert(head.find("Content-type: text/plain\r\n") != std::string::npos);
+    assert(head.find("Content-length: 18446744073709551615\r\n\r\n") != std::string::npos);
+}
+
+std::string_view Type(const char* path) {
+    return ResponseHeader::MimeType(ResponseHeader::MimeIndex(path));
+}
+
+void TestMime() {
+    assert(Type("/a/b.c/x.jpg") == "image/jpeg");
+    assert(Type("/x.css") == "text/css");
+    assert(Type("/fonts/x.woff2") == "font/woff2");
+    assert(Type("/x.svg") == "image/svg+xml");
+    assert(Type("/x.webp") == "image/webp");
+    assert(Type("/x.mp4") == "video/mp4");
+    assert(Type("/x.json") == "application/json");
+    assert(Type("/x.wasm") == "application/wasm");
+    assert(Type("/X.JPG") == "image/jpeg"); // 不区分大小写
+    assert(Type("/x.unknown") == "text/plain");
+    assert(Type("/x.jpgx") == "text/plain");
+    assert(Type("/x.verylongsuffix") == "text/plain");
+    assert(Type("/noext") == "text/plain");
+    assert(Type("/x.") == "text/plain");
+    // 表中的每一项都能查到自己
+    for (int i = 0; i < http_tables::MIME_COUNT; ++i)
+        assert(ResponseHeader::MimeIndex(std::string("/a") + std::string(http_tables::MIMES[i].suffix)) == i);
+}
+
+void TestStatus() {
+    assert(ResponseHeader::Status(413) == "Payload Too Large");
+    assert(ResponseHeader::Status(302).empty() && ResponseHeader::Status(-1).empty());
+    assert(ResponseHeader::ErrorPage(404) == "/404.html");
+    assert(ResponseHeader::ErrorPage(200).empty() && ResponseHeader::ErrorPage(500).empty());
+    for (const http_tables::Status& status : http_tables::STATUSES)
+        assert(ResponseHeader::Status(status.code) == status.reason);
+}
+
+void TestDate() {
+    const std::string& date = ResponseHeader::Date();
+    // Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n
+    assert(date.size() == 37);
+    assert(date.compare(0, 6, "Date: ") == 0);
+    assert(date.compare(date.size() - 6, 6, " GMT\r\n") == 0);
+    assert(&ResponseHeader::Date() == &date); // 同一线程复用同一份缓存
+}
+
+int main() {
+    TestHeader();
+    TestMime();
+    TestStatus();
+    TestDate();
+    std::cout << "All tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "../code/http/router.h"
+#include <iostream>
+#include <cassert>
+#include <string>
+
+Router::Handler Noop() {
+    return [](HttpRequest&, HttpResponse&) {};
+}
+
+// 返回匹配到的模式，没有匹配时为空
+std::string Match(const Router& router, const char* method, const char* path, RouteParams* params) {
+    const Router::Route* route = router.Match(method, path, params);
+    return route ? route->pattern : "";
+}
+
+void TestStatic() {
+    Router router;
+    assert(router.Add("GET", "/", Noop()));
+    assert(router.Add("GET", "/index", Noop()));
+    assert(router.Add("GET", "/images", Noop()));
+    assert(router.Add("GET", "/img", Noop()));
+    assert(router.Add("POST", "/index", Noop()));
+    assert(!router.Add("GET", "/index", Noop())); // 重复
+    assert(!router.Add("GET", "index", Noop()));
+    assert(!router.Add("BREW", "/coffee", Noop()));
+
+    RouteParams params;
+    assert(Match(router, "GET", "/", &params) == "/");
+    assert(Match(router, "GET", "/index", &params) == "/index");
+    assert(Match(router, "GET", "/images", &params) == "/images");
+    assert(Match(router, "GET", "/img", &params) == "/img");
+    assert(Match(router, "GET", "/im", &params) == "");
+    assert(Match(router, "GET", "/indexx", &params) == "");
+    assert(Match(router, "GET", "", &params) == "");
+    assert(router.Match("POST", "/index", &params)->pattern == "/index");
+    assert(Match(router, "PUT", "/index", &params) == "");
+    assert(params.count == 0);
+}
+
+void TestParams() {
+    Router router;
+    assert(router.Add("GET", "/user/:id", Noop()));
+    assert(router.Add("GET", "/user/:id/posts/:post", Noop()));
+    assert(router.Add("GET", "/user/me", Noop()));
+    assert(router.Add("GET", "/static/*path", Noop()));
+    assert(!router.Add("GET", "/user/:name/x", Noop())); // 同一位置的参数名不同
+    assert(!router.Add("GET", "/a*b", Noop()));
+    assert(!router.Add("GET", "/files/*path/x", Noop()));
+    assert(!router.Add("GET", "/x/:", Noop()));
+
+    RouteParams params;
+    assert(Match(router, "GET", "/user/42", &params) == "/user/:id");
+    assert(params.count == 1 && params.Get("id") == "42" && params.Get("post").empty());
+    assert(Match(router, "GET", "/user/me", &params) == "/user/me"); // 静态段优先
+    assert(params.count == 0);
+    assert(Match(router, "GET", "/user/mee", &params) == "/user/:id"); // 静态段不匹配时回退到参数
+    assert(params.Get("id") == "mee");
+    assert(Match(router, "GET", "/user/7/posts/9", &params) == "/user/:id/posts/:post");
+    assert(params.count == 2 && params.Get("id") == "7" && params.Get("post") == "9");
+    assert(Match(router, "GET", "/user/7/posts", &params) == "");
+    assert(Match(router, "GET", "/user/", &params) == ""); // 参数不能为空
+    assert(Match(router, "GET", "/static/css/a.css", &params) == "/static/*path");
+    assert(params.count == 1 && params.Get("path") == "css/a.css");
+    assert(Match(router, "GET", "/static/", &params) == "/static/*path");
+    assert(params.Get("path").empty());
+}
+
+// 具体方法优先于 "*"，找不到时回退到通配路由
+void TestFallback() {
+    Router router;
+    assert(router.Add("*", "/*path", Noop()));
+    assert(router.Add("*", "/login", Noop()));
+    assert(router.Add("POST", "/login", Noop(), Router::STREAM_BODY));
+    assert(router.Add("GET", "/user/:id", Noop()));
+
+    RouteParams params;
+    const Router::Route* route = router.Match("POST", "/login", &params);
+    assert(route && route->pattern == "/login" && route->flags == Router::STREAM_BODY);
+    route = router.Match("GET", "/login", &params);
+    assert(route && route->pattern == "/login" && route->flags == 0);
+    assert(Match(router, "GET", "/login.html", &params) == "/*path");
+    assert(params.Get("path") == "login.html");
+    assert(Match(router, "POST", "/user/1", &params) == "/*path"); // 方法不符时回退，参数也被丢弃
+    assert(params.count == 1 && params.Get("id").empty() && params.Get("path") == "user/1");
+    assert(Match(router, "BREW", "/", &params) == "/*path");
+}
+
+void TestTooManyParams() {
+    Router router;
+    std::string pattern, path;
+    for (int i = 0; i <= RouteParams::MAX_PARAMS; ++i) {
+        pattern += "/:p" + std::to_string(i);
+        path += "/" + std::to_string(i);
+    }
+    assert(router.Add("GET", pattern, Noop()));
+    RouteParams params;
+    assert(Match(router, "GET", path.c_str(), &params) == "");
+}
+
+int main() {
+    TestStatic();
+    TestParams();
+    TestFallback();
+    TestTooManyParams();
+    std::cout << "All tests passed!" << std::endl;
+    return 0;
+}
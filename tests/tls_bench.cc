@@ -0,0 +1,201 @@
+#include "../code/tls/tls_connect.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <thread>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+// 回环上的发送吞吐基准：明文 writev、用户态 TLS（SSL_write）和 kTLS（writev，内核加密）
+// 服务端线程和 HttpConnect 一样用 TlsConnect 写出"响应头 + 文件内容"的 iovec，客户端线程读完全部数据；
+// 输出吞吐和服务端线程每 GB 消耗的 CPU 时间（含内核中的加密），内核没有 tls ULP 时 kTLS 一项跳过
+// 用法：tls_bench cert.pem key.pem [MB] [runs]
+// 证书可以用 openssl req -x509 -newkey rsa:2048 -nodes -keyout key.pem -out cert.pem -subj /CN=localhost 生成
+
+using Clock = std::chrono::steady_clock;
+
+enum MODE {
+    MODE_PLAIN,
+    MODE_TLS,
+    MODE_KTLS
+};
+
+const char* MODE_NAME[] = {"plaintext", "userspace TLS", "kTLS"};
+
+struct Result {
+    bool ok = false;
+    bool ktls = false;
+    double seconds = 0;
+    double server_cpu = 0;
+};
+
+double ThreadCpu() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 按块写出 total 字节的"文件"，每块前面有一个较短的"响应头"
+void Serve(int fd, MODE mode, size_t total, const std::string& file, Result* result) {
+    TlsConnect tls;
+    if (mode != MODE_PLAIN) {
+        tls.Init(fd);
+        int ret;
+        while ((ret = tls.Handshake()) == 0) {
+        }
+        if (ret < 0)
+            return;
+        result->ktls = tls.IsKtlsSend();
+        if (mode == MODE_KTLS && !result->ktls)
+            return;
+    }
+    std::string head(256, 'h');
+    double cpu = ThreadCpu();
+    size_t sent = 0;
+    int err = 0;
+    while (sent < total) {
+        size_t body = std::min(file.size(), total - sent);
+        std::vector<struct iovec> iov = {{&head[0], head.size()}, {const_cast<char*>(file.data()), body}};
+        size_t idx = 0, left = head.size() + body;
+        while (left > 0) {
+            ssize_t len = mode == MODE_PLAIN ? writev(fd, &iov[idx], iov.size() - idx)
+                                             : tls.Writev(&iov[idx], iov.size() - idx, &err);
+            if (len <= 0)
+                return;
+            left -= len;
+            size_t written = len;
+            while (idx < iov.size() && written >= iov[idx].iov_len) {
+                written -= iov[idx].iov_len;
+                ++idx;
+            }
+            if (written > 0) {
+                iov[idx].iov_base = static_cast<char*>(iov[idx].iov_base) + written;
+                iov[idx].iov_len -= written;
+            }
+        }
+        sent += body;
+    }
+    result->server_cpu = ThreadCpu() - cpu;
+    result->ok = true;
+    tls.Close();
+}
+
+Result Run(MODE mode, size_t total, const std::string& file) {
+    Result result;
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd, 1) < 0 ||
+        getsockname(listen_fd, (sockaddr*)&addr, &addr_len) < 0) {
+        std::cerr << "listen error: " << strerror(errno) << std::endl;
+        close(listen_fd);
+        return result;
+    }
+
+    // 文件内容加上每块响应头的长度才是客户端要读的总量
+    size_t chunks = (total + file.size() - 1) / file.size();
+    size_t expect = total + chunks * 256;
+    std::thread server([&]() {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0)
+            return;
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        Serve(fd, mode, total, file, &result);
+        close(fd);
+    });
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    SSL_CTX* ctx = nullptr;
+    SSL* ssl = nullptr;
+    Clock::time_point start;
+    size_t received = 0;
+    std::vector<char> buf(1 << 18);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0) {
+        if (mode != MODE_PLAIN) {
+            ctx = SSL_CTX_new(TLS_client_method());
+            ssl = SSL_new(ctx);
+            SSL_set_fd(ssl, fd);
+            if (SSL_connect(ssl) != 1)
+                received = expect + 1; // 握手失败
+        }
+        start = Clock::now();
+        while (received < expect) {
+            int n = ssl ? SSL_read(ssl, buf.data(), buf.size()) : read(fd, buf.data(), buf.size());
+            if (n <= 0)
+                break;
+            received += n;
+        }
+    }
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (ssl)
+        SSL_shutdown(ssl);
+    close(fd); // 服务端卡在握手或 kTLS 不可用时由此结束
+    server.join();
+    SSL_free(ssl);
+    SSL_CTX_free(ctx);
+    close(listen_fd);
+    result.ok = result.ok && received == expect;
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "usage: tls_bench cert.pem key.pem [MB] [runs]" << std::endl;
+        return 1;
+    }
+    size_t mb = argc > 3 ? std::max(atoi(argv[3]), 1) : 512;
+    int runs = argc > 4 ? std::max(atoi(argv[4]), 1) : 3;
+    signal(SIGPIPE, SIG_IGN);
+
+    std::string file(4 << 20, '\0'); // 一次写出的"文件"，4MB
+    for (size_t i = 0; i < file.size(); ++i)
+        file[i] = static_cast<char>(i * 131);
+    size_t total = mb << 20;
+
+    for (int mode = MODE_PLAIN; mode <= MODE_KTLS; ++mode) {
+        if (mode != MODE_PLAIN &&
+            !TlsContext::instance()->Init(argv[1], argv[2], mode == MODE_KTLS)) {
+            std::cerr << "load certificate error" << std::endl;
+            return 1;
+        }
+        if (mode == MODE_KTLS && !TlsContext::instance()->IsKtlsEnabled()) {
+            std::cout << MODE_NAME[mode] << ": unavailable (kernel has no tls ULP)" << std::endl;
+            continue;
+        }
+        double best = 0, cpu = 0;
+        bool ktls = false;
+        for (int i = 0; i < runs; ++i) {
+            Result result = Run(static_cast<MODE>(mode), total, file);
+            if (!result.ok) {
+                std::cout << MODE_NAME[mode] << ": failed" << (mode == MODE_KTLS ? " (kTLS not enabled for the cipher)" : "")
+                          << std::endl;
+                break;
+            }
+            double rate = mb / result.seconds;
+            if (rate > best) {
+                best = rate;
+                cpu = result.server_cpu;
+            }
+            ktls = result.ktls;
+        }
+        if (best > 0) {
+            printf("%-14s %9.1f MB/s  server cpu %7.1f ms/GB%s\n", MODE_NAME[mode], best,
+                   cpu * 1000 * 1024 / mb, mode != MODE_PLAIN && ktls ? "  (kTLS send)" : "");
+        }
+    }
+    return 0;
+}
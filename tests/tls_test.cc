@@ -0,0 +1,254 @@
+#include "../code/tls/tls_connect.h"
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include <openssl/pem.h>
+
+const char* CERT_FILE = "/tmp/tls_test_cert.pem";
+const char* KEY_FILE = "/tmp/tls_test_key.pem";
+
+// 生成自签名的 P-256 证书
+void MakeCert() {
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    assert(key);
+    X509* cert = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    assert(X509_sign(cert, key, EVP_sha256()) > 0);
+
+    FILE* fp = fopen(CERT_FILE, "w");
+    assert(fp && PEM_write_X509(fp, cert));
+    fclose(fp);
+    fp = fopen(KEY_FILE, "w");
+    assert(fp && PEM_write_PrivateKey(fp, key, nullptr, nullptr, 0, nullptr, nullptr));
+    fclose(fp);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+}
+
+// 一对非阻塞的 socket，服务端一侧交给 TlsConnect，客户端一侧直接用 OpenSSL
+struct Pair {
+    int fds[2];
+    TlsConnect server;
+    SSL* client;
+
+    Pair(SSL_CTX* ctx, SSL_SESSION* session = nullptr) {
+        assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        for (int fd : fds)
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        server.Init(fds[0]);
+        client = SSL_new(ctx);
+        SSL_set_fd(client, fds[1]);
+        SSL_set_connect_state(client);
+        if (session)
+            SSL_set_session(client, session);
+    }
+    ~Pair() {
+        server.Close();
+        SSL_shutdown(client); // 否则客户端把会话从缓存中删除，不能再用于恢复
+        SSL_free(client);
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    // 双方交替推进握手
+    bool Handshake() {
+        for (int i = 0; i < 32; ++i) {
+            int c = SSL_do_handshake(client);
+            if (c <= 0) {
+                int err = SSL_get_error(client, c);
+                if (err != SSL_ERROR_WANT_READ && err != SSL_ERROR_WANT_WRITE)
+                    return false;
+            }
+            int s = server.IsEstablished() ? 1 : server.Handshake();
+            if (s < 0)
+                return false;
+            if (c == 1 && s == 1)
+                return true;
+        }
+        return false;
+    }
+
+    // 客户端处理握手后的票据等消息，读出已到达的明文
+    std::string ClientRead() {
+        std::string data;
+        char buf[16384];
+        int n;
+        while ((n = SSL_read(client, buf, sizeof(buf))) > 0)
+            data.append(buf, n);
+        return data;
+    }
+};
+
+SSL_CTX* ClientCtx(const unsigned char* alpn, unsigned int alpn_len, int max_version = 0, bool tickets = true) {
+    SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT);
+    if (alpn)
+        SSL_CTX_set_alpn_protos(ctx, alpn, alpn_len);
+    if (max_version)
+        SSL_CTX_set_max_proto_version(ctx, max_version);
+    if (!tickets)
+        SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+    return ctx;
+}
+
+void TestInit() {
+    TlsContext* context = TlsContext::instance();
+    assert(!context->IsEnabled());
+    assert(!context->Init("/nonexistent/cert.pem", KEY_FILE));
+    assert(!context->IsEnabled());
+    assert(context->Init(CERT_FILE, KEY_FILE));
+    assert(context->IsEnabled());
+}
+
+// ALPN 优先选择 h2，客户端不支持时选 http/1.1
+void TestAlpn() {
+    static const unsigned char BOTH[] = "\x08http/1.1\x02h2";
+    static const unsigned char HTTP1[] = "\x08http/1.1";
+    static const unsigned char OTHER[] = "\x06spdy/3";
+    struct Case {
+        const unsigned char* protos;
+        unsigned int len;
+        const char* expect;
+    } cases[] = {{BOTH, sizeof(BOTH) - 1, "h2"}, {HTTP1, sizeof(HTTP1) - 1, "http/1.1"},
+                 {OTHER, sizeof(OTHER) - 1, ""}, {nullptr, 0, ""}};
+    for (const Case& c : cases) {
+        SSL_CTX* ctx = ClientCtx(c.protos, c.len);
+        {
+            Pair pair(ctx);
+            assert(pair.Handshake());
+            const unsigned char* alpn = nullptr;
+            unsigned int alpn_len = 0;
+            SSL_get0_alpn_selected(pair.client, &alpn, &alpn_len);
+            assert(std::string(reinterpret_cast<const char*>(alpn), alpn_len) == c.expect);
+            assert(!pair.server.IsKtlsSend()); // Unix socket 上不会开启 kTLS
+        }
+        SSL_CTX_free(ctx);
+    }
+}
+
+// 客户端的请求解密进读缓冲；响应头和内容分成多个 iovec，按写出的长度推进，直到全部写完
+void TestReadWrite() {
+    SSL_CTX* ctx = ClientCtx(nullptr, 0);
+    Pair pair(ctx);
+    assert(pair.Handshake());
+
+    Buffer buff;
+    int err = 0;
+    assert(pair.server.Read(buff, &err) == -1 && err == EAGAIN);
+    const char* request = "GET / HTTP/1.1\r\n\r\n";
+    assert(SSL_write(pair.client, request, strlen(request)) == (int)strlen(request));
+    assert(pair.server.Read(buff, &err) == (ssize_t)strlen(request));
+    assert(buff.RetrieveAllAsString() == request);
+
+    std::string head = "HTTP/1.1 200 OK\r\n\r\n";
+    std::string body(300000, '\0');
+    for (size_t i = 0; i < body.size(); ++i)
+        body[i] = static_cast<char>(i * 31);
+    std::string tail = "end";
+    std::vector<struct iovec> iov = {{&head[0], head.size()}, {&body[0], body.size()}, {&tail[0], tail.size()}};
+    size_t idx = 0, left = head.size() + body.size() + tail.size();
+    std::string received;
+    while (left > 0) {
+        ssize_t len = pair.server.Writev(&iov[idx], iov.size() - idx, &err);
+        if (len < 0) {
+            assert(err == EAGAIN); // 发送缓冲区满，客户端读走后重试
+            received += pair.ClientRead();
+            continue;
+        }
+        left -= len;
+        size_t written = len;
+        while (idx < iov.size() && written >= iov[idx].iov_len) {
+            written -= iov[idx].iov_len;
+            ++idx;
+        }
+        if (written > 0) {
+            iov[idx].iov_base = static_cast<char*>(iov[idx].iov_base) + written;
+            iov[idx].iov_len -= written;
+        }
+    }
+    received += pair.ClientRead();
+    assert(received == head + body + tail);
+
+    // close_notify 之后读到 0
+    assert(SSL_shutdown(pair.client) == 0);
+    assert(pair.server.Read(buff, &err) == 0);
+    SSL_CTX_free(ctx);
+}
+
+// TLS 1.3 用票据恢复，TLS 1.2 不用票据时按会话 ID 从服务端缓存恢复
+void TestResumption() {
+    struct Case {
+        int max_version;
+        bool tickets;
+    } cases[] = {{0, true}, {TLS1_2_VERSION, true}, {TLS1_2_VERSION, false}};
+    for (const Case& c : cases) {
+        SSL_CTX* ctx = ClientCtx(nullptr, 0, c.max_version, c.tickets);
+        SSL_SESSION* session = nullptr;
+        {
+            Pair pair(ctx);
+            assert(pair.Handshake());
+            assert(!pair.server.IsResumed());
+            pair.ClientRead(); // 收下 TLS 1.3 的票据
+            session = SSL_get1_session(pair.client);
+            assert(session && SSL_SESSION_is_resumable(session));
+            // 客户端不发 close_notify 直接断开，服务端的会话缓存仍然保留
+            SSL_set_shutdown(pair.client, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+            shutdown(pair.fds[1], SHUT_RDWR);
+            Buffer buff;
+            int err = 0;
+            assert(pair.server.Read(buff, &err) <= 0 && err != EAGAIN);
+        }
+        {
+            Pair pair(ctx, session);
+            assert(pair.Handshake());
+            assert(pair.server.IsResumed() && SSL_session_reused(pair.client));
+        }
+        SSL_SESSION_free(session);
+        SSL_CTX_free(ctx);
+    }
+}
+
+// 握手失败和未初始化的连接
+void TestFailure() {
+    int fds[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    TlsConnect server;
+    server.Init(fds[0]);
+    assert(server.IsActive() && server.Handshake() == 0 && !server.WantWrite());
+    const char* plain = "GET / HTTP/1.1\r\n\r\n";
+    assert(write(fds[1], plain, strlen(plain)) == (ssize_t)strlen(plain));
+    assert(server.Handshake() == -1);
+    server.Close();
+    assert(!server.IsActive() && !server.IsEstablished());
+    close(fds[0]);
+    close(fds[1]);
+}
+
+int main() {
+    signal(SIGPIPE, SIG_IGN); // 和服务端相同，对端断开后 OpenSSL 发送告警时得到 EPIPE
+    MakeCert();
+    TestInit();
+    TestAlpn();
+    TestReadWrite();
+    TestResumption();
+    TestFailure();
+    unlink(CERT_FILE);
+    unlink(KEY_FILE);
+    std::cout << "All tests passed!" << std::endl;
+    return 0;
+}
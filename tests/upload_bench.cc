@@ -0,0 +1,129 @@
+#include "../code/pool/wait_histogram.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+// 上传吞吐基准：多个线程不断地 建连 -> 上传一个文件 -> 读完响应 -> 关闭，
+// 统计每秒上传的数据量和单次上传的耗时分布
+// 用法：upload_bench [ip] [port] [seconds] [threads] [size_kb] [mode]
+// mode 0: multipart/form-data（服务端解析后写文件）；1: 请求体即文件内容（服务端用 splice 写文件）
+// 服务端需要先启动并调用 EnableUpload；上传的文件保存在服务端的上传目录中，测试后需要手动清理
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string ip = "127.0.0.1";
+    int port = 8080;
+    int seconds = 5;
+    int threads = 4;
+    int size_kb = 1024;
+    int mode = 0;
+};
+
+enum MODE {
+    MODE_MULTIPART,
+    MODE_RAW
+};
+
+const char* BOUNDARY = "----UploadBenchBoundary7MA4YWxkTrZu0gW";
+
+// 请求头和请求体只生成一次，所有线程共用
+std::string MakeRequest(const Options& opt) {
+    std::string file(static_cast<size_t>(opt.size_kb) * 1024, '\0');
+    for (size_t i = 0; i < file.size(); ++i)
+        file[i] = static_cast<char>(i * 131 + (i >> 12));
+    std::string body, type;
+    if (opt.mode == MODE_MULTIPART) {
+        body = std::string("--") + BOUNDARY + "\r\n"
+               "Content-Disposition: form-data; name=\"picture\"; filename=\"bench.jpg\"\r\n"
+               "Content-Type: image/jpeg\r\n\r\n" + file + "\r\n--" + BOUNDARY + "--\r\n";
+        type = std::string("multipart/form-data; boundary=") + BOUNDARY;
+    } else {
+        body = file;
+        type = "image/jpeg";
+    }
+    return "POST /upload HTTP/1.1\r\nHost: bench\r\nConnection: close\r\n"
+           "Content-Type: " + type + "\r\nContent-Length: " + std::to_string(body.size()) +
+           "\r\n\r\n" + body;
+}
+
+void Worker(const Options& opt, const std::string& req, std::atomic<bool>& stop,
+            std::atomic<long>& done, std::atomic<long>& failed, WaitHistogram& upload_time) {
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opt.port);
+    inet_pton(AF_INET, opt.ip.c_str(), &addr.sin_addr);
+    char buf[16384];
+
+    while (!stop) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            failed++;
+            continue;
+        }
+        linger lg = {1, 0};
+        setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+        Clock::time_point start = Clock::now();
+        bool ok = connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0;
+        for (size_t sent = 0; ok && sent < req.size();) {
+            ssize_t len = write(fd, req.data() + sent, req.size() - sent);
+            ok = len > 0;
+            sent += ok ? len : 0;
+        }
+        std::string resp;
+        ssize_t len = 0;
+        while (ok && (len = read(fd, buf, sizeof(buf))) > 0)
+            resp.append(buf, len);
+        close(fd);
+        if (ok && resp.compare(0, 12, "HTTP/1.1 200") == 0) {
+            upload_time.Record(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+            done++;
+        } else {
+            failed++;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    if (argc > 1) opt.ip = argv[1];
+    if (argc > 2) opt.port = atoi(argv[2]);
+    if (argc > 3) opt.seconds = atoi(argv[3]);
+    if (argc > 4) opt.threads = atoi(argv[4]);
+    if (argc > 5) opt.size_kb = std::max(atoi(argv[5]), 1);
+    if (argc > 6) opt.mode = std::min(std::max(atoi(argv[6]), 0), static_cast<int>(MODE_RAW));
+
+    std::string req = MakeRequest(opt);
+    std::atomic<bool> stop(false);
+    std::atomic<long> done(0), failed(0);
+    WaitHistogram upload_time;
+    std::vector<std::thread> threads;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < opt.threads; ++i)
+        threads.emplace_back(Worker, std::cref(opt), std::cref(req), std::ref(stop), std::ref(done),
+                             std::ref(failed), std::ref(upload_time));
+    std::this_thread::sleep_for(std::chrono::seconds(opt.seconds));
+    stop = true;
+    for (auto& thread : threads)
+        thread.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    const char* names[] = {"multipart", "raw"};
+    std::cout << names[opt.mode] << " " << opt.size_kb << "KB " << opt.ip << ":" << opt.port
+              << " threads=" << opt.threads << std::endl;
+    std::cout << "done=" << done << " failed=" << failed
+              << " rate=" << static_cast<long>(done / elapsed) << "/s"
+              << " throughput=" << static_cast<long>(done * opt.size_kb / 1024.0 / elapsed) << "MB/s" << std::endl;
+    std::cout << "upload " << upload_time.Summary() << std::endl;
+    return 0;
+}
@@ -0,0 +1,244 @@
+#include "../code/pool/upstream_pool.h"
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <poll.h>
+#include <arpa/inet.h>
+
+// 本地的上游桩：接受连接并保持，对 GET /health 按 healthy 回答 200 或 503 后关闭，其余数据忽略
+struct Stub {
+    int listen_fd;
+    int port;
+    std::atomic<int> accepts{0};
+    std::atomic<bool> healthy{true};
+    std::atomic<bool> drop{false}; // 关闭所有已接受的连接
+    std::atomic<bool> stop{false};
+    std::thread worker;
+
+    Stub() {
+        listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        assert(bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+        assert(listen(listen_fd, 64) == 0);
+        socklen_t len = sizeof(addr);
+        getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &len);
+        port = ntohs(addr.sin_port);
+        worker = std::thread([this]() { Run(); });
+    }
+
+    ~Stub() {
+        stop = true;
+        worker.join();
+        close(listen_fd);
+    }
+
+    std::string Name() const { return "127.0.0.1:" + std::to_string(port); }
+
+    void Run() {
+        std::vector<int> clients;
+        while (!stop) {
+            std::vector<pollfd> fds = {{listen_fd, POLLIN, 0}};
+            for (int fd : clients)
+                fds.push_back({fd, POLLIN, 0});
+            poll(fds.data(), fds.size(), 10);
+            bool dropping = drop.exchange(false);
+            std::vector<int> alive;
+            if (fds[0].revents & POLLIN) {
+                alive.push_back(accept(listen_fd, nullptr, nullptr));
+                ++accepts;
+            }
+            for (size_t i = 1; i < fds.size(); ++i) {
+                bool keep = !dropping;
+                if (keep && fds[i].revents) {
+                    char buf[1024];
+                    ssize_t len = read(fds[i].fd, buf, sizeof(buf));
+                    keep = len > 0;
+                    if (keep && std::string(buf, len).find("GET /health ") == 0) {
+                        std::string reply = healthy ? "HTTP/1.1 200 OK\r\n\r\n" : "HTTP/1.1 503 Unavailable\r\n\r\n";
+                        assert(write(fds[i].fd, reply.data(), reply.size()) == static_cast<ssize_t>(reply.size()));
+                        keep = false;
+                    }
+                }
+                if (keep)
+                    alive.push_back(fds[i].fd);
+                else
+                    close(fds[i].fd);
+            }
+            clients.swap(alive);
+        }
+        for (int fd : clients)
+            close(fd);
+    }
+};
+
+Epoller epoller;
+UpstreamPool* pool = UpstreamPool::instance();
+
+// 像 WebServer 的主循环一样处理连接池的事件和定时，直到 until 成立
+template <typename Pred>
+bool Pump(Pred until, int max_ms = 3000) {
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(max_ms);
+    while (!until()) {
+        if (std::chrono::steady_clock::now() >= end)
+            return false;
+        int tick = pool->GetNextTick();
+        int n = epoller.Wait(tick < 0 || tick > 10 ? 10 : tick);
+        for (int i = 0; i < n; ++i) {
+            int fd = epoller.GetEventsFd(i);
+            assert(pool->Owns(fd));
+            pool->OnEvent(fd, epoller.GetEvents(i), epoller.GetEventsTag(i));
+        }
+    }
+    return true;
+}
+
+// 同步地取一个连接
+UpstreamConnect* Get(int upstream) {
+    bool done = false;
+    UpstreamConnect* result = nullptr;
+    pool->Acquire(upstream, [&](UpstreamConnect* conn) { result = conn; done = true; }, []() {});
+    assert(Pump([&]() { return done; }));
+    return result;
+}
+
+void Put(UpstreamConnect* conn, UpstreamPool::RELEASE how) {
+    pool->Release(conn, how);
+    Pump([]() { return false; }, 20);
+}
+
+void TestRoundRobin() {
+    Stub stubs[3];
+    int up = pool->Add({stubs[0].Name(), stubs[1].Name(), stubs[2].Name()});
+    assert(up >= 0);
+    for (int i = 0; i < 6; ++i) {
+        UpstreamConnect* conn = Get(up);
+        assert(conn && conn->server == static_cast<size_t>(i % 3) && conn->requests == 0);
+        Put(conn, UpstreamPool::CLOSE);
+    }
+    for (Stub& stub : stubs)
+        assert(stub.accepts == 2);
+}
+
+// 放回的连接被下一个请求复用，不再建立新连接
+void TestReuse() {
+    Stub stub;
+    int up = pool->Add({stub.Name()});
+    UpstreamConnect* conn = Get(up);
+    int fd = conn->fd;
+    Put(conn, UpstreamPool::REUSE);
+    assert(pool->IdleCount(up, 0) == 1);
+    for (int i = 1; i <= 5; ++i) {
+        conn = Get(up);
+        assert(conn->fd == fd && conn->requests == i);
+        Put(conn, UpstreamPool::REUSE);
+    }
+    assert(stub.accepts == 1);
+
+    // 两个同时租出时第二个新建
+    UpstreamConnect* a = Get(up);
+    UpstreamConnect* b = Get(up);
+    assert(a->fd == fd && b->fd != fd);
+    Put(a, UpstreamPool::REUSE);
+    Put(b, UpstreamPool::REUSE);
+    assert(pool->IdleCount(up, 0) == 2 && stub.accepts == 2);
+    // 最近放回的先被取出
+    conn = Get(up);
+    assert(conn == b);
+    Put(conn, UpstreamPool::CLOSE);
+    assert(pool->IdleCount(up, 0) == 1);
+
+    // 上游关闭空闲连接后从池中移除
+    stub.drop = true;
+    assert(Pump([&]() { return pool->IdleCount(up, 0) == 0; }));
+}
+
+void TestLeastConn() {
+    Stub stubs[2];
+    int up = pool->Add({stubs[0].Name(), stubs[1].Name()}, UpstreamPool::LEAST_CONN);
+    UpstreamConnect* a = Get(up);
+    UpstreamConnect* b = Get(up);
+    assert(a->server == 0 && b->server == 1);
+    Put(b, UpstreamPool::REUSE);
+    // 服务器 0 还有一个租出的连接，轮询会选它
+    UpstreamConnect* c = Get(up);
+    assert(c->server == 1 && c == b);
+    Put(a, UpstreamPool::REUSE);
+    Put(c, UpstreamPool::REUSE);
+}
+
+// 建连失败的服务器立即暂停，请求改投其他服务器；全部不可用时得到 nullptr
+void TestConnectFail() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    socklen_t len = sizeof(addr);
+    getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+    std::string dead = "127.0.0.1:" + std::to_string(ntohs(addr.sin_port));
+    close(fd); // 端口上没有监听
+
+    Stub stub;
+    int up = pool->Add({dead, stub.Name()});
+    UpstreamConnect* conn = Get(up);
+    assert(conn && conn->server == 1);
+    assert(!pool->IsHealthy(up, 0));
+    Put(conn, UpstreamPool::CLOSE);
+
+    int alone = pool->Add({dead});
+    assert(Get(alone) == nullptr);
+    assert(Get(alone) == nullptr);
+
+    assert(pool->Add({"127.0.0.1"}) < 0);
+    assert(pool->Add({"127.0.0.1:99999"}) < 0);
+    assert(pool->Add({}) < 0);
+}
+
+// 连续出错的服务器暂停，直到健康检查通过
+void TestHealthCheck() {
+    Stub stubs[2];
+    int up = pool->Add({stubs[0].Name(), stubs[1].Name()});
+    assert(pool->SetHealthCheck(up, "/health", 30));
+    assert(!pool->SetHealthCheck(up, "health", 30));
+
+    stubs[1].healthy = false;
+    assert(Pump([&]() { return !pool->IsHealthy(up, 1); }));
+    for (int i = 0; i < 4; ++i) {
+        UpstreamConnect* conn = Get(up);
+        assert(conn->server == 0);
+        Put(conn, UpstreamPool::REUSE);
+    }
+    stubs[1].healthy = true;
+    assert(Pump([&]() { return pool->IsHealthy(up, 1); }));
+
+    // 出错的释放达到次数后暂停；没有检查路径时靠建连恢复
+    int plain = pool->Add({stubs[0].Name()});
+    assert(pool->SetHealthCheck(plain, "", 30));
+    for (int i = 0; i < 3; ++i) {
+        assert(pool->IsHealthy(plain, 0));
+        Put(Get(plain), UpstreamPool::FAIL);
+    }
+    assert(!pool->IsHealthy(plain, 0));
+    assert(Pump([&]() { return pool->IsHealthy(plain, 0); }));
+}
+
+int main() {
+    pool->Attach(&epoller);
+    pool->SetConnectTimeout(1000);
+    TestRoundRobin();
+    TestReuse();
+    TestLeastConn();
+    TestConnectFail();
+    TestHealthCheck();
+    pool->ClosePool();
+    std::cout << "All tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include "../code/cache/user_cache.h"
+#include <iostream>
+#include <cassert>
+#include <thread>
+
+// 测试正/负缓存和失效
+void TestLookup() {
+    UserCache* cache = UserCache::instance();
+    cache->Init(1024, 60000, 60000);
+    std::string password;
+    assert(cache->Get("alice", &password) == UserCache::MISS);
+
+    cache->Put("alice", "123");
+    assert(cache->Get("alice", &password) == UserCache::FOUND);
+    assert(password == "123");
+
+    cache->PutMissing("bob");
+    assert(cache->Get("bob", &password) == UserCache::NOT_FOUND);
+    cache->Put("bob", "456"); // 注册成功后覆盖负缓存
+    assert(cache->Get("bob", &password) == UserCache::FOUND);
+    assert(password == "456");
+
+    cache->Invalidate("alice");
+    assert(cache->Get("alice", &password) == UserCache::MISS);
+    cache->Clear();
+    assert(cache->Size() == 0);
+}
+
+// 测试过期
+void TestExpire() {
+    UserCache* cache = UserCache::instance();
+    cache->Init(1024, 20, 20);
+    cache->Put("alice", "123");
+    cache->PutMissing("bob");
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    assert(cache->Get("alice", nullptr) == UserCache::MISS);
+    assert(cache->Get("bob", nullptr) == UserCache::MISS);
+}
+
+// 测试容量上限和 LRU 淘汰
+void TestCapacity() {
+    UserCache* cache = UserCache::instance();
+    cache->Init(64, 60000, 60000);
+    for (int i = 0; i < 1000; ++i) {
+        std::string name = "user" + std::to_string(i);
+        cache->Put(name, name);
+        cache->Get("user0", nullptr); // 一直被访问，不应被淘汰
+    }
+    assert(cache->Size() <= 64);
+    assert(cache->Get("user0", nullptr) == UserCache::FOUND);
+    assert(cache->Get("user999", nullptr) == UserCache::FOUND);
+
+    cache->Init(0, 60000, 60000); // 关闭缓存
+    cache->Put("alice", "123");
+    assert(cache->Get("alice", nullptr) == UserCache::MISS);
+}
+
+int main() {
+    TestLookup();
+    TestExpire();
+    TestCapacity();
+    std::cout << "All tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include "../code/store/sqlite_user_store.h"
+#include "../code/store/batch_user_store.h"
+#include <iostream>
+#include <cassert>
+#include <unistd.h>
+#include <atomic>
+#include <thread>
+
+// 测试 SQLite 用户存储的查找、注册和重复注册
+void TestSqliteUserStore() {
+    const char* path = "./user_store_test.db";
+    unlink(path);
+    SqliteUserStore store(path);
+    assert(store.IsOpen());
+
+    bool called = false;
+    store.FindUser("alice", [&](bool ok, bool exists, const std::string&) {
+        assert(ok && !exists);
+        called = true;
+    });
+    assert(called); // 同步存储，回调已执行
+
+    store.AddUser("alice", "123", [](bool ok) { assert(ok); });
+    store.AddUser("alice", "456", [](bool ok) { assert(!ok); }); // 用户名已存在
+    store.FindUser("alice", [](bool ok, bool exists, const std::string& password) {
+        assert(ok && exists && password == "123");
+    });
+    store.FindUser("alice' OR '1'='1", [](bool ok, bool exists, const std::string&) {
+        assert(ok && !exists); // 参数按值绑定，不会被当作 SQL
+    });
+    unlink(path);
+    unlink("./user_store_test.db-wal");
+    unlink("./user_store_test.db-shm");
+}
+
+void RemoveDb(const char* path) {
+    unlink(path);
+    unlink((std::string(path) + "-wal").c_str());
+    unlink((std::string(path) + "-shm").c_str());
+}
+
+// 测试批量写入：整批一个事务，重复的用户名只影响该行
+void TestAddUsers() {
+    const char* path = "./user_store_batch_test.db";
+    RemoveDb(path);
+    SqliteUserStore store(path);
+    store.AddUser("carol", "0", [](bool ok) { assert(ok); });
+
+    UserStore::UserList users = {{"alice", "1"}, {"carol", "2"}, {"bob", "3"}, {"alice", "4"}};
+    std::vector<bool> results;
+    store.AddUsers(users, [&](const std::vector<bool>& r) { results = r; });
+    assert(results.size() == 4);
+    assert(results[0] && !results[1] && results[2] && !results[3]);
+    store.FindUser("alice", [](bool ok, bool exists, const std::string& password) {
+        assert(ok && exists && password == "1");
+    });
+    RemoveDb(path);
+}
+
+// 测试注册合并器：多线程并发注册，每个请求拿到自己那一行的结果
+void TestBatchUserStore() {
+    const char* path = "./user_store_batch_test.db";
+    RemoveDb(path);
+    std::atomic<int> succeeded(0), failed(0);
+    {
+        BatchUserStore store(std::unique_ptr<UserStore>(new SqliteUserStore(path)), 16, 5);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&store, &succeeded, &failed]() {
+                for (int i = 0; i < 50; ++i) { // 4 个线程注册同一批用户名，每个只能成功一次
+                    store.AddUser("user" + std::to_string(i), "pwd", [&](bool ok) {
+                        ok ? ++succeeded : ++failed;
+                    });
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+    } // 析构时写完队列中剩余的用户
+    assert(succeeded == 50);
+    assert(failed == 150);
+
+    SqliteUserStore check(path);
+    check.FindUser("user49", [](bool ok, bool exists, const std::string&) {
+        assert(ok && exists);
+    });
+    RemoveDb(path);
+}
+
+int main() {
+    TestSqliteUserStore();
+    TestAddUsers();
+    TestBatchUserStore();
+    std::cout << "All tests passed!" << std::endl;
+    return 0;
+}
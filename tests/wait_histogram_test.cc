@@ -0,0 +1,58 @@
+#include "../code/pool/wait_histogram.h"
+#include <iostream>
+#include <cassert>
+#include <thread>
+
+// 测试分桶边界
+void TestBucket() {
+    WaitHistogram hist;
+    hist.Record(0);    // 桶 0
+    hist.Record(1);    // 桶 1: [1, 2)
+    hist.Record(3);    // 桶 2: [2, 4)
+    hist.Record(4);    // 桶 3: [4, 8)
+    hist.Record(int64_t(1) << 40); // 最后一个桶
+    std::vector<uint64_t> counts = hist.Snapshot();
+    assert(counts.size() == WaitHistogram::BUCKET_COUNT);
+    assert(counts[0] == 1 && counts[1] == 1 && counts[2] == 1 && counts[3] == 1);
+    assert(counts[WaitHistogram::BUCKET_COUNT - 1] == 1);
+    assert(hist.Count() == 5);
+    hist.Reset();
+    assert(hist.Count() == 0);
+}
+
+// 测试百分位
+void TestPercentile() {
+    WaitHistogram hist;
+    assert(WaitHistogram::Percentile(hist.Snapshot(), 50) == 0);
+    for (int i = 0; i < 99; ++i)
+        hist.Record(10); // 桶 [8, 16)
+    hist.Record(5000);   // 桶 [4096, 8192)
+    std::vector<uint64_t> counts = hist.Snapshot();
+    assert(WaitHistogram::Percentile(counts, 50) == 16);
+    assert(WaitHistogram::Percentile(counts, 99) == 16);
+    assert(WaitHistogram::Percentile(counts, 100) == 8192);
+    std::cout << hist.Summary() << std::endl;
+}
+
+// 测试多线程并发记录
+void TestConcurrent() {
+    WaitHistogram hist;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&hist, t] {
+            for (int i = 0; i < 10000; ++i)
+                hist.Record(i * (t + 1));
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    assert(hist.Count() == 40000);
+}
+
+int main() {
+    TestBucket();
+    TestPercentile();
+    TestConcurrent();
+    std::cout << "All tests passed!" << std::endl;
+    return 0;
+}
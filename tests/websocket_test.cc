@@ -0,0 +1,296 @@
+#include "../code/http/websocket.h"
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// 客户端的帧：带掩码，opcode 为 0 时是延续帧
+std::string ClientFrame(uint8_t opcode, std::string_view payload, bool fin = true, uint8_t first = 0) {
+    static const uint8_t MASK[4] = {0x37, 0xfa, 0x21, 0x3d};
+    std::string frame;
+    frame.push_back(static_cast<char>((fin ? 0x80 : 0) | first | opcode));
+    size_t len = payload.size();
+    if (len < 126) {
+        frame.push_back(static_cast<char>(0x80 | len));
+    } else if (len <= 0xffff) {
+        frame.push_back(static_cast<char>(0x80 | 126));
+        frame.push_back(static_cast<char>(len >> 8));
+        frame.push_back(static_cast<char>(len));
+    } else {
+        frame.push_back(static_cast<char>(0x80 | 127));
+        for (int shift = 56; shift >= 0; shift -= 8)
+            frame.push_back(static_cast<char>(static_cast<uint64_t>(len) >> shift));
+    }
+    frame.append(reinterpret_cast<const char*>(MASK), 4);
+    for (size_t i = 0; i < len; ++i)
+        frame.push_back(static_cast<char>(payload[i] ^ MASK[i & 3]));
+    return frame;
+}
+
+std::string CloseCode(uint16_t code) {
+    return std::string{static_cast<char>(code >> 8), static_cast<char>(code)};
+}
+
+// 记录回调的一个连接
+struct Peer {
+    std::vector<std::string> messages;
+    std::vector<uint16_t> closes;
+    int wakes = 0;
+    std::shared_ptr<WebSocket> ws;
+
+    Peer() {
+        auto handler = std::make_shared<WebSocketHandler>();
+        handler->on_message = [this](const std::shared_ptr<WebSocket>&, std::string& message, bool binary) {
+            messages.push_back((binary ? "b:" : "t:") + message);
+        };
+        handler->on_close = [this](const std::shared_ptr<WebSocket>&, uint16_t code) { closes.push_back(code); };
+        ws = std::make_shared<WebSocket>(handler, [this]() { ++wakes; });
+        ws->Open();
+    }
+
+    void Feed(const std::string& data) {
+        Buffer buff;
+        buff.Append(data);
+        ws->Process(buff);
+    }
+
+    std::vector<WebSocket::Frame> Take() {
+        std::vector<WebSocket::Frame> frames;
+        ws->TakeFrames(&frames, 1024);
+        return frames;
+    }
+};
+
+void TestHandshake() {
+    // RFC 6455 1.3 的例子
+    assert(WebSocket::AcceptKey("dGhlIHNhbXBsZSBub25jZQ==") == "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+    assert(WebSocket::IsValidKey("dGhlIHNhbXBsZSBub25jZQ=="));
+    assert(!WebSocket::IsValidKey("dGhlIHNhbXBsZSBub25jZQ="));
+    assert(!WebSocket::IsValidKey("dGhlIHNhbXBsZSBub25jZ$=="));
+    assert(!WebSocket::IsValidKey(""));
+}
+
+// 向量化的去掩码和逐字节异或结果相同，各种长度和起始对齐
+void TestUnmask() {
+    const uint8_t mask[4] = {0x12, 0x34, 0x56, 0x78};
+    std::string origin(300, '\0');
+    for (size_t i = 0; i < origin.size(); ++i)
+        origin[i] = static_cast<char>(i * 7 + 3);
+    for (size_t offset = 0; offset < 4; ++offset) {
+        for (size_t len = 0; len + offset <= origin.size(); len += 1 + len / 8) {
+            std::string data = origin;
+            WebSocket::Unmask(&data[offset], len, mask);
+            for (size_t i = 0; i < origin.size(); ++i) {
+                bool inside = i >= offset && i < offset + len;
+                assert(data[i] == (inside ? static_cast<char>(origin[i] ^ mask[(i - offset) & 3]) : origin[i]));
+            }
+            WebSocket::Unmask(&data[offset], len, mask);
+            assert(data == origin);
+        }
+    }
+}
+
+void TestUtf8() {
+    const char* valid[] = {"", "hello, world", "κόσμε", "中文消息", "\xf0\x9f\x98\x80", "\xef\xbf\xbf",
+                           "\xf4\x8f\xbf\xbf", "0123456789abcdef\xc2\xa9"};
+    for (const char* s : valid)
+        assert(WebSocket::IsValidUtf8(s, strlen(s)));
+    const char* invalid[] = {"\x80", "\xc0\xaf", "\xc1\xbf", "\xe0\x80\xaf", "\xed\xa0\x80", "\xf4\x90\x80\x80",
+                             "\xf5\x80\x80\x80", "\xe2\x82", "abcdefgh\xe2\x82", "abcdefghij\xff", "\xc2\x41"};
+    for (const char* s : invalid)
+        assert(!WebSocket::IsValidUtf8(s, strlen(s)));
+}
+
+void TestMakeFrame() {
+    struct Case {
+        size_t len;
+        size_t head;
+    } cases[] = {{0, 2}, {125, 2}, {126, 4}, {65535, 4}, {65536, 10}};
+    for (const Case& c : cases) {
+        std::string payload(c.len, 'x');
+        WebSocket::Frame frame = WebSocket::MakeFrame(WebSocket::TEXT, payload);
+        assert(frame->size() == c.head + c.len);
+        assert(static_cast<uint8_t>((*frame)[0]) == 0x81);
+        assert(frame->compare(c.head, c.len, payload) == 0);
+    }
+    WebSocket::Frame close = WebSocket::MakeClose(WebSocket::NORMAL, "bye");
+    assert(*close == std::string("\x88\x05", 2) + CloseCode(1000) + "bye");
+    assert(*WebSocket::MakeClose(WebSocket::NO_STATUS, "") == std::string("\x88\x00", 2));
+}
+
+void TestMessages() {
+    Peer peer;
+    // RFC 6455 5.7 的例子：带掩码的 "Hello"
+    peer.Feed(std::string("\x81\x85\x37\xfa\x21\x3d\x7f\x9f\x4d\x51\x58", 11));
+    assert(peer.messages.size() == 1 && peer.messages[0] == "t:Hello");
+
+    // 分片之间插入 ping，ping 立即应答，消息在最后一片到达时给出
+    peer.Feed(ClientFrame(WebSocket::TEXT, "Hel", false) + ClientFrame(WebSocket::PING, "p") +
+              ClientFrame(WebSocket::CONTINUATION, "lo", true));
+    assert(peer.messages.size() == 2 && peer.messages[1] == "t:Hello");
+    std::vector<WebSocket::Frame> frames = peer.Take();
+    assert(frames.size() == 1 && *frames[0] == *WebSocket::MakeFrame(WebSocket::PONG, "p"));
+
+    // 扩展长度，逐字节到达
+    std::string big(70000, '\0');
+    for (size_t i = 0; i < big.size(); ++i)
+        big[i] = static_cast<char>(i);
+    std::string data = ClientFrame(WebSocket::BINARY, std::string(200, 'a')) + ClientFrame(WebSocket::BINARY, big);
+    Buffer buff;
+    for (size_t i = 0; i < data.size(); ++i) {
+        buff.Append(&data[i], 1);
+        peer.ws->Process(buff);
+        if (i + 1 < 200 + 8)
+            assert(peer.messages.size() == 2);
+    }
+    assert(buff.ReadableBytes() == 0);
+    assert(peer.messages.size() == 4);
+    assert(peer.messages[2] == "b:" + std::string(200, 'a') && peer.messages[3] == "b:" + big);
+    assert(!peer.ws->IsDone() && peer.ws->IsOpen());
+}
+
+// 对端发起关闭时原样回应关闭码；服务端发起关闭时等待对端回应
+void TestCloseHandshake() {
+    {
+        Peer peer;
+        peer.Feed(ClientFrame(WebSocket::CLOSE, CloseCode(1001) + "gone") + ClientFrame(WebSocket::TEXT, "late"));
+        assert(peer.ws->IsDone() && !peer.ws->IsOpen() && peer.messages.empty());
+        std::vector<WebSocket::Frame> frames = peer.Take();
+        assert(frames.size() == 1 && *frames[0] == *WebSocket::MakeClose(1001, ""));
+        assert(!peer.ws->Send("after close"));
+        peer.ws->Shutdown();
+        peer.ws->Shutdown();
+        assert(peer.closes.size() == 1 && peer.closes[0] == 1001);
+    }
+    {
+        Peer peer;
+        peer.ws->Close(WebSocket::GOING_AWAY, "restart");
+        assert(!peer.ws->IsOpen() && !peer.ws->IsDone());
+        assert(peer.Take().size() == 1);
+        peer.Feed(ClientFrame(WebSocket::CLOSE, ""));
+        assert(peer.ws->IsDone() && peer.Take().empty());
+        peer.ws->Shutdown();
+        assert(peer.closes.size() == 1 && peer.closes[0] == WebSocket::NO_STATUS);
+    }
+}
+
+// 协议错误时发送对应的关闭码，不等待回应
+void TestProtocolErrors() {
+    size_t max_message_size = WebSocket::max_message_size;
+    WebSocket::max_message_size = 1000;
+    std::string unmasked("\x81\x02hi", 4);
+    struct Case {
+        std::string data;
+        uint16_t code;
+    } cases[] = {
+        {unmasked, WebSocket::PROTOCOL_ERROR},
+        {ClientFrame(WebSocket::TEXT, "rsv", true, 0x40), WebSocket::PROTOCOL_ERROR},
+        {ClientFrame(WebSocket::CONTINUATION, "x"), WebSocket::PROTOCOL_ERROR},
+        {ClientFrame(WebSocket::TEXT, "a", false) + ClientFrame(WebSocket::TEXT, "b"), WebSocket::PROTOCOL_ERROR},
+        {ClientFrame(0x3, "x"), WebSocket::PROTOCOL_ERROR},
+        {ClientFrame(WebSocket::PING, "x", false), WebSocket::PROTOCOL_ERROR},
+        {ClientFrame(WebSocket::PING, std::string(126, 'x')), WebSocket::PROTOCOL_ERROR},
+        {ClientFrame(WebSocket::CLOSE, "x"), WebSocket::PROTOCOL_ERROR},
+        {ClientFrame(WebSocket::CLOSE, CloseCode(1005)), WebSocket::PROTOCOL_ERROR},
+        {ClientFrame(WebSocket::CLOSE, CloseCode(1000) + "\xff"), WebSocket::PROTOCOL_ERROR},
+        {ClientFrame(WebSocket::TEXT, "\xc0\xaf"), WebSocket::INVALID_DATA},
+        {ClientFrame(WebSocket::TEXT, "\xe2\x82", false) + ClientFrame(WebSocket::CONTINUATION, "\xac"), 0},
+        {ClientFrame(WebSocket::BINARY, std::string(1001, 'x')), WebSocket::MESSAGE_TOO_BIG},
+        {ClientFrame(WebSocket::TEXT, std::string(600, 'x'), false) + ClientFrame(WebSocket::CONTINUATION, std::string(600, 'x')),
+         WebSocket::MESSAGE_TOO_BIG},
+    };
+    for (const Case& c : cases) {
+        Peer peer;
+        peer.Feed(c.data);
+        std::vector<WebSocket::Frame> frames = peer.Take();
+        if (c.code == 0) { // 跨分片的多字节字符是合法的
+            assert(peer.messages.size() == 1 && peer.messages[0] == "t:\xe2\x82\xac");
+            assert(frames.empty() && !peer.ws->IsDone());
+            continue;
+        }
+        assert(peer.messages.empty() && peer.ws->IsDone());
+        assert(frames.size() == 1 && frames[0]->size() >= 4 && frames[0]->compare(2, 2, CloseCode(c.code)) == 0);
+    }
+    WebSocket::max_message_size = max_message_size;
+}
+
+// 停放的连接收到其他线程的消息时唤醒一次；工作线程重新注册前发现新的帧时继续处理
+void TestPark() {
+    Peer peer;
+    int arms = 0;
+    auto arm = [&arms]() { ++arms; };
+    assert(peer.ws->Park(true, arm) && arms == 1);
+    assert(peer.ws->Send("one") && peer.wakes == 1);
+    assert(peer.ws->Send("two") && peer.wakes == 1); // 已被唤醒，由处理它的线程一起取走
+    assert(!peer.ws->Unpark(false, false)); // 主线程的事件丢弃
+    assert(!peer.ws->Park(true, arm) && arms == 1);
+    assert(peer.Take().size() == 2);
+    assert(peer.ws->Park(false, arm) && arms == 2);
+    assert(!peer.ws->Unpark(false, false)); // 上一次注册的读事件，现在等待写
+    assert(peer.ws->Unpark(false, true) && !peer.ws->Unpark(false, true));
+    assert(peer.ws->Park(false, arm));
+    assert(peer.ws->Unpark(true, false)); // 连接断开的事件总是处理
+
+    // ping 之后没有任何数据，下一次到期时关闭
+    assert(peer.ws->Park(true, arm));
+    assert(peer.ws->Ping() && peer.wakes == 2);
+    std::vector<WebSocket::Frame> frames = peer.Take();
+    assert(frames.size() == 1 && *frames[0] == *WebSocket::MakeFrame(WebSocket::PING, ""));
+    assert(peer.ws->Ping()); // 正在处理，不关闭
+    peer.Feed(ClientFrame(WebSocket::PONG, ""));
+    assert(peer.ws->Park(true, arm));
+    assert(peer.ws->Ping() && peer.wakes == 3);
+    peer.Take();
+    assert(peer.ws->Park(true, arm));
+    assert(!peer.ws->Ping());
+    assert(peer.ws->Send("x") && peer.wakes == 3); // 已由定时器取消停放，不再唤醒
+}
+
+// 广播的帧只编码一次，所有连接共享；已关闭的连接从频道中移除
+void TestChannel() {
+    WebSocketChannel channel;
+    Peer peers[3];
+    for (Peer& peer : peers)
+        channel.Join(peer.ws);
+    assert(channel.Size() == 3);
+    assert(channel.Broadcast("news") == 3);
+    const std::string* shared = nullptr;
+    for (Peer& peer : peers) {
+        std::vector<WebSocket::Frame> frames = peer.Take();
+        assert(frames.size() == 1 && *frames[0] == *WebSocket::MakeFrame(WebSocket::TEXT, "news"));
+        assert(!shared || frames[0].get() == shared);
+        shared = frames[0].get();
+    }
+    peers[1].ws->Shutdown();
+    assert(channel.Broadcast("more", true) == 2 && channel.Size() == 2);
+    channel.Leave(peers[0].ws);
+    assert(channel.Size() == 1);
+
+    // 对端不读时积压超过上限，丢弃消息并以 1008 关闭
+    WebSocket::Frame big = WebSocket::MakeFrame(WebSocket::BINARY, std::string(1 << 20, 'x'));
+    Peer& slow = peers[2];
+    slow.Take();
+    size_t posted = 0;
+    while (slow.ws->Post(big))
+        ++posted;
+    assert(posted == WebSocket::MAX_PENDING_BYTES / big->size());
+    assert(slow.ws->IsDone() && !slow.ws->IsOpen());
+    std::vector<WebSocket::Frame> frames = slow.Take();
+    assert(frames.size() == 1 && frames[0]->compare(2, 2, CloseCode(WebSocket::POLICY_VIOLATION)) == 0);
+    assert(channel.Broadcast("gone") == 0 && channel.Size() == 0);
+}
+
+int main() {
+    TestHandshake();
+    TestUnmask();
+    TestUtf8();
+    TestMakeFrame();
+    TestMessages();
+    TestCloseHandshake();
+    TestProtocolErrors();
+    TestPark();
+    TestChannel();
+    std::cout << "All tests passed!" << std::endl;
+    return 0;
+}